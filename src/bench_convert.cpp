@@ -0,0 +1,123 @@
+// bench_convert: microbenchmark for the camera software path's pixel conversion.
+//
+// Converts synthetic YUYV frames to RGBA with every kernel this CPU can run
+// (scalar reference, SSE2/AVX2 or NEON) on one thread, then with the best
+// kernel split into row bands across the YuyvConverter pool. Reports the median
+// time per frame and megapixels per second as JSON on stdout.
+//
+//   bench_convert [--frames N] [--threads N] [WxH...]
+
+#include "modules/yuyv_convert.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using nlohmann::json;
+using nuc_display::modules::YuyvConverter;
+using nuc_display::modules::YuyvKernel;
+
+struct BenchOptions {
+    int frames = 200;
+    unsigned threads = 0;  // YuyvConverter default
+    std::vector<std::pair<int, int>> sizes;
+};
+
+// Median milliseconds per call of `convert` over `frames` runs (after a warm-up)
+template <typename F>
+static double median_ms(int frames, F&& convert) {
+    convert();
+    std::vector<double> samples;
+    samples.reserve(frames);
+    for (int i = 0; i < frames; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        convert();
+        samples.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    std::nth_element(samples.begin(), samples.begin() + samples.size() / 2, samples.end());
+    return samples[samples.size() / 2];
+}
+
+static json run_entry(int w, int h, const char* kernel, unsigned threads, double ms, double scalar_ms) {
+    json run;
+    run["size"] = std::to_string(w) + "x" + std::to_string(h);
+    run["kernel"] = kernel;
+    run["threads"] = threads;
+    run["ms_per_frame"] = ms;
+    run["mpix_per_s"] = ms > 0.0 ? (static_cast<double>(w) * h / 1e6) / (ms / 1000.0) : 0.0;
+    run["speedup_vs_scalar"] = ms > 0.0 ? scalar_ms / ms : 0.0;
+    return run;
+}
+
+static void print_usage(const char* argv0) {
+    std::cerr << "Usage: " << argv0 << " [--frames N] [--threads N] [WxH...]\n"
+              << "  Without sizes, benchmarks 640x480, 1280x720 and 1920x1080.\n";
+}
+
+int main(int argc, char* argv[]) {
+    BenchOptions opts;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        int w = 0, h = 0;
+        if (arg == "--frames" && i + 1 < argc) {
+            opts.frames = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--threads" && i + 1 < argc) {
+            opts.threads = static_cast<unsigned>(std::max(1, std::atoi(argv[++i])));
+        } else if (arg == "-h" || arg == "--help") {
+            print_usage(argv[0]);
+            return 0;
+        } else if (std::sscanf(arg.c_str(), "%dx%d", &w, &h) == 2 && w > 0 && h > 0 && w % 2 == 0) {
+            opts.sizes.emplace_back(w, h);
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (opts.sizes.empty()) opts.sizes = {{640, 480}, {1280, 720}, {1920, 1080}};
+
+    YuyvConverter converter(opts.threads);
+    json report;
+    report["cpu_threads"] = std::thread::hardware_concurrency();
+    report["frames"] = opts.frames;
+    report["runs"] = json::array();
+
+    for (auto [w, h] : opts.sizes) {
+        // Camera-like content: a gradient with some noise so no kernel sees a constant
+        std::vector<uint8_t> src(static_cast<size_t>(w) * h * 2);
+        uint32_t seed = 1;
+        for (size_t i = 0; i < src.size(); ++i) {
+            seed = seed * 1664525 + 1013904223;
+            src[i] = static_cast<uint8_t>((i % 2 ? 128 : (i / 2) % w * 255 / w) + (seed >> 29));
+        }
+        std::vector<uint8_t> dst(static_cast<size_t>(w) * h * 4);
+
+        double scalar_ms = 0.0;
+        auto kernels = nuc_display::modules::available_yuyv_kernels();
+        std::reverse(kernels.begin(), kernels.end()); // Scalar first, as the baseline
+        for (YuyvKernel kernel : kernels) {
+            double ms = median_ms(opts.frames, [&] {
+                nuc_display::modules::yuyv_to_rgba(src.data(), w * 2, dst.data(), w * 4, w, h, kernel);
+            });
+            if (kernel == YuyvKernel::Scalar) scalar_ms = ms;
+            report["runs"].push_back(run_entry(w, h, nuc_display::modules::yuyv_kernel_name(kernel), 1, ms, scalar_ms));
+        }
+
+        double ms = median_ms(opts.frames, [&] {
+            converter.convert(src.data(), w * 2, dst.data(), w * 4, w, h);
+        });
+        report["runs"].push_back(run_entry(w, h, nuc_display::modules::yuyv_kernel_name(converter.kernel()),
+                                           converter.threads(), ms, scalar_ms));
+        std::cerr << "[Bench] " << w << "x" << h << " done\n";
+    }
+
+    std::cout << report.dump(2) << std::endl;
+    return 0;
+}
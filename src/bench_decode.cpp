@@ -0,0 +1,422 @@
+// bench_decode: headless decode benchmark for the video pipeline.
+//
+// Demuxes with ContainerReader and decodes through the same DecodeBackends the
+// VideoDecoder uses (threaded software, VA-API, V4L2 M2M, DRM PRIME), as fast
+// as possible and without a display. Reports decoded fps, per-stage latency
+// histograms, peak RSS and heap allocation counts as JSON on stdout.
+//
+//   bench_decode [--backend auto|all|sw|vaapi|v4l2|drm] [--max-frames N] [--no-audio] [files...]
+
+#include "modules/container_reader.hpp"
+#include "modules/decode_backend.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libswresample/swresample.h>
+}
+
+#ifndef BENCH_SAMPLES_DIR
+#define BENCH_SAMPLES_DIR "tests"
+#endif
+
+using nlohmann::json;
+using nuc_display::modules::ContainerReader;
+using nuc_display::modules::DecodeBackend;
+using nuc_display::modules::DecodeBackendKind;
+using nuc_display::modules::DecodeSetup;
+
+// --- Heap allocation counting ---
+// Interposes the glibc allocator so allocations made inside FFmpeg count too,
+// not only C++ operator new.
+static std::atomic<uint64_t> g_alloc_count{0};
+static std::atomic<uint64_t> g_alloc_bytes{0};
+
+#ifdef __GLIBC__
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t n, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void __libc_free(void* ptr);
+
+void* malloc(size_t size) {
+    g_alloc_count.fetch_add(1, std::memory_order_relaxed);
+    g_alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+void* calloc(size_t n, size_t size) {
+    g_alloc_count.fetch_add(1, std::memory_order_relaxed);
+    g_alloc_bytes.fetch_add(n * size, std::memory_order_relaxed);
+    return __libc_calloc(n, size);
+}
+void* realloc(void* ptr, size_t size) {
+    g_alloc_count.fetch_add(1, std::memory_order_relaxed);
+    g_alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+    return __libc_realloc(ptr, size);
+}
+int posix_memalign(void** out, size_t alignment, size_t size) {
+    g_alloc_count.fetch_add(1, std::memory_order_relaxed);
+    g_alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+    *out = __libc_memalign(alignment, size);
+    return *out ? 0 : ENOMEM;
+}
+void* aligned_alloc(size_t alignment, size_t size) {
+    g_alloc_count.fetch_add(1, std::memory_order_relaxed);
+    g_alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+    return __libc_memalign(alignment, size);
+}
+void free(void* ptr) {
+    __libc_free(ptr);
+}
+}
+#endif
+
+// --- Latency histogram: power-of-two microsecond buckets ---
+class LatencyHistogram {
+public:
+    void add(double seconds) {
+        double us = seconds * 1e6;
+        this->samples_.push_back(us);
+        size_t bucket = 0;
+        while (bucket + 1 < this->buckets_.size() && us >= static_cast<double>(1ULL << bucket)) bucket++;
+        this->buckets_[bucket]++;
+    }
+
+    json to_json() {
+        json j;
+        j["count"] = this->samples_.size();
+        if (this->samples_.empty()) return j;
+
+        std::sort(this->samples_.begin(), this->samples_.end());
+        double sum = 0.0;
+        for (double s : this->samples_) sum += s;
+        auto pct = [this](double p) {
+            size_t idx = static_cast<size_t>(p * (this->samples_.size() - 1));
+            return this->samples_[idx];
+        };
+        j["mean_us"] = sum / this->samples_.size();
+        j["p50_us"] = pct(0.50);
+        j["p95_us"] = pct(0.95);
+        j["p99_us"] = pct(0.99);
+        j["max_us"] = this->samples_.back();
+        j["total_ms"] = sum / 1000.0;
+
+        json hist = json::array();
+        for (size_t i = 0; i < this->buckets_.size(); ++i) {
+            if (this->buckets_[i] == 0) continue;
+            hist.push_back({{"lt_us", 1ULL << i}, {"count", this->buckets_[i]}});
+        }
+        j["histogram"] = hist;
+        return j;
+    }
+
+private:
+    std::vector<double> samples_;
+    std::array<uint64_t, 24> buckets_{};  // Last bucket: >= ~4 s
+};
+
+class StageClock {
+public:
+    explicit StageClock(LatencyHistogram& hist) : hist_(hist), start_(std::chrono::steady_clock::now()) {}
+    ~StageClock() {
+        this->hist_.add(std::chrono::duration<double>(std::chrono::steady_clock::now() - this->start_).count());
+    }
+private:
+    LatencyHistogram& hist_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+static long peak_rss_kb() {
+    struct rusage usage {};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+struct BenchOptions {
+    std::vector<DecodeBackendKind> backends;
+    std::vector<std::string> files;
+    int64_t max_frames = 0;   // 0 = whole file
+    bool audio = true;
+};
+
+// Open a decoder the way VideoDecoder does for this backend. Returns nullptr if unavailable.
+static AVCodecContext* open_video_decoder(DecodeBackend& backend, const AVCodecParameters* params) {
+    const AVCodec* codec = backend.find_decoder(params);
+    if (!codec) return nullptr;
+
+    AVCodecContext* ctx = avcodec_alloc_context3(codec);
+    avcodec_parameters_to_context(ctx, params);
+    DecodeSetup setup;
+    setup.extra_hw_frames = 8;
+    setup.queued_frames = 6;
+    backend.configure(ctx, setup);
+
+    if (avcodec_open2(ctx, codec, nullptr) < 0) {
+        avcodec_free_context(&ctx);
+        backend.reset();
+        return nullptr;
+    }
+    return ctx;
+}
+
+static json bench_file(const std::string& path, DecodeBackendKind kind, DecodeBackend* backend, const BenchOptions& opts) {
+    json result;
+    result["file"] = std::filesystem::path(path).filename().string();
+    result["backend"] = nuc_display::modules::decode_backend_name(kind);
+    if (!backend) {
+        result["error"] = "backend unavailable";
+        return result;
+    }
+
+    ContainerReader reader;
+    if (!reader.open(path)) {
+        result["error"] = "open failed";
+        return result;
+    }
+    int video_index = reader.find_video_stream();
+    if (video_index < 0) {
+        result["error"] = "no video stream";
+        return result;
+    }
+    const AVCodecParameters* v_params = reader.get_codec_params(video_index);
+    result["codec"] = avcodec_get_name(v_params->codec_id);
+    result["width"] = v_params->width;
+    result["height"] = v_params->height;
+
+    AVCodecContext* video_ctx = open_video_decoder(*backend, v_params);
+    if (!video_ctx) {
+        result["error"] = "backend unavailable for this codec";
+        return result;
+    }
+    result["decoder"] = video_ctx->codec->name;
+
+    // Audio: decode and convert to S16 stereo 48 kHz like the ALSA path
+    AVCodecContext* audio_ctx = nullptr;
+    SwrContext* swr = nullptr;
+    int audio_index = opts.audio ? reader.find_audio_stream() : -1;
+    if (audio_index >= 0) {
+        const AVCodecParameters* a_params = reader.get_codec_params(audio_index);
+        const AVCodec* a_codec = avcodec_find_decoder(a_params->codec_id);
+        if (a_codec) {
+            audio_ctx = avcodec_alloc_context3(a_codec);
+            avcodec_parameters_to_context(audio_ctx, a_params);
+            if (avcodec_open2(audio_ctx, a_codec, nullptr) == 0) {
+                AVChannelLayout out_layout;
+                av_channel_layout_default(&out_layout, 2);
+                swr_alloc_set_opts2(&swr, &out_layout, AV_SAMPLE_FMT_S16, 48000,
+                                    &audio_ctx->ch_layout, audio_ctx->sample_fmt, audio_ctx->sample_rate, 0, nullptr);
+                av_channel_layout_uninit(&out_layout);
+                if (swr) swr_init(swr);
+            }
+        }
+    }
+
+    LatencyHistogram h_read, h_send, h_receive, h_map, h_swr;
+    AVFrame* frame = av_frame_alloc();
+    AVFrame* drm_frame = av_frame_alloc();
+    std::vector<uint8_t> pcm;
+    int64_t frames = 0;
+    int64_t audio_samples = 0;
+
+    // Map hardware frames to DRM PRIME, as render() does before the EGLImage import
+    auto map_frame = [&](AVFrame* f) {
+        if (!f->hw_frames_ctx || f->format == AV_PIX_FMT_DRM_PRIME) return;
+        StageClock clock(h_map);
+        av_frame_unref(drm_frame);
+        drm_frame->format = AV_PIX_FMT_DRM_PRIME;
+        av_hwframe_map(drm_frame, f, AV_HWFRAME_MAP_READ);
+        av_frame_unref(drm_frame);
+    };
+    auto drain_video = [&]() {
+        while (true) {
+            int res;
+            {
+                StageClock clock(h_receive);
+                res = avcodec_receive_frame(video_ctx, frame);
+            }
+            if (res < 0) break;
+            map_frame(frame);
+            av_frame_unref(frame);
+            frames++;
+        }
+    };
+    auto drain_audio = [&]() {
+        while (avcodec_receive_frame(audio_ctx, frame) == 0) {
+            if (swr) {
+                StageClock clock(h_swr);
+                int out_samples = swr_get_out_samples(swr, frame->nb_samples);
+                pcm.resize(static_cast<size_t>(std::max(out_samples, 0)) * 4);
+                uint8_t* out[1] = {pcm.data()};
+                int converted = swr_convert(swr, out, out_samples, (const uint8_t**)frame->data, frame->nb_samples);
+                if (converted > 0) audio_samples += converted;
+            }
+            av_frame_unref(frame);
+        }
+    };
+
+    uint64_t allocs_before = g_alloc_count.load();
+    uint64_t alloc_bytes_before = g_alloc_bytes.load();
+    auto start = std::chrono::steady_clock::now();
+
+    while (opts.max_frames <= 0 || frames < opts.max_frames) {
+        std::expected<AVPacket*, nuc_display::modules::MediaError> packet_res;
+        {
+            StageClock clock(h_read);
+            packet_res = reader.read_packet();
+        }
+        if (!packet_res) break;
+        AVPacket* packet = packet_res.value();
+
+        if (packet->stream_index == video_index) {
+            while (true) {
+                int res;
+                {
+                    StageClock clock(h_send);
+                    res = avcodec_send_packet(video_ctx, packet);
+                }
+                if (res != AVERROR(EAGAIN)) break;
+                drain_video();  // Decoder full: make room and resend
+            }
+            drain_video();
+        } else if (audio_ctx && packet->stream_index == audio_index) {
+            if (avcodec_send_packet(audio_ctx, packet) == 0) drain_audio();
+        }
+    }
+
+    // Flush the frames still inside the decoder
+    avcodec_send_packet(video_ctx, nullptr);
+    drain_video();
+    if (!backend->active(video_ctx)) result["warning"] = "hwaccel dropped for this profile, decoded in software";
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    uint64_t allocs = g_alloc_count.load() - allocs_before;
+    uint64_t alloc_bytes = g_alloc_bytes.load() - alloc_bytes_before;
+
+    result["frames"] = frames;
+    result["seconds"] = elapsed;
+    result["fps"] = elapsed > 0.0 ? frames / elapsed : 0.0;
+    result["audio_samples"] = audio_samples;
+    result["stages"] = {
+        {"read_packet", h_read.to_json()},
+        {"send_packet", h_send.to_json()},
+        {"receive_frame", h_receive.to_json()},
+        {"hwframe_map", h_map.to_json()},
+        {"swr_convert", h_swr.to_json()},
+    };
+    result["allocations"] = {
+        {"count", allocs},
+        {"bytes", alloc_bytes},
+        {"per_frame", frames > 0 ? static_cast<double>(allocs) / frames : 0.0},
+    };
+    result["peak_rss_kb"] = peak_rss_kb();
+
+    av_frame_free(&drm_frame);
+    av_frame_free(&frame);
+    if (swr) swr_free(&swr);
+    if (audio_ctx) avcodec_free_context(&audio_ctx);
+    avcodec_free_context(&video_ctx);
+    backend->reset();
+    return result;
+}
+
+static void print_usage(const char* argv0) {
+    std::cerr << "Usage: " << argv0 << " [--backend auto|all|sw|vaapi|v4l2|drm] [--max-frames N] [--no-audio] [files...]\n"
+              << "  Without files, benchmarks the samples in " << BENCH_SAMPLES_DIR << ".\n";
+}
+
+int main(int argc, char* argv[]) {
+    BenchOptions opts;
+    std::string backend_arg = "auto";
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--backend" && i + 1 < argc) {
+            backend_arg = argv[++i];
+        } else if (arg == "--max-frames" && i + 1 < argc) {
+            opts.max_frames = std::atoll(argv[++i]);
+        } else if (arg == "--no-audio") {
+            opts.audio = false;
+        } else if (arg == "-h" || arg == "--help") {
+            print_usage(argv[0]);
+            return 0;
+        } else if (!arg.empty() && arg[0] == '-') {
+            print_usage(argv[0]);
+            return 1;
+        } else {
+            opts.files.push_back(arg);
+        }
+    }
+
+    if (backend_arg == "all") {
+        opts.backends = {DecodeBackendKind::Software, DecodeBackendKind::Vaapi,
+                         DecodeBackendKind::V4l2M2m, DecodeBackendKind::DrmPrime};
+    } else if (backend_arg == "auto") {
+        opts.backends = nuc_display::modules::default_decode_backends();
+    } else if (auto kind = nuc_display::modules::decode_backend_from_name(backend_arg)) {
+        opts.backends = {*kind};
+    } else {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    if (opts.files.empty()) {
+        for (const char* name : {"sample_with_audio.mp4", "sample_no_audio.mp4", "sample_uhd_hevc_with_audio.mp4"}) {
+            opts.files.push_back(std::string(BENCH_SAMPLES_DIR) + "/" + name);
+        }
+    }
+
+    // Module logging goes to stdout; keep stdout clean for the JSON report
+    std::streambuf* stdout_buf = std::cout.rdbuf(std::cerr.rdbuf());
+    av_log_set_level(AV_LOG_ERROR);
+
+    json report;
+    report["ffmpeg"] = av_version_info();
+#ifdef PLATFORM_RPI
+    report["platform"] = "rpi";
+#else
+    report["platform"] = "nuc";
+#endif
+    report["cpu_threads"] = std::thread::hardware_concurrency();
+    report["runs"] = json::array();
+
+    // One instance per backend, so the device is opened once for all files;
+    // unbuilt or unavailable backends stay null and are reported per run
+    std::map<DecodeBackendKind, std::unique_ptr<DecodeBackend>> backends;
+    for (DecodeBackendKind kind : opts.backends) {
+        auto backend = DecodeBackend::create(kind);
+        if (backend && !backend->init_device()) backend.reset();
+        backends[kind] = std::move(backend);
+    }
+
+    for (const auto& file : opts.files) {
+        for (DecodeBackendKind kind : opts.backends) {
+            std::cerr << "[Bench] " << file << " (" << nuc_display::modules::decode_backend_name(kind) << ")\n";
+            report["runs"].push_back(bench_file(file, kind, backends[kind].get(), opts));
+        }
+    }
+    backends.clear();
+    report["peak_rss_kb"] = peak_rss_kb();
+
+    std::cout.rdbuf(stdout_buf);
+    std::cout << report.dump(2) << std::endl;
+    return 0;
+}
@@ -6,7 +6,10 @@
 #include <poll.h>
 #include <EGL/eglext.h>
 #include <GLES2/gl2.h>
+#include <algorithm>
 #include <cerrno>
+#include <cmath>
+#include <cstdlib>
 #include <cstring>
 #include <vector>
 
@@ -78,6 +81,15 @@ void DisplayManager::shutdown_display() {
     }
 }
 
+std::string DisplayManager::render_node_path() const {
+    if (drm_fd_ < 0) return {};
+    char* name = drmGetRenderDeviceNameFromFd(drm_fd_);
+    if (!name) return {};
+    std::string path = name;
+    free(name);
+    return path;
+}
+
 std::expected<void, DisplayError> DisplayManager::init_drm() {
     for (int i = 0; i < 10; i++) {
         char path[32];
@@ -87,6 +99,7 @@ std::expected<void, DisplayError> DisplayManager::init_drm() {
             drm_resources_ = drmModeGetResources(drm_fd_);
             if (drm_resources_ && drm_resources_->count_connectors > 0) {
                 std::cout << "Successfully opened " << path << " (connectors: " << drm_resources_->count_connectors << ")" << std::endl;
+                device_path_ = path;
                 break;
             }
             if (drm_resources_) {
@@ -121,7 +134,11 @@ std::expected<void, DisplayError> DisplayManager::init_drm() {
 
     if (!connected) return std::unexpected(DisplayError::DrmConnectorFailed);
 
-    std::cout << "Found Display! " << mode_.hdisplay << "x" << mode_.vdisplay << std::endl;
+    std::cout << "Found Display! " << mode_.hdisplay << "x" << mode_.vdisplay
+              << " @ " << 1.0 / nominal_period_sec() << " Hz" << std::endl;
+
+    uint64_t monotonic = 0;
+    monotonic_timestamps_ = drmGetCap(drm_fd_, DRM_CAP_TIMESTAMP_MONOTONIC, &monotonic) == 0 && monotonic;
 
     if (drmSetMaster(drm_fd_) != 0) {
         std::cerr << "  - Fatal: Failed to set DRM master: " << std::strerror(errno) << "\n";
@@ -259,8 +276,28 @@ std::expected<void, DisplayError> DisplayManager::init_egl() {
     return {};
 }
 
-void DisplayManager::page_flip_handler(int fd, unsigned int /*frame*/, unsigned int /*sec*/, unsigned int /*usec*/, void *data) {
+void DisplayManager::page_flip_handler(int fd, unsigned int /*frame*/, unsigned int sec, unsigned int usec, void *data) {
     auto dm = static_cast<DisplayManager*>(data);
+
+    if (dm->monotonic_timestamps_) {
+        auto vblank = std::chrono::steady_clock::time_point(std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::seconds(sec) + std::chrono::microseconds(usec)));
+        if (dm->has_vblank_) {
+            // Flips can skip vblanks when a frame runs long: divide by the number of periods
+            double nominal = dm->nominal_period_sec();
+            double delta = std::chrono::duration<double>(vblank - dm->last_vblank_).count();
+            double periods = std::round(delta / nominal);
+            if (periods >= 1.0 && periods <= 4.0) {
+                double sample = delta / periods;
+                if (std::abs(sample - nominal) < nominal * 0.05) {
+                    dm->measured_period_sec_ = dm->measured_period_sec_ > 0.0
+                        ? dm->measured_period_sec_ * 0.95 + sample * 0.05 : sample;
+                }
+            }
+        }
+        dm->last_vblank_ = vblank;
+        dm->has_vblank_ = true;
+    }
     
     // The previous buffer is now safe to release
     if (dm->current_bo_) {
@@ -277,6 +314,26 @@ void DisplayManager::page_flip_handler(int fd, unsigned int /*frame*/, unsigned
     dm->waiting_for_flip_ = false;
 }
 
+double DisplayManager::nominal_period_sec() const {
+    if (mode_.clock > 0 && mode_.htotal > 0 && mode_.vtotal > 0) {
+        return static_cast<double>(mode_.htotal) * mode_.vtotal / (mode_.clock * 1000.0);
+    }
+    return mode_.vrefresh > 0 ? 1.0 / mode_.vrefresh : 1.0 / 60.0;
+}
+
+double DisplayManager::refresh_period_sec() const {
+    return measured_period_sec_ > 0.0 ? measured_period_sec_ : nominal_period_sec();
+}
+
+std::optional<std::chrono::steady_clock::time_point> DisplayManager::next_vblank(std::chrono::steady_clock::time_point now) const {
+    if (!has_vblank_) return std::nullopt;
+    double period = refresh_period_sec();
+    double elapsed = std::chrono::duration<double>(now - last_vblank_).count();
+    double periods = std::max(1.0, std::ceil(elapsed / period));
+    return last_vblank_ + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(periods * period));
+}
+
 void DisplayManager::swap_buffers() {
     eglSwapBuffers(egl_display_, egl_surface_);
 }
@@ -4,6 +4,8 @@
 #include <vector>
 #include <memory>
 #include <expected>
+#include <chrono>
+#include <optional>
 
 #include <xf86drm.h>
 #include <xf86drmMode.h>
@@ -51,10 +53,19 @@ public:
 
     // Accessors
     int drm_fd() const { return drm_fd_; }
+    // Primary node the display was opened on, and the render node of the same GPU
+    // (empty if the driver exposes none)
+    const std::string& device_path() const { return device_path_; }
+    std::string render_node_path() const;
     uint32_t width() const { return mode_.hdisplay; }
     uint32_t height() const { return mode_.vdisplay; }
     EGLDisplay egl_display() const { return egl_display_; }
 
+    // Refresh period measured from page-flip events (nominal mode timing until then)
+    double refresh_period_sec() const;
+    // Predicted scanout of a frame flipped after `now`; empty until the first flip event
+    std::optional<std::chrono::steady_clock::time_point> next_vblank(std::chrono::steady_clock::time_point now) const;
+
 private:
     DisplayManager() = default;
     
@@ -66,6 +77,7 @@ private:
 
     // DRM State
     int drm_fd_ = -1;
+    std::string device_path_;
     drmModeRes* drm_resources_ = nullptr;
     drmModeConnector* drm_connector_ = nullptr;
     drmModeEncoder* drm_encoder_ = nullptr;
@@ -83,6 +95,14 @@ private:
     uint32_t next_fb_ = 0;
     bool waiting_for_flip_ = false;
 
+    // Vblank timing from flip events. DRM reports CLOCK_MONOTONIC, the clock
+    // behind std::chrono::steady_clock, so the timestamps are used as is.
+    double nominal_period_sec() const;
+    bool monotonic_timestamps_ = false;
+    bool has_vblank_ = false;
+    std::chrono::steady_clock::time_point last_vblank_{};
+    double measured_period_sec_ = 0.0;
+
     // EGL State
     EGLDisplay egl_display_ = EGL_NO_DISPLAY;
     EGLConfig egl_config_ = nullptr;
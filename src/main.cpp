@@ -8,6 +8,8 @@
 #include <sstream>
 #include <iomanip>
 #include <vector>
+#include <cstdint>
+#include <algorithm>
 #include <curl/curl.h>
 
 #include "core/display_manager.hpp"
@@ -26,6 +28,7 @@
 #include "modules/camera_module.hpp"
 #include "modules/config_validator.hpp"
 #include "modules/performance_monitor.hpp"
+#include "modules/decode_scheduler.hpp"
 
 using namespace nuc_display;
 
@@ -128,29 +131,56 @@ int main(int argc, char** argv) {
     // Image Loading
     auto image_loader = std::make_unique<modules::ImageLoader>();
 
-    // Video Decoding (Hardware Accelerated) - Multi-instance support
+    // Video Decoding (Hardware Accelerated) - Multi-instance support.
+    // One slot per videos[] entry; entries sharing a source id are drawn from the
+    // decoder of the first one, and their own slot stays empty.
+    std::vector<int> video_owner = modules::resolve_video_sources(app_config.videos);
     std::vector<std::unique_ptr<modules::VideoDecoder>> video_decoders;
     std::vector<bool> video_started; // Track if key-triggered videos have been started
-    for (const auto& v_config : app_config.videos) {
-        if (!v_config.enabled) continue;
+    for (size_t vi = 0; vi < app_config.videos.size(); ++vi) {
+        const auto& v_config = app_config.videos[vi];
+        if (video_owner[vi] != (int)vi) {
+            if (video_owner[vi] >= 0) {
+                std::cout << "[Core] Video " << vi << " shows source '" << v_config.source
+                          << "' decoded by video " << video_owner[vi] << ".\n";
+            }
+            video_decoders.push_back(nullptr);
+            video_started.push_back(false);
+            continue;
+        }
         
         auto decoder = std::make_unique<modules::VideoDecoder>();
         if (display) {
-#ifdef PLATFORM_RPI
-            decoder->init_v4l2(display->drm_fd());
-#else
-            decoder->init_vaapi(display->drm_fd());
-#endif
+            // Hardware backends in priority order, software last; each file takes the first that fits.
+            // Decode on the GPU that scans out so frames import without crossing devices.
+            modules::DecodeDevices devices;
+            devices.primary_node = display->device_path();
+            if (auto node = display->render_node_path(); !node.empty()) devices.render_node = node;
+            decoder->init_backends(devices);
+        }
+        if (display) {
+            // Source pixels the region actually samples: destination size divided by the crop fraction.
+            // A shared source is decoded for the most demanding of its layers.
+            int target_w = 0, target_h = 0;
+            for (size_t j = vi; j < app_config.videos.size(); ++j) {
+                if (video_owner[j] != (int)vi) continue;
+                const auto& vc = app_config.videos[j];
+                target_w = std::max(target_w, static_cast<int>(std::ceil(vc.w * display->width() / std::max(vc.src_w, 0.01f))));
+                target_h = std::max(target_h, static_cast<int>(std::ceil(vc.h * display->height() / std::max(vc.src_h, 0.01f))));
+            }
+            decoder->set_target_size(target_w, target_h);
         }
         decoder->set_audio_enabled(v_config.audio_enabled);
+        decoder->set_network_options(v_config.network);
         if (v_config.audio_enabled) {
+            decoder->set_audio_mix(v_config.audio_volume, v_config.audio_ducking);
             decoder->init_audio(v_config.audio_device);
         }
         
         if (!v_config.playlists.empty()) {
-            // Only auto-start if start_trigger is "auto" (key == 0)
+            // Only auto-start if start_trigger is "auto" (key == 0).
+            // The playlist is loaded below, once the DecodeScheduler has assigned surfaces.
             if (v_config.start_trigger_key == 0) {
-                decoder->load_playlist(v_config.playlists);
                 video_started.push_back(true);
             } else {
                 std::cout << "[Core] Video region waiting for key '" 
@@ -160,26 +190,20 @@ int main(int argc, char** argv) {
             video_decoders.push_back(std::move(decoder));
         } else {
             std::cerr << "[Core] No videos defined for a configured video region.\n";
+            video_decoders.push_back(nullptr);
             video_started.push_back(false);
         }
     }
 
-    // Camera Modules (V4L2) - Multi-instance support with hot-plug
+    // Camera Modules (V4L2) - Multi-instance; each captures (and hot-plugs) on its own thread
     std::vector<std::unique_ptr<modules::CameraModule>> cameras;
-    std::vector<modules::CameraConfig> camera_configs_copy; // Keep config copies for hot-plug retry
-    std::vector<std::chrono::steady_clock::time_point> camera_last_retry;
+    std::vector<modules::CameraConfig> camera_configs_copy; // Keep config copies for the layout rects
     for (const auto& c_config : app_config.cameras) {
         if (!c_config.enabled) continue;
         auto cam = std::make_unique<modules::CameraModule>();
-        if (cam->open(c_config)) {
-            std::cout << "[Core] Camera opened: " << cam->device_name() 
-                      << " (" << cam->device_path() << ")\n";
-        } else {
-            std::cout << "[Core] Camera not available yet (will retry via hot-plug).\n";
-        }
+        cam->start(c_config, headless_mode ? 0 : renderer->width(), headless_mode ? 0 : renderer->height());
         cameras.push_back(std::move(cam));
         camera_configs_copy.push_back(c_config);
-        camera_last_retry.push_back(std::chrono::steady_clock::now());
     }
 
     // Container Reader
@@ -225,7 +249,61 @@ int main(int argc, char** argv) {
 
     // Multi-video background tasks
     std::vector<std::future<std::expected<void, modules::MediaError>>> video_process_tasks(video_decoders.size());
+    // render_tick a decoder last presented on; further layers of the same source only draw
+    std::vector<uint64_t> video_presented_tick(video_decoders.size(), UINT64_MAX);
     bool videos_hidden = false;
+    uint64_t render_tick = 0;
+
+    // Decode Scheduler: derive each region's visible area from the layers that actually draw,
+    // split the hardware surface budget accordingly and suspend fully covered regions.
+    // Recomputed whenever a start trigger or the hide key changes what is on screen.
+    modules::DecodeScheduler decode_scheduler;
+    auto update_decode_layout = [&]() {
+        std::vector<modules::LayerRect> layer_rects;
+        for (const auto& layer : app_config.layout) {
+            if (layer.type == modules::LayoutType::Video &&
+                layer.video_index >= 0 && layer.video_index < (int)video_decoders.size()) {
+                // Layers of a shared source all count towards the decoder that feeds them
+                int vi = video_owner[layer.video_index];
+                if (vi < 0 || !video_decoders[vi] || !video_started[vi] || videos_hidden) continue;
+                const auto& vc = app_config.videos[layer.video_index];
+                layer_rects.push_back({vi, {vc.x, vc.y, vc.w, vc.h}});
+            } else if (layer.type == modules::LayoutType::Camera &&
+                       layer.camera_index >= 0 && layer.camera_index < (int)cameras.size()) {
+                // Same camera the render loop draws for this layer (enabled cameras only)
+                const auto& cc = camera_configs_copy[layer.camera_index];
+                layer_rects.push_back({-1, {cc.x, cc.y, cc.w, cc.h}});
+            }
+        }
+        decode_scheduler.update_layout(layer_rects);
+
+        for (size_t i = 0; i < video_decoders.size(); ++i) {
+            auto& decoder = video_decoders[i];
+            if (!decoder) continue;
+            decoder->set_surface_budget(decode_scheduler.surface_budget((int)i)); // Next load() / resume()
+            if (!video_started[i] || videos_hidden) continue;
+            if (decode_scheduler.state((int)i) == modules::DecodeState::Suspended) {
+                // Covered by a later layer: nothing of it is drawn, so give back its decoder memory
+                if (decoder->is_loaded()) {
+                    if (video_process_tasks[i].valid()) video_process_tasks[i].get();
+                    std::cout << "[Core] Video " << i << " is fully covered by later layers. Decode suspended.\n";
+                    decoder->suspend();
+                }
+                continue;
+            }
+            std::cout << "[Core] Video " << i << ": visible " << std::fixed << std::setprecision(0)
+                      << decode_scheduler.visible_fraction((int)i) * 100.0 << "%, "
+                      << decode_scheduler.surface_budget((int)i) << " HW surfaces\n" << std::defaultfloat;
+            if (decoder->is_suspended()) {
+                if (video_process_tasks[i].valid()) video_process_tasks[i].get();
+                decoder->resume();
+            } else if (!decoder->is_loaded()) {
+                if (video_process_tasks[i].valid()) video_process_tasks[i].get();
+                decoder->load_playlist(app_config.videos[i].playlists);
+            }
+        }
+    };
+    update_decode_layout();
     auto last_config_error_log = std::chrono::steady_clock::now();
 
     std::cout << "--- Starting main loop ---" << std::endl;
@@ -233,6 +311,13 @@ int main(int argc, char** argv) {
     while (g_running) {
         auto now_p = std::chrono::steady_clock::now();
         double render_time_sec = std::chrono::duration<double>(now_p - program_start_time).count();
+        // Predicted scanout of the frame rendered in this iteration, for refresh-aware video pacing
+        double vblank_sec = -1.0;
+        if (!headless_mode) {
+            if (auto vblank = display->next_vblank(now_p)) {
+                vblank_sec = std::chrono::duration<double>(*vblank - program_start_time).count();
+            }
+        }
 
         // --- POLL INPUT EVENTS ---
         while (auto event = input_module->pop_event()) {
@@ -243,46 +328,74 @@ int main(int argc, char** argv) {
             if (app_config.global_keys.hide_videos && code == *app_config.global_keys.hide_videos) {
                 videos_hidden = !videos_hidden;
                 std::cout << "[Core] Videos " << (videos_hidden ? "HIDDEN" : "SHOWN") << "\n";
-                for (auto& decoder : video_decoders) {
-                    decoder->set_paused(videos_hidden, render_time_sec);
+                // Hidden regions give back their decoder memory and resume on the same frame
+                if (videos_hidden) {
+                    for (size_t i = 0; i < video_decoders.size(); ++i) {
+                        if (!video_decoders[i] || !video_started[i]) continue;
+                        if (video_process_tasks[i].valid()) video_process_tasks[i].get();
+                        video_decoders[i]->suspend();
+                    }
                 }
+                // Shown again: only the regions no camera or later video covers come back
+                update_decode_layout();
             }
 
             // Per-video key handling
             for (size_t i = 0; i < video_decoders.size(); ++i) {
                 auto& decoder = video_decoders[i];
                 auto& v_config = app_config.videos[i];
+                if (!decoder) continue; // Keys of a shared source belong to the entry that decodes it
 
                 // Start trigger (Toggle)
                 if (v_config.start_trigger_key > 0 && code == v_config.start_trigger_key) {
+                    if (video_process_tasks[i].valid()) video_process_tasks[i].get();
                     if (!video_started[i]) {
-                        std::cout << "[Core] Key trigger: Starting video " << i << "\n";
-                        decoder->load_playlist(v_config.playlists);
+                        // Loaded (or resumed) by update_decode_layout() only once the region is
+                        // visible: a hidden or covered one would hold a codec and surfaces for nothing
+                        std::cout << "[Core] Key trigger: " << (decoder->is_suspended() ? "Resuming" : "Starting")
+                                  << " video " << i << "\n";
                         video_started[i] = true;
                     } else {
-                        std::cout << "[Core] Key trigger: Unloading video " << i << "\n";
-                        decoder->unload();
+                        // Stopped regions can sit idle for hours: keep only the position
+                        std::cout << "[Core] Key trigger: Suspending video " << i << "\n";
+                        decoder->suspend();
                         video_started[i] = false;
                     }
+                    // The region now draws (or no longer covers the ones below it)
+                    update_decode_layout();
                 }
 
                 // Navigation keys
                 if (v_config.keys.next && code == *v_config.keys.next) {
+                    if (video_process_tasks[i].valid()) video_process_tasks[i].get();
                     std::cout << "[Core] Key: Next video for decoder " << i << "\n";
                     decoder->next_video();
                 }
                 if (v_config.keys.prev && code == *v_config.keys.prev) {
+                    if (video_process_tasks[i].valid()) video_process_tasks[i].get();
                     std::cout << "[Core] Key: Prev video for decoder " << i << "\n";
                     decoder->prev_video();
                 }
                 if (v_config.keys.skip_forward && code == *v_config.keys.skip_forward) {
+                    if (video_process_tasks[i].valid()) video_process_tasks[i].get();
                     std::cout << "[Core] Key: Skip forward for decoder " << i << "\n";
                     decoder->skip_forward(2.0);
                 }
                 if (v_config.keys.skip_backward && code == *v_config.keys.skip_backward) {
+                    if (video_process_tasks[i].valid()) video_process_tasks[i].get();
                     std::cout << "[Core] Key: Skip backward for decoder " << i << "\n";
                     decoder->skip_backward(2.0);
                 }
+                if (v_config.keys.scan_forward && code == *v_config.keys.scan_forward) {
+                    if (video_process_tasks[i].valid()) video_process_tasks[i].get();
+                    std::cout << "[Core] Key: Scan forward for decoder " << i << "\n";
+                    decoder->scan(1);
+                }
+                if (v_config.keys.scan_backward && code == *v_config.keys.scan_backward) {
+                    if (video_process_tasks[i].valid()) video_process_tasks[i].get();
+                    std::cout << "[Core] Key: Scan backward for decoder " << i << "\n";
+                    decoder->scan(-1);
+                }
             }
 
             // Stock navigation keys
@@ -369,7 +482,16 @@ int main(int argc, char** argv) {
         // --- CHECK PERFORMANCE LOG (Every 30s) ---
         if (std::chrono::duration_cast<std::chrono::seconds>(now - last_perf_update).count() >= 30) {
             perf_monitor->update();
-            perf_monitor->log();
+            std::vector<std::pair<size_t, modules::VideoDecoderStats>> video_stats;
+            for (size_t i = 0; i < video_decoders.size(); ++i) {
+                if (!video_decoders[i] || !video_decoders[i]->is_loaded()) continue;
+                video_stats.emplace_back(i, video_decoders[i]->stats());
+            }
+            std::vector<std::pair<size_t, modules::CameraStats>> camera_stats;
+            for (size_t i = 0; i < cameras.size(); ++i) {
+                camera_stats.emplace_back(i, cameras[i]->stats());
+            }
+            perf_monitor->log(video_stats, camera_stats);
             last_perf_update = now;
         }
 
@@ -437,6 +559,31 @@ int main(int argc, char** argv) {
             }
         }
 
+        // --- DISPATCH VIDEO DECODING ---
+        // Largest visible regions are queued first; mostly covered ones only every other tick
+        for (int vi : decode_scheduler.dispatch_order()) {
+            if (vi >= (int)video_decoders.size() || !video_decoders[vi]) continue;
+            auto& decoder = video_decoders[vi];
+            auto& task = video_process_tasks[vi];
+
+            if (task.valid() && task.wait_for(std::chrono::seconds(0)) != std::future_status::ready) continue;
+            if (task.valid()) {
+                auto res = task.get();
+                (void)res;
+            }
+            // No decode task running: safe to swap the codec under render()
+            if (decoder->backend_fallback_pending()) decoder->apply_backend_fallback();
+
+            // Only process decoding if the video is started and not hidden
+            if (video_started[vi] && !videos_hidden && decoder->is_loaded() &&
+                decode_scheduler.should_decode(vi, render_tick)) {
+                task = thread_pool.enqueue([&decoder, render_time_sec]() {
+                    return decoder->process(render_time_sec);
+                });
+            }
+        }
+        render_tick++;
+
         // Stocks and News render independently — they have their own data/placeholders
         // --- LAYOUT-DRIVEN RENDERING ---
         // Iterate over the layout array: first entry drawn first (behind), last drawn last (on top)
@@ -456,28 +603,27 @@ int main(int argc, char** argv) {
                     break;
 
                 case modules::LayoutType::Video: {
-                    int vi = layer.video_index;
-                    if (vi < 0 || vi >= (int)video_decoders.size()) break;
+                    if (layer.video_index < 0 || layer.video_index >= (int)video_decoders.size()) break;
+                    // This layer's crop and rect, drawn from the decoder that plays its source
+                    auto& v_config = app_config.videos[layer.video_index];
+                    int vi = video_owner[layer.video_index];
+                    if (vi < 0 || !video_decoders[vi]) break;
 
                     auto& decoder = video_decoders[vi];
-                    auto& v_config = app_config.videos[vi];
                     auto& task = video_process_tasks[vi];
 
-                    if (!task.valid() || task.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
-                        if (task.valid()) {
-                            auto res = task.get();
-                            (void)res;
-                        }
-                        
-                        // Only process decoding if the video is started and not hidden
-                        if (video_started[vi] && !videos_hidden && decoder->is_loaded()) {
-                            task = thread_pool.enqueue([&decoder, render_time_sec]() {
-                                return decoder->process(render_time_sec);
-                            });
-                        }
-                    }
+                    // Fully covered regions are never decoded, so there is nothing to present
+                    if (decode_scheduler.state(vi) == modules::DecodeState::Suspended) break;
 
                     if (!headless_mode && !videos_hidden && video_started[vi] && decoder->is_loaded()) {
+                        if (video_presented_tick[vi] == render_tick) {
+                            // Already advanced for an earlier layer this tick: sample the same frame
+                            decoder->draw(*renderer, v_config.src_x, v_config.src_y, v_config.src_w, v_config.src_h,
+                                          v_config.x, v_config.y, v_config.w, v_config.h);
+                            break;
+                        }
+                        video_presented_tick[vi] = render_tick;
+                        decoder->set_presentation_timing(vblank_sec, display->refresh_period_sec());
                         bool playing = decoder->render(*renderer, display->egl_display(), 
                                                        v_config.src_x, v_config.src_y,
                                                        v_config.src_w, v_config.src_h,
@@ -496,31 +642,14 @@ int main(int argc, char** argv) {
                     int ci = layer.camera_index;
                     if (ci < 0 || ci >= (int)cameras.size()) break;
 
-                    auto& cam = cameras[ci];
-                    
-                    if (cam->is_open()) {
-                        bool alive = cam->capture_frame();
-                        if (!alive) {
-                            std::cerr << "[Core] Camera " << ci << " disconnected. Will retry.\n";
-                            cam->close();
-                            camera_last_retry[ci] = now;
-                        } else if (!headless_mode) {
-                            auto& c_config = camera_configs_copy[ci];
-                            cam->render(*renderer, display->egl_display(),
-                                        c_config.src_x, c_config.src_y,
-                                        c_config.src_w, c_config.src_h,
-                                        c_config.x, c_config.y,
-                                        c_config.w, c_config.h);
-                        }
-                    } else {
-                        // Hot-plug retry every 5s
-                        if (std::chrono::duration_cast<std::chrono::seconds>(now - camera_last_retry[ci]).count() >= 5) {
-                            if (cam->open(camera_configs_copy[ci])) {
-                                std::cout << "[Core] Camera " << ci << " reconnected: " 
-                                          << cam->device_name() << "\n";
-                            }
-                            camera_last_retry[ci] = now;
-                        }
+                    // Never blocks: draws the newest frame the capture thread has published
+                    if (!headless_mode) {
+                        auto& c_config = camera_configs_copy[ci];
+                        cameras[ci]->render(*renderer, display->egl_display(),
+                                            c_config.src_x, c_config.src_y,
+                                            c_config.src_w, c_config.src_h,
+                                            c_config.x, c_config.y,
+                                            c_config.w, c_config.h);
                     }
                     break;
                 }
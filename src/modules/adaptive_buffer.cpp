@@ -0,0 +1,99 @@
+#include "modules/adaptive_buffer.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace nuc_display::modules {
+
+BufferProfile BufferProfile::for_platform() {
+#ifdef PLATFORM_RPI
+    // 512 MB boards: a few MB of UHD packets is already a lot
+    return {256 * 1024, 8 * 1024 * 1024, 1.0, 2.5, 2, 4};
+#else
+    return {512 * 1024, 48 * 1024 * 1024, 2.0, 5.0, 3, 8};
+#endif
+}
+
+AdaptiveBuffer::AdaptiveBuffer(const BufferProfile& profile) : profile_(profile) {}
+
+void AdaptiveBuffer::observe_demuxed(size_t bytes, double video_seconds) {
+    this->total_bytes_ += bytes;
+    this->total_video_sec_ += video_seconds;
+}
+
+void AdaptiveBuffer::on_packet_queued(size_t bytes, double seconds, bool is_video) {
+    this->packets_++;
+    this->bytes_ += bytes;
+    (is_video ? this->video_sec_ : this->audio_sec_) += seconds;
+}
+
+void AdaptiveBuffer::on_packet_dequeued(size_t bytes, double seconds, bool is_video) {
+    this->packets_ = this->packets_ > 0 ? this->packets_ - 1 : 0;
+    this->bytes_ = this->bytes_ > bytes ? this->bytes_ - bytes : 0;
+    double& sec = is_video ? this->video_sec_ : this->audio_sec_;
+    sec = std::max(0.0, sec - seconds);
+}
+
+void AdaptiveBuffer::clear_packets() {
+    this->packets_ = 0;
+    this->bytes_ = 0;
+    this->video_sec_ = 0.0;
+    this->audio_sec_ = 0.0;
+}
+
+void AdaptiveBuffer::reset() {
+    this->clear_packets();
+    this->total_bytes_ = 0;
+    this->total_video_sec_ = 0.0;
+    this->decode_load_ = 0.0;
+}
+
+void AdaptiveBuffer::observe_decode(double seconds, int frames, double frame_interval_sec) {
+    if (frames <= 0 || frame_interval_sec <= 0.0) return;
+    double load = (seconds / frames) / frame_interval_sec;
+    this->decode_load_ = this->decode_load_ <= 0.0 ? load : this->decode_load_ * 0.9 + load * 0.1;
+}
+
+double AdaptiveBuffer::packet_duration_limit() const {
+    // Slide from the target towards the maximum as decode approaches real time
+    double t = std::clamp((this->decode_load_ - 0.5) / 0.5, 0.0, 1.0);
+    double limit = this->profile_.target_duration_sec + t * (this->profile_.max_duration_sec - this->profile_.target_duration_sec);
+    return std::max(limit, this->min_duration_sec_);
+}
+
+size_t AdaptiveBuffer::packet_byte_limit() const {
+    if (this->total_video_sec_ <= 0.0) return this->profile_.max_packet_bytes;
+    double bytes_per_sec = this->total_bytes_ / this->total_video_sec_;
+    double wanted = bytes_per_sec * this->packet_duration_limit();
+    return static_cast<size_t>(std::clamp(wanted, static_cast<double>(this->profile_.min_packet_bytes),
+                                          static_cast<double>(this->profile_.max_packet_bytes)));
+}
+
+bool AdaptiveBuffer::packets_full() const {
+    if (this->bytes_ >= this->packet_byte_limit()) return true;
+    // Media time only counts once both streams are covered, so audio never starves
+    double queued_sec = this->audio_sec_ > 0.0 ? std::min(this->video_sec_, this->audio_sec_) : this->video_sec_;
+    return queued_sec >= this->packet_duration_limit();
+}
+
+size_t AdaptiveBuffer::video_frame_limit() const {
+    // One extra frame of slack per half frame interval of decode time beyond 50% load
+    double extra = std::ceil(std::max(0.0, this->decode_load_ - 0.5) * 2.0);
+    return std::clamp(this->profile_.min_video_frames + static_cast<size_t>(extra),
+                      this->profile_.min_video_frames, this->profile_.max_video_frames);
+}
+
+BufferFill AdaptiveBuffer::fill(size_t video_frames) const {
+    BufferFill f;
+    f.packets = this->packets_;
+    f.packet_bytes = this->bytes_;
+    f.packet_duration_sec = std::max(this->video_sec_, this->audio_sec_);
+    f.packet_byte_limit = this->packet_byte_limit();
+    f.packet_duration_limit_sec = this->packet_duration_limit();
+    f.video_frames = video_frames;
+    f.video_frame_limit = this->video_frame_limit();
+    f.bitrate_bps = this->total_video_sec_ > 0.0 ? this->total_bytes_ * 8.0 / this->total_video_sec_ : 0.0;
+    f.decode_load = this->decode_load_;
+    return f;
+}
+
+} // namespace nuc_display::modules
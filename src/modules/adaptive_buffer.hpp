@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace nuc_display::modules {
+
+// Per-platform buffering limits, in bytes and media seconds rather than packet counts
+struct BufferProfile {
+    size_t min_packet_bytes;     // Never cap the demux queue below this (tiny low-bitrate packets)
+    size_t max_packet_bytes;     // Hard ceiling for queued compressed data (OOM guard)
+    double target_duration_sec;  // Media time to keep queued when decode keeps up
+    double max_duration_sec;     // Media time to keep queued when decode is slow
+    size_t min_video_frames;     // Decoded frames queued ahead of presentation
+    size_t max_video_frames;
+
+    static BufferProfile for_platform();
+};
+
+// Current fill of one decoder's queues, exported for the performance log
+struct BufferFill {
+    size_t packets = 0;
+    size_t packet_bytes = 0;
+    double packet_duration_sec = 0.0;
+    size_t packet_byte_limit = 0;
+    double packet_duration_limit_sec = 0.0;
+    size_t video_frames = 0;
+    size_t video_frame_limit = 0;
+    double bitrate_bps = 0.0;
+    double decode_load = 0.0;    // Decode time per frame / frame interval (1.0 = just keeping up)
+};
+
+// Demux and decoded-frame limits for one decoder. The byte limit follows the
+// observed bitrate (so a fixed amount of media time is buffered whatever the
+// file), and both the media-time target and the decoded-frame queue grow when
+// measured decode time gets close to the frame interval. Not thread-safe: the
+// decoder calls it under its queue mutex.
+class AdaptiveBuffer {
+public:
+    explicit AdaptiveBuffer(const BufferProfile& profile = BufferProfile::for_platform());
+
+    // Every packet read from the container, for the bitrate estimate
+    void observe_demuxed(size_t bytes, double video_seconds);
+    // Queue accounting (seconds may be 0 when the container gives no duration)
+    void on_packet_queued(size_t bytes, double seconds, bool is_video);
+    void on_packet_dequeued(size_t bytes, double seconds, bool is_video);
+    void clear_packets();
+    // Forget bitrate/decode measurements as well (new file)
+    void reset();
+    // Never target less media time than this (network jitter buffer; 0 = profile only)
+    void set_min_duration(double seconds) { this->min_duration_sec_ = seconds; }
+
+    // Decode cost of `frames` frames that took `seconds` of decoder time
+    void observe_decode(double seconds, int frames, double frame_interval_sec);
+
+    bool packets_full() const;
+    size_t video_frame_limit() const;
+    size_t packet_byte_limit() const;
+    double packet_duration_limit() const;
+
+    BufferFill fill(size_t video_frames) const;
+    const BufferProfile& profile() const { return this->profile_; }
+
+private:
+    BufferProfile profile_;
+
+    size_t packets_ = 0;
+    size_t bytes_ = 0;
+    double video_sec_ = 0.0;
+    double audio_sec_ = 0.0;
+
+    // Bitrate from everything demuxed so far (bytes / video seconds)
+    uint64_t total_bytes_ = 0;
+    double total_video_sec_ = 0.0;
+    double decode_load_ = 0.0;   // Exponential moving average
+    double min_duration_sec_ = 0.0;
+};
+
+} // namespace nuc_display::modules
@@ -0,0 +1,125 @@
+#include "modules/audio_interleave.hpp"
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace nuc_display::modules {
+
+void interleave_stereo_f32(const float* left, const float* right, float* out, size_t samples) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    for (; i + 4 <= samples; i += 4) {
+        __m128 l = _mm_loadu_ps(left + i);
+        __m128 r = _mm_loadu_ps(right + i);
+        _mm_storeu_ps(out + 2 * i, _mm_unpacklo_ps(l, r));
+        _mm_storeu_ps(out + 2 * i + 4, _mm_unpackhi_ps(l, r));
+    }
+#elif defined(__ARM_NEON)
+    for (; i + 4 <= samples; i += 4) {
+        float32x4x2_t lr = {{vld1q_f32(left + i), vld1q_f32(right + i)}};
+        vst2q_f32(out + 2 * i, lr);
+    }
+#endif
+    for (; i < samples; ++i) {
+        out[2 * i] = left[i];
+        out[2 * i + 1] = right[i];
+    }
+}
+
+void interleave_stereo_s16(const int16_t* left, const int16_t* right, int16_t* out, size_t samples) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    for (; i + 8 <= samples; i += 8) {
+        __m128i l = _mm_loadu_si128(reinterpret_cast<const __m128i*>(left + i));
+        __m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i*>(right + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2 * i), _mm_unpacklo_epi16(l, r));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2 * i + 8), _mm_unpackhi_epi16(l, r));
+    }
+#elif defined(__ARM_NEON)
+    for (; i + 8 <= samples; i += 8) {
+        int16x8x2_t lr = {{vld1q_s16(left + i), vld1q_s16(right + i)}};
+        vst2q_s16(out + 2 * i, lr);
+    }
+#endif
+    for (; i < samples; ++i) {
+        out[2 * i] = left[i];
+        out[2 * i + 1] = right[i];
+    }
+}
+
+void mix_add_s16(int16_t* acc, const int16_t* src, size_t values, int gain_q15) {
+    gain_q15 = std::max(gain_q15, 0);
+    bool unity = gain_q15 >= 32768;
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i g = _mm_set1_epi16(static_cast<int16_t>(std::min(gain_q15, 32767)));
+    for (; i + 8 <= values; i += 8) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(acc + i));
+        __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        if (!unity) {
+            // Full 32-bit products, then >> 15 and pack back with saturation
+            __m128i lo = _mm_mullo_epi16(s, g);
+            __m128i hi = _mm_mulhi_epi16(s, g);
+            __m128i p0 = _mm_srai_epi32(_mm_unpacklo_epi16(lo, hi), 15);
+            __m128i p1 = _mm_srai_epi32(_mm_unpackhi_epi16(lo, hi), 15);
+            s = _mm_packs_epi32(p0, p1);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(acc + i), _mm_adds_epi16(a, s));
+    }
+#elif defined(__ARM_NEON)
+    const int16_t g = static_cast<int16_t>(std::min(gain_q15, 32767));
+    for (; i + 8 <= values; i += 8) {
+        int16x8_t s = vld1q_s16(src + i);
+        if (!unity) s = vqdmulhq_n_s16(s, g);
+        vst1q_s16(acc + i, vqaddq_s16(vld1q_s16(acc + i), s));
+    }
+#endif
+    for (; i < values; ++i) {
+        int32_t s = unity ? src[i] : (static_cast<int32_t>(src[i]) * gain_q15) >> 15;
+        acc[i] = static_cast<int16_t>(std::clamp<int32_t>(acc[i] + s, -32768, 32767));
+    }
+}
+
+void mix_add_f32(float* acc, const float* src, size_t values, float gain) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128 g = _mm_set1_ps(gain);
+    for (; i + 4 <= values; i += 4) {
+        __m128 a = _mm_loadu_ps(acc + i);
+        _mm_storeu_ps(acc + i, _mm_add_ps(a, _mm_mul_ps(_mm_loadu_ps(src + i), g)));
+    }
+#elif defined(__ARM_NEON)
+    for (; i + 4 <= values; i += 4) {
+        vst1q_f32(acc + i, vmlaq_n_f32(vld1q_f32(acc + i), vld1q_f32(src + i), gain));
+    }
+#endif
+    for (; i < values; ++i) {
+        acc[i] += src[i] * gain;
+    }
+}
+
+void clamp_f32(float* samples, size_t values) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128 lo = _mm_set1_ps(-1.0f);
+    const __m128 hi = _mm_set1_ps(1.0f);
+    for (; i + 4 <= values; i += 4) {
+        _mm_storeu_ps(samples + i, _mm_min_ps(_mm_max_ps(_mm_loadu_ps(samples + i), lo), hi));
+    }
+#elif defined(__ARM_NEON)
+    const float32x4_t lo = vdupq_n_f32(-1.0f);
+    const float32x4_t hi = vdupq_n_f32(1.0f);
+    for (; i + 4 <= values; i += 4) {
+        vst1q_f32(samples + i, vminq_f32(vmaxq_f32(vld1q_f32(samples + i), lo), hi));
+    }
+#endif
+    for (; i < values; ++i) {
+        samples[i] = std::clamp(samples[i], -1.0f, 1.0f);
+    }
+}
+
+} // namespace nuc_display::modules
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace nuc_display::modules {
+
+// Planar stereo -> interleaved L/R kernels for the audio fast path (source
+// already at the device's rate and sample format, only the layout differs).
+// SSE2 on x86-64, NEON on ARM, scalar elsewhere. `out` holds 2 * samples values.
+void interleave_stereo_f32(const float* left, const float* right, float* out, size_t samples);
+void interleave_stereo_s16(const int16_t* left, const int16_t* right, int16_t* out, size_t samples);
+
+// Mixing kernels for AudioMixer: acc += src * gain over `values` samples.
+// The S16 variant uses saturating adds (gain in Q15, >= 32768 means unity);
+// float sums are saturated once per block with clamp_f32.
+void mix_add_s16(int16_t* acc, const int16_t* src, size_t values, int gain_q15);
+void mix_add_f32(float* acc, const float* src, size_t values, float gain);
+void clamp_f32(float* samples, size_t values);
+
+} // namespace nuc_display::modules
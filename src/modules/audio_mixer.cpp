@@ -0,0 +1,434 @@
+#include "modules/audio_mixer.hpp"
+#include "modules/audio_interleave.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <unistd.h>
+
+namespace nuc_display::modules {
+
+// ---------------------------------------------------------------------------
+// AudioStream
+// ---------------------------------------------------------------------------
+
+AudioStream::AudioStream(size_t capacity_frames, size_t prebuffer_frames, unsigned int rate, bool is_float)
+    : capacity_frames_(std::max<size_t>(capacity_frames, 1)),
+      prebuffer_frames_(std::min(prebuffer_frames, capacity_frames)),
+      rate_(rate),
+      is_float_(is_float),
+      frame_bytes_(is_float ? 2 * sizeof(float) : 2 * sizeof(int16_t)) {
+    this->ring_.resize(this->capacity_frames_ * this->frame_bytes_);
+}
+
+size_t AudioStream::write(const uint8_t* data, size_t frames) {
+    uint64_t w = this->write_pos_.load(std::memory_order_relaxed);
+    uint64_t r = this->read_pos_.load(std::memory_order_acquire);
+    size_t free_frames = this->capacity_frames_ - static_cast<size_t>(w - r);
+    frames = std::min(frames, free_frames);
+
+    size_t idx = static_cast<size_t>(w % this->capacity_frames_);
+    size_t first = std::min(frames, this->capacity_frames_ - idx);
+    std::memcpy(this->ring_.data() + idx * this->frame_bytes_, data, first * this->frame_bytes_);
+    if (frames > first) {
+        std::memcpy(this->ring_.data(), data + first * this->frame_bytes_, (frames - first) * this->frame_bytes_);
+    }
+    this->write_pos_.store(w + frames, std::memory_order_release);
+    return frames;
+}
+
+void AudioStream::flush() {
+    // The reader skips up to here; anything written afterwards is kept
+    this->discard_until_.store(this->write_pos_.load(std::memory_order_relaxed), std::memory_order_release);
+}
+
+size_t AudioStream::queued_frames() const {
+    uint64_t w = this->write_pos_.load(std::memory_order_acquire);
+    uint64_t r = std::max(this->read_pos_.load(std::memory_order_acquire), this->discard_until_.load(std::memory_order_acquire));
+    return w > r ? static_cast<size_t>(w - r) : 0;
+}
+
+void AudioStream::set_gain(float gain) {
+    this->gain_.store(std::clamp(gain, 0.0f, 1.0f), std::memory_order_relaxed);
+}
+
+void AudioStream::set_ducking(bool ducks_others) {
+    this->ducks_others_.store(ducks_others, std::memory_order_relaxed);
+}
+
+void AudioStream::set_paused(bool paused) {
+    this->paused_.store(paused, std::memory_order_relaxed);
+}
+
+size_t AudioStream::readable_frames() {
+    uint64_t r = this->read_pos_.load(std::memory_order_relaxed);
+    uint64_t discard = this->discard_until_.load(std::memory_order_acquire);
+    if (discard > r) {
+        // Flushed by the producer: start over with a fresh prebuffer
+        this->read_pos_.store(discard, std::memory_order_release);
+        this->prebuffering_ = true;
+        r = discard;
+    }
+    return static_cast<size_t>(this->write_pos_.load(std::memory_order_acquire) - r);
+}
+
+template <typename Fn>
+void AudioStream::consume(size_t frames, Fn&& fn) {
+    // fn(data, frames) is called for up to two contiguous segments of the ring
+    uint64_t r = this->read_pos_.load(std::memory_order_relaxed);
+    size_t idx = static_cast<size_t>(r % this->capacity_frames_);
+    size_t first = std::min(frames, this->capacity_frames_ - idx);
+    fn(this->ring_.data() + idx * this->frame_bytes_, first);
+    if (frames > first) {
+        fn(this->ring_.data(), frames - first);
+    }
+    this->read_pos_.store(r + frames, std::memory_order_release);
+}
+
+// ---------------------------------------------------------------------------
+// AudioMixer
+// ---------------------------------------------------------------------------
+
+AudioMixer& AudioMixer::shared() {
+    static AudioMixer mixer;
+    return mixer;
+}
+
+AudioMixer::AudioMixer(bool threaded) : threaded_(threaded) {}
+
+AudioMixer::~AudioMixer() {
+    if (this->thread_.joinable()) {
+        this->thread_.request_stop();
+        this->thread_.join();
+    }
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    this->close_device();
+}
+
+std::shared_ptr<AudioStream> AudioMixer::add_stream(const std::string& device_name) {
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    if (!this->pcm_) {
+        if (!this->open_device(device_name)) return nullptr;
+    } else if (device_name != this->device_name_) {
+        std::cout << "[AudioMixer] '" << device_name << "' requested while mixing on '" << this->device_name_
+                  << "'. Sharing the open device.\n";
+    }
+
+    // 1 s ring per stream, 200 ms prebuffer before a stream joins the mix
+    auto stream = std::make_shared<AudioStream>(this->rate_, this->rate_ / 5, this->rate_, this->is_float_);
+    this->streams_.push_back(stream);
+    std::cout << "[AudioMixer] Stream added (" << this->streams_.size() << " active).\n";
+
+    if (this->threaded_ && !this->thread_.joinable()) {
+        this->thread_ = std::jthread([this](std::stop_token stop) { this->run(stop); });
+    }
+    return stream;
+}
+
+void AudioMixer::remove_stream(const std::shared_ptr<AudioStream>& stream) {
+    std::jthread finished;
+    {
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        auto it = std::find(this->streams_.begin(), this->streams_.end(), stream);
+        if (it == this->streams_.end()) return;
+        this->streams_.erase(it);
+        std::cout << "[AudioMixer] Stream removed (" << this->streams_.size() << " active).\n";
+        if (!this->streams_.empty()) return;
+
+        this->close_device();
+        finished = std::move(this->thread_);
+    }
+    // Joined outside the lock: the thread may be waiting for it in pump()
+    if (finished.joinable()) {
+        finished.request_stop();
+        finished.join();
+    }
+}
+
+bool AudioMixer::is_open() const {
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    return this->pcm_ != nullptr;
+}
+
+AudioMixerStats AudioMixer::stats() const {
+    AudioMixerStats s;
+    s.frames_written = this->frames_written_.load(std::memory_order_relaxed);
+    s.underruns = this->underruns_.load(std::memory_order_acquire);
+    s.stream_underruns = this->stream_underruns_.load(std::memory_order_relaxed);
+    s.reopens = this->reopens_.load(std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    s.streams = this->streams_.size();
+    return s;
+}
+
+uint64_t AudioMixer::recoveries() const {
+    return this->underruns_.load(std::memory_order_relaxed) + this->reopens_.load(std::memory_order_relaxed);
+}
+
+bool AudioMixer::open_device(const std::string& device_name) {
+    std::cout << "[AudioMixer] Opening ALSA device (Non-blocking): " << device_name << "\n";
+    // SND_PCM_NONBLOCK: the mixer thread paces itself and never parks inside ALSA
+    int err = snd_pcm_open(&this->pcm_, device_name.c_str(), SND_PCM_STREAM_PLAYBACK, SND_PCM_NONBLOCK);
+    std::string opened = device_name;
+    if (err < 0) {
+        std::cerr << "ALSA: Cannot open audio device " << device_name << ": " << snd_strerror(err) << "\n";
+#ifdef PLATFORM_RPI
+        // Pi-optimized fallbacks: HDMI is typically plughw:0,0 or plughw:1,0
+        const std::vector<std::string> fallbacks = {"plughw:0,0", "plughw:1,0", "default"};
+#else
+        // If 'default' fails due to dmix/slave issues, try hardware directly.
+        // Card 0 Device 3 is ARZOPA (common display)
+        const std::vector<std::string> fallbacks = {"plughw:0,3", "plughw:0,7", "plughw:0,8", "plughw:0,0", "default"};
+#endif
+        for (const auto& fb : fallbacks) {
+            if (fb == device_name) continue;
+            std::cout << "ALSA: Trying fallback device '" << fb << "'...\n";
+            err = snd_pcm_open(&this->pcm_, fb.c_str(), SND_PCM_STREAM_PLAYBACK, SND_PCM_NONBLOCK);
+            if (err >= 0) {
+                std::cout << "ALSA: Successfully opened fallback device '" << fb << "'\n";
+                opened = fb;
+                break;
+            }
+            std::cerr << "ALSA: Fallback to '" << fb << "' failed: " << snd_strerror(err) << "\n";
+        }
+    }
+    if (err < 0) {
+        this->pcm_ = nullptr;
+        return false;
+    }
+    if (!this->configure_device()) {
+        snd_pcm_close(this->pcm_);
+        this->pcm_ = nullptr;
+        return false;
+    }
+    this->device_name_ = opened;
+    this->error_count_ = 0;
+    return true;
+}
+
+bool AudioMixer::configure_device() {
+    snd_pcm_hw_params_t *params;
+    snd_pcm_hw_params_alloca(&params);
+    snd_pcm_hw_params_any(this->pcm_, params);
+    snd_pcm_hw_params_set_access(this->pcm_, params, SND_PCM_ACCESS_RW_INTERLEAVED);
+
+    // Mix in float when the device takes it (headroom, and decoded AAC/Opus is float already).
+    // After a reopen the format and rate must stay what the streams were created with.
+    bool reopening = !this->streams_.empty();
+    if (!reopening) {
+        this->is_float_ = snd_pcm_hw_params_test_format(this->pcm_, params, SND_PCM_FORMAT_FLOAT_LE) == 0;
+        this->rate_ = 48000;
+        if (snd_pcm_hw_params_test_rate(this->pcm_, params, 48000, 0) != 0 &&
+            snd_pcm_hw_params_test_rate(this->pcm_, params, 44100, 0) == 0) {
+            this->rate_ = 44100;
+        }
+    }
+    snd_pcm_format_t format = this->is_float_ ? SND_PCM_FORMAT_FLOAT_LE : SND_PCM_FORMAT_S16_LE;
+    unsigned int rate = this->rate_;
+    int dir = 0;
+    std::cout << "[AudioMixer] Initializing ALSA PCM for " << rate << "Hz, 2 channels, "
+              << (this->is_float_ ? "FLOAT_LE" : "S16_LE") << "\n";
+    snd_pcm_hw_params_set_format(this->pcm_, params, format);
+    snd_pcm_hw_params_set_channels(this->pcm_, params, 2);
+    snd_pcm_hw_params_set_rate_near(this->pcm_, params, &rate, &dir);
+
+    // Large device buffer to ride out scheduling spikes; the mixer only keeps
+    // target_queue_frames_ of it filled so gain changes are heard promptly
+#ifdef PLATFORM_RPI
+    snd_pcm_uframes_t buffer_size = rate / 2; // 0.5 seconds
+#else
+    snd_pcm_uframes_t buffer_size = rate + (rate / 2); // 1.5 seconds
+#endif
+    snd_pcm_hw_params_set_buffer_size_near(this->pcm_, params, &buffer_size);
+    snd_pcm_uframes_t period_size = rate / 10;
+    snd_pcm_hw_params_set_period_size_near(this->pcm_, params, &period_size, &dir);
+
+    int hw_err = snd_pcm_hw_params(this->pcm_, params);
+    if (hw_err < 0) {
+        std::cerr << "ALSA: FATAL: Failed to apply hardware parameters: " << snd_strerror(hw_err) << "\n";
+        return false;
+    }
+    if (!reopening) {
+        this->rate_ = rate;
+    }
+
+    snd_pcm_sw_params_t *sw_params;
+    snd_pcm_sw_params_alloca(&sw_params);
+    snd_pcm_sw_params_current(this->pcm_, sw_params);
+    // Start as soon as anything is written: streams are prebuffered before they join the mix
+    snd_pcm_sw_params_set_start_threshold(this->pcm_, sw_params, 1);
+    snd_pcm_sw_params_set_avail_min(this->pcm_, sw_params, period_size);
+    snd_pcm_sw_params(this->pcm_, sw_params);
+
+    this->buffer_frames_ = buffer_size;
+    this->block_frames_ = std::max<size_t>(this->rate_ / 100, 1);
+    this->target_queue_frames_ = std::min<size_t>(this->rate_ / 5, buffer_size);
+    this->mix_buffer_.resize(this->block_frames_ * (this->is_float_ ? 2 * sizeof(float) : 2 * sizeof(int16_t)));
+    this->pending_offset_ = 0;
+    this->pending_frames_ = 0;
+    return true;
+}
+
+void AudioMixer::close_device() {
+    if (!this->pcm_) return;
+    snd_pcm_drop(this->pcm_);
+    snd_pcm_close(this->pcm_);
+    this->pcm_ = nullptr;
+    this->pending_offset_ = 0;
+    this->pending_frames_ = 0;
+    std::cout << "[AudioMixer] Device '" << this->device_name_ << "' closed.\n";
+}
+
+size_t AudioMixer::mix_block(size_t frames) {
+    size_t frame_bytes = this->is_float_ ? 2 * sizeof(float) : 2 * sizeof(int16_t);
+    std::memset(this->mix_buffer_.data(), 0, frames * frame_bytes);
+
+    // Ducking applies while a ducking stream is actually audible
+    bool ducked = false;
+    for (const auto& s : this->streams_) {
+        if (s->ducks_others_.load(std::memory_order_relaxed) && !s->paused_.load(std::memory_order_relaxed) &&
+            !s->prebuffering_ && s->readable_frames() > 0) {
+            ducked = true;
+            break;
+        }
+    }
+
+    size_t produced = 0;
+    for (const auto& s : this->streams_) {
+        if (s->paused_.load(std::memory_order_relaxed)) continue;
+
+        size_t available = s->readable_frames();
+        if (s->prebuffering_) {
+            if (available < s->prebuffer_frames_) continue;
+            s->prebuffering_ = false;
+        }
+        if (available == 0) {
+            s->prebuffering_ = true;
+            this->stream_underruns_.fetch_add(1, std::memory_order_relaxed);
+            s->underruns_.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        // Ramp towards the target gain over ~200 ms so ducking doesn't click
+        float target = s->gain_.load(std::memory_order_relaxed);
+        if (ducked && !s->ducks_others_.load(std::memory_order_relaxed)) target *= kDuckGain;
+        constexpr float kGainStep = 0.05f;
+        s->applied_gain_ += std::clamp(target - s->applied_gain_, -kGainStep, kGainStep);
+        float gain = s->applied_gain_;
+
+        size_t n = std::min(available, frames);
+        size_t out_frame = 0;
+        s->consume(n, [&](const uint8_t* data, size_t count) {
+            if (this->is_float_) {
+                mix_add_f32(reinterpret_cast<float*>(this->mix_buffer_.data()) + 2 * out_frame,
+                            reinterpret_cast<const float*>(data), 2 * count, gain);
+            } else {
+                int gain_q15 = gain >= 1.0f ? 32768 : static_cast<int>(std::lround(gain * 32768.0f));
+                mix_add_s16(reinterpret_cast<int16_t*>(this->mix_buffer_.data()) + 2 * out_frame,
+                            reinterpret_cast<const int16_t*>(data), 2 * count, gain_q15);
+            }
+            out_frame += count;
+        });
+        produced = std::max(produced, n);
+    }
+
+    if (this->is_float_ && produced > 0) {
+        clamp_f32(reinterpret_cast<float*>(this->mix_buffer_.data()), 2 * produced);
+    }
+    return produced;
+}
+
+bool AudioMixer::pump() {
+    std::lock_guard<std::mutex> lock(this->mutex_);
+
+    if (!this->pcm_) {
+        // Persistent recovery: reopen the device we lost, every 5 seconds
+        auto now = std::chrono::steady_clock::now();
+        if (this->streams_.empty() || this->device_name_.empty() ||
+            now - this->last_reopen_attempt_ < std::chrono::seconds(5)) {
+            return false;
+        }
+        this->last_reopen_attempt_ = now;
+        std::cout << "ALSA: Retrying to open device '" << this->device_name_ << "'\n";
+        if (!this->open_device(this->device_name_)) return false;
+        this->reopens_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (this->pending_frames_ == 0) {
+        snd_pcm_sframes_t avail = snd_pcm_avail_update(this->pcm_);
+        if (avail < 0) {
+            this->handle_write_error(avail);
+            return false;
+        }
+        snd_pcm_sframes_t queued = static_cast<snd_pcm_sframes_t>(this->buffer_frames_) - avail;
+        this->output_latency_us_.store(static_cast<uint64_t>(std::max<snd_pcm_sframes_t>(queued, 0)) * 1000000 / this->rate_,
+                                       std::memory_order_relaxed);
+        snd_pcm_sframes_t room = static_cast<snd_pcm_sframes_t>(this->target_queue_frames_) - queued;
+        if (room <= 0) return false;
+
+        size_t mixed = this->mix_block(std::min<size_t>(room, this->block_frames_));
+        if (mixed == 0) return false;
+        this->pending_offset_ = 0;
+        this->pending_frames_ = mixed;
+    }
+
+    size_t frame_bytes = this->is_float_ ? 2 * sizeof(float) : 2 * sizeof(int16_t);
+    snd_pcm_sframes_t written = snd_pcm_writei(this->pcm_, this->mix_buffer_.data() + this->pending_offset_ * frame_bytes,
+                                               this->pending_frames_);
+    if (written > 0) {
+        this->error_count_ = 0;
+        this->pending_offset_ += written;
+        this->pending_frames_ -= written;
+        this->frames_written_.fetch_add(written, std::memory_order_relaxed);
+        return true;
+    }
+    if (written != -EAGAIN) {
+        this->handle_write_error(written);
+    }
+    return false;
+}
+
+void AudioMixer::handle_write_error(snd_pcm_sframes_t err) {
+    if (err == -EPIPE) {
+        std::cerr << "ALSA: Underrun (EPIPE). Preparing device...\n";
+        snd_pcm_prepare(this->pcm_);
+        this->underruns_.fetch_add(1, std::memory_order_release);
+        return;
+    }
+    if (err == -ESTRPIPE) {
+        std::cerr << "ALSA: Suspended (ESTRPIPE). Resuming...\n";
+        int res;
+        while ((res = snd_pcm_resume(this->pcm_)) == -EAGAIN) sleep(1);
+        if (res < 0) {
+            snd_pcm_prepare(this->pcm_);
+        }
+        return;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if (now - this->last_error_log_ >= std::chrono::seconds(5)) {
+        std::cerr << "ALSA: Write error: " << snd_strerror(static_cast<int>(err)) << " (" << err
+                  << "). Recovering (Count: " << this->error_count_ << ")...\n";
+        this->last_error_log_ = now;
+    }
+    // ALSA's built-in recovery first; persistent failure closes the device for a reopen
+    if (snd_pcm_recover(this->pcm_, static_cast<int>(err), 0) < 0 && ++this->error_count_ > 10) {
+        std::cerr << "ALSA: Persistent failure. Forcing device close/reopen.\n";
+        std::string device = this->device_name_;
+        this->close_device();
+        this->device_name_ = device;
+        this->error_count_ = 0;
+        this->last_reopen_attempt_ = {};
+    }
+}
+
+void AudioMixer::run(std::stop_token stop) {
+    while (!stop.stop_requested()) {
+        // Write back-to-back while the device has room, then sleep a fraction of a block
+        if (!this->pump()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    }
+}
+
+} // namespace nuc_display::modules
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include <alsa/asoundlib.h>
+}
+
+namespace nuc_display::modules {
+
+// One input of the AudioMixer: a single-producer/single-consumer ring of
+// interleaved stereo frames in the mixer's sample format and rate. The
+// decoder writes from its own thread, the mixer thread reads.
+class AudioStream {
+public:
+    AudioStream(size_t capacity_frames, size_t prebuffer_frames, unsigned int rate, bool is_float);
+
+    AudioStream(const AudioStream&) = delete;
+    AudioStream& operator=(const AudioStream&) = delete;
+
+    // Producer side. Returns the frames accepted (fewer than asked when the ring is full).
+    size_t write(const uint8_t* data, size_t frames);
+    // Drop everything queued so far (seek, next playlist item)
+    void flush();
+    size_t queued_frames() const;
+
+    void set_gain(float gain);           // 0..1
+    void set_ducking(bool ducks_others); // While this stream plays, every other one is lowered
+    void set_paused(bool paused);
+    // Times this stream ran dry while playing
+    uint64_t underruns() const { return this->underruns_.load(std::memory_order_relaxed); }
+
+    unsigned int rate() const { return this->rate_; }
+    bool is_float() const { return this->is_float_; }
+    size_t frame_bytes() const { return this->frame_bytes_; }
+
+private:
+    friend class AudioMixer;
+
+    // Consumer side (mixer thread)
+    size_t readable_frames();
+    template <typename Fn> void consume(size_t frames, Fn&& fn);
+
+    std::vector<uint8_t> ring_;
+    size_t capacity_frames_;
+    size_t prebuffer_frames_;
+    unsigned int rate_;
+    bool is_float_;
+    size_t frame_bytes_;
+
+    // Monotonic frame positions; index = pos % capacity
+    std::atomic<uint64_t> write_pos_{0};
+    std::atomic<uint64_t> read_pos_{0};
+    std::atomic<uint64_t> discard_until_{0};
+    std::atomic<float> gain_{1.0f};
+    std::atomic<bool> ducks_others_{false};
+    std::atomic<bool> paused_{false};
+    std::atomic<uint64_t> underruns_{0};
+
+    // Owned by the mixer thread
+    bool prebuffering_ = true;
+    float applied_gain_ = 1.0f;
+};
+
+struct AudioMixerStats {
+    uint64_t frames_written = 0;
+    uint64_t underruns = 0;       // Device xruns (EPIPE)
+    uint64_t stream_underruns = 0; // A stream ran dry while playing
+    uint64_t reopens = 0;         // Device closed and reopened after persistent errors
+    size_t streams = 0;
+};
+
+// Process-wide software mixer. Owns the only PCM handle, so any number of
+// audio-enabled video regions can share one HDMI device. A dedicated thread
+// mixes every stream in small blocks (saturating SIMD adds), keeps the device
+// queue at a short target latency, and handles underruns and device recovery
+// for everyone.
+class AudioMixer {
+public:
+    static AudioMixer& shared();
+
+    // threaded = false leaves the mixing to explicit pump() calls (tests)
+    explicit AudioMixer(bool threaded = true);
+    ~AudioMixer();
+
+    AudioMixer(const AudioMixer&) = delete;
+    AudioMixer& operator=(const AudioMixer&) = delete;
+
+    // The first stream opens and configures the device and starts the mixer
+    // thread. Later streams mix into that device whatever they ask for.
+    // Returns nullptr if no device could be opened.
+    std::shared_ptr<AudioStream> add_stream(const std::string& device_name);
+    // The device is closed and the thread stopped with the last stream
+    void remove_stream(const std::shared_ptr<AudioStream>& stream);
+
+    // One mixing cycle: mix a block and write it. True if frames reached the device.
+    bool pump();
+
+    bool is_open() const;
+    AudioMixerStats stats() const;
+    // Device xruns recovered plus reopens, without taking the mixer lock
+    uint64_t recoveries() const;
+    // Mixed audio queued in the device (and the block not yet written), as of the last pump()
+    double output_latency_sec() const { return this->output_latency_us_.load(std::memory_order_relaxed) / 1e6; }
+
+    static constexpr float kDuckGain = 0.25f;
+
+private:
+    bool open_device(const std::string& device_name);
+    bool configure_device();
+    void close_device();
+    size_t mix_block(size_t frames);
+    void handle_write_error(snd_pcm_sframes_t err);
+    void run(std::stop_token stop);
+
+    bool threaded_;
+    mutable std::mutex mutex_;
+    std::jthread thread_;
+    std::vector<std::shared_ptr<AudioStream>> streams_;
+
+    snd_pcm_t* pcm_ = nullptr;
+    std::string device_name_;
+    bool is_float_ = false;
+    unsigned int rate_ = 48000;
+    snd_pcm_uframes_t buffer_frames_ = 0;
+    size_t block_frames_ = 480;         // 10 ms
+    size_t target_queue_frames_ = 9600; // 200 ms kept queued in the device
+
+    // Mixed block not yet fully accepted by the device
+    std::vector<uint8_t> mix_buffer_;
+    size_t pending_offset_ = 0;
+    size_t pending_frames_ = 0;
+
+    int error_count_ = 0;
+    std::chrono::steady_clock::time_point last_error_log_{};
+    std::chrono::steady_clock::time_point last_reopen_attempt_{};
+
+    std::atomic<uint64_t> frames_written_{0};
+    std::atomic<uint64_t> underruns_{0};
+    std::atomic<uint64_t> stream_underruns_{0};
+    std::atomic<uint64_t> reopens_{0};
+    std::atomic<uint64_t> output_latency_us_{0};
+};
+
+} // namespace nuc_display::modules
@@ -1,8 +1,13 @@
 #include "modules/camera_module.hpp"
+#include "modules/yuv_color.hpp"
 #include "core/renderer.hpp"
 #include <iostream>
 #include <fstream>
 #include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
 #include <cstring>
 #include <fcntl.h>
 #include <unistd.h>
@@ -13,15 +18,14 @@
 #include <sys/stat.h>
 #include <linux/videodev2.h>
 #include <drm_fourcc.h>
-
-// MJPEG → RGB decode via libjpeg (software fallback)
-#include <jpeglib.h>
+#include <gbm.h>
 
 namespace nuc_display::modules {
 
 // --- Helpers ---
 
 static uint32_t pixel_format_from_string(const std::string& fmt) {
+    if (fmt.empty() || fmt == "auto" || fmt == "AUTO") return 0; // Negotiated
     if (fmt == "MJPG" || fmt == "mjpg") return V4L2_PIX_FMT_MJPEG;
     if (fmt == "YUYV" || fmt == "yuyv") return V4L2_PIX_FMT_YUYV;
     if (fmt == "NV12" || fmt == "nv12") return V4L2_PIX_FMT_NV12;
@@ -29,8 +33,9 @@ static uint32_t pixel_format_from_string(const std::string& fmt) {
     return V4L2_PIX_FMT_MJPEG; // Default
 }
 
-static const char* fourcc_to_string(uint32_t fourcc) {
-    static char buf[5];
+static std::string fourcc_to_string(uint32_t fourcc) {
+    // By value: several capture threads log at once
+    char buf[5];
     buf[0] = fourcc & 0xFF;
     buf[1] = (fourcc >> 8) & 0xFF;
     buf[2] = (fourcc >> 16) & 0xFF;
@@ -39,45 +44,87 @@ static const char* fourcc_to_string(uint32_t fourcc) {
     return buf;
 }
 
-static bool decode_mjpeg_to_rgb(const uint8_t* mjpeg_data, size_t mjpeg_size,
-                                 uint8_t* rgb_out, int expected_w, int expected_h) {
-    struct jpeg_decompress_struct cinfo;
-    struct jpeg_error_mgr jerr;
-    cinfo.err = jpeg_std_error(&jerr);
-    jpeg_create_decompress(&cinfo);
-    
-    jpeg_mem_src(&cinfo, mjpeg_data, mjpeg_size);
-    if (jpeg_read_header(&cinfo, TRUE) != JPEG_HEADER_OK) {
-        jpeg_destroy_decompress(&cinfo);
-        return false;
-    }
-    
-    cinfo.out_color_space = JCS_RGB;
-    jpeg_start_decompress(&cinfo);
-    
-    if ((int)cinfo.output_width != expected_w || (int)cinfo.output_height != expected_h) {
-        jpeg_abort_decompress(&cinfo);
-        jpeg_destroy_decompress(&cinfo);
-        return false;
-    }
-    
-    int row_stride = cinfo.output_width * 3;
-    while (cinfo.output_scanline < cinfo.output_height) {
-        uint8_t* row = rgb_out + cinfo.output_scanline * row_stride;
-        jpeg_read_scanlines(&cinfo, &row, 1);
-    }
-    
-    jpeg_finish_decompress(&cinfo);
-    jpeg_destroy_decompress(&cinfo);
-    return true;
-}
-
 // --- CameraModule ---
 
 CameraModule::CameraModule() {}
 
 CameraModule::~CameraModule() {
+    stop();
+    for (auto& frame : mailbox_.slots()) {
+        if (frame.dmabuf_fd >= 0) ::close(frame.dmabuf_fd);
+        frame.dmabuf_fd = -1;
+    }
+    release_gl();
+}
+
+void CameraModule::start(const CameraConfig& config, int screen_width, int screen_height) {
+    stop();
+    config_ = config;
+    screen_width_ = screen_width;
+    screen_height_ = screen_height;
+    frames_captured_ = 0;
+    decode_latency_.reset();
+    published_stats_.publish(CameraStats{});
+    thread_ = std::jthread([this](std::stop_token stop) { run(stop); });
+}
+
+void CameraModule::stop() {
+    if (!thread_.joinable()) return;
+    thread_.request_stop();
+    thread_ = std::jthread(); // Joins; the thread closes the device on its way out
+}
+
+void CameraModule::run(std::stop_token stop) {
+    bool first_attempt = true;
+    auto next_attempt = std::chrono::steady_clock::now();
+    while (!stop.stop_requested()) {
+        if (!is_open()) {
+            auto now = std::chrono::steady_clock::now();
+            if (now < next_attempt) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(kPollTimeoutMs));
+                continue;
+            }
+            // Hot-plug: keep trying every few seconds until the device shows up
+            if (!open(config_)) {
+                if (first_attempt) std::cout << "[Camera] Not available yet (will retry via hot-plug).\n";
+                first_attempt = false;
+                next_attempt = now + std::chrono::seconds(kRetrySec);
+                continue;
+            }
+            first_attempt = false;
+        }
+        if (use_dmabuf_ && dmabuf_rejected_.load(std::memory_order_relaxed)) {
+            // Reopen at once with driver buffers uploaded through the shader
+            std::cerr << "[Camera] GPU can't import " << fourcc_to_string(capture_fourcc_)
+                      << " buffers, reopening with software upload.\n";
+            close();
+            continue;
+        }
+        if (!capture_frame()) {
+            std::cerr << "[Camera] " << device_path() << " disconnected. Will retry.\n";
+            close();
+            next_attempt = std::chrono::steady_clock::now() + std::chrono::seconds(kRetrySec);
+        }
+    }
     close();
+    release_gbm();
+}
+
+std::string CameraModule::device_path() const {
+    std::lock_guard<std::mutex> lock(info_mutex_);
+    return device_path_;
+}
+
+std::string CameraModule::device_name() const {
+    std::lock_guard<std::mutex> lock(info_mutex_);
+    return device_name_;
+}
+
+CameraStats CameraModule::stats() const {
+    CameraStats s = published_stats_.load();
+    s.open = is_open();
+    s.decode = decode_latency_.summary();
+    return s;
 }
 
 bool CameraModule::is_capture_device(const std::string& path) {
@@ -143,8 +190,7 @@ bool CameraModule::open(const CameraConfig& config) {
         }
     }
     
-    uint32_t fourcc = pixel_format_from_string(config.pixel_format);
-    if (!init_v4l2(device, config.width, config.height, config.fps, fourcc)) {
+    if (!init_v4l2(device, capture_request(config, device))) {
         return false;
     }
     
@@ -152,27 +198,117 @@ bool CameraModule::open(const CameraConfig& config) {
         cleanup_v4l2();
         return false;
     }
+    session_++;
+    open_.store(true, std::memory_order_release);
     
     std::cout << "[Camera] Opened " << device_name_ << " (" << device_path_ 
               << ") @ " << capture_width_ << "x" << capture_height_ 
               << " " << fourcc_to_string(capture_fourcc_)
-              << (use_dmabuf_ ? " [DMA-BUF zero-copy]" : " [software upload]") << "\n";
+              << (buffer_memory_ == V4L2_MEMORY_DMABUF ? " [GBM buffers, zero-copy]"
+                  : use_dmabuf_ ? " [DMA-BUF zero-copy]" : " [software upload]") << "\n";
     return true;
 }
 
-bool CameraModule::init_v4l2(const std::string& device, int w, int h, int fps, uint32_t fourcc) {
+CaptureRequest CameraModule::capture_request(const CameraConfig& config, const std::string& device) const {
+    CaptureRequest request;
+    request.fourcc = pixel_format_from_string(config.pixel_format);
+    request.fps = config.fps;
+    // The configured size is the most worth capturing; a smaller on-screen rect needs less
+    request.width = config.width;
+    request.height = config.height;
+    if (screen_width_ > 0 && screen_height_ > 0 && config.src_w > 0.0f && config.src_h > 0.0f) {
+        request.width = std::min(request.width, static_cast<int>(std::lround(config.w * screen_width_ / config.src_w)));
+        request.height = std::min(request.height, static_cast<int>(std::lround(config.h * screen_height_ / config.src_h)));
+    }
+    request.bandwidth_bytes_per_sec = usb_bandwidth(device);
+    return request;
+}
+
+std::vector<CaptureMode> CameraModule::enumerate_modes(int fd, const CaptureRequest& request) {
+    std::vector<CaptureMode> modes;
+    struct v4l2_fmtdesc fmtdesc;
+    memset(&fmtdesc, 0, sizeof(fmtdesc));
+    fmtdesc.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    for (fmtdesc.index = 0; ioctl(fd, VIDIOC_ENUM_FMT, &fmtdesc) == 0; ++fmtdesc.index) {
+        std::vector<std::pair<uint32_t, uint32_t>> sizes;
+        struct v4l2_frmsizeenum frmsize;
+        memset(&frmsize, 0, sizeof(frmsize));
+        frmsize.pixel_format = fmtdesc.pixelformat;
+        for (frmsize.index = 0; ioctl(fd, VIDIOC_ENUM_FRAMESIZES, &frmsize) == 0; ++frmsize.index) {
+            if (frmsize.type == V4L2_FRMSIZE_TYPE_DISCRETE) {
+                sizes.emplace_back(frmsize.discrete.width, frmsize.discrete.height);
+                continue;
+            }
+            // Stepwise/continuous (a single entry): both ends, plus the first step covering the request
+            const struct v4l2_frmsize_stepwise& range = frmsize.stepwise;
+            auto snap = [](int want, uint32_t min, uint32_t max, uint32_t step) {
+                uint32_t v = std::clamp<uint32_t>(static_cast<uint32_t>(want), min, max);
+                if (step > 1) v = std::min(max, min + (v - min + step - 1) / step * step);
+                return v;
+            };
+            sizes.emplace_back(range.min_width, range.min_height);
+            sizes.emplace_back(range.max_width, range.max_height);
+            if (request.width > 0 && request.height > 0) {
+                sizes.emplace_back(snap(request.width, range.min_width, range.max_width, range.step_width),
+                                   snap(request.height, range.min_height, range.max_height, range.step_height));
+            }
+            break;
+        }
+        
+        for (auto [width, height] : sizes) {
+            CaptureMode mode;
+            mode.fourcc = fmtdesc.pixelformat;
+            mode.width = static_cast<int>(width);
+            mode.height = static_cast<int>(height);
+            struct v4l2_frmivalenum frmival;
+            memset(&frmival, 0, sizeof(frmival));
+            frmival.pixel_format = fmtdesc.pixelformat;
+            frmival.width = width;
+            frmival.height = height;
+            for (frmival.index = 0; ioctl(fd, VIDIOC_ENUM_FRAMEINTERVALS, &frmival) == 0; ++frmival.index) {
+                const struct v4l2_fract& interval =
+                    frmival.type == V4L2_FRMIVAL_TYPE_DISCRETE ? frmival.discrete : frmival.stepwise.min;
+                if (interval.numerator > 0) {
+                    mode.max_fps = std::max(mode.max_fps, static_cast<double>(interval.denominator) / interval.numerator);
+                }
+                if (frmival.type != V4L2_FRMIVAL_TYPE_DISCRETE) break;
+            }
+            modes.push_back(mode);
+        }
+    }
+    return modes;
+}
+
+double CameraModule::usb_bandwidth(const std::string& device) {
+    // /sys/class/video4linux/videoN/device is the UVC interface; its parent, the USB
+    // device, has the link speed in Mbit/s. No speed file: not USB (CSI, vivid), no limit.
+    char resolved[PATH_MAX];
+    if (!realpath(device.c_str(), resolved)) return 0.0;
+    std::string node = resolved;
+    node = node.substr(node.find_last_of('/') + 1);
+    if (!realpath(("/sys/class/video4linux/" + node + "/device").c_str(), resolved)) return 0.0;
+    std::string interface = resolved;
+    std::ifstream speed_file(interface.substr(0, interface.find_last_of('/')) + "/speed");
+    double mbps = 0.0;
+    if (!(speed_file >> mbps) || mbps <= 0.0) return 0.0;
+    return mbps * 1e6 / 8.0 * kUsbIsoShare;
+}
+
+bool CameraModule::init_v4l2(const std::string& device, const CaptureRequest& request) {
     v4l2_fd_ = ::open(device.c_str(), O_RDWR | O_NONBLOCK);
     if (v4l2_fd_ < 0) {
         std::cerr << "[Camera] Failed to open " << device << ": " << strerror(errno) << "\n";
         return false;
     }
-    device_path_ = device;
     
     // Query device name
     struct v4l2_capability cap;
     memset(&cap, 0, sizeof(cap));
-    if (ioctl(v4l2_fd_, VIDIOC_QUERYCAP, &cap) == 0) {
-        device_name_ = reinterpret_cast<const char*>(cap.card);
+    bool have_cap = ioctl(v4l2_fd_, VIDIOC_QUERYCAP, &cap) == 0;
+    {
+        std::lock_guard<std::mutex> lock(info_mutex_);
+        device_path_ = device;
+        if (have_cap) device_name_ = reinterpret_cast<const char*>(cap.card);
     }
     
     if (!(cap.capabilities & V4L2_CAP_VIDEO_CAPTURE) || !(cap.capabilities & V4L2_CAP_STREAMING)) {
@@ -181,10 +317,36 @@ bool CameraModule::init_v4l2(const std::string& device, int w, int h, int fps, u
         return false;
     }
     
-    // Try to set the requested format exactly as specified in the config.
-    // We shouldn't silently fallback to NV12/YUYV if the user requested MJPEG, 
-    // because USB webcams often lack bandwidth for uncompressed YUYV at high resolutions 
-    // leading to "cannot set freq at ep" USB errors.
+    // Pick the cheapest mode the device offers for the on-screen size and fps. An
+    // explicitly configured format is kept (no silent fallback to YUYV when MJPEG was
+    // asked for); uncompressed modes the USB link can't carry are never picked, as
+    // those end in "cannot set freq at ep" errors.
+    std::string name = have_cap ? reinterpret_cast<const char*>(cap.card) : device;
+    CaptureModeCache& cache = CaptureModeCache::shared();
+    std::optional<CaptureMode> mode = cache.find(name, request);
+    bool cached = mode.has_value();
+    if (!mode) {
+        std::vector<CaptureMode> modes = enumerate_modes(v4l2_fd_, request);
+        mode = choose_capture_mode(modes, request);
+        if (mode) {
+            cache.store(name, request, *mode);
+            std::cout << "[Camera] " << name << ": " << modes.size() << " modes, chose "
+                      << fourcc_to_string(mode->fourcc) << " " << mode->width << "x" << mode->height
+                      << " for " << request.width << "x" << request.height << "@" << request.fps;
+            if (request.bandwidth_bytes_per_sec > 0.0) {
+                std::cout << " (USB budget " << static_cast<int>(request.bandwidth_bytes_per_sec / 1e6) << " MB/s)";
+            }
+            std::cout << "\n";
+        } else {
+            // Nothing enumerated (or nothing usable): ask for the request and let the driver adjust
+            mode = CaptureMode{request.fourcc != 0 ? request.fourcc : V4L2_PIX_FMT_MJPEG,
+                               request.width, request.height, 0.0};
+        }
+    }
+    uint32_t fourcc = mode->fourcc;
+    int w = mode->width;
+    int h = mode->height;
+    int fps = request.fps;
     
     struct v4l2_format fmt;
     memset(&fmt, 0, sizeof(fmt));
@@ -198,7 +360,23 @@ bool CameraModule::init_v4l2(const std::string& device, int w, int h, int fps, u
         capture_fourcc_ = fmt.fmt.pix.pixelformat;
         capture_width_ = fmt.fmt.pix.width;
         capture_height_ = fmt.fmt.pix.height;
+        capture_stride_ = fmt.fmt.pix.bytesperline;
+        capture_size_image_ = fmt.fmt.pix.sizeimage;
+        
+        // Colour encoding for the YUV shaders, with the kernel's defaults for unset fields
+        uint32_t ycbcr_enc = fmt.fmt.pix.ycbcr_enc;
+        if (ycbcr_enc == V4L2_YCBCR_ENC_DEFAULT) ycbcr_enc = V4L2_MAP_YCBCR_ENC_DEFAULT(fmt.fmt.pix.colorspace);
+        uint32_t quantization = fmt.fmt.pix.quantization;
+        if (quantization == V4L2_QUANTIZATION_DEFAULT) {
+            quantization = V4L2_MAP_QUANTIZATION_DEFAULT(false, fmt.fmt.pix.colorspace, ycbcr_enc);
+        }
+        capture_bt709_ = ycbcr_enc == V4L2_YCBCR_ENC_709;
+        capture_full_range_ = quantization == V4L2_QUANTIZATION_FULL_RANGE;
         
+        // A cached mode the device no longer takes as is gets negotiated again next time
+        if (cached && (capture_width_ != w || capture_height_ != h || capture_fourcc_ != fourcc)) {
+            cache.invalidate(name, request);
+        }
         if (capture_width_ != w || capture_height_ != h) {
             std::cerr << "[Camera] Warning: Kernel adjusted resolution for " << device 
                       << " from " << w << "x" << h << " to " 
@@ -211,10 +389,10 @@ bool CameraModule::init_v4l2(const std::string& device, int w, int h, int fps, u
     } else {
         std::cerr << "[Camera] Failed to set format " << fourcc_to_string(fourcc) 
                   << " at " << w << "x" << h << " on " << device << "\n";
+        if (cached) cache.invalidate(name, request);
                   
-        // Print supported formats to help debugging (only once per failure to avoid spam)
-        static bool format_printed = false;
-        if (!format_printed) {
+        // Print supported formats to help debugging (once per camera to avoid spam)
+        if (!formats_listed_) {
             std::cerr << "[Camera] Supported formats for " << device << ":\n";
             struct v4l2_fmtdesc fmtdesc;
             memset(&fmtdesc, 0, sizeof(fmtdesc));
@@ -225,7 +403,7 @@ bool CameraModule::init_v4l2(const std::string& device, int w, int h, int fps, u
                           << fourcc_to_string(fmtdesc.pixelformat) << ")\n";
                 fmtdesc.index++;
             }
-            format_printed = true;
+            formats_listed_ = true;
         }
         
         cleanup_v4l2();
@@ -240,7 +418,26 @@ bool CameraModule::init_v4l2(const std::string& device, int w, int h, int fps, u
     parm.parm.capture.timeperframe.denominator = fps;
     ioctl(v4l2_fd_, VIDIOC_S_PARM, &parm); // Best-effort, not all cameras support this
     
-    // Request buffers (MMAP)
+    // Plane layout for DMA-BUF import, from the driver's bytesperline/sizeimage
+    std::optional<CapturePlanes> planes = capture_planes(capture_fourcc_, capture_width_, capture_height_,
+                                                         capture_stride_, capture_size_image_);
+    bool importable = planes.has_value();
+    bool gpu_import = importable && !dmabuf_rejected_.load(std::memory_order_relaxed);
+    if (planes) {
+        capture_stride_ = planes->pitch;
+        capture_uv_offset_ = planes->uv_offset;
+    }
+    
+    // Best case: the camera writes straight into GBM buffers the GPU imports
+    if (gpu_import && alloc_gbm_buffers()) {
+        buffer_memory_ = V4L2_MEMORY_DMABUF;
+        use_dmabuf_ = true;
+        sw_upload_ = false;
+        return true;
+    }
+    buffer_memory_ = V4L2_MEMORY_MMAP;
+    
+    // Otherwise driver buffers (MMAP), exported with EXPBUF where the driver can
     struct v4l2_requestbuffers req;
     memset(&req, 0, sizeof(req));
     req.count = NUM_BUFFERS;
@@ -300,27 +497,93 @@ bool CameraModule::init_v4l2(const std::string& device, int w, int h, int fps, u
     if (capture_fourcc_ == V4L2_PIX_FMT_MJPEG || capture_fourcc_ == V4L2_PIX_FMT_JPEG) {
         use_dmabuf_ = false;
         sw_upload_ = true;
-        rgb_buffer_.resize(capture_width_ * capture_height_ * 3);
-    } else if (!use_dmabuf_) {
+    } else if (!use_dmabuf_ || !gpu_import) {
+        use_dmabuf_ = false;
+        // YUYV/NV12 without DMA-BUF: raw planes uploaded and converted in the shader
         sw_upload_ = true;
-        // For YUYV/NV12 without DMA-BUF, we'd need to convert to RGB
-        // For simplicity, we try to use the raw buffer with glTexImage2D
-        rgb_buffer_.resize(capture_width_ * capture_height_ * 3);
     }
     
     return true;
 }
 
+bool CameraModule::alloc_gbm_buffers() {
+    if (gbm_failed_ || capture_stride_ == 0) return false;
+    if (!gbm_) {
+        // Any render node of the GPU will do: the buffers are plain linear memory
+        for (int minor = 128; minor < 192 && !gbm_; ++minor) {
+            render_fd_ = ::open(("/dev/dri/renderD" + std::to_string(minor)).c_str(), O_RDWR | O_CLOEXEC);
+            if (render_fd_ < 0) continue;
+            gbm_ = gbm_create_device(render_fd_);
+            if (!gbm_) {
+                ::close(render_fd_);
+                render_fd_ = -1;
+            }
+        }
+        if (!gbm_) {
+            std::cerr << "[Camera] No GBM render node, using driver-allocated buffers.\n";
+            gbm_failed_ = true;
+            return false;
+        }
+    }
+    
+    struct v4l2_requestbuffers req;
+    memset(&req, 0, sizeof(req));
+    req.count = NUM_BUFFERS;
+    req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    req.memory = V4L2_MEMORY_DMABUF;
+    if (ioctl(v4l2_fd_, VIDIOC_REQBUFS, &req) < 0 || req.count == 0) {
+        return false; // Driver can't capture into imported buffers
+    }
+    
+    // One linear R8 "blob" per buffer: bytesperline wide and tall enough for sizeimage,
+    // so the rows land exactly where V4L2 (and the EGL import) expects them
+    uint32_t rows = (capture_size_image_ + capture_stride_ - 1) / capture_stride_;
+    buffers_.resize(req.count);
+    for (auto& buffer : buffers_) {
+        buffer.bo = gbm_bo_create(gbm_, capture_stride_, rows, GBM_FORMAT_R8, GBM_BO_USE_LINEAR);
+        if (buffer.bo) buffer.dmabuf_fd = gbm_bo_get_fd(buffer.bo);
+        // A padded bo pitch would move every row but the first
+        if (!buffer.bo || buffer.dmabuf_fd < 0 || gbm_bo_get_stride(buffer.bo) != capture_stride_) {
+            std::cerr << "[Camera] GBM buffer for " << capture_stride_ << "x" << rows
+                      << " unusable, using driver-allocated buffers.\n";
+            for (auto& b : buffers_) {
+                if (b.dmabuf_fd >= 0) ::close(b.dmabuf_fd);
+                if (b.bo) gbm_bo_destroy(b.bo);
+            }
+            buffers_.clear();
+            req.count = 0;
+            ioctl(v4l2_fd_, VIDIOC_REQBUFS, &req);
+            return false;
+        }
+        buffer.length = static_cast<size_t>(capture_stride_) * rows;
+    }
+    return true;
+}
+
+void CameraModule::release_gbm() {
+    if (gbm_) gbm_device_destroy(gbm_);
+    gbm_ = nullptr;
+    if (render_fd_ >= 0) ::close(render_fd_);
+    render_fd_ = -1;
+}
+
+bool CameraModule::queue_buffer(unsigned index) {
+    struct v4l2_buffer buf;
+    memset(&buf, 0, sizeof(buf));
+    buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    buf.memory = buffer_memory_;
+    buf.index = index;
+    if (buffer_memory_ == V4L2_MEMORY_DMABUF) {
+        buf.m.fd = buffers_[index].dmabuf_fd;
+        buf.length = buffers_[index].length;
+    }
+    return ioctl(v4l2_fd_, VIDIOC_QBUF, &buf) == 0;
+}
+
 bool CameraModule::start_streaming() {
     // Queue all buffers
     for (unsigned int i = 0; i < buffers_.size(); ++i) {
-        struct v4l2_buffer buf;
-        memset(&buf, 0, sizeof(buf));
-        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        buf.memory = V4L2_MEMORY_MMAP;
-        buf.index = i;
-        
-        if (ioctl(v4l2_fd_, VIDIOC_QBUF, &buf) < 0) {
+        if (!queue_buffer(i)) {
             std::cerr << "[Camera] VIDIOC_QBUF failed: " << strerror(errno) << "\n";
             return false;
         }
@@ -355,6 +618,9 @@ void CameraModule::cleanup_v4l2() {
         if (buf.dmabuf_fd >= 0) {
             ::close(buf.dmabuf_fd);
         }
+        if (buf.bo) {
+            gbm_bo_destroy(buf.bo);
+        }
     }
     buffers_.clear();
     
@@ -363,11 +629,29 @@ void CameraModule::cleanup_v4l2() {
         v4l2_fd_ = -1;
     }
     
-    // Cleanup GL resources
-    if (current_egl_image_ != EGL_NO_IMAGE_KHR && eglDestroyImageKHR_) {
-        eglDestroyImageKHR_(egl_display_, current_egl_image_);
-        current_egl_image_ = EGL_NO_IMAGE_KHR;
+    open_.store(false, std::memory_order_release);
+    
+    use_dmabuf_ = false;
+    sw_upload_ = false;
+    timeout_consecutive_ = 0;
+    {
+        std::lock_guard<std::mutex> lock(info_mutex_);
+        device_path_.clear();
+        device_name_.clear();
     }
+    capture_fourcc_ = 0;
+    capture_width_ = 0;
+    capture_height_ = 0;
+    capture_stride_ = 0;
+    capture_size_image_ = 0;
+    capture_uv_offset_ = 0;
+}
+
+void CameraModule::release_gl() {
+    for (EGLImageKHR image : egl_images_) {
+        if (image != EGL_NO_IMAGE_KHR && eglDestroyImageKHR_) eglDestroyImageKHR_(egl_display_, image);
+    }
+    egl_images_.clear();
     if (texture_id_ != 0) {
         glDeleteTextures(1, &texture_id_);
         texture_id_ = 0;
@@ -376,31 +660,39 @@ void CameraModule::cleanup_v4l2() {
         glDeleteTextures(1, &sw_texture_id_);
         sw_texture_id_ = 0;
     }
+    if (uv_texture_id_ != 0) {
+        glDeleteTextures(1, &uv_texture_id_);
+        uv_texture_id_ = 0;
+    }
+    if (v_texture_id_ != 0) {
+        glDeleteTextures(1, &v_texture_id_);
+        v_texture_id_ = 0;
+    }
+    sw_tex_w_ = sw_tex_h_ = 0;
+    uv_tex_w_ = uv_tex_h_ = 0;
+    v_tex_w_ = v_tex_h_ = 0;
     if (program_ != 0) {
         glDeleteProgram(program_);
         program_ = 0;
     }
-    
-    use_dmabuf_ = false;
-    sw_upload_ = false;
-    has_frame_ = false;
-    current_buf_index_ = -1;
-    timeout_consecutive_ = 0;
     gl_initialized_ = false;
-    device_path_.clear();
-    device_name_.clear();
-    capture_fourcc_ = 0;
-    capture_width_ = 0;
-    capture_height_ = 0;
-    rgb_buffer_.clear();
+    frame_imported_ = false;
 }
 
 void CameraModule::close() {
     cleanup_v4l2();
 }
 
-bool CameraModule::is_open() const {
-    return v4l2_fd_ >= 0 && streaming_;
+void CameraModule::recycle(CapturedFrame& frame) {
+    // Buffers from before a reconnect belong to a closed queue: only the fd dup is left to drop
+    if (frame.buf_index >= 0 && frame.session == session_ && v4l2_fd_ >= 0 && streaming_) {
+        queue_buffer(frame.buf_index);
+    }
+    frame.buf_index = -1;
+    if (frame.dmabuf_fd >= 0) {
+        ::close(frame.dmabuf_fd);
+        frame.dmabuf_fd = -1;
+    }
 }
 
 bool CameraModule::capture_frame() {
@@ -412,7 +704,7 @@ bool CameraModule::capture_frame() {
     pfd.events = POLLIN;
     pfd.revents = 0;
     
-    int ret = poll(&pfd, 1, 100); // 100ms timeout
+    int ret = poll(&pfd, 1, kPollTimeoutMs); // Blocks only the capture thread
     if (ret < 0) {
         std::cerr << "[Camera] poll() error: " << strerror(errno) << "\n";
         return false;
@@ -431,7 +723,7 @@ bool CameraModule::capture_frame() {
             std::cerr << "[Camera] Device " << device_path_ 
                       << " is completely frozen (2.5s timeout). Forcing software reset...\n";
             timeout_consecutive_ = 0;
-            return false; // Triggers close() and hot-plug retry in main.cpp
+            return false; // Triggers close() and the hot-plug retry in run()
         }
         return true; // No frame yet, but keep trying
     }
@@ -448,22 +740,16 @@ bool CameraModule::capture_frame() {
         return true; // No new frame, but camera is still connected
     }
     
-    // Re-queue the previous buffer if one was dequeued (for DMA-BUF path)
-    if (current_buf_index_ >= 0) {
-        struct v4l2_buffer qbuf;
-        memset(&qbuf, 0, sizeof(qbuf));
-        qbuf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        qbuf.memory = V4L2_MEMORY_MMAP;
-        qbuf.index = current_buf_index_;
-        ioctl(v4l2_fd_, VIDIOC_QBUF, &qbuf);
-        current_buf_index_ = -1;
-    }
+    // The slot coming back from the mailbox is either a frame the render thread
+    // skipped or the one it has replaced: its buffer can go back to the driver
+    CapturedFrame& frame = mailbox_.back();
+    recycle(frame);
     
     // Dequeue the new buffer
     struct v4l2_buffer buf;
     memset(&buf, 0, sizeof(buf));
     buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    buf.memory = V4L2_MEMORY_MMAP;
+    buf.memory = buffer_memory_;
     
     if (ioctl(v4l2_fd_, VIDIOC_DQBUF, &buf) < 0) {
         if (errno == EAGAIN) return true; // No frame ready
@@ -475,101 +761,203 @@ bool CameraModule::capture_frame() {
         return false;
     }
     
+    frame.session = session_;
+    frame.fourcc = capture_fourcc_;
+    frame.width = capture_width_;
+    frame.height = capture_height_;
+    bool publish = true;
+    int decode_scale = 1;
+    
     if (sw_upload_) {
-        // Software path: decode MJPEG or convert YUYV to RGB
+        // Software path: decode MJPEG here rather than on the render thread; YUV
+        // formats are only repacked into tight rows for the shader to convert
+        auto decode_start = std::chrono::steady_clock::now();
+        const uint8_t* src = static_cast<uint8_t*>(buffers_[buf.index].start);
+        size_t w = capture_width_, h = capture_height_;
+        size_t bytes = buffers_[buf.index].length;
+        frame.bt709 = capture_bt709_;
+        frame.full_range = capture_full_range_;
         if (capture_fourcc_ == V4L2_PIX_FMT_MJPEG || capture_fourcc_ == V4L2_PIX_FMT_JPEG) {
-            decode_mjpeg_to_rgb(
-                static_cast<uint8_t*>(buffers_[buf.index].start), buf.bytesused,
-                rgb_buffer_.data(), capture_width_, capture_height_
-            );
+            // Decode no larger than the camera is drawn, and leave YCbCr -> RGB to the shader
+            decode_scale = MjpegDecoder::scale_for(capture_width_, capture_height_,
+                                                   target_width_.load(std::memory_order_relaxed),
+                                                   target_height_.load(std::memory_order_relaxed));
+            MjpegImage image;
+            publish = mjpeg_.decode(src, std::min<size_t>(buf.bytesused, bytes), decode_scale, true,
+                                    frame.pixels, image);
+            if (publish) {
+                frame.layout = image.planar ? FrameLayout::Yuv : FrameLayout::Rgb;
+                frame.width = image.width;
+                frame.height = image.height;
+                frame.chroma_width = image.chroma_width;
+                frame.chroma_height = image.chroma_height;
+                frame.bt709 = false;      // JFIF: full-range BT.601 whatever the driver says
+                frame.full_range = true;
+            }
         } else if (capture_fourcc_ == V4L2_PIX_FMT_YUYV) {
-            // YUYV → RGB conversion
-            const uint8_t* src = static_cast<uint8_t*>(buffers_[buf.index].start);
-            uint8_t* dst = rgb_buffer_.data();
-            int pixels = capture_width_ * capture_height_;
-            for (int i = 0; i < pixels; i += 2) {
-                int y0 = src[0]; int u = src[1]; int y1 = src[2]; int v = src[3];
-                src += 4;
-                int c0 = y0 - 16, c1 = y1 - 16, d = u - 128, e = v - 128;
-                dst[0] = std::clamp((298 * c0 + 409 * e + 128) >> 8, 0, 255);
-                dst[1] = std::clamp((298 * c0 - 100 * d - 208 * e + 128) >> 8, 0, 255);
-                dst[2] = std::clamp((298 * c0 + 516 * d + 128) >> 8, 0, 255);
-                dst[3] = std::clamp((298 * c1 + 409 * e + 128) >> 8, 0, 255);
-                dst[4] = std::clamp((298 * c1 - 100 * d - 208 * e + 128) >> 8, 0, 255);
-                dst[5] = std::clamp((298 * c1 + 516 * d + 128) >> 8, 0, 255);
-                dst += 6;
+            size_t stride = std::max<size_t>(capture_stride_, w * 2);
+            if (stride * h > bytes) {
+                publish = false; // Short buffer
+            } else if (gpu_yuyv_.load(std::memory_order_relaxed)) {
+                frame.layout = FrameLayout::Yuyv;
+                frame.pixels.resize(w * h * 2);
+                for (size_t y = 0; y < h; ++y) memcpy(frame.pixels.data() + y * w * 2, src + y * stride, w * 2);
+            } else {
+                frame.layout = FrameLayout::Rgba;
+                frame.pixels.resize(w * h * 4);
+                converter_.convert(src, stride, frame.pixels.data(), w * 4, capture_width_, capture_height_);
             }
+        } else if (capture_fourcc_ == V4L2_PIX_FMT_NV12) {
+            // Single-planar NV12: the UV plane follows the Y plane at the same stride.
+            // Odd sizes round the chroma up, like capture_planes().
+            size_t cw = (w + 1) / 2, ch = (h + 1) / 2;
+            size_t stride = std::max<size_t>(capture_stride_, cw * 2);
+            if (stride * (h + ch) > bytes) {
+                publish = false; // Short buffer
+            } else {
+                frame.layout = FrameLayout::Nv12;
+                frame.chroma_width = static_cast<int>(cw);
+                frame.chroma_height = static_cast<int>(ch);
+                frame.pixels.resize(w * h + cw * 2 * ch);
+                uint8_t* uv = frame.pixels.data() + w * h;
+                for (size_t y = 0; y < h; ++y) memcpy(frame.pixels.data() + y * w, src + y * stride, w);
+                for (size_t y = 0; y < ch; ++y) memcpy(uv + y * cw * 2, src + (h + y) * stride, cw * 2);
+            }
+        } else {
+            publish = false; // No converter for this format
+        }
+        if (publish) {
+            decode_latency_.record(std::chrono::duration<double>(std::chrono::steady_clock::now() - decode_start).count());
         }
         
         // Re-queue immediately for software path
-        struct v4l2_buffer qbuf;
-        memset(&qbuf, 0, sizeof(qbuf));
-        qbuf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        qbuf.memory = V4L2_MEMORY_MMAP;
-        qbuf.index = buf.index;
-        ioctl(v4l2_fd_, VIDIOC_QBUF, &qbuf);
+        queue_buffer(buf.index);
     } else {
-        // DMA-BUF path: keep buffer dequeued until next frame
-        current_buf_index_ = buf.index;
+        // DMA-BUF path: the buffer stays dequeued while its slot is in the mailbox.
+        // The slot gets its own fd so a reconnect can't pull it from under an import.
+        frame.layout = FrameLayout::DmaBuf;
+        frame.buf_index = buf.index;
+        frame.pitch = capture_stride_;
+        frame.uv_offset = capture_uv_offset_;
+        frame.dmabuf_fd = fcntl(buffers_[buf.index].dmabuf_fd, F_DUPFD_CLOEXEC, 0);
+        publish = frame.dmabuf_fd >= 0;
     }
     
-    has_frame_ = true;
+    if (publish) {
+        CameraStats stats;
+        stats.format = frame.layout == FrameLayout::Yuv  ? "MJPG -> YCbCr"
+                     : frame.layout == FrameLayout::Rgb  ? "MJPG -> RGB"
+                     : frame.layout == FrameLayout::Rgba ? "YUYV -> RGBA"
+                     : frame.layout == FrameLayout::Yuyv ? "YUYV"
+                     : frame.layout == FrameLayout::Nv12 ? "NV12"
+                                                         : "DMA-BUF";
+        stats.frames_captured = ++frames_captured_;
+        stats.capture_width = capture_width_;
+        stats.capture_height = capture_height_;
+        stats.decode_scale = decode_scale;
+        published_stats_.publish(stats);
+        mailbox_.publish();
+    }
     return true;
 }
 
-void CameraModule::init_gl(core::Renderer& renderer, EGLDisplay egl_display) {
+void CameraModule::init_gl(core::Renderer& renderer, EGLDisplay egl_display, FrameLayout layout) {
     egl_display_ = egl_display;
+    gl_layout_ = layout;
     
     // Cache EGL function pointers
     eglCreateImageKHR_ = (PFNEGLCREATEIMAGEKHRPROC)eglGetProcAddress("eglCreateImageKHR");
     eglDestroyImageKHR_ = (PFNEGLDESTROYIMAGEKHRPROC)eglGetProcAddress("eglDestroyImageKHR");
     glEGLImageTargetTexture2DOES_ = (PFNGLEGLIMAGETARGETTEXTURE2DOESPROC)eglGetProcAddress("glEGLImageTargetTexture2DOES");
+    const char* extensions = eglQueryString(egl_display, EGL_EXTENSIONS);
+    egl_modifiers_ = extensions && strstr(extensions, "EGL_EXT_image_dma_buf_import_modifiers");
+    
+    const char* vs = R"(
+        attribute vec4 a_position;
+        attribute vec2 a_texCoord;
+        varying vec2 v_texCoord;
+        void main() {
+            gl_Position = a_position;
+            v_texCoord = a_texCoord;
+        }
+    )";
+    const char* fs = nullptr;
     
-    if (use_dmabuf_ && eglCreateImageKHR_ && glEGLImageTargetTexture2DOES_) {
+    if (layout == FrameLayout::DmaBuf) {
         // External OES shader (same as VideoDecoder — hardware YUV→RGB)
-        const char* vs = R"(
-            attribute vec4 a_position;
-            attribute vec2 a_texCoord;
+        fs = R"(
+            #extension GL_OES_EGL_image_external : require
+            precision mediump float;
             varying vec2 v_texCoord;
+            uniform samplerExternalOES s_texture;
             void main() {
-                gl_Position = a_position;
-                v_texCoord = a_texCoord;
+                gl_FragColor = texture2D(s_texture, v_texCoord);
             }
         )";
-        const char* fs = R"(
-            #extension GL_OES_EGL_image_external : require
+    } else if (layout == FrameLayout::Yuyv) {
+        // Each RGBA texel is one Y0 U Y1 V pair: pick the pair's texel, then the
+        // pixel's luma. Needs highp to address pixels across a 1080p row.
+        fs = R"(
+            #ifdef GL_FRAGMENT_PRECISION_HIGH
+            precision highp float;
+            #else
             precision mediump float;
+            #endif
             varying vec2 v_texCoord;
-            uniform samplerExternalOES s_texture;
+            uniform sampler2D s_texture;
+            uniform float u_width;
+            uniform mat3 u_yuv_matrix;
+            uniform vec3 u_yuv_offset;
             void main() {
-                gl_FragColor = texture2D(s_texture, v_texCoord);
+                float px = floor(v_texCoord.x * u_width);
+                vec4 t = texture2D(s_texture, vec2((floor(px * 0.5) + 0.5) * 2.0 / u_width, v_texCoord.y));
+                float y = mod(px, 2.0) < 0.5 ? t.r : t.b;
+                vec3 rgb = u_yuv_matrix * (vec3(y, t.g, t.a) - u_yuv_offset);
+                gl_FragColor = vec4(clamp(rgb, 0.0, 1.0), 1.0);
             }
         )";
-        
-        GLuint vs_id = renderer.compile_shader(GL_VERTEX_SHADER, vs);
-        GLuint fs_id = renderer.compile_shader(GL_FRAGMENT_SHADER, fs);
-        program_ = renderer.link_program(vs_id, fs_id);
-        glDeleteShader(vs_id);
-        glDeleteShader(fs_id);
-        
-        glGenTextures(1, &texture_id_);
-        glBindTexture(GL_TEXTURE_EXTERNAL_OES, texture_id_);
-        glTexParameteri(GL_TEXTURE_EXTERNAL_OES, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_EXTERNAL_OES, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_EXTERNAL_OES, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_EXTERNAL_OES, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    } else {
-        // Software path: standard 2D texture shader
-        const char* vs = R"(
-            attribute vec4 a_position;
-            attribute vec2 a_texCoord;
+        GLint range[2] = {0, 0};
+        GLint precision = 0;
+        glGetShaderPrecisionFormat(GL_FRAGMENT_SHADER, GL_HIGH_FLOAT, range, &precision);
+        if (precision == 0) {
+            std::cerr << "[Camera] No highp in fragment shaders, converting YUYV on the CPU.\n";
+            gpu_yuyv_.store(false, std::memory_order_relaxed);
+        }
+    } else if (layout == FrameLayout::Yuv) {
+        // Three single-channel planes; chroma is sampled at its own (subsampled) size
+        fs = R"(
+            precision mediump float;
+            varying vec2 v_texCoord;
+            uniform sampler2D s_texture;
+            uniform sampler2D s_u;
+            uniform sampler2D s_v;
+            uniform mat3 u_yuv_matrix;
+            uniform vec3 u_yuv_offset;
+            void main() {
+                vec3 yuv = vec3(texture2D(s_texture, v_texCoord).r,
+                                texture2D(s_u, v_texCoord).r,
+                                texture2D(s_v, v_texCoord).r);
+                vec3 rgb = u_yuv_matrix * (yuv - u_yuv_offset);
+                gl_FragColor = vec4(clamp(rgb, 0.0, 1.0), 1.0);
+            }
+        )";
+    } else if (layout == FrameLayout::Nv12) {
+        fs = R"(
+            precision mediump float;
             varying vec2 v_texCoord;
+            uniform sampler2D s_texture;
+            uniform sampler2D s_uv;
+            uniform mat3 u_yuv_matrix;
+            uniform vec3 u_yuv_offset;
             void main() {
-                gl_Position = a_position;
-                v_texCoord = a_texCoord;
+                vec4 c = texture2D(s_uv, v_texCoord);
+                vec3 rgb = u_yuv_matrix * (vec3(texture2D(s_texture, v_texCoord).r, c.r, c.a) - u_yuv_offset);
+                gl_FragColor = vec4(clamp(rgb, 0.0, 1.0), 1.0);
             }
         )";
-        const char* fs = R"(
+    } else {
+        // RGB / RGBA decoded on the CPU: standard 2D texture shader
+        fs = R"(
             precision mediump float;
             varying vec2 v_texCoord;
             uniform sampler2D s_texture;
@@ -577,98 +965,191 @@ void CameraModule::init_gl(core::Renderer& renderer, EGLDisplay egl_display) {
                 gl_FragColor = texture2D(s_texture, v_texCoord);
             }
         )";
-        
-        GLuint vs_id = renderer.compile_shader(GL_VERTEX_SHADER, vs);
-        GLuint fs_id = renderer.compile_shader(GL_FRAGMENT_SHADER, fs);
-        program_ = renderer.link_program(vs_id, fs_id);
-        glDeleteShader(vs_id);
-        glDeleteShader(fs_id);
-        
-        glGenTextures(1, &sw_texture_id_);
-        glBindTexture(GL_TEXTURE_2D, sw_texture_id_);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+    
+    GLuint vs_id = renderer.compile_shader(GL_VERTEX_SHADER, vs);
+    GLuint fs_id = renderer.compile_shader(GL_FRAGMENT_SHADER, fs);
+    program_ = renderer.link_program(vs_id, fs_id);
+    glDeleteShader(vs_id);
+    glDeleteShader(fs_id);
+    
+    auto make_texture = [](GLenum target, GLint filter) {
+        GLuint tex = 0;
+        glGenTextures(1, &tex);
+        glBindTexture(target, tex);
+        glTexParameteri(target, GL_TEXTURE_MIN_FILTER, filter);
+        glTexParameteri(target, GL_TEXTURE_MAG_FILTER, filter);
+        glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(target, 0);
+        return tex;
+    };
+    if (layout == FrameLayout::DmaBuf) {
+        texture_id_ = make_texture(GL_TEXTURE_EXTERNAL_OES, GL_LINEAR);
+    } else {
+        // Packed YUYV must not blend neighbouring pairs; the shader picks texels itself
+        sw_texture_id_ = make_texture(GL_TEXTURE_2D, layout == FrameLayout::Yuyv ? GL_NEAREST : GL_LINEAR);
+        if (layout == FrameLayout::Nv12 || layout == FrameLayout::Yuv) uv_texture_id_ = make_texture(GL_TEXTURE_2D, GL_LINEAR);
+        if (layout == FrameLayout::Yuv) v_texture_id_ = make_texture(GL_TEXTURE_2D, GL_LINEAR);
     }
     
     pos_loc_ = glGetAttribLocation(program_, "a_position");
     tex_coord_loc_ = glGetAttribLocation(program_, "a_texCoord");
     sampler_loc_ = glGetUniformLocation(program_, "s_texture");
+    uv_sampler_loc_ = glGetUniformLocation(program_, layout == FrameLayout::Yuv ? "s_u" : "s_uv");
+    v_sampler_loc_ = glGetUniformLocation(program_, "s_v");
+    width_loc_ = glGetUniformLocation(program_, "u_width");
+    matrix_loc_ = glGetUniformLocation(program_, "u_yuv_matrix");
+    offset_loc_ = glGetUniformLocation(program_, "u_yuv_offset");
     
     gl_initialized_ = true;
 }
 
+void CameraModule::upload_texture(GLuint tex, int& tex_w, int& tex_h, GLenum format,
+                                  int width, int height, const uint8_t* data) {
+    glBindTexture(GL_TEXTURE_2D, tex);
+    if (tex_w != width || tex_h != height) {
+        // Storage is (re)allocated only when the geometry changes
+        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, nullptr);
+        tex_w = width;
+        tex_h = height;
+    }
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, format, GL_UNSIGNED_BYTE, data);
+}
+
 void CameraModule::render(core::Renderer& renderer, EGLDisplay egl_display,
                           float src_x, float src_y, float src_w, float src_h,
                           float x, float y, float w, float h) {
-    if (!has_frame_) return;
+    if (!is_open()) return;
+    
+    // The whole frame's size on screen, for the next MJPEG decode
+    if (src_w > 0.0f && src_h > 0.0f) {
+        target_width_.store(static_cast<int>(w * renderer.width() / src_w), std::memory_order_relaxed);
+        target_height_.store(static_cast<int>(h * renderer.height() / src_h), std::memory_order_relaxed);
+    }
+    
+    if (mailbox_.acquire()) frame_imported_ = false;
+    CapturedFrame& frame = mailbox_.front();
+    if (frame.width == 0) return; // Nothing captured yet
     
-    if (!gl_initialized_) {
-        init_gl(renderer, egl_display);
+    // The capture path can change across a reconnect, and the shader with it
+    if (!gl_initialized_ || frame.layout != gl_layout_) {
+        release_gl();
+        init_gl(renderer, egl_display, frame.layout);
     }
+    bool dmabuf = gl_layout_ == FrameLayout::DmaBuf;
     
-    // Update texture from current frame
-    if (use_dmabuf_ && current_buf_index_ >= 0) {
-        // DMA-BUF → EGLImage → external OES texture
-        if (current_egl_image_ != EGL_NO_IMAGE_KHR) {
-            eglDestroyImageKHR_(egl_display_, current_egl_image_);
-            current_egl_image_ = EGL_NO_IMAGE_KHR;
+    // Import or upload each captured frame once; repeats just redraw the texture
+    if (!frame_imported_ && dmabuf) {
+        // Once EGL has refused the buffers the capture thread reopens with software
+        // upload; until its frames arrive there is nothing to import
+        if (dmabuf_rejected_.load(std::memory_order_relaxed)) return;
+        if (!eglCreateImageKHR_ || !glEGLImageTargetTexture2DOES_) {
+            std::cerr << "[Camera] No EGLImage import on this display.\n";
+            dmabuf_rejected_.store(true, std::memory_order_relaxed);
+            return;
         }
         
-        // Determine DRM fourcc from V4L2 fourcc
-        uint32_t drm_fourcc = DRM_FORMAT_NV12; // default
-        if (capture_fourcc_ == V4L2_PIX_FMT_NV12) drm_fourcc = DRM_FORMAT_NV12;
-        else if (capture_fourcc_ == V4L2_PIX_FMT_YUYV) drm_fourcc = DRM_FORMAT_YUYV;
-        
-        EGLint attribs[] = {
-            EGL_WIDTH, capture_width_,
-            EGL_HEIGHT, capture_height_,
-            EGL_LINUX_DRM_FOURCC_EXT, (EGLint)drm_fourcc,
-            EGL_DMA_BUF_PLANE0_FD_EXT, buffers_[current_buf_index_].dmabuf_fd,
-            EGL_DMA_BUF_PLANE0_OFFSET_EXT, 0,
-            EGL_DMA_BUF_PLANE0_PITCH_EXT, capture_width_ * ((drm_fourcc == DRM_FORMAT_YUYV) ? 2 : 1),
-            EGL_NONE
-        };
+        // Each V4L2 buffer becomes an EGLImage once per session; later frames in it reuse it
+        if (frame.session != egl_images_session_) {
+            for (EGLImageKHR image : egl_images_) {
+                if (image != EGL_NO_IMAGE_KHR) eglDestroyImageKHR_(egl_display_, image);
+            }
+            egl_images_.clear();
+            egl_images_session_ = frame.session;
+        }
+        if (frame.buf_index < 0) return;
+        if (static_cast<size_t>(frame.buf_index) >= egl_images_.size()) {
+            egl_images_.resize(frame.buf_index + 1, EGL_NO_IMAGE_KHR);
+        }
+        EGLImageKHR& image = egl_images_[frame.buf_index];
         
-        // For NV12, add UV plane
-        if (drm_fourcc == DRM_FORMAT_NV12) {
-            // NV12: Y plane pitch = width, UV plane offset = width*height, pitch = width
-            std::vector<EGLint> nv12_attribs = {
-                EGL_WIDTH, capture_width_,
-                EGL_HEIGHT, capture_height_,
-                EGL_LINUX_DRM_FOURCC_EXT, (EGLint)DRM_FORMAT_NV12,
-                EGL_DMA_BUF_PLANE0_FD_EXT, buffers_[current_buf_index_].dmabuf_fd,
+        if (image == EGL_NO_IMAGE_KHR) {
+            // DMA-BUF → EGLImage → external OES texture. Pitch and the NV12 chroma offset
+            // come from the driver's bytesperline, not the width: rows may be padded.
+            bool nv12 = frame.fourcc == V4L2_PIX_FMT_NV12;
+            std::vector<EGLint> attribs = {
+                EGL_WIDTH, frame.width,
+                EGL_HEIGHT, frame.height,
+                EGL_LINUX_DRM_FOURCC_EXT, (EGLint)(nv12 ? DRM_FORMAT_NV12 : DRM_FORMAT_YUYV),
+                EGL_DMA_BUF_PLANE0_FD_EXT, frame.dmabuf_fd,
                 EGL_DMA_BUF_PLANE0_OFFSET_EXT, 0,
-                EGL_DMA_BUF_PLANE0_PITCH_EXT, capture_width_,
-                EGL_DMA_BUF_PLANE1_FD_EXT, buffers_[current_buf_index_].dmabuf_fd,
-                EGL_DMA_BUF_PLANE1_OFFSET_EXT, capture_width_ * capture_height_,
-                EGL_DMA_BUF_PLANE1_PITCH_EXT, capture_width_,
-                EGL_NONE
+                EGL_DMA_BUF_PLANE0_PITCH_EXT, (EGLint)frame.pitch,
             };
+            if (nv12) {
+                attribs.insert(attribs.end(), {
+                    EGL_DMA_BUF_PLANE1_FD_EXT, frame.dmabuf_fd,
+                    EGL_DMA_BUF_PLANE1_OFFSET_EXT, (EGLint)frame.uv_offset,
+                    EGL_DMA_BUF_PLANE1_PITCH_EXT, (EGLint)frame.pitch,
+                });
+            }
+            if (egl_modifiers_) {
+                // V4L2 buffers (driver or GBM allocated) are always linear
+                EGLint lo = (EGLint)(DRM_FORMAT_MOD_LINEAR & 0xFFFFFFFF);
+                EGLint hi = (EGLint)(DRM_FORMAT_MOD_LINEAR >> 32);
+                attribs.insert(attribs.end(), {
+                    EGL_DMA_BUF_PLANE0_MODIFIER_LO_EXT, lo,
+                    EGL_DMA_BUF_PLANE0_MODIFIER_HI_EXT, hi,
+                });
+                if (nv12) {
+                    attribs.insert(attribs.end(), {
+                        EGL_DMA_BUF_PLANE1_MODIFIER_LO_EXT, lo,
+                        EGL_DMA_BUF_PLANE1_MODIFIER_HI_EXT, hi,
+                    });
+                }
+            }
+            attribs.push_back(EGL_NONE);
             
-            current_egl_image_ = eglCreateImageKHR_(
-                egl_display_, EGL_NO_CONTEXT, EGL_LINUX_DMA_BUF_EXT, nullptr, nv12_attribs.data()
-            );
-        } else {
-            current_egl_image_ = eglCreateImageKHR_(
-                egl_display_, EGL_NO_CONTEXT, EGL_LINUX_DMA_BUF_EXT, nullptr, attribs
-            );
+            image = eglCreateImageKHR_(egl_display_, EGL_NO_CONTEXT, EGL_LINUX_DMA_BUF_EXT, nullptr, attribs.data());
+            if (image == EGL_NO_IMAGE_KHR) {
+                std::cerr << "[Camera] eglCreateImageKHR failed for " << fourcc_to_string(frame.fourcc) << " buffers.\n";
+                dmabuf_rejected_.store(true, std::memory_order_relaxed);
+                return;
+            }
         }
         
-        if (current_egl_image_ != EGL_NO_IMAGE_KHR) {
-            glBindTexture(GL_TEXTURE_EXTERNAL_OES, texture_id_);
-            glEGLImageTargetTexture2DOES_(GL_TEXTURE_EXTERNAL_OES, current_egl_image_);
-        } else {
-            return; // Can't render without a valid EGLImage
+        // Re-target per frame (cheap, no import): drivers that shadow linear images
+        // (vc4/v3d) only refresh the copy here
+        glBindTexture(GL_TEXTURE_EXTERNAL_OES, texture_id_);
+        glEGLImageTargetTexture2DOES_(GL_TEXTURE_EXTERNAL_OES, image);
+        frame_imported_ = true;
+    } else if (!frame_imported_) {
+        if (frame.pixels.empty()) return; // No frame data
+        // Software path: RGB(A) as is; YUYV as half-width RGBA texels, NV12 and Yuv as planes
+        const uint8_t* data = frame.pixels.data();
+        glActiveTexture(GL_TEXTURE2);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        switch (gl_layout_) {
+            case FrameLayout::Rgb:
+                upload_texture(sw_texture_id_, sw_tex_w_, sw_tex_h_, GL_RGB, frame.width, frame.height, data);
+                break;
+            case FrameLayout::Rgba:
+                upload_texture(sw_texture_id_, sw_tex_w_, sw_tex_h_, GL_RGBA, frame.width, frame.height, data);
+                break;
+            case FrameLayout::Yuyv:
+                upload_texture(sw_texture_id_, sw_tex_w_, sw_tex_h_, GL_RGBA, frame.width / 2, frame.height, data);
+                break;
+            case FrameLayout::Nv12:
+                upload_texture(sw_texture_id_, sw_tex_w_, sw_tex_h_, GL_LUMINANCE, frame.width, frame.height, data);
+                upload_texture(uv_texture_id_, uv_tex_w_, uv_tex_h_, GL_LUMINANCE_ALPHA,
+                               frame.chroma_width, frame.chroma_height, data + frame.width * frame.height);
+                break;
+            case FrameLayout::Yuv: {
+                const uint8_t* cb = data + frame.width * frame.height;
+                const uint8_t* cr = cb + frame.chroma_width * frame.chroma_height;
+                upload_texture(sw_texture_id_, sw_tex_w_, sw_tex_h_, GL_LUMINANCE, frame.width, frame.height, data);
+                upload_texture(uv_texture_id_, uv_tex_w_, uv_tex_h_, GL_LUMINANCE,
+                               frame.chroma_width, frame.chroma_height, cb);
+                upload_texture(v_texture_id_, v_tex_w_, v_tex_h_, GL_LUMINANCE,
+                               frame.chroma_width, frame.chroma_height, cr);
+                break;
+            }
+            case FrameLayout::DmaBuf:
+                break;
         }
-    } else if (sw_upload_ && !rgb_buffer_.empty()) {
-        // Software path: upload RGB data
-        glBindTexture(GL_TEXTURE_2D, sw_texture_id_);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, capture_width_, capture_height_, 0,
-                     GL_RGB, GL_UNSIGNED_BYTE, rgb_buffer_.data());
-    } else {
-        return; // No frame data
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        frame_imported_ = true;
     }
     
     // Draw the texture quad (same rendering pattern as VideoDecoder)
@@ -694,13 +1175,29 @@ void CameraModule::render(core::Renderer& renderer, EGLDisplay egl_display,
     glVertexAttribPointer(tex_coord_loc_, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), &vertices[2]);
     glEnableVertexAttribArray(tex_coord_loc_);
     
-    glActiveTexture(GL_TEXTURE2); // Use unit 2 to avoid conflict with video (unit 1) and UI (unit 0)
-    if (use_dmabuf_) {
+    glActiveTexture(GL_TEXTURE2); // Use unit 2 to avoid conflict with video (units 1/3/4) and UI (unit 0)
+    if (dmabuf) {
         glBindTexture(GL_TEXTURE_EXTERNAL_OES, texture_id_);
     } else {
         glBindTexture(GL_TEXTURE_2D, sw_texture_id_);
     }
     glUniform1i(sampler_loc_, 2);
+    if (gl_layout_ == FrameLayout::Nv12 || gl_layout_ == FrameLayout::Yuv) {
+        glActiveTexture(GL_TEXTURE5);
+        glBindTexture(GL_TEXTURE_2D, uv_texture_id_);
+        glUniform1i(uv_sampler_loc_, 5);
+    }
+    if (gl_layout_ == FrameLayout::Yuv) {
+        glActiveTexture(GL_TEXTURE6);
+        glBindTexture(GL_TEXTURE_2D, v_texture_id_);
+        glUniform1i(v_sampler_loc_, 6);
+    }
+    if (gl_layout_ == FrameLayout::Yuyv || gl_layout_ == FrameLayout::Nv12 || gl_layout_ == FrameLayout::Yuv) {
+        YuvColorMatrix color = yuv_color_matrix(frame.bt709, frame.full_range);
+        glUniformMatrix3fv(matrix_loc_, 1, GL_FALSE, color.matrix);
+        glUniform3fv(offset_loc_, 1, color.offset);
+        glUniform1f(width_loc_, static_cast<float>(frame.width));
+    }
     
     glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
     
@@ -708,8 +1205,16 @@ void CameraModule::render(core::Renderer& renderer, EGLDisplay egl_display,
     glDisableVertexAttribArray(tex_coord_loc_);
     
     // Cleanup GL state
+    if (gl_layout_ == FrameLayout::Yuv) {
+        glActiveTexture(GL_TEXTURE6);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+    if (gl_layout_ == FrameLayout::Nv12 || gl_layout_ == FrameLayout::Yuv) {
+        glActiveTexture(GL_TEXTURE5);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
     glActiveTexture(GL_TEXTURE2);
-    if (use_dmabuf_) {
+    if (dmabuf) {
         glBindTexture(GL_TEXTURE_EXTERNAL_OES, 0);
     } else {
         glBindTexture(GL_TEXTURE_2D, 0);
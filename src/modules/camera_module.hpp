@@ -4,6 +4,7 @@
 #include <vector>
 #include <atomic>
 #include <mutex>
+#include <thread>
 #include <cstdint>
 
 #include <EGL/egl.h>
@@ -11,37 +12,61 @@
 #include <GLES2/gl2.h>
 #include <GLES2/gl2ext.h>
 
+#include "modules/capture_format.hpp"
 #include "modules/config_module.hpp"
+#include "modules/decoder_stats.hpp"
+#include "modules/frame_mailbox.hpp"
+#include "modules/mjpeg_decoder.hpp"
+#include "modules/yuyv_convert.hpp"
+
+struct gbm_device;
+struct gbm_bo;
 
 namespace nuc_display::core { class Renderer; }
 
 namespace nuc_display::modules {
 
+// A V4L2 camera captured on its own thread. The capture thread opens the device
+// (and reopens it after a disconnect), waits for frames, converts them when the
+// format needs it and publishes each one into a latest-frame mailbox; render()
+// only picks up the newest frame, so a slow or wedged camera never holds up the
+// render loop.
 class CameraModule {
 public:
     CameraModule();
     ~CameraModule();
 
-    // Open camera (from config — handles auto-detect if device is empty)
-    bool open(const CameraConfig& config);
-    void close();
-    bool is_open() const;
-    
-    // Capture the latest frame from V4L2. Returns false if camera disconnected.
-    bool capture_frame();
+    // Start the capture thread for this camera (device auto-detected if empty).
+    // It retries every few seconds until the device shows up. With the screen size,
+    // the capture mode is negotiated for the camera's on-screen rect.
+    void start(const CameraConfig& config, int screen_width = 0, int screen_height = 0);
+    void stop();
+    bool is_open() const { return open_.load(std::memory_order_acquire); }
     
-    // Render latest frame as EGLImage / texture
+    // Render latest frame as EGLImage / texture (render thread)
     void render(core::Renderer& renderer, EGLDisplay egl_display,
                 float src_x, float src_y, float src_w, float src_h,
                 float x, float y, float w, float h);
     
     // Info
-    std::string device_path() const { return device_path_; }
-    std::string device_name() const { return device_name_; }
+    std::string device_path() const;
+    std::string device_name() const;
+    CameraStats stats() const;
 
 private:
+    // Capture thread
+    void run(std::stop_token stop);
+    bool open(const CameraConfig& config);
+    void close();
+    // Wait for and publish the next frame. Returns false if camera disconnected.
+    bool capture_frame();
+    
     // V4L2 setup
-    bool init_v4l2(const std::string& device, int w, int h, int fps, uint32_t fourcc);
+    CaptureRequest capture_request(const CameraConfig& config, const std::string& device) const;
+    bool init_v4l2(const std::string& device, const CaptureRequest& request);
+    bool alloc_gbm_buffers();
+    void release_gbm();
+    bool queue_buffer(unsigned index);
     bool start_streaming();
     void stop_streaming();
     void cleanup_v4l2();
@@ -50,53 +75,142 @@ private:
     static std::string find_camera_device();
     static bool is_capture_device(const std::string& path);
     
+    // Mode negotiation
+    static std::vector<CaptureMode> enumerate_modes(int fd, const CaptureRequest& request);
+    static double usb_bandwidth(const std::string& device);
+    
     // Buffer management
     struct V4L2Buffer {
-        void* start = nullptr;
+        void* start = nullptr;       // MMAP only
         size_t length = 0;
-        int dmabuf_fd = -1;
+        int dmabuf_fd = -1;          // EXPBUF export, or the GBM buffer the camera writes into
+        struct gbm_bo* bo = nullptr; // DMABUF only
+    };
+    
+    // How a captured frame reaches the GPU
+    enum class FrameLayout {
+        DmaBuf,   // EGLImage import of the V4L2 buffer
+        Rgb,      // MJPEG decoded on the CPU
+        Yuv,      // MJPEG decoded to its Y, Cb, Cr planes, converted in the shader
+        Rgba,     // YUYV converted on the CPU (GPUs without highp fragment shaders)
+        Yuyv,     // Raw YUYV as a half-width RGBA texture, converted in the shader
+        Nv12      // Raw NV12: luma + interleaved chroma textures, converted in the shader
+    };
+    
+    // One mailbox slot. A zero-copy frame keeps its V4L2 buffer dequeued and holds
+    // its own dup of the DMA-BUF fd, so it stays importable even if the device is
+    // closed while the render thread still has it.
+    struct CapturedFrame {
+        uint64_t session = 0;        // open() the frame came from
+        int buf_index = -1;          // V4L2 buffer to requeue once the slot comes back
+        int dmabuf_fd = -1;          // DMA-BUF path, owned by the slot
+        uint32_t fourcc = 0;
+        int width = 0;
+        int height = 0;
+        uint32_t pitch = 0;          // DMA-BUF: bytesperline of both planes
+        uint32_t uv_offset = 0;      // DMA-BUF NV12: chroma plane start
+        FrameLayout layout = FrameLayout::Rgb;
+        bool bt709 = false;          // YUV layouts: colour matrix and range
+        bool full_range = false;
+        int chroma_width = 0;        // Yuv: Cb/Cr plane size (the JPEG's subsampling); Nv12: UV pairs per row
+        int chroma_height = 0;
+        std::vector<uint8_t> pixels; // Software path: tightly packed rows (NV12: Y plane, then UV; Yuv: Y, Cb, Cr)
     };
+    // Capture thread: give a slot's buffer back to the driver before reusing it
+    void recycle(CapturedFrame& frame);
+    
+    // EGL/GL setup (render thread, redone when the camera comes back with another layout)
+    void init_gl(core::Renderer& renderer, EGLDisplay egl_display, FrameLayout layout);
+    void release_gl();
+    void upload_texture(GLuint tex, int& tex_w, int& tex_h, GLenum format,
+                        int width, int height, const uint8_t* data);
     
-    // EGL/GL setup (called once on first render)
-    void init_gl(core::Renderer& renderer, EGLDisplay egl_display);
+    std::jthread thread_;
+    CameraConfig config_;
+    int screen_width_ = 0;
+    int screen_height_ = 0;
+    std::atomic<bool> open_{false};
+    mutable std::mutex info_mutex_;  // device_path_ / device_name_ for other threads
+    FrameMailbox<CapturedFrame> mailbox_;
+    uint64_t session_ = 0;
     
-    // V4L2 state
+    // V4L2 state (capture thread)
     int v4l2_fd_ = -1;
     std::vector<V4L2Buffer> buffers_;
     bool streaming_ = false;
-    bool use_dmabuf_ = false;        // True if VIDIOC_EXPBUF succeeded (zero-copy)
+    bool use_dmabuf_ = false;        // True if frames are imported as DMA-BUFs (zero-copy)
+    uint32_t buffer_memory_ = 0;     // V4L2_MEMORY_MMAP (+ EXPBUF) or V4L2_MEMORY_DMABUF (GBM buffers)
+    int render_fd_ = -1;             // DRM render node the GBM buffers come from
+    struct gbm_device* gbm_ = nullptr;
+    bool gbm_failed_ = false;        // No render node / GBM: don't retry on every reopen
     uint32_t capture_fourcc_ = 0;
     int capture_width_ = 0;
     int capture_height_ = 0;
+    uint32_t capture_stride_ = 0;    // bytesperline of the capture buffers
+    uint32_t capture_size_image_ = 0; // sizeimage: bytes per buffer the driver writes
+    uint32_t capture_uv_offset_ = 0; // NV12 chroma plane within a buffer
+    bool capture_bt709_ = false;     // Colour encoding the driver reports
+    bool capture_full_range_ = false;
+    bool formats_listed_ = false;    // Supported formats logged after the first S_FMT failure
+    YuyvConverter converter_;        // CPU fallback for YUYV
+    MjpegDecoder mjpeg_;             // Kept for the whole stream
+    std::atomic<bool> gpu_yuyv_{true}; // Cleared by the render thread if the YUYV shader can't run
+    std::atomic<bool> dmabuf_rejected_{false}; // Set by the render thread if EGL can't import the buffers
     std::string device_path_;
     std::string device_name_;
     
     // Frame state
-    bool has_frame_ = false;
-    int current_buf_index_ = -1;     // Currently dequeued buffer index for DMA-BUF
     int timeout_consecutive_ = 0;    // Tracks wedged camera state
     
-    // EGL/GL state (same pattern as VideoDecoder)
+    // Drawn size in pixels of the whole frame, from the last render(); picks the MJPEG scale
+    std::atomic<int> target_width_{0};
+    std::atomic<int> target_height_{0};
+    
+    // Stats (written by the capture thread, read by stats())
+    AtomicLatencyHistogram decode_latency_;
+    StatsSnapshot<CameraStats> published_stats_;
+    uint64_t frames_captured_ = 0;
+    
+    // EGL/GL state (render thread, same pattern as VideoDecoder)
     EGLDisplay egl_display_ = EGL_NO_DISPLAY;
-    EGLImageKHR current_egl_image_ = EGL_NO_IMAGE_KHR;
+    std::vector<EGLImageKHR> egl_images_; // By V4L2 buffer index: each buffer is imported once
+    uint64_t egl_images_session_ = 0;     // open() the images belong to
+    bool egl_modifiers_ = false;          // EGL_EXT_image_dma_buf_import_modifiers
     GLuint texture_id_ = 0;
     GLuint program_ = 0;
     GLint pos_loc_ = -1;
     GLint tex_coord_loc_ = -1;
     GLint sampler_loc_ = -1;
     bool gl_initialized_ = false;
+    FrameLayout gl_layout_ = FrameLayout::Rgb; // Layout the program and textures are set up for
+    bool frame_imported_ = false;    // front() is in the texture already
     
-    // Software fallback texture (when DMA-BUF not available, e.g. MJPG → RGB decode)
+    // Software path textures (no DMA-BUF): persistent storage, updated with glTexSubImage2D
     bool sw_upload_ = false;
-    GLuint sw_texture_id_ = 0;
-    std::vector<uint8_t> rgb_buffer_;  // Decoded RGB data for software path
+    GLuint sw_texture_id_ = 0;       // RGB(A), packed YUYV or NV12 luma
+    GLuint uv_texture_id_ = 0;       // NV12 chroma, or Cb
+    GLuint v_texture_id_ = 0;        // Cr
+    int sw_tex_w_ = 0, sw_tex_h_ = 0;
+    int uv_tex_w_ = 0, uv_tex_h_ = 0;
+    int v_tex_w_ = 0, v_tex_h_ = 0;
+    GLint uv_sampler_loc_ = -1;
+    GLint v_sampler_loc_ = -1;
+    GLint width_loc_ = -1;
+    GLint matrix_loc_ = -1;
+    GLint offset_loc_ = -1;
 
     // EGL function pointers (cached)
     PFNEGLCREATEIMAGEKHRPROC eglCreateImageKHR_ = nullptr;
     PFNEGLDESTROYIMAGEKHRPROC eglDestroyImageKHR_ = nullptr;
     PFNGLEGLIMAGETARGETTEXTURE2DOESPROC glEGLImageTargetTexture2DOES_ = nullptr;
     
-    static constexpr int NUM_BUFFERS = 4;
+    // The mailbox can hold three buffers dequeued; the driver keeps the rest
+    static constexpr int NUM_BUFFERS = 6;
+    static constexpr int kRetrySec = 5;          // Hot-plug: reopen attempts
+    static constexpr int kPollTimeoutMs = 100;
+    // Share of the USB link a UVC isochronous stream can count on: one high-bandwidth
+    // endpoint moves at most 3 x 1024 bytes per 125 us, ~40% of USB 2.0's 480 Mbit/s
+    static constexpr double kUsbIsoShare = 0.4;
 };
 
 } // namespace nuc_display::modules
@@ -0,0 +1,115 @@
+#include "modules/capture_format.hpp"
+#include <tuple>
+#include <linux/videodev2.h>
+
+namespace nuc_display::modules {
+
+namespace {
+
+// Pipeline preference, lower is cheaper; -1 = not displayable
+int pipeline_rank(uint32_t fourcc) {
+    switch (fourcc) {
+        case V4L2_PIX_FMT_NV12: return 0;   // Smallest raw format, one EGLImage
+        case V4L2_PIX_FMT_YUYV: return 1;
+        case V4L2_PIX_FMT_MJPEG:
+        case V4L2_PIX_FMT_JPEG: return 2;   // CPU decode
+        default: return -1;
+    }
+}
+
+bool same_format(uint32_t a, uint32_t b) {
+    auto jpeg = [](uint32_t f) { return f == V4L2_PIX_FMT_MJPEG || f == V4L2_PIX_FMT_JPEG; };
+    return a == b || (jpeg(a) && jpeg(b));
+}
+
+} // namespace
+
+std::optional<CapturePlanes> capture_planes(uint32_t fourcc, int width, int height,
+                                            uint32_t bytesperline, uint32_t sizeimage) {
+    if (width <= 0 || height <= 0) return std::nullopt;
+    uint64_t row_bytes;
+    if (fourcc == V4L2_PIX_FMT_YUYV) row_bytes = static_cast<uint64_t>(width) * 2;
+    else if (fourcc == V4L2_PIX_FMT_NV12) row_bytes = (static_cast<uint64_t>(width) + 1) / 2 * 2; // Chroma rows hold whole UV pairs
+    else return std::nullopt;
+
+    uint64_t pitch = bytesperline != 0 ? bytesperline : row_bytes;
+    if (pitch < row_bytes) return std::nullopt;
+    uint64_t luma = pitch * height;
+    uint64_t size = fourcc == V4L2_PIX_FMT_NV12 ? luma + pitch * ((height + 1) / 2) : luma;
+    if (size > sizeimage) return std::nullopt;
+
+    CapturePlanes planes;
+    planes.pitch = static_cast<uint32_t>(pitch);
+    planes.uv_offset = fourcc == V4L2_PIX_FMT_NV12 ? static_cast<uint32_t>(luma) : 0;
+    planes.size = static_cast<uint32_t>(size);
+    return planes;
+}
+
+double capture_bytes_per_sec(uint32_t fourcc, int width, int height, double fps) {
+    double pixels = static_cast<double>(width) * height * fps;
+    switch (fourcc) {
+        case V4L2_PIX_FMT_NV12: return pixels * 1.5;
+        case V4L2_PIX_FMT_YUYV: return pixels * 2.0;
+        default: return 0.0;
+    }
+}
+
+std::optional<CaptureMode> choose_capture_mode(const std::vector<CaptureMode>& modes, const CaptureRequest& request) {
+    std::optional<CaptureMode> best;
+    std::tuple<bool, bool, int, double, int, double> best_key;
+    for (const CaptureMode& mode : modes) {
+        int pipeline = pipeline_rank(mode.fourcc);
+        if (pipeline < 0 || mode.width <= 0 || mode.height <= 0) continue;
+        if (request.fourcc != 0 && !same_format(mode.fourcc, request.fourcc)) continue;
+
+        // 29.97 counts as 30; an unknown rate is taken at its word
+        bool fast_enough = mode.max_fps <= 0.0 || mode.max_fps + 0.5 >= request.fps;
+        double fps = fast_enough ? request.fps : mode.max_fps;
+        if (request.bandwidth_bytes_per_sec > 0.0 &&
+            capture_bytes_per_sec(mode.fourcc, mode.width, mode.height, fps) > request.bandwidth_bytes_per_sec) {
+            continue; // Would not fit on the bus: the driver fails STREAMON or drops frames
+        }
+
+        bool covers = request.width > 0 && request.height > 0 &&
+                      mode.width >= request.width && mode.height >= request.height;
+        double area = static_cast<double>(mode.width) * mode.height;
+        // Smaller is better in every field. Short of the request, size matters before pipeline.
+        auto key = std::make_tuple(!fast_enough, !covers, covers ? pipeline : 0, covers ? area : -area, pipeline,
+                                   -mode.max_fps);
+        if (!best || key < best_key) {
+            best = mode;
+            best_key = key;
+        }
+    }
+    return best;
+}
+
+CaptureModeCache& CaptureModeCache::shared() {
+    static CaptureModeCache cache;
+    return cache;
+}
+
+std::string CaptureModeCache::key(const std::string& device_name, const CaptureRequest& request) {
+    return device_name + "|" + std::to_string(request.fourcc) + "|" + std::to_string(request.width) + "x" +
+           std::to_string(request.height) + "@" + std::to_string(request.fps) + "|" +
+           std::to_string(static_cast<long long>(request.bandwidth_bytes_per_sec));
+}
+
+std::optional<CaptureMode> CaptureModeCache::find(const std::string& device_name, const CaptureRequest& request) const {
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    auto it = this->modes_.find(key(device_name, request));
+    if (it == this->modes_.end()) return std::nullopt;
+    return it->second;
+}
+
+void CaptureModeCache::store(const std::string& device_name, const CaptureRequest& request, const CaptureMode& mode) {
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    this->modes_[key(device_name, request)] = mode;
+}
+
+void CaptureModeCache::invalidate(const std::string& device_name, const CaptureRequest& request) {
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    this->modes_.erase(key(device_name, request));
+}
+
+} // namespace nuc_display::modules
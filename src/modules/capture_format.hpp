@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace nuc_display::modules {
+
+// One frame size and format a capture device offers (VIDIOC_ENUM_FRAMESIZES /
+// VIDIOC_ENUM_FRAMEINTERVALS), or the mode picked from them
+struct CaptureMode {
+    uint32_t fourcc = 0;     // V4L2_PIX_FMT_*
+    int width = 0;
+    int height = 0;
+    double max_fps = 0.0;    // Fastest interval at this size; 0 = driver didn't say
+
+    bool operator==(const CaptureMode&) const = default;
+};
+
+// What the camera is needed for
+struct CaptureRequest {
+    uint32_t fourcc = 0;             // Only this format; 0 = whichever pipeline is cheapest
+    int width = 0;                   // Pixels the whole frame covers on screen (capped by the config)
+    int height = 0;
+    int fps = 30;
+    double bandwidth_bytes_per_sec = 0.0; // Bus budget for uncompressed formats; 0 = unlimited
+};
+
+// Where the planes of a single-planar NV12/YUYV buffer sit, from S_FMT's
+// bytesperline and sizeimage. Rows may be padded past the visible width.
+struct CapturePlanes {
+    uint32_t pitch = 0;      // Bytes per row, luma and (NV12) chroma alike
+    uint32_t uv_offset = 0;  // NV12: chroma plane start, right after the luma rows
+    uint32_t size = 0;       // Bytes the planes span
+};
+
+// Empty for other formats, or if the driver's numbers can't hold the image.
+// A bytesperline of 0 (driver left it unset) means unpadded rows.
+std::optional<CapturePlanes> capture_planes(uint32_t fourcc, int width, int height,
+                                            uint32_t bytesperline, uint32_t sizeimage);
+
+// Bytes per second an uncompressed mode needs at `fps`; 0 for compressed formats
+double capture_bytes_per_sec(uint32_t fourcc, int width, int height, double fps);
+
+// The cheapest mode for `request`, in order of preference:
+//  1. reaches the requested fps (modes that can't only win when nothing can),
+//  2. covers the requested size (if nothing does: the largest available),
+//  3. NV12, then YUYV (DMA-BUF importable, converted on the GPU) if the bus can
+//     carry them, then MJPEG (decoded on the CPU),
+//  4. the smallest sufficient size.
+// A request size of 0 asks for the largest mode.
+// Formats the camera pipeline can't display are ignored. Empty if nothing fits.
+std::optional<CaptureMode> choose_capture_mode(const std::vector<CaptureMode>& modes, const CaptureRequest& request);
+
+// Negotiated modes by device name and request, so a reconnect (or a second camera
+// of the same model) skips enumeration. Process-wide; safe from several capture threads.
+class CaptureModeCache {
+public:
+    static CaptureModeCache& shared();
+
+    std::optional<CaptureMode> find(const std::string& device_name, const CaptureRequest& request) const;
+    void store(const std::string& device_name, const CaptureRequest& request, const CaptureMode& mode);
+    // The device refused a cached mode (firmware update, different model under the same name)
+    void invalidate(const std::string& device_name, const CaptureRequest& request);
+
+private:
+    static std::string key(const std::string& device_name, const CaptureRequest& request);
+
+    mutable std::mutex mutex_;
+    std::map<std::string, CaptureMode> modes_;
+};
+
+} // namespace nuc_display::modules
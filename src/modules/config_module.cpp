@@ -3,6 +3,7 @@
 #include <nlohmann/json.hpp>
 #include <fstream>
 #include <iostream>
+#include <algorithm>
 #include <linux/input-event-codes.h>
 
 namespace nuc_display::modules {
@@ -56,6 +57,24 @@ bool is_valid_key_name(const std::string& name) {
     return get_key_map().count(name) > 0;
 }
 
+// --- Shared video sources ---
+
+std::vector<int> resolve_video_sources(const std::vector<VideoConfig>& videos) {
+    std::vector<int> owners(videos.size(), -1);
+    for (size_t i = 0; i < videos.size(); ++i) {
+        if (!videos[i].enabled) continue;
+        owners[i] = static_cast<int>(i);
+        if (videos[i].source.empty()) continue;
+        for (size_t j = 0; j < i; ++j) {
+            if (owners[j] == static_cast<int>(j) && videos[j].source == videos[i].source) {
+                owners[i] = static_cast<int>(j);
+                break;
+            }
+        }
+    }
+    return owners;
+}
+
 // --- ConfigModule ---
 
 ConfigModule::ConfigModule() {
@@ -169,7 +188,18 @@ void ConfigModule::save_config(const AppConfig& config, const std::string& filep
         vj["enabled"] = v.enabled;
         vj["audio_enabled"] = v.audio_enabled;
         vj["audio_device"] = v.audio_device;
+        vj["audio_volume"] = v.audio_volume;
+        vj["audio_ducking"] = v.audio_ducking;
         vj["playlists"] = v.playlists;
+        if (!v.source.empty()) vj["source"] = v.source;
+        vj["network"] = {
+            {"open_timeout_ms", v.network.open_timeout_ms},
+            {"read_timeout_ms", v.network.read_timeout_ms},
+            {"jitter_buffer_ms", v.network.jitter_buffer_ms},
+            {"low_latency", v.network.low_latency},
+            {"reconnect_min_ms", v.network.reconnect_min_ms},
+            {"reconnect_max_ms", v.network.reconnect_max_ms}
+        };
         vj["x"] = v.x;
         vj["y"] = v.y;
         vj["w"] = v.w;
@@ -185,6 +215,8 @@ void ConfigModule::save_config(const AppConfig& config, const std::string& filep
         if (v.keys.prev) keys_j["prev"] = key_code_to_name(*v.keys.prev);
         if (v.keys.skip_forward) keys_j["skip_forward"] = key_code_to_name(*v.keys.skip_forward);
         if (v.keys.skip_backward) keys_j["skip_backward"] = key_code_to_name(*v.keys.skip_backward);
+        if (v.keys.scan_forward) keys_j["scan_forward"] = key_code_to_name(*v.keys.scan_forward);
+        if (v.keys.scan_backward) keys_j["scan_backward"] = key_code_to_name(*v.keys.scan_backward);
         if (!keys_j.empty()) vj["keys"] = keys_j;
 
         videos.push_back(vj);
@@ -353,13 +385,28 @@ std::expected<AppConfig, ConfigError> ConfigModule::load_or_create_config(const
                 v.enabled = video_json.value("enabled", true);
                 v.audio_enabled = video_json.value("audio_enabled", false);
                 v.audio_device = video_json.value("audio_device", "default");
+                v.audio_volume = std::clamp(video_json.value("audio_volume", 1.0f), 0.0f, 1.0f);
+                v.audio_ducking = video_json.value("audio_ducking", false);
                 
                 if (video_json.contains("playlists") && video_json["playlists"].is_array()) {
                     for (const auto& item : video_json["playlists"]) {
                         if (item.is_string()) v.playlists.push_back(item);
                     }
                 }
+
+                if (video_json.contains("network") && video_json["network"].is_object()) {
+                    const auto& net = video_json["network"];
+                    NetworkSourceOptions defaults;
+                    v.network.open_timeout_ms = net.value("open_timeout_ms", defaults.open_timeout_ms);
+                    v.network.read_timeout_ms = net.value("read_timeout_ms", defaults.read_timeout_ms);
+                    v.network.jitter_buffer_ms = net.value("jitter_buffer_ms", defaults.jitter_buffer_ms);
+                    v.network.low_latency = net.value("low_latency", defaults.low_latency);
+                    v.network.reconnect_min_ms = net.value("reconnect_min_ms", defaults.reconnect_min_ms);
+                    v.network.reconnect_max_ms = net.value("reconnect_max_ms", defaults.reconnect_max_ms);
+                }
                 
+                v.source = video_json.value("source", "");
+
                 v.x = video_json.value("x", 0.0f);
                 v.y = video_json.value("y", 0.0f);
                 v.w = video_json.value("w", 1.0f);
@@ -389,6 +436,8 @@ std::expected<AppConfig, ConfigError> ConfigModule::load_or_create_config(const
                     v.keys.prev = parse_optional_key(keys_json, "prev");
                     v.keys.skip_forward = parse_optional_key(keys_json, "skip_forward");
                     v.keys.skip_backward = parse_optional_key(keys_json, "skip_backward");
+                    v.keys.scan_forward = parse_optional_key(keys_json, "scan_forward");
+                    v.keys.scan_backward = parse_optional_key(keys_json, "scan_backward");
                 }
 
                 return v;
@@ -419,7 +468,7 @@ std::expected<AppConfig, ConfigError> ConfigModule::load_or_create_config(const
                     cam.width = c_json.value("width", 640);
                     cam.height = c_json.value("height", 480);
                     cam.fps = c_json.value("fps", 30);
-                    cam.pixel_format = c_json.value("pixel_format", "MJPG");
+                    cam.pixel_format = c_json.value("pixel_format", "auto");
                     cam.x = c_json.value("x", 0.0f);
                     cam.y = c_json.value("y", 0.0f);
                     cam.w = c_json.value("w", 1.0f);
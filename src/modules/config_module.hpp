@@ -7,6 +7,7 @@
 #include <cstdint>
 #include <unordered_map>
 #include "modules/stock_module.hpp" // For StockConfig
+#include "modules/network_source.hpp" // For NetworkSourceOptions
 
 namespace nuc_display::modules {
 
@@ -39,13 +40,22 @@ struct VideoKeysConfig {
     std::optional<uint16_t> prev;
     std::optional<uint16_t> skip_forward;
     std::optional<uint16_t> skip_backward;
+    // Keyframe-only fast forward / rewind: each press doubles the speed (2x..16x), then stops
+    std::optional<uint16_t> scan_forward;
+    std::optional<uint16_t> scan_backward;
 };
 
 struct VideoConfig {
     bool enabled = true;
     bool audio_enabled = false;
     std::string audio_device = "default";
-    std::vector<std::string> playlists;
+    float audio_volume = 1.0f;   // Gain in the shared audio mixer (0..1)
+    bool audio_ducking = false;  // Lower other regions' audio while this one plays
+    std::vector<std::string> playlists;  // File paths or http(s)/HLS/rtsp URLs
+    // Entries with the same non-empty source id share one decoder. The first enabled one
+    // owns it (playlists, audio, network, trigger, keys); the others only add a crop and rect.
+    std::string source;
+    NetworkSourceOptions network;        // Used by URL entries only
     float x = 0.0f, y = 0.0f, w = 1.0f, h = 1.0f;
     float src_x = 0.0f, src_y = 0.0f, src_w = 1.0f, src_h = 1.0f;
 
@@ -57,13 +67,17 @@ struct VideoConfig {
     VideoKeysConfig keys;
 };
 
+// For each videos[i]: the index of the entry whose decoder plays it (i itself unless it
+// shares a source with an earlier enabled entry), or -1 if the entry is disabled
+std::vector<int> resolve_video_sources(const std::vector<VideoConfig>& videos);
+
 struct CameraConfig {
     bool enabled = true;
     std::string device = "";         // e.g. "/dev/video0", "" = auto-detect
     int width = 640;
     int height = 480;
     int fps = 30;
-    std::string pixel_format = "MJPG"; // MJPG, YUYV, NV12
+    std::string pixel_format = "auto"; // auto (negotiated), MJPG, YUYV, NV12
     // Destination rect (same convention as VideoConfig)
     float x = 0.0f, y = 0.0f, w = 1.0f, h = 1.0f;
     float src_x = 0.0f, src_y = 0.0f, src_w = 1.0f, src_h = 1.0f;
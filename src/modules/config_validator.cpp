@@ -41,14 +41,33 @@ std::vector<std::string> ConfigValidator::validate(const AppConfig& config) {
     if (config.stock_keys.prev_chart) check_key(*config.stock_keys.prev_chart, "stock_keys.prev_chart");
 
     // 4. Per-video validation
+    std::vector<int> owners = resolve_video_sources(config.videos);
     for (size_t i = 0; i < config.videos.size(); ++i) {
         const auto& v = config.videos[i];
         std::string ctx = "videos[" + std::to_string(i) + "]";
 
-        // Enabled videos must have playlists
-        if (v.enabled && v.playlists.empty()) {
+        // Enabled videos must have playlists, unless another entry decodes their source
+        bool shared = owners[i] >= 0 && owners[i] != static_cast<int>(i);
+        if (v.enabled && v.playlists.empty() && !shared) {
             errors.push_back(ctx + ": enabled but has no playlists.");
         }
+        if (shared && !v.playlists.empty() && v.playlists != config.videos[owners[i]].playlists) {
+            errors.push_back(ctx + ": shares source '" + v.source + "' with videos[" + std::to_string(owners[i]) +
+                             "] but lists different playlists.");
+        }
+
+        // Network source timing
+        auto check_ms = [&](int val, int min_ms, int max_ms, const std::string& name) {
+            if (val < min_ms || val > max_ms) {
+                errors.push_back(ctx + ".network." + name + " out of range [" + std::to_string(min_ms) + ", " +
+                                 std::to_string(max_ms) + "] ms: " + std::to_string(val));
+            }
+        };
+        check_ms(v.network.open_timeout_ms, 100, 60000, "open_timeout_ms");
+        check_ms(v.network.read_timeout_ms, 100, 60000, "read_timeout_ms");
+        check_ms(v.network.jitter_buffer_ms, 0, 10000, "jitter_buffer_ms");
+        check_ms(v.network.reconnect_min_ms, 10, 60000, "reconnect_min_ms");
+        check_ms(v.network.reconnect_max_ms, v.network.reconnect_min_ms, 600000, "reconnect_max_ms");
 
         // Coordinate range checks
         auto check_range = [&](float val, const std::string& name) {
@@ -75,6 +94,8 @@ std::vector<std::string> ConfigValidator::validate(const AppConfig& config) {
         if (v.keys.prev) check_key(*v.keys.prev, ctx + ".keys.prev");
         if (v.keys.skip_forward) check_key(*v.keys.skip_forward, ctx + ".keys.skip_forward");
         if (v.keys.skip_backward) check_key(*v.keys.skip_backward, ctx + ".keys.skip_backward");
+        if (v.keys.scan_forward) check_key(*v.keys.scan_forward, ctx + ".keys.scan_forward");
+        if (v.keys.scan_backward) check_key(*v.keys.scan_backward, ctx + ".keys.scan_backward");
     }
 
     return errors;
@@ -1,8 +1,122 @@
 #include "modules/container_reader.hpp"
 #include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <mutex>
 
 namespace nuc_display::modules {
 
+namespace {
+// Keyframe indexes survive reloads of the same file (playlist loops, prev/next)
+constexpr size_t kMaxCachedIndexes = 32;
+// Packet scans stop here; seeks beyond the scanned range fall back to timestamp seeking
+constexpr int64_t kMaxScanBytes = 256LL * 1024 * 1024;
+// Demuxer-side AVIO buffer; the real buffering happens in ReadAheadFile
+constexpr int kAvioBufferBytes = 64 * 1024;
+
+std::mutex g_keyframe_cache_mutex;
+std::map<std::string, KeyframeIndex> g_keyframe_cache;
+
+std::string keyframe_cache_key(const std::string& filepath, int stream_index) {
+    std::error_code ec;
+    auto mtime = std::filesystem::last_write_time(filepath, ec);
+    auto stamp = ec ? 0 : mtime.time_since_epoch().count();
+    return filepath + "|" + std::to_string(stamp) + "|" + std::to_string(stream_index);
+}
+
+double stream_seconds(const AVStream* st, int64_t ts) {
+    int64_t start = st->start_time != AV_NOPTS_VALUE ? st->start_time : 0;
+    return (ts - start) * av_q2d(st->time_base);
+}
+
+ProbedStream probed_from(const AVStream* st) {
+    const AVCodecParameters* par = st->codecpar;
+    ProbedStream s;
+    s.codec_type = par->codec_type;
+    s.codec_id = par->codec_id;
+    s.codec_tag = par->codec_tag;
+    s.format = par->format;
+    s.bit_rate = par->bit_rate;
+    s.profile = par->profile;
+    s.level = par->level;
+    s.width = par->width;
+    s.height = par->height;
+    s.sar_num = par->sample_aspect_ratio.num;
+    s.sar_den = par->sample_aspect_ratio.den;
+    s.field_order = par->field_order;
+    s.color_range = par->color_range;
+    s.color_primaries = par->color_primaries;
+    s.color_trc = par->color_trc;
+    s.color_space = par->color_space;
+    s.chroma_location = par->chroma_location;
+    s.video_delay = par->video_delay;
+    s.sample_rate = par->sample_rate;
+    s.channel_order = par->ch_layout.order;
+    s.channels = par->ch_layout.nb_channels;
+    s.channel_mask = par->ch_layout.order == AV_CHANNEL_ORDER_NATIVE ? par->ch_layout.u.mask : 0;
+    s.frame_size = par->frame_size;
+    s.block_align = par->block_align;
+    if (par->extradata && par->extradata_size > 0) {
+        s.extradata.assign(par->extradata, par->extradata + par->extradata_size);
+    }
+    s.avg_frame_rate_num = st->avg_frame_rate.num;
+    s.avg_frame_rate_den = st->avg_frame_rate.den;
+    s.r_frame_rate_num = st->r_frame_rate.num;
+    s.r_frame_rate_den = st->r_frame_rate.den;
+    s.start_time = st->start_time;
+    s.duration = st->duration;
+    s.nb_frames = st->nb_frames;
+    return s;
+}
+
+bool apply_probed(AVStream* st, const ProbedStream& s) {
+    AVCodecParameters* par = st->codecpar;
+    if (!s.extradata.empty()) {
+        auto* extradata = static_cast<uint8_t*>(av_mallocz(s.extradata.size() + AV_INPUT_BUFFER_PADDING_SIZE));
+        if (!extradata) return false;
+        std::copy(s.extradata.begin(), s.extradata.end(), extradata);
+        av_freep(&par->extradata);
+        par->extradata = extradata;
+        par->extradata_size = static_cast<int>(s.extradata.size());
+    }
+    par->codec_id = static_cast<AVCodecID>(s.codec_id);
+    par->codec_tag = s.codec_tag;
+    par->format = s.format;
+    par->bit_rate = s.bit_rate;
+    par->profile = s.profile;
+    par->level = s.level;
+    par->width = s.width;
+    par->height = s.height;
+    par->sample_aspect_ratio = AVRational{s.sar_num, s.sar_den};
+    par->field_order = static_cast<AVFieldOrder>(s.field_order);
+    par->color_range = static_cast<AVColorRange>(s.color_range);
+    par->color_primaries = static_cast<AVColorPrimaries>(s.color_primaries);
+    par->color_trc = static_cast<AVColorTransferCharacteristic>(s.color_trc);
+    par->color_space = static_cast<AVColorSpace>(s.color_space);
+    par->chroma_location = static_cast<AVChromaLocation>(s.chroma_location);
+    par->video_delay = s.video_delay;
+    par->sample_rate = s.sample_rate;
+    if (s.codec_type == AVMEDIA_TYPE_AUDIO && s.channels > 0) {
+        av_channel_layout_uninit(&par->ch_layout);
+        if (s.channel_order == AV_CHANNEL_ORDER_NATIVE && s.channel_mask != 0) {
+            av_channel_layout_from_mask(&par->ch_layout, s.channel_mask);
+        } else {
+            av_channel_layout_default(&par->ch_layout, s.channels);
+        }
+    }
+    par->frame_size = s.frame_size;
+    par->block_align = s.block_align;
+    st->avg_frame_rate = AVRational{s.avg_frame_rate_num, s.avg_frame_rate_den};
+    st->r_frame_rate = AVRational{s.r_frame_rate_num, s.r_frame_rate_den};
+    st->start_time = s.start_time;
+    st->duration = s.duration;
+    st->nb_frames = s.nb_frames;
+    return true;
+}
+} // namespace
+
 ContainerReader::ContainerReader() {
     this->packet_ = av_packet_alloc();
 }
@@ -11,32 +125,207 @@ ContainerReader::~ContainerReader() {
     if (this->packet_) {
         av_packet_free(&this->packet_);
     }
+    this->close();
+}
+
+void ContainerReader::close() {
     if (this->format_ctx_) {
         avformat_close_input(&this->format_ctx_);
     }
+    // Custom I/O is ours to free, avformat_close_input leaves it alone
+    if (this->avio_) {
+        av_freep(&this->avio_->buffer);
+        avio_context_free(&this->avio_);
+    }
+    if (this->file_) {
+        this->file_->close();
+    }
+}
+
+int ContainerReader::read_cb(void* opaque, uint8_t* buf, int size) {
+    int64_t got = static_cast<ReadAheadFile*>(opaque)->read(buf, static_cast<size_t>(size));
+    if (got == 0) return AVERROR_EOF;
+    if (got < 0) return AVERROR(EIO);
+    return static_cast<int>(got);
+}
+
+int64_t ContainerReader::seek_cb(void* opaque, int64_t offset, int whence) {
+    auto* file = static_cast<ReadAheadFile*>(opaque);
+    if (whence & AVSEEK_SIZE) return file->size();
+    switch (whence & ~AVSEEK_FORCE) {
+        case SEEK_SET: break;
+        case SEEK_CUR: offset += file->position(); break;
+        case SEEK_END: offset += file->size(); break;
+        default: return AVERROR(EINVAL);
+    }
+    int64_t pos = file->seek(offset);
+    return pos < 0 ? AVERROR(EINVAL) : pos;
+}
+
+ReadAheadStats ContainerReader::io_stats() const {
+    return (this->avio_ && this->file_) ? this->file_->stats() : ReadAheadStats{};
 }
 
 std::expected<void, MediaError> ContainerReader::open(const std::string& filepath) {
     std::cout << "ContainerReader: Opening " << filepath << " using FFmpeg (Architecture Ready)\n";
     
     // Close any previously opened container to prevent double-open segfault
-    if (this->format_ctx_) {
-        avformat_close_input(&this->format_ctx_);
-        this->format_ctx_ = nullptr;
+    this->close();
+    
+    this->filepath_ = filepath;
+    this->keyframe_index_.clear();
+    this->keyframe_stream_ = -1;
+    this->probe_record_.reset();
+    this->probe_cached_ = false;
+
+    // Local files: a background thread reads ahead so SD card / USB latency
+    // spikes never reach the demuxer. Anything that fails here falls back to
+    // FFmpeg's own file protocol.
+    if (filepath.find("://") == std::string::npos) {
+        if (!this->file_) this->file_ = std::make_unique<ReadAheadFile>();
+        if (this->file_->open(filepath)) {
+            auto* buffer = static_cast<unsigned char*>(av_malloc(kAvioBufferBytes));
+            this->avio_ = buffer ? avio_alloc_context(buffer, kAvioBufferBytes, 0, this->file_.get(),
+                                                      &ContainerReader::read_cb, nullptr, &ContainerReader::seek_cb)
+                                 : nullptr;
+            if (this->avio_) {
+                this->format_ctx_ = avformat_alloc_context();
+                this->format_ctx_->pb = this->avio_;
+                this->format_ctx_->flags |= AVFMT_FLAG_CUSTOM_IO;
+            } else {
+                av_free(buffer);
+                this->file_->close();
+            }
+        }
     }
     
-    if (avformat_open_input(&this->format_ctx_, filepath.c_str(), nullptr, nullptr) != 0) {
+    AVDictionary* options = nullptr;
+    this->source_kind_ = classify_source(filepath);
+    this->last_read_error_ = 0;
+    if (this->is_network()) {
+        this->apply_network_options(&options);
+    }
+
+    int open_res = avformat_open_input(&this->format_ctx_, filepath.c_str(), nullptr, &options);
+    av_dict_free(&options);
+    if (open_res != 0) {
+        // format_ctx_ was freed by the failed open; the custom I/O is not
+        this->close();
         return std::unexpected(MediaError::FileNotFound);
     }
     
-    if (avformat_find_stream_info(this->format_ctx_, nullptr) < 0) {
-        return std::unexpected(MediaError::DecodeFailed);
+    // Repeat opens of an unchanged local file skip probing, which otherwise decodes
+    // the first frames of every stream. Formats that discover streams while demuxing
+    // (NOHEADER, e.g. MPEG-TS) always probe: their stream list isn't known yet.
+    bool cacheable = !this->is_network() && !(this->format_ctx_->ctx_flags & AVFMTCTX_NOHEADER);
+    if (cacheable) {
+        this->probe_record_ = ProbeCache::shared().load(filepath);
+        this->probe_cached_ = this->probe_record_ && this->apply_probe_record(*this->probe_record_);
+    }
+
+    if (!this->probe_cached_) {
+        int probe_res = avformat_find_stream_info(this->format_ctx_, nullptr);
+        this->deadline_.disarm();
+        if (probe_res < 0) {
+            return std::unexpected(MediaError::DecodeFailed);
+        }
+        this->probe_record_.reset();
+        if (cacheable) {
+            this->probe_record_ = this->make_probe_record();
+            ProbeCache::shared().store(filepath, *this->probe_record_);
+        }
     }
 
-    std::cout << "ContainerReader: Found " << this->format_ctx_->nb_streams << " streams.\n";
+    std::cout << "ContainerReader: Found " << this->format_ctx_->nb_streams << " streams";
+    if (this->probe_cached_) {
+        std::cout << " (probe cache)";
+    }
+    if (this->is_network()) {
+        std::cout << " (" << source_kind_name(this->source_kind_) << (this->is_live() ? ", live" : "") << ")";
+    }
+    std::cout << ".\n";
     return {};
 }
 
+bool ContainerReader::apply_probe_record(const ProbeRecord& record) {
+    // Same path, size and mtime, but make sure the demuxer agrees before trusting it
+    if (record.streams.size() != this->format_ctx_->nb_streams ||
+        !this->format_ctx_->iformat || record.format_name != this->format_ctx_->iformat->name) {
+        return false;
+    }
+    for (unsigned int i = 0; i < this->format_ctx_->nb_streams; i++) {
+        if (record.streams[i].codec_type != this->format_ctx_->streams[i]->codecpar->codec_type) return false;
+    }
+    for (unsigned int i = 0; i < this->format_ctx_->nb_streams; i++) {
+        if (!apply_probed(this->format_ctx_->streams[i], record.streams[i])) return false;
+    }
+    this->format_ctx_->start_time = record.start_time;
+    this->format_ctx_->duration = record.duration;
+    this->format_ctx_->bit_rate = record.bit_rate;
+    return true;
+}
+
+ProbeRecord ContainerReader::make_probe_record() const {
+    ProbeRecord record;
+    record.format_name = this->format_ctx_->iformat ? this->format_ctx_->iformat->name : "";
+    record.start_time = this->format_ctx_->start_time;
+    record.duration = this->format_ctx_->duration;
+    record.bit_rate = this->format_ctx_->bit_rate;
+    for (unsigned int i = 0; i < this->format_ctx_->nb_streams; i++) {
+        record.streams.push_back(probed_from(this->format_ctx_->streams[i]));
+    }
+    return record;
+}
+
+void ContainerReader::apply_network_options(AVDictionary** options) {
+    const auto& net = this->network_options_;
+
+    // Every blocking call (connect, probe, read) polls the deadline
+    this->format_ctx_ = avformat_alloc_context();
+    this->format_ctx_->interrupt_callback.callback = &IoDeadline::interrupt_cb;
+    this->format_ctx_->interrupt_callback.opaque = &this->deadline_;
+    this->deadline_.arm(std::chrono::milliseconds(net.open_timeout_ms));
+
+    // Protocol-level timeouts (microseconds) as a second line of defence
+    std::string read_timeout_us = std::to_string(static_cast<int64_t>(net.read_timeout_ms) * 1000);
+    av_dict_set(options, "rw_timeout", read_timeout_us.c_str(), 0);
+    switch (this->source_kind_) {
+        case SourceKind::Http:
+        case SourceKind::Hls:
+            // Let the HTTP protocol ride out short drops itself; longer outages end
+            // the read and the decoder reconnects with backoff
+            av_dict_set(options, "reconnect", "1", 0);
+            av_dict_set(options, "reconnect_streamed", "1", 0);
+            av_dict_set(options, "reconnect_on_network_error", "1", 0);
+            av_dict_set(options, "reconnect_delay_max", "2", 0);
+            if (net.low_latency && this->source_kind_ == SourceKind::Hls) {
+                av_dict_set(options, "live_start_index", "-1", 0);
+            }
+            break;
+        case SourceKind::Rtsp:
+            // Interleaved TCP: no lost UDP packets on a busy LAN, and it gets through NAT
+            av_dict_set(options, "rtsp_transport", "tcp", 0);
+            av_dict_set(options, "timeout", read_timeout_us.c_str(), 0);
+            break;
+        default:
+            break;
+    }
+
+    if (net.low_latency) {
+        // Start from a short probe and hand packets over as soon as they are demuxed
+        this->format_ctx_->flags |= AVFMT_FLAG_NOBUFFER;
+        av_dict_set(options, "probesize", "500000", 0);
+        av_dict_set(options, "analyzeduration", "500000", 0);
+        av_dict_set(options, "max_delay", "100000", 0);
+    }
+}
+
+bool ContainerReader::is_live() const {
+    if (is_live_protocol(this->source_kind_)) return true;
+    return this->is_network() && this->format_ctx_ &&
+           (this->format_ctx_->duration == AV_NOPTS_VALUE || this->format_ctx_->duration <= 0);
+}
+
 int ContainerReader::find_video_stream() const {
     if (!this->format_ctx_) return -1;
     for (unsigned int i = 0; i < this->format_ctx_->nb_streams; i++) {
@@ -74,7 +363,12 @@ AVRational ContainerReader::get_stream_timebase(int stream_index) const {
 std::expected<AVPacket*, MediaError> ContainerReader::read_packet() {
     if (!this->format_ctx_ || !this->packet_) return std::unexpected(MediaError::InternalError);
     av_packet_unref(this->packet_);
-    if (av_read_frame(this->format_ctx_, this->packet_) < 0) {
+    if (this->is_network()) {
+        this->deadline_.arm(std::chrono::milliseconds(this->network_options_.read_timeout_ms));
+    }
+    this->last_read_error_ = av_read_frame(this->format_ctx_, this->packet_);
+    this->deadline_.disarm();
+    if (this->last_read_error_ < 0) {
         return std::unexpected(MediaError::InternalError);
     }
     return this->packet_;
@@ -86,4 +380,122 @@ void ContainerReader::rewind() {
     }
 }
 
+size_t ContainerReader::build_keyframe_index(int stream_index) {
+    this->keyframe_index_.clear();
+    this->keyframe_stream_ = -1;
+    if (!this->format_ctx_ || stream_index < 0 || stream_index >= static_cast<int>(this->format_ctx_->nb_streams)) {
+        return 0;
+    }
+    this->keyframe_stream_ = stream_index;
+
+    std::string key = keyframe_cache_key(this->filepath_, stream_index);
+    {
+        std::lock_guard<std::mutex> lock(g_keyframe_cache_mutex);
+        auto it = g_keyframe_cache.find(key);
+        if (it != g_keyframe_cache.end()) {
+            this->keyframe_index_ = it->second;
+            return this->keyframe_index_.size();
+        }
+    }
+
+    // Seek table persisted by an earlier run: skips the packet scan entirely
+    if (this->probe_record_ && this->probe_record_->keyframe_stream == stream_index) {
+        for (const auto& e : this->probe_record_->keyframes) this->keyframe_index_.add(e.time_sec, e.timestamp);
+        this->keyframe_index_.set_coverage(this->probe_record_->keyframe_coverage);
+        this->keyframe_index_.finalize();
+        std::cout << "ContainerReader: Keyframe index " << this->keyframe_index_.size() << " entries (probe cache)\n";
+        std::lock_guard<std::mutex> lock(g_keyframe_cache_mutex);
+        if (g_keyframe_cache.size() >= kMaxCachedIndexes) g_keyframe_cache.clear();
+        g_keyframe_cache[key] = this->keyframe_index_;
+        return this->keyframe_index_.size();
+    }
+
+    // 1. Container index (MP4/MKV/...): free, already parsed by avformat_open_input
+    AVStream* st = this->format_ctx_->streams[stream_index];
+    int count = avformat_index_get_entries_count(st);
+    for (int i = 0; i < count; ++i) {
+        const AVIndexEntry* e = avformat_index_get_entry(st, i);
+        if (e && (e->flags & AVINDEX_KEYFRAME)) {
+            this->keyframe_index_.add(stream_seconds(st, e->timestamp), e->timestamp);
+        }
+    }
+
+    // 2. No usable index (MPEG-TS, raw streams): scan packet headers once.
+    // Never over the network: that would download the whole file up front.
+    if (this->keyframe_index_.size() < 2 && this->is_network()) {
+        this->keyframe_index_.clear();
+    } else if (this->keyframe_index_.size() < 2) {
+        this->keyframe_index_.clear();
+        this->scan_keyframes(stream_index, this->keyframe_index_);
+    }
+    this->keyframe_index_.finalize();
+
+    std::cout << "ContainerReader: Keyframe index " << this->keyframe_index_.size() << " entries"
+              << (count > 0 ? " (container index)" : " (packet scan)") << "\n";
+
+    if (this->probe_record_) {
+        this->probe_record_->keyframe_stream = stream_index;
+        this->probe_record_->keyframes = this->keyframe_index_.entries();
+        this->probe_record_->keyframe_coverage = this->keyframe_index_.coverage();
+        ProbeCache::shared().store(this->filepath_, *this->probe_record_);
+    }
+
+    std::lock_guard<std::mutex> lock(g_keyframe_cache_mutex);
+    if (g_keyframe_cache.size() >= kMaxCachedIndexes) g_keyframe_cache.clear();
+    g_keyframe_cache[key] = this->keyframe_index_;
+    return this->keyframe_index_.size();
+}
+
+void ContainerReader::scan_keyframes(int stream_index, KeyframeIndex& index) {
+    AVStream* st = this->format_ctx_->streams[stream_index];
+
+    // Let the demuxer skip payloads of every other stream while scanning
+    std::vector<AVDiscard> saved_discard(this->format_ctx_->nb_streams);
+    for (unsigned int i = 0; i < this->format_ctx_->nb_streams; i++) {
+        saved_discard[i] = this->format_ctx_->streams[i]->discard;
+        if (static_cast<int>(i) != stream_index) this->format_ctx_->streams[i]->discard = AVDISCARD_ALL;
+    }
+
+    AVPacket* pkt = av_packet_alloc();
+    double last_sec = 0.0;
+    bool complete = true;
+    while (av_read_frame(this->format_ctx_, pkt) >= 0) {
+        if (pkt->stream_index == stream_index) {
+            int64_t ts = pkt->pts != AV_NOPTS_VALUE ? pkt->pts : pkt->dts;
+            if (ts != AV_NOPTS_VALUE) {
+                double t = stream_seconds(st, ts);
+                last_sec = std::max(last_sec, t);
+                if (pkt->flags & AV_PKT_FLAG_KEY) index.add(t, ts);
+            }
+        }
+        av_packet_unref(pkt);
+        if (this->format_ctx_->pb && avio_tell(this->format_ctx_->pb) > kMaxScanBytes) {
+            complete = false;
+            break;
+        }
+    }
+    av_packet_free(&pkt);
+    if (!complete) index.set_coverage(last_sec);
+
+    for (unsigned int i = 0; i < this->format_ctx_->nb_streams; i++) {
+        this->format_ctx_->streams[i]->discard = saved_discard[i];
+    }
+    this->rewind();
+}
+
+double ContainerReader::seek_to_keyframe(int stream_index, double target_sec) {
+    if (!this->format_ctx_) return target_sec;
+
+    const KeyframeEntry* kf = (stream_index == this->keyframe_stream_)
+                                  ? this->keyframe_index_.at_or_before(target_sec) : nullptr;
+    if (kf && av_seek_frame(this->format_ctx_, stream_index, kf->timestamp, AVSEEK_FLAG_BACKWARD) >= 0) {
+        return kf->time_sec;
+    }
+
+    // No index for this position: let the demuxer search by timestamp
+    int64_t start = this->format_ctx_->start_time != AV_NOPTS_VALUE ? this->format_ctx_->start_time : 0;
+    av_seek_frame(this->format_ctx_, -1, start + static_cast<int64_t>(target_sec * AV_TIME_BASE), AVSEEK_FLAG_BACKWARD);
+    return target_sec;
+}
+
 } // namespace nuc_display::modules
@@ -4,7 +4,12 @@
 #include <expected>
 #include <vector>
 #include <memory>
+#include <optional>
 #include "modules/media_module.hpp"
+#include "modules/keyframe_index.hpp"
+#include "modules/read_ahead_file.hpp"
+#include "modules/network_source.hpp"
+#include "modules/probe_cache.hpp"
 
 extern "C" {
 #include <libavformat/avformat.h>
@@ -18,6 +23,19 @@ public:
     ~ContainerReader();
 
     std::expected<void, MediaError> open(const std::string& filepath);
+    // Timeouts, probing and buffering flags for URLs (applied on the next open())
+    void set_network_options(const NetworkSourceOptions& options) { network_options_ = options; }
+    
+    SourceKind source_kind() const { return source_kind_; }
+    bool is_network() const { return source_kind_ != SourceKind::File; }
+    // No end in sight: RTSP/UDP/..., or HTTP/HLS without a duration
+    bool is_live() const;
+    // The last read_packet() failed because the stream ended, not on a timeout or network error
+    bool at_eof() const { return last_read_error_ == AVERROR_EOF; }
+    // Make a blocking open/read on another thread give up now, and every one after
+    // it until clear_interrupt()
+    void interrupt() { deadline_.abort(); }
+    void clear_interrupt() { deadline_.clear_abort(); }
     
     int find_video_stream() const;
     int find_audio_stream() const;
@@ -26,12 +44,51 @@ public:
     std::expected<AVPacket*, MediaError> read_packet();
 
     void rewind();
+    // Free the demuxer and read-ahead buffer; open() brings them back (through the probe cache)
+    void close();
+
+    // Build (or fetch from the in-memory or probe cache) the keyframe index of one stream.
+    // Uses the container index when it has one, otherwise scans packet headers.
+    size_t build_keyframe_index(int stream_index);
+    const KeyframeIndex& keyframe_index() const { return keyframe_index_; }
+    // Seek to the last keyframe at or before target_sec (seconds from stream start).
+    // Returns the keyframe time, or target_sec if the index could not be used.
+    double seek_to_keyframe(int stream_index, double target_sec);
     
     AVFormatContext* format_ctx() const { return format_ctx_; }
+    // Local files are demuxed through a read-ahead buffer; URLs use FFmpeg's own I/O
+    ReadAheadStats io_stats() const;
+    // Stream parameters came from the on-disk probe cache instead of avformat_find_stream_info
+    bool probe_cached() const { return probe_cached_; }
 
 private:
+    // Interrupt callback, protocol timeouts and low-latency flags for a URL
+    void apply_network_options(AVDictionary** options);
+    void scan_keyframes(int stream_index, KeyframeIndex& index);
+    // Copy a cached probe into the freshly opened streams; false if it doesn't fit them
+    bool apply_probe_record(const ProbeRecord& record);
+    ProbeRecord make_probe_record() const;
+
+    // AVIOContext callbacks over file_
+    static int read_cb(void* opaque, uint8_t* buf, int size);
+    static int64_t seek_cb(void* opaque, int64_t offset, int whence);
+
     AVFormatContext* format_ctx_ = nullptr;
     AVPacket* packet_ = nullptr;
+    std::string filepath_;
+    KeyframeIndex keyframe_index_;
+    int keyframe_stream_ = -1;
+    std::unique_ptr<ReadAheadFile> file_;
+    AVIOContext* avio_ = nullptr;
+
+    NetworkSourceOptions network_options_;
+    SourceKind source_kind_ = SourceKind::File;
+    IoDeadline deadline_;
+    int last_read_error_ = 0;
+
+    // Local files only: what was (or will be) persisted in ProbeCache
+    std::optional<ProbeRecord> probe_record_;
+    bool probe_cached_ = false;
 };
 
 } // namespace nuc_display::modules
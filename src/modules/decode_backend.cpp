@@ -0,0 +1,273 @@
+#include "modules/decode_backend.hpp"
+#ifdef HAVE_VAAPI
+#include "modules/vaapi_scaler.hpp"
+#endif
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace nuc_display::modules {
+
+namespace {
+
+// One hardware device context per device type for the whole process. Every
+// backend instance holds a reference; the registry's own one goes with the last.
+std::mutex g_shared_hw_device_mutex;
+std::map<AVHWDeviceType, AVBufferRef*> g_shared_hw_devices;
+
+int acquire_shared_hw_device(AVBufferRef** out, AVHWDeviceType type, const char* device_path) {
+    std::lock_guard<std::mutex> lock(g_shared_hw_device_mutex);
+    AVBufferRef*& shared = g_shared_hw_devices[type];
+    if (!shared) {
+        int err = av_hwdevice_ctx_create(&shared, type, device_path, nullptr, 0);
+        if (err < 0) return err;
+    }
+    *out = av_buffer_ref(shared);
+    return *out ? 0 : AVERROR(ENOMEM);
+}
+
+void release_shared_hw_device(AVBufferRef** ref) {
+    if (!*ref) return;
+    std::lock_guard<std::mutex> lock(g_shared_hw_device_mutex);
+    auto type = reinterpret_cast<AVHWDeviceContext*>((*ref)->data)->type;
+    av_buffer_unref(ref);
+    auto it = g_shared_hw_devices.find(type);
+    if (it != g_shared_hw_devices.end() && it->second && av_buffer_get_ref_count(it->second) == 1) {
+        av_buffer_unref(&it->second);
+        g_shared_hw_devices.erase(it);
+    }
+}
+
+// Map DecodeScalePlan levels onto libavcodec discard thresholds
+AVDiscard discard_from_level(int level) {
+    switch (level) {
+        case 1: return AVDISCARD_NONREF;
+        case 2: return AVDISCARD_ALL;
+        default: return AVDISCARD_DEFAULT;
+    }
+}
+
+bool has_hw_config(const AVCodec* codec, AVHWDeviceType type) {
+    for (int i = 0;; ++i) {
+        const AVCodecHWConfig* hw_cfg = avcodec_get_hw_config(codec, i);
+        if (!hw_cfg) return false;
+        if (hw_cfg->device_type == type && (hw_cfg->methods & AV_CODEC_HW_CONFIG_METHOD_HW_DEVICE_CTX)) return true;
+    }
+}
+
+// Base for hwaccels selected through get_format(): pick `format` when offered,
+// otherwise let the codec carry on in software until the core reopens it
+class HwaccelBackend : public DecodeBackend {
+public:
+    HwaccelBackend(AVHWDeviceType type, AVPixelFormat format, std::string device_path)
+        : type_(type), format_(format), device_path_(std::move(device_path)) {}
+    ~HwaccelBackend() override { release_shared_hw_device(&this->device_); }
+
+    bool init_device() override {
+        if (this->device_) return true;
+        int err = acquire_shared_hw_device(&this->device_, this->type_, this->device_path_.c_str());
+        if (err < 0) {
+            char errbuf[AV_ERROR_MAX_STRING_SIZE];
+            av_strerror(err, errbuf, sizeof(errbuf));
+            std::cerr << "DecodeBackend: " << this->name() << " device " << this->device_path_
+                      << " unavailable (" << errbuf << ").\n";
+            return false;
+        }
+        return true;
+    }
+
+    const AVCodec* find_decoder(const AVCodecParameters* params) const override {
+        const AVCodec* codec = avcodec_find_decoder(params->codec_id);
+        return codec && has_hw_config(codec, this->type_) ? codec : nullptr;
+    }
+
+    void configure(AVCodecContext* ctx, const DecodeSetup& setup) override {
+        ctx->hw_device_ctx = av_buffer_ref(this->device_);
+        ctx->opaque = this;
+        ctx->get_format = [](AVCodecContext* c, const enum AVPixelFormat* pix_fmts) -> enum AVPixelFormat {
+            auto* self = static_cast<HwaccelBackend*>(c->opaque);
+            for (const enum AVPixelFormat* p = pix_fmts; *p != AV_PIX_FMT_NONE; p++) {
+                if (*p == self->format_) return *p;
+            }
+            std::cerr << "DecodeBackend: " << self->name() << " can't decode this " << avcodec_get_name(c->codec_id)
+                      << " profile.\n";
+            // Without the hwaccel the codec must not allocate hardware surfaces
+            av_buffer_unref(&c->hw_device_ctx);
+            return pix_fmts[0];
+        };
+        // Headroom beyond the codec's reference frames, within the DecodeScheduler's grant
+        ctx->extra_hw_frames = setup.extra_hw_frames;
+    }
+
+    bool active(const AVCodecContext* ctx) const override { return ctx->hw_device_ctx != nullptr; }
+
+protected:
+    AVHWDeviceType type_;
+    AVPixelFormat format_;
+    std::string device_path_;
+    AVBufferRef* device_ = nullptr;
+};
+
+#ifdef HAVE_VAAPI
+class VaapiBackend : public HwaccelBackend {
+public:
+    explicit VaapiBackend(const std::string& render_node)
+        : HwaccelBackend(AV_HWDEVICE_TYPE_VAAPI, AV_PIX_FMT_VAAPI, render_node) {}
+    DecodeBackendKind kind() const override { return DecodeBackendKind::Vaapi; }
+
+    void configure(AVCodecContext* ctx, const DecodeSetup& setup) override {
+        HwaccelBackend::configure(ctx, setup);
+        this->scale_ = setup.scale;
+        // Output frames live in the frame queue plus the presented/mapped pair
+        this->scaler_pool_ = setup.queued_frames + 3;
+    }
+
+    // Small region: scale on the GPU into right-sized surfaces before queueing
+    AVFrame* postprocess(AVFrame* frame) override {
+        if (frame->format != AV_PIX_FMT_VAAPI || !this->scale_.worth_scaling || this->scale_failed_) return frame;
+        if (!this->scaler_.is_active()) {
+            if (!this->scaler_.init(this->device_, this->scale_.target_w,
+                                    this->scale_.target_h, this->scaler_pool_)) {
+                std::cerr << "DecodeBackend: VPP scaling unavailable, presenting full-size surfaces.\n";
+                this->scale_failed_ = true;
+                return frame;
+            }
+        }
+        AVFrame* scaled = this->scaler_.scale(frame);
+        if (!scaled) return frame;
+        // Release the full-size surface back to the decoder pool right away
+        av_frame_free(&frame);
+        return scaled;
+    }
+
+    void reset() override {
+        this->scaler_.release();
+        this->scale_failed_ = false;
+    }
+
+private:
+    VaapiScaler scaler_;
+    bool scale_failed_ = false;  // Don't retry VPP setup on every frame
+    DecodeScalePlan scale_;
+    int scaler_pool_ = 0;
+};
+#endif
+
+class DrmPrimeBackend : public HwaccelBackend {
+public:
+    explicit DrmPrimeBackend(const std::string& primary_node)
+        : HwaccelBackend(AV_HWDEVICE_TYPE_DRM, AV_PIX_FMT_DRM_PRIME, primary_node) {}
+    DecodeBackendKind kind() const override { return DecodeBackendKind::DrmPrime; }
+};
+
+class V4l2M2mBackend : public DecodeBackend {
+public:
+    explicit V4l2M2mBackend(std::string primary_node) : device_path_(std::move(primary_node)) {}
+    ~V4l2M2mBackend() override { release_shared_hw_device(&this->device_); }
+    DecodeBackendKind kind() const override { return DecodeBackendKind::V4l2M2m; }
+
+    bool init_device() override {
+        // The mem2mem decoder drives its own video device; the DRM device only helps
+        // it export DMA-BUFs, so it is optional
+        if (!this->device_ && acquire_shared_hw_device(&this->device_, AV_HWDEVICE_TYPE_DRM, this->device_path_.c_str()) < 0) {
+            std::cerr << "DecodeBackend: No DRM device for v4l2, frames may not be zero-copy.\n";
+        }
+        return true;
+    }
+
+    const AVCodec* find_decoder(const AVCodecParameters* params) const override {
+        std::string base = avcodec_get_name(params->codec_id);
+        if (base == "mpeg2video") base = "mpeg2";
+        return avcodec_find_decoder_by_name((base + "_v4l2m2m").c_str());
+    }
+
+    void configure(AVCodecContext* ctx, const DecodeSetup& setup) override {
+        if (this->device_) ctx->hw_device_ctx = av_buffer_ref(this->device_);
+        ctx->extra_hw_frames = setup.extra_hw_frames;
+    }
+
+private:
+    std::string device_path_;
+    AVBufferRef* device_ = nullptr;
+};
+
+class SoftwareBackend : public DecodeBackend {
+public:
+    DecodeBackendKind kind() const override { return DecodeBackendKind::Software; }
+    bool is_hardware() const override { return false; }
+
+    const AVCodec* find_decoder(const AVCodecParameters* params) const override {
+        return avcodec_find_decoder(params->codec_id);
+    }
+
+    void configure(AVCodecContext* ctx, const DecodeSetup& setup) override {
+        // Spread the work across all cores with frame + slice threading
+        unsigned int cores = std::thread::hardware_concurrency();
+        ctx->thread_count = std::clamp(static_cast<int>(cores), 1, 16);
+        ctx->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+        std::cout << "DecodeBackend: Software decode with " << ctx->thread_count << " threads.\n";
+
+        // Small destination: decode at reduced resolution and skip detail the GPU minification hides
+        const DecodeScalePlan& plan = setup.scale;
+        if (plan.reduction >= 2.0) {
+            ctx->lowres = plan.lowres;
+            ctx->skip_loop_filter = discard_from_level(plan.skip_loop_filter);
+            ctx->skip_idct = discard_from_level(plan.skip_idct);
+            std::cout << "DecodeBackend: Target " << plan.target_w << "x" << plan.target_h
+                      << " is " << plan.reduction << "x smaller than the stream: lowres="
+                      << plan.lowres << ", skip_loop_filter=" << plan.skip_loop_filter
+                      << ", skip_idct=" << plan.skip_idct << "\n";
+        }
+    }
+};
+
+} // namespace
+
+const char* decode_backend_name(DecodeBackendKind kind) {
+    switch (kind) {
+        case DecodeBackendKind::Vaapi:    return "vaapi";
+        case DecodeBackendKind::V4l2M2m:  return "v4l2";
+        case DecodeBackendKind::DrmPrime: return "drm";
+        case DecodeBackendKind::Software: return "sw";
+    }
+    return "?";
+}
+
+std::optional<DecodeBackendKind> decode_backend_from_name(std::string_view name) {
+    for (DecodeBackendKind kind : {DecodeBackendKind::Vaapi, DecodeBackendKind::V4l2M2m,
+                                   DecodeBackendKind::DrmPrime, DecodeBackendKind::Software}) {
+        if (name == decode_backend_name(kind)) return kind;
+    }
+    return std::nullopt;
+}
+
+std::vector<DecodeBackendKind> default_decode_backends() {
+#ifdef PLATFORM_RPI
+    // The Pi's stateful H.264 block first; newer boards decode HEVC through the request API
+    return {DecodeBackendKind::V4l2M2m, DecodeBackendKind::DrmPrime, DecodeBackendKind::Software};
+#elif defined(HAVE_VAAPI)
+    return {DecodeBackendKind::Vaapi, DecodeBackendKind::DrmPrime, DecodeBackendKind::V4l2M2m,
+            DecodeBackendKind::Software};
+#else
+    return {DecodeBackendKind::DrmPrime, DecodeBackendKind::V4l2M2m, DecodeBackendKind::Software};
+#endif
+}
+
+std::unique_ptr<DecodeBackend> DecodeBackend::create(DecodeBackendKind kind, const DecodeDevices& devices) {
+    switch (kind) {
+#ifdef HAVE_VAAPI
+        case DecodeBackendKind::Vaapi:    return std::make_unique<VaapiBackend>(devices.render_node);
+#else
+        case DecodeBackendKind::Vaapi:    return nullptr; // Built without libva
+#endif
+        case DecodeBackendKind::V4l2M2m:  return std::make_unique<V4l2M2mBackend>(devices.primary_node);
+        case DecodeBackendKind::DrmPrime: return std::make_unique<DrmPrimeBackend>(devices.primary_node);
+        case DecodeBackendKind::Software: return std::make_unique<SoftwareBackend>();
+    }
+    return nullptr;
+}
+
+} // namespace nuc_display::modules
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "modules/decode_scale_policy.hpp"
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavutil/hwcontext.h>
+}
+
+namespace nuc_display::modules {
+
+enum class DecodeBackendKind {
+    Vaapi,     // Intel/AMD hwaccel, VAAPI surfaces mapped to DRM PRIME (optional VPP downscale)
+    V4l2M2m,   // Stateful V4L2 mem2mem decoders (<codec>_v4l2m2m), e.g. the Pi's bcm2835-codec
+    DrmPrime,  // Stateless hwaccels that hand out DRM PRIME frames directly (V4L2 request API)
+    Software   // libavcodec on the CPU with frame + slice threads
+};
+
+// "vaapi", "v4l2", "drm", "sw"
+const char* decode_backend_name(DecodeBackendKind kind);
+std::optional<DecodeBackendKind> decode_backend_from_name(std::string_view name);
+// Every backend this build can run, in runtime probe order (hardware first, software last)
+std::vector<DecodeBackendKind> default_decode_backends();
+
+// What the decoder core asks of a backend when it opens a stream
+struct DecodeSetup {
+    DecodeScalePlan scale;     // Destination-aware sizing for this stream
+    int extra_hw_frames = 0;   // Surfaces beyond the codec's references (frame queue + presented)
+    int queued_frames = 0;     // Decoded frames the core may queue ahead of presentation
+};
+
+// DRM nodes the hardware backends open. The defaults suit single-GPU machines; the
+// player passes those of the GPU that scans out, so decoded surfaces import without
+// crossing devices.
+struct DecodeDevices {
+    std::string render_node = "/dev/dri/renderD128"; // VA-API
+    std::string primary_node = "/dev/dri/card0";     // DRM PRIME hwaccels, v4l2 DMA-BUF export
+};
+
+// One way of turning packets into frames. VideoDecoder owns the queues, audio,
+// pacing and presentation, and asks its backends in priority order for a decoder
+// until one opens; a backend that turns out not to handle the stream after all
+// (hwaccel without the profile) makes it reopen with the next one.
+class DecodeBackend {
+public:
+    virtual ~DecodeBackend() = default;
+    static std::unique_ptr<DecodeBackend> create(DecodeBackendKind kind, const DecodeDevices& devices = {});
+
+    virtual DecodeBackendKind kind() const = 0;
+    const char* name() const { return decode_backend_name(this->kind()); }
+    virtual bool is_hardware() const { return true; }
+
+    // Once per decoder: open (or share) the device. False if this machine can't run it.
+    virtual bool init_device() { return true; }
+    // Decoder for the stream, nullptr if the backend has none for its codec
+    virtual const AVCodec* find_decoder(const AVCodecParameters* params) const = 0;
+    // Prepare the context before avcodec_open2()
+    virtual void configure(AVCodecContext* ctx, const DecodeSetup& setup) = 0;
+    // After the first frame: still decoding on this backend (get_format() may have
+    // dropped a hwaccel that lacks the stream's profile)
+    virtual bool active(const AVCodecContext* ctx) const { (void)ctx; return true; }
+    // Decoded frame on its way to the queue; may return a replacement
+    virtual AVFrame* postprocess(AVFrame* frame) { return frame; }
+    // The codec was closed: drop per-stream state
+    virtual void reset() {}
+};
+
+} // namespace nuc_display::modules
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+namespace nuc_display::modules {
+
+// How aggressively the decoder may cut corners for a small on-screen region.
+// Kept free of FFmpeg types so the heuristics can be unit tested on their own;
+// the software decode backend maps the levels onto AVDiscard values.
+struct DecodeScalePlan {
+    int target_w = 0;          // Pixels actually needed (even, never larger than the source)
+    int target_h = 0;
+    double reduction = 1.0;    // Uniform source/target factor achievable on both axes
+    int lowres = 0;            // libavcodec lowres shift (0 = full resolution)
+    int skip_loop_filter = 0;  // 0 = none, 1 = non-reference frames, 2 = all frames
+    int skip_idct = 0;         // 0 = none, 1 = non-reference frames
+    bool worth_scaling = false; // True when a VA-API scale step pays for itself
+};
+
+// src_*: coded stream size. dst_*: source pixels the region samples on screen
+// (destination size divided by the crop fraction). max_lowres: AVCodec::max_lowres.
+inline DecodeScalePlan plan_decode_scale(int src_w, int src_h, int dst_w, int dst_h, int max_lowres) {
+    DecodeScalePlan plan;
+    plan.target_w = src_w;
+    plan.target_h = src_h;
+    if (src_w <= 0 || src_h <= 0 || dst_w <= 0 || dst_h <= 0) return plan;
+
+    // Round up to even sizes (NV12 chroma) and never upscale
+    plan.target_w = std::min(src_w, (dst_w + 1) & ~1);
+    plan.target_h = std::min(src_h, (dst_h + 1) & ~1);
+
+    plan.reduction = std::min(static_cast<double>(src_w) / plan.target_w,
+                              static_cast<double>(src_h) / plan.target_h);
+    plan.worth_scaling = plan.reduction >= 1.5;
+
+    // Largest power-of-two shrink that still covers the target on both axes
+    int shift = static_cast<int>(std::floor(std::log2(plan.reduction)));
+    plan.lowres = std::clamp(shift, 0, std::max(0, max_lowres));
+
+    // Deblocking and IDCT detail is invisible once the GPU minifies by 2x/4x
+    if (plan.reduction >= 4.0) {
+        plan.skip_loop_filter = 2;
+        plan.skip_idct = 1;
+    } else if (plan.reduction >= 2.0) {
+        plan.skip_loop_filter = 1;
+    }
+    return plan;
+}
+
+} // namespace nuc_display::modules
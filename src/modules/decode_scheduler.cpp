@@ -0,0 +1,140 @@
+#include "modules/decode_scheduler.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace nuc_display::modules {
+
+DecodeScheduler::DecodeScheduler(int total_surfaces)
+    : total_surfaces_(std::max(total_surfaces, kMinSurfacesPerDecoder)) {}
+
+double DecodeScheduler::uncovered_area(const RegionRect& target, const std::vector<RegionRect>& occluders) {
+    if (target.w <= 0.0f || target.h <= 0.0f) return 0.0;
+
+    // Coordinate compression: split the target along every occluder edge and
+    // sum the cells no occluder covers. Exact, and cheap for a handful of layers.
+    std::vector<float> xs = {target.x, target.x + target.w};
+    std::vector<float> ys = {target.y, target.y + target.h};
+    for (const auto& o : occluders) {
+        xs.push_back(std::clamp(o.x, target.x, target.x + target.w));
+        xs.push_back(std::clamp(o.x + o.w, target.x, target.x + target.w));
+        ys.push_back(std::clamp(o.y, target.y, target.y + target.h));
+        ys.push_back(std::clamp(o.y + o.h, target.y, target.y + target.h));
+    }
+    std::sort(xs.begin(), xs.end());
+    xs.erase(std::unique(xs.begin(), xs.end()), xs.end());
+    std::sort(ys.begin(), ys.end());
+    ys.erase(std::unique(ys.begin(), ys.end()), ys.end());
+
+    double area = 0.0;
+    for (size_t i = 0; i + 1 < xs.size(); ++i) {
+        float cx = (xs[i] + xs[i + 1]) * 0.5f;
+        for (size_t j = 0; j + 1 < ys.size(); ++j) {
+            float cy = (ys[j] + ys[j + 1]) * 0.5f;
+            bool covered = std::any_of(occluders.begin(), occluders.end(), [&](const RegionRect& o) {
+                return cx > o.x && cx < o.x + o.w && cy > o.y && cy < o.y + o.h;
+            });
+            if (!covered) {
+                area += static_cast<double>(xs[i + 1] - xs[i]) * (ys[j + 1] - ys[j]);
+            }
+        }
+    }
+    return area;
+}
+
+void DecodeScheduler::update_layout(const std::vector<LayerRect>& draw_order) {
+    int max_slot = -1;
+    for (const auto& layer : draw_order) max_slot = std::max(max_slot, layer.slot);
+    this->regions_.assign(max_slot + 1, RegionInfo{});
+    std::vector<double> layer_area(this->regions_.size(), 0.0);
+
+    for (size_t i = 0; i < draw_order.size(); ++i) {
+        int slot = draw_order[i].slot;
+        if (slot < 0) continue;
+
+        // Everything drawn after this layer sits on top of it
+        std::vector<RegionRect> occluders;
+        for (size_t j = i + 1; j < draw_order.size(); ++j) {
+            occluders.push_back(draw_order[j].rect);
+        }
+
+        // A decoder shown in several layers is as visible as all of them together
+        RegionInfo& info = this->regions_[slot];
+        info.visible_area += uncovered_area(draw_order[i].rect, occluders);
+        layer_area[slot] += draw_order[i].rect.area();
+    }
+
+    for (size_t slot = 0; slot < this->regions_.size(); ++slot) {
+        RegionInfo& info = this->regions_[slot];
+        info.visible_fraction = layer_area[slot] > 0.0 ? std::min(1.0, info.visible_area / layer_area[slot]) : 0.0;
+
+        // Slots no layer draws (unlisted, or shown through another slot) are never decoded
+        if (info.visible_area < 1e-6) {
+            info.state = DecodeState::Suspended;
+        } else if (info.visible_fraction < 0.5) {
+            info.state = DecodeState::Throttled;
+        } else {
+            info.state = DecodeState::Active;
+        }
+    }
+    this->assign_surfaces();
+}
+
+void DecodeScheduler::assign_surfaces() {
+    // Every decoder gets the minimum it needs to open; the rest is shared by visible area
+    int remaining = this->total_surfaces_ - kMinSurfacesPerDecoder * static_cast<int>(this->regions_.size());
+    double visible_total = 0.0;
+    for (auto& r : this->regions_) {
+        r.surfaces = kMinSurfacesPerDecoder;
+        if (r.state != DecodeState::Suspended) visible_total += r.visible_area;
+    }
+    if (remaining <= 0 || visible_total <= 0.0) return;
+
+    for (auto& r : this->regions_) {
+        if (r.state == DecodeState::Suspended) continue;
+        int extra = static_cast<int>(std::floor(remaining * (r.visible_area / visible_total)));
+        r.surfaces = std::min(kMaxSurfacesPerDecoder, kMinSurfacesPerDecoder + extra);
+    }
+}
+
+double DecodeScheduler::visible_area(int slot) const {
+    if (slot < 0 || slot >= this->slot_count()) return 0.0;
+    return this->regions_[slot].visible_area;
+}
+
+double DecodeScheduler::visible_fraction(int slot) const {
+    if (slot < 0 || slot >= this->slot_count()) return 0.0;
+    return this->regions_[slot].visible_fraction;
+}
+
+DecodeState DecodeScheduler::state(int slot) const {
+    // Decoders missing from the layout are never drawn
+    if (slot < 0 || slot >= this->slot_count()) return DecodeState::Suspended;
+    return this->regions_[slot].state;
+}
+
+int DecodeScheduler::surface_budget(int slot) const {
+    if (slot < 0 || slot >= this->slot_count()) return kMinSurfacesPerDecoder;
+    return this->regions_[slot].surfaces;
+}
+
+bool DecodeScheduler::should_decode(int slot, uint64_t tick) const {
+    switch (this->state(slot)) {
+        case DecodeState::Active:    return true;
+        case DecodeState::Throttled: return (tick % 2) == 0;
+        case DecodeState::Suspended: return false;
+    }
+    return false;
+}
+
+std::vector<int> DecodeScheduler::dispatch_order() const {
+    std::vector<int> order;
+    for (int i = 0; i < this->slot_count(); ++i) {
+        if (this->regions_[i].state != DecodeState::Suspended) order.push_back(i);
+    }
+    std::stable_sort(order.begin(), order.end(), [this](int a, int b) {
+        return this->regions_[a].visible_area > this->regions_[b].visible_area;
+    });
+    return order;
+}
+
+} // namespace nuc_display::modules
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace nuc_display::modules {
+
+// Normalized screen rect (same convention as VideoConfig / CameraConfig)
+struct RegionRect {
+    float x = 0.0f, y = 0.0f, w = 0.0f, h = 0.0f;
+    double area() const { return static_cast<double>(w) * h; }
+};
+
+// One entry of the layout in draw order. slot >= 0 is a decoder (several layers
+// may share one); slot == -1 is an opaque non-video layer (camera) that only occludes.
+struct LayerRect {
+    int slot = -1;
+    RegionRect rect;
+};
+
+enum class DecodeState {
+    Active,     // Decode every tick
+    Throttled,  // Mostly covered: decode every other tick
+    Suspended   // Fully covered: no decode, playback paused
+};
+
+// Global decode scheduler shared by all video regions. It derives each
+// region's visible area from the layout stacking, splits a fixed pool of
+// hardware surfaces between decoders in proportion to what is visible, and
+// decides which decoders run on a given render tick (and in which order).
+class DecodeScheduler {
+public:
+#ifdef PLATFORM_RPI
+    static constexpr int kDefaultSurfaceBudget = 24;
+#else
+    static constexpr int kDefaultSurfaceBudget = 64;
+#endif
+    static constexpr int kMinSurfacesPerDecoder = 4;
+    static constexpr int kMaxSurfacesPerDecoder = 32;
+
+    explicit DecodeScheduler(int total_surfaces = kDefaultSurfaceBudget);
+
+    // Recompute visibility from the layout (first = behind, last = on top)
+    void update_layout(const std::vector<LayerRect>& draw_order);
+
+    double visible_area(int slot) const;      // In screen units (0..1)
+    double visible_fraction(int slot) const;  // Of the area of its layers (0..1)
+    DecodeState state(int slot) const;
+    int surface_budget(int slot) const;
+
+    // True if the decoder in `slot` should run process() on this render tick
+    bool should_decode(int slot, uint64_t tick) const;
+    // Slots sorted by priority (largest visible area first), suspended ones omitted
+    std::vector<int> dispatch_order() const;
+
+    int slot_count() const { return static_cast<int>(this->regions_.size()); }
+
+private:
+    struct RegionInfo {
+        double visible_area = 0.0;
+        double visible_fraction = 0.0;
+        DecodeState state = DecodeState::Active;
+        int surfaces = kMinSurfacesPerDecoder;
+    };
+
+    static double uncovered_area(const RegionRect& target, const std::vector<RegionRect>& occluders);
+    void assign_surfaces();
+
+    int total_surfaces_;
+    std::vector<RegionInfo> regions_;
+};
+
+} // namespace nuc_display::modules
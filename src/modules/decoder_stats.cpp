@@ -0,0 +1,47 @@
+#include "modules/decoder_stats.hpp"
+#include <algorithm>
+
+namespace nuc_display::modules {
+
+void AtomicLatencyHistogram::record(double seconds) {
+    uint64_t us = seconds > 0.0 ? static_cast<uint64_t>(seconds * 1e6) : 0;
+    size_t bucket = 0;
+    while (bucket + 1 < kBuckets && us >= (1ULL << bucket)) bucket++;
+    this->buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+
+    uint64_t max = this->max_us_.load(std::memory_order_relaxed);
+    while (us > max && !this->max_us_.compare_exchange_weak(max, us, std::memory_order_relaxed)) {}
+}
+
+LatencySummary AtomicLatencyHistogram::summary() const {
+    std::array<uint64_t, kBuckets> counts;
+    LatencySummary s;
+    for (size_t i = 0; i < kBuckets; ++i) {
+        counts[i] = this->buckets_[i].load(std::memory_order_relaxed);
+        s.count += counts[i];
+    }
+    if (s.count == 0) return s;
+    s.max_ms = this->max_us_.load(std::memory_order_relaxed) / 1000.0;
+
+    // Bucket i holds [2^(i-1), 2^i) us; report its upper edge, capped at the observed max
+    auto percentile = [&](double p) {
+        uint64_t rank = static_cast<uint64_t>(p * (s.count - 1)) + 1;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < kBuckets; ++i) {
+            seen += counts[i];
+            if (seen >= rank) return std::min(static_cast<double>(1ULL << i) / 1000.0, s.max_ms);
+        }
+        return s.max_ms;
+    };
+    s.p50_ms = percentile(0.50);
+    s.p95_ms = percentile(0.95);
+    s.p99_ms = percentile(0.99);
+    return s;
+}
+
+void AtomicLatencyHistogram::reset() {
+    for (auto& bucket : this->buckets_) bucket.store(0, std::memory_order_relaxed);
+    this->max_us_.store(0, std::memory_order_relaxed);
+}
+
+} // namespace nuc_display::modules
@@ -0,0 +1,119 @@
+#pragma once
+
+#include "modules/adaptive_buffer.hpp"
+#include "modules/frame_cadence.hpp"
+#include "modules/read_ahead_file.hpp"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace nuc_display::modules {
+
+// Frames never shown because playback fell behind, since load()
+struct FrameDropStats {
+    uint64_t dropped_late = 0;     // Decoded, but a later frame was already due
+    uint64_t skipped_nonref = 0;   // Never decoded: non-reference frames skipped while catching up
+    uint64_t seek_discarded = 0;   // Decoded from the keyframe up to a precise seek target, never shown
+    uint64_t import_failed = 0;    // Due for presentation, but the texture upload or EGL import failed
+};
+
+struct LatencySummary {
+    uint64_t count = 0;
+    double p50_ms = 0.0;   // Upper edge of the bucket holding the percentile
+    double p95_ms = 0.0;
+    double p99_ms = 0.0;
+    double max_ms = 0.0;
+};
+
+// Latency distribution in power-of-two microsecond buckets. record() is a
+// couple of relaxed atomic adds, so the decode and render threads can feed it
+// on every frame while another thread reads a summary.
+class AtomicLatencyHistogram {
+public:
+    static constexpr size_t kBuckets = 24;  // Last bucket: >= ~4 s
+
+    void record(double seconds);
+    LatencySummary summary() const;
+    void reset();
+
+private:
+    std::array<std::atomic<uint64_t>, kBuckets> buckets_{};
+    std::atomic<uint64_t> max_us_{0};
+};
+
+// Latest value of a small trivially copyable struct, published by one writer at
+// a time (callers serialize writers) and read without locks. The reader retries
+// while a publish is in progress; the payload lives in relaxed atomic words, so
+// there is no data race to reason about.
+template <typename T>
+class StatsSnapshot {
+    static_assert(std::is_trivially_copyable_v<T>);
+    static constexpr size_t kWords = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+public:
+    void publish(const T& value) {
+        std::array<uint64_t, kWords> words{};
+        std::memcpy(words.data(), &value, sizeof(T));
+        uint64_t seq = this->seq_.load(std::memory_order_relaxed);
+        this->seq_.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < kWords; ++i) this->words_[i].store(words[i], std::memory_order_relaxed);
+        this->seq_.store(seq + 2, std::memory_order_release);
+    }
+
+    T load() const {
+        std::array<uint64_t, kWords> words;
+        uint64_t before, after;
+        do {
+            before = this->seq_.load(std::memory_order_acquire);
+            for (size_t i = 0; i < kWords; ++i) words[i] = this->words_[i].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = this->seq_.load(std::memory_order_relaxed);
+        } while ((before & 1) || before != after);
+        T value;
+        std::memcpy(static_cast<void*>(&value), words.data(), sizeof(T));
+        return value;
+    }
+
+private:
+    std::atomic<uint64_t> seq_{0};
+    std::array<std::atomic<uint64_t>, kWords> words_{};
+};
+
+// One video's health since load(), as VideoDecoder::stats() returns it
+struct VideoDecoderStats {
+    const char* backend = "none";     // "vaapi", "v4l2", "drm", "sw"
+    bool hardware = false;
+    uint64_t frames_decoded = 0;
+    uint64_t frames_presented = 0;
+    uint64_t frames_late = 0;         // Shown, but at least one vblank after they were due
+    FrameDropStats drops;
+    uint64_t decoded_bytes_per_frame = 0;
+    uint64_t queued_frame_bytes = 0;  // Decoded frames waiting for presentation (estimate)
+    BufferFill fill;                  // As of the last render()
+    CadenceStats cadence;
+    LatencySummary decode;            // Codec time per frame (send + receive)
+    LatencySummary import;            // EGLImage import, or texture upload for software frames
+    bool audio = false;               // A mixer stream is attached
+    double audio_buffer_ms = 0.0;     // Decoded audio not yet taken by the mixer
+    uint64_t audio_underruns = 0;     // This stream ran dry while playing
+    uint64_t audio_recoveries = 0;    // Device xruns recovered and reopens (shared by all regions)
+    double av_offset_ms = 0.0;        // Audio being heard minus the video on screen (+ = audio ahead)
+    ReadAheadStats io;
+};
+
+// One camera's capture health, as CameraModule::stats() returns it
+struct CameraStats {
+    bool open = false;
+    const char* format = "none";      // "MJPG -> YCbCr", "MJPG -> RGB", "YUYV", "NV12", "DMA-BUF"
+    uint64_t frames_captured = 0;     // Published to the render thread since start()
+    int capture_width = 0;
+    int capture_height = 0;
+    int decode_scale = 1;             // MJPEG DCT downscale of the last frame (1, 2, 4, 8)
+    LatencySummary decode;            // CPU time per frame: MJPEG decode or YUV repack/convert
+};
+
+} // namespace nuc_display::modules
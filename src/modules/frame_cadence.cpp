@@ -0,0 +1,117 @@
+#include "modules/frame_cadence.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace nuc_display::modules {
+
+namespace {
+// A frame exactly halfway between two vblanks (25 fps on 50 Hz lands there
+// every other frame) always goes to the later one instead of flipping with
+// rounding noise
+constexpr double kTieBias = 1e-6;
+// Share of each prediction error folded back into the grid phase, so the grid
+// follows slow drift between the measured period and the real vblanks
+constexpr double kPhaseGain = 0.02;
+}
+
+void CadenceSelector::set_refresh_period(double period_sec) {
+    if (period_sec <= 0.0) {
+        this->period_ = 0.0;
+        this->has_grid_ = false;
+        return;
+    }
+    if (this->period_ > 0.0 && std::abs(period_sec - this->period_) < this->period_ * 0.01) {
+        // Refined measurement: keep the grid phase, continue from the last vblank
+        if (this->has_grid_) this->grid_origin_ = this->scanout_sec_;
+    } else {
+        this->has_grid_ = false;
+    }
+    this->period_ = period_sec;
+}
+
+double CadenceSelector::snap(double scanout_sec) {
+    if (this->period_ <= 0.0) return scanout_sec;
+    if (!this->has_grid_) {
+        this->grid_origin_ = scanout_sec;
+        this->has_grid_ = true;
+        return scanout_sec;
+    }
+    double k = std::round((scanout_sec - this->grid_origin_) / this->period_);
+    double snapped = this->grid_origin_ + k * this->period_;
+    if (std::abs(scanout_sec - snapped) > this->period_ * 0.25) {
+        // The prediction no longer matches the grid: the display drifted away from it
+        this->grid_origin_ = scanout_sec;
+        this->resyncs_++;
+        return scanout_sec;
+    }
+    this->grid_origin_ += (scanout_sec - snapped) * kPhaseGain;
+    return snapped;
+}
+
+int64_t CadenceSelector::select(double scanout_sec, double start_sec, double frame_interval_sec) {
+    this->scanout_sec_ = this->snap(scanout_sec);
+    this->start_sec_ = start_sec;
+    this->frame_interval_ = frame_interval_sec;
+    if (frame_interval_sec <= 0.0) return 0;
+
+    double pos = (this->scanout_sec_ - start_sec) / frame_interval_sec;
+    if (this->period_ <= 0.0) {
+        // No refresh information: every frame whose PTS has passed is due
+        return static_cast<int64_t>(std::floor(pos));
+    }
+    return static_cast<int64_t>(std::floor(pos + 0.5 - kTieBias));
+}
+
+void CadenceSelector::present(int64_t frame_index) {
+    if (this->frame_interval_ <= 0.0 || frame_index < 0) return;
+
+    this->vblanks_++;
+    double error_ms = std::abs(this->scanout_sec_ - (this->start_sec_ + frame_index * this->frame_interval_)) * 1000.0;
+    this->error_sum_ += error_ms;
+    this->error_max_ = std::max(this->error_max_, error_ms);
+
+    if (frame_index == this->shown_index_) {
+        this->held_vblanks_++;
+        return;
+    }
+
+    if (this->shown_index_ >= 0 && !this->first_hold_ && this->period_ > 0.0) {
+        // 24 fps on 60 Hz: every frame must stay up for 2 or 3 vblanks
+        double ratio = this->frame_interval_ / this->period_;
+        int lo = std::max(1, static_cast<int>(std::floor(ratio + 1e-6)));
+        int hi = std::max(1, static_cast<int>(std::ceil(ratio - 1e-6)));
+        if (this->held_vblanks_ < lo || this->held_vblanks_ > hi) this->breaks_++;
+        this->held_total_ += this->held_vblanks_;
+        this->held_frames_++;
+    }
+    this->first_hold_ = this->shown_index_ < 0;
+    this->shown_index_ = frame_index;
+    this->held_vblanks_ = 1;
+    this->frames_++;
+}
+
+void CadenceSelector::restart() {
+    this->shown_index_ = -1;
+    this->held_vblanks_ = 0;
+    this->first_hold_ = true;
+}
+
+CadenceStats CadenceSelector::stats() const {
+    CadenceStats s;
+    s.vblanks = this->vblanks_;
+    s.frames = this->frames_;
+    s.breaks = this->breaks_;
+    s.resyncs = this->resyncs_;
+    s.mean_error_ms = this->vblanks_ > 0 ? this->error_sum_ / this->vblanks_ : 0.0;
+    s.max_error_ms = this->error_max_;
+    s.vblanks_per_frame = this->held_frames_ > 0 ? static_cast<double>(this->held_total_) / this->held_frames_ : 0.0;
+    return s;
+}
+
+void CadenceSelector::reset() {
+    double period = this->period_;
+    *this = CadenceSelector{};
+    this->period_ = period;
+}
+
+} // namespace nuc_display::modules
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+
+namespace nuc_display::modules {
+
+// Presentation quality since load(), exported for the performance log
+struct CadenceStats {
+    uint64_t vblanks = 0;          // Scanouts with a video frame on screen
+    uint64_t frames = 0;           // Distinct frames shown
+    uint64_t breaks = 0;           // Frames held for a vblank count outside the pulldown pattern
+    uint64_t resyncs = 0;          // Vblank grid re-anchored (refresh drift or a missed prediction)
+    double mean_error_ms = 0.0;    // |scanout - PTS| of the frame on screen
+    double max_error_ms = 0.0;
+    double vblanks_per_frame = 0.0;
+};
+
+// Picks the frame to put on screen for a given scanout time, with the display
+// refresh in mind. Predicted scanout times are snapped to a grid of vblanks, so
+// render-loop jitter can't move a frame to a different vblank and 24/25/30 fps
+// content keeps a steady 3:2 / 2:2 pulldown on a 60 Hz panel. Not thread-safe:
+// the decoder calls it from render() under its queue mutex.
+class CadenceSelector {
+public:
+    // 0 = unknown (headless, no flip timestamps): select() returns the latest due frame
+    void set_refresh_period(double period_sec);
+    double refresh_period() const { return this->period_; }
+
+    // Index (counted from start_sec) of the frame whose PTS is closest to scanout_sec
+    int64_t select(double scanout_sec, double start_sec, double frame_interval_sec);
+    // Frame actually on screen for the scanout passed to the last select()
+    void present(int64_t frame_index);
+    // New timeline (load, seek, resume): the next frame starts a new pattern
+    void restart();
+
+    CadenceStats stats() const;
+    void reset();
+
+private:
+    double snap(double scanout_sec);
+
+    double period_ = 0.0;
+    bool has_grid_ = false;
+    double grid_origin_ = 0.0;
+
+    // Last select()
+    double scanout_sec_ = 0.0;
+    double start_sec_ = 0.0;
+    double frame_interval_ = 0.0;
+
+    int64_t shown_index_ = -1;
+    int held_vblanks_ = 0;
+    bool first_hold_ = true;       // Its length depends on where playback started
+
+    uint64_t vblanks_ = 0;
+    uint64_t frames_ = 0;
+    uint64_t breaks_ = 0;
+    uint64_t resyncs_ = 0;
+    uint64_t held_total_ = 0;      // Vblanks of frames whose hold has ended
+    uint64_t held_frames_ = 0;
+    double error_sum_ = 0.0;
+    double error_max_ = 0.0;
+};
+
+} // namespace nuc_display::modules
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace nuc_display::modules {
+
+// Latest-frame handoff between one producer and one consumer thread, over three
+// slots (triple buffering). The producer fills back() and publish()es it as the
+// newest frame; the consumer's acquire() takes the newest published frame, if
+// there is one, and front() stays untouched until its next acquire(). Neither
+// side ever waits for the other: frames the consumer never got to are simply
+// handed back to the producer as its next back() slot.
+template <typename T>
+class FrameMailbox {
+public:
+    // Producer side
+    T& back() { return this->slots_[this->back_]; }
+    void publish() {
+        uint8_t previous = this->middle_.exchange(this->back_ | kFresh, std::memory_order_acq_rel);
+        this->back_ = previous & kIndexMask;
+    }
+
+    // Consumer side. True if front() changed.
+    bool acquire() {
+        if (!(this->middle_.load(std::memory_order_acquire) & kFresh)) return false;
+        uint8_t previous = this->middle_.exchange(this->front_, std::memory_order_acq_rel);
+        this->front_ = previous & kIndexMask;
+        return true;
+    }
+    T& front() { return this->slots_[this->front_]; }
+
+    // Every slot, for teardown once both threads are done with the mailbox
+    std::array<T, 3>& slots() { return this->slots_; }
+
+private:
+    static constexpr uint8_t kIndexMask = 0x3;
+    static constexpr uint8_t kFresh = 0x4;   // Middle slot was published and not yet acquired
+
+    std::array<T, 3> slots_{};
+    uint8_t back_ = 0;                       // Producer-owned
+    std::atomic<uint8_t> middle_{1};         // Shared: slot index | kFresh
+    uint8_t front_ = 2;                      // Consumer-owned
+};
+
+} // namespace nuc_display::modules
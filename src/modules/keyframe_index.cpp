@@ -0,0 +1,35 @@
+#include "modules/keyframe_index.hpp"
+#include <algorithm>
+
+namespace nuc_display::modules {
+
+void KeyframeIndex::clear() {
+    this->entries_.clear();
+    this->covered_until_sec_ = std::numeric_limits<double>::infinity();
+}
+
+void KeyframeIndex::add(double time_sec, int64_t timestamp) {
+    this->entries_.push_back({time_sec, timestamp});
+}
+
+void KeyframeIndex::finalize() {
+    std::sort(this->entries_.begin(), this->entries_.end(), [](const KeyframeEntry& a, const KeyframeEntry& b) {
+        return a.timestamp < b.timestamp;
+    });
+    this->entries_.erase(std::unique(this->entries_.begin(), this->entries_.end(),
+                                     [](const KeyframeEntry& a, const KeyframeEntry& b) {
+                                         return a.timestamp == b.timestamp;
+                                     }),
+                         this->entries_.end());
+}
+
+const KeyframeEntry* KeyframeIndex::at_or_before(double time_sec) const {
+    if (this->entries_.empty() || time_sec > this->covered_until_sec_) return nullptr;
+
+    auto it = std::upper_bound(this->entries_.begin(), this->entries_.end(), time_sec,
+                               [](double t, const KeyframeEntry& e) { return t < e.time_sec; });
+    if (it == this->entries_.begin()) return &this->entries_.front();
+    return &*(it - 1);
+}
+
+} // namespace nuc_display::modules
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace nuc_display::modules {
+
+struct KeyframeEntry {
+    double time_sec = 0.0;   // Seconds from the start of the stream
+    int64_t timestamp = 0;   // Same position in the stream's time_base (what av_seek_frame expects)
+};
+
+// Sorted keyframe positions of one stream, built once per file from the
+// container index (or a packet scan) so seeks can jump straight to the
+// closest preceding keyframe. FFmpeg-free so the lookup can be unit tested.
+class KeyframeIndex {
+public:
+    void clear();
+    void add(double time_sec, int64_t timestamp);
+    // Sort and drop duplicates; call once all entries are added
+    void finalize();
+
+    // Seconds up to which the index is known to be complete (partial packet scans)
+    void set_coverage(double until_sec) { this->covered_until_sec_ = until_sec; }
+    double coverage() const { return this->covered_until_sec_; }
+
+    // Last keyframe at or before time_sec. The first keyframe if time_sec precedes it;
+    // nullptr if the index is empty or does not cover time_sec.
+    const KeyframeEntry* at_or_before(double time_sec) const;
+
+    bool empty() const { return this->entries_.empty(); }
+    size_t size() const { return this->entries_.size(); }
+    const std::vector<KeyframeEntry>& entries() const { return this->entries_; }
+
+private:
+    std::vector<KeyframeEntry> entries_;
+    double covered_until_sec_ = std::numeric_limits<double>::infinity();
+};
+
+} // namespace nuc_display::modules
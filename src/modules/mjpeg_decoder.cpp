@@ -0,0 +1,164 @@
+#include "modules/mjpeg_decoder.hpp"
+#include <algorithm>
+#include <csetjmp>
+#include <cstdio>
+#include <cstring>
+
+#include <jpeglib.h>
+
+namespace nuc_display::modules {
+
+namespace {
+
+// Scaled IDCT block size; libjpeg 7+ split it per direction
+#if JPEG_LIB_VERSION >= 70
+int dct_width(const jpeg_component_info& comp) { return comp.DCT_h_scaled_size; }
+int dct_height(const jpeg_component_info& comp) { return comp.DCT_v_scaled_size; }
+int min_dct_height(const jpeg_decompress_struct& cinfo) { return cinfo.min_DCT_v_scaled_size; }
+#else
+int dct_width(const jpeg_component_info& comp) { return comp.DCT_scaled_size; }
+int dct_height(const jpeg_component_info& comp) { return comp.DCT_scaled_size; }
+int min_dct_height(const jpeg_decompress_struct& cinfo) { return cinfo.min_DCT_scaled_size; }
+#endif
+
+// Y at full or half resolution, Cb/Cr once per MCU: what the shader can sample directly
+bool plain_ycbcr(const jpeg_decompress_struct& cinfo) {
+    if (cinfo.num_components != 3 || cinfo.jpeg_color_space != JCS_YCbCr) return false;
+    const jpeg_component_info* comp = cinfo.comp_info;
+    return comp[0].h_samp_factor <= 2 && comp[0].v_samp_factor <= 2 &&
+           comp[1].h_samp_factor == 1 && comp[1].v_samp_factor == 1 &&
+           comp[2].h_samp_factor == 1 && comp[2].v_samp_factor == 1;
+}
+
+} // namespace
+
+struct MjpegDecoder::State {
+    // libjpeg's default error_exit() calls exit(); jump back into decode() instead
+    struct ErrorManager {
+        jpeg_error_mgr pub;
+        jmp_buf jump;
+    };
+
+    jpeg_decompress_struct cinfo;
+    ErrorManager err;
+    std::vector<JSAMPROW> rows;          // RGB: one pointer per output row
+    std::vector<uint8_t> scratch;        // Planar: one iMCU row of each component
+    std::vector<JSAMPROW> raw_rows[3];
+};
+
+MjpegDecoder::MjpegDecoder() : state_(std::make_unique<State>()) {
+    State& s = *this->state_;
+    s.cinfo.err = jpeg_std_error(&s.err.pub);
+    s.err.pub.error_exit = [](j_common_ptr cinfo) {
+        longjmp(reinterpret_cast<State::ErrorManager*>(cinfo->err)->jump, 1);
+    };
+    // Truncated frames are routine on USB webcams: no warning per frame
+    s.err.pub.output_message = [](j_common_ptr) {};
+    jpeg_create_decompress(&s.cinfo);
+}
+
+MjpegDecoder::~MjpegDecoder() {
+    jpeg_destroy_decompress(&this->state_->cinfo);
+}
+
+int MjpegDecoder::scale_for(int width, int height, int target_w, int target_h) {
+    if (target_w <= 0 || target_h <= 0) return 1;
+    for (int scale : {8, 4, 2}) {
+        if (width / scale >= target_w && height / scale >= target_h) return scale;
+    }
+    return 1;
+}
+
+bool MjpegDecoder::decode(const uint8_t* data, size_t size, int scale, bool planar,
+                          std::vector<uint8_t>& out, MjpegImage& image) {
+    State& s = *this->state_;
+    jpeg_decompress_struct& cinfo = s.cinfo;
+    // Nothing with a destructor may live on this frame between setjmp() and the end
+    if (setjmp(s.err.jump)) {
+        jpeg_abort_decompress(&cinfo);
+        return false;
+    }
+
+    jpeg_mem_src(&cinfo, data, static_cast<unsigned long>(size));
+    if (jpeg_read_header(&cinfo, TRUE) != JPEG_HEADER_OK) {
+        jpeg_abort_decompress(&cinfo);
+        return false;
+    }
+
+    cinfo.scale_num = 1;
+    cinfo.scale_denom = (scale == 2 || scale == 4 || scale == 8) ? scale : 1;
+    cinfo.dct_method = JDCT_IFAST;
+    cinfo.do_fancy_upsampling = FALSE;
+    cinfo.do_block_smoothing = FALSE;
+    bool raw = planar && plain_ycbcr(cinfo);
+    cinfo.raw_data_out = raw ? TRUE : FALSE;
+    cinfo.out_color_space = raw ? JCS_YCbCr : JCS_RGB;
+    jpeg_start_decompress(&cinfo);
+
+    image.width = static_cast<int>(cinfo.output_width);
+    image.height = static_cast<int>(cinfo.output_height);
+    image.planar = raw;
+    image.chroma_width = raw ? static_cast<int>(cinfo.comp_info[1].downsampled_width) : 0;
+    image.chroma_height = raw ? static_cast<int>(cinfo.comp_info[1].downsampled_height) : 0;
+
+    if (raw) {
+        size_t luma = static_cast<size_t>(image.width) * image.height;
+        size_t chroma = static_cast<size_t>(image.chroma_width) * image.chroma_height;
+        out.resize(luma + 2 * chroma);
+        uint8_t* dst[3] = {out.data(), out.data() + luma, out.data() + luma + chroma};
+        int plane_w[3] = {image.width, image.chroma_width, image.chroma_width};
+        int plane_h[3] = {image.height, image.chroma_height, image.chroma_height};
+
+        // jpeg_read_raw_data() fills whole iMCU rows at block-padded width; decode
+        // each into scratch and copy the visible part out
+        size_t pitch[3];
+        int rows_per_imcu[3];
+        size_t total = 0;
+        for (int c = 0; c < 3; ++c) {
+            const jpeg_component_info& comp = cinfo.comp_info[c];
+            pitch[c] = static_cast<size_t>(comp.width_in_blocks) * dct_width(comp);
+            rows_per_imcu[c] = comp.v_samp_factor * dct_height(comp);
+            total += pitch[c] * rows_per_imcu[c];
+        }
+        s.scratch.resize(total);
+        JSAMPARRAY planes[3];
+        uint8_t* p = s.scratch.data();
+        for (int c = 0; c < 3; ++c) {
+            s.raw_rows[c].resize(rows_per_imcu[c]);
+            for (int r = 0; r < rows_per_imcu[c]; ++r, p += pitch[c]) s.raw_rows[c][r] = p;
+            planes[c] = s.raw_rows[c].data();
+        }
+
+        JDIMENSION lines = cinfo.max_v_samp_factor * min_dct_height(cinfo);
+        for (int imcu = 0; cinfo.output_scanline < cinfo.output_height; ++imcu) {
+            if (jpeg_read_raw_data(&cinfo, planes, lines) == 0) {
+                jpeg_abort_decompress(&cinfo);
+                return false;
+            }
+            for (int c = 0; c < 3; ++c) {
+                int y0 = imcu * rows_per_imcu[c];
+                int n = std::min(rows_per_imcu[c], plane_h[c] - y0);
+                for (int r = 0; r < n; ++r) {
+                    memcpy(dst[c] + static_cast<size_t>(y0 + r) * plane_w[c], s.raw_rows[c][r], plane_w[c]);
+                }
+            }
+        }
+    } else {
+        size_t stride = static_cast<size_t>(image.width) * 3;
+        out.resize(stride * image.height);
+        s.rows.resize(image.height);
+        for (int y = 0; y < image.height; ++y) s.rows[y] = out.data() + y * stride;
+        while (cinfo.output_scanline < cinfo.output_height) {
+            JDIMENSION line = cinfo.output_scanline;
+            if (jpeg_read_scanlines(&cinfo, s.rows.data() + line, cinfo.output_height - line) == 0) {
+                jpeg_abort_decompress(&cinfo);
+                return false;
+            }
+        }
+    }
+
+    jpeg_finish_decompress(&cinfo);
+    return true;
+}
+
+} // namespace nuc_display::modules
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace nuc_display::modules {
+
+// Geometry of a decoded frame. Packed RGB, or the JPEG's own Y, Cb, Cr planes
+// back to back (tightly packed, full-range BT.601 as JFIF defines it).
+struct MjpegImage {
+    int width = 0;            // After DCT scaling
+    int height = 0;
+    bool planar = false;
+    int chroma_width = 0;     // Planar: Cb and Cr plane size
+    int chroma_height = 0;
+};
+
+// Camera MJPEG decoder on libjpeg(-turbo). One decompressor lives for the whole
+// stream instead of one per frame, runs with the fast integer IDCT and plain
+// upsampling, and can scale down in the DCT domain (1/2, 1/4, 1/8) when the
+// camera is drawn small. Corrupt frames return false instead of exiting.
+class MjpegDecoder {
+public:
+    MjpegDecoder();
+    ~MjpegDecoder();
+
+    MjpegDecoder(const MjpegDecoder&) = delete;
+    MjpegDecoder& operator=(const MjpegDecoder&) = delete;
+
+    // Largest DCT downscale (1, 2, 4 or 8) that still covers target_w x target_h.
+    // A target of 0 means unknown: full size.
+    static int scale_for(int width, int height, int target_w, int target_h);
+
+    // Decode one frame into `out` at 1/scale. With `planar`, frames with plain
+    // 4:4:4 / 4:2:2 / 4:2:0 sampling come out as raw planes via jpeg_read_raw_data
+    // (for the GPU to convert); anything else falls back to RGB.
+    bool decode(const uint8_t* data, size_t size, int scale, bool planar,
+                std::vector<uint8_t>& out, MjpegImage& image);
+
+private:
+    struct State;
+    std::unique_ptr<State> state_;
+};
+
+} // namespace nuc_display::modules
@@ -0,0 +1,77 @@
+#include "modules/network_source.hpp"
+#include <algorithm>
+#include <cctype>
+
+namespace nuc_display::modules {
+
+namespace {
+int64_t steady_now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+} // namespace
+
+SourceKind classify_source(const std::string& location) {
+    auto scheme_end = location.find("://");
+    if (scheme_end == std::string::npos) return SourceKind::File;
+
+    std::string scheme = location.substr(0, scheme_end);
+    std::transform(scheme.begin(), scheme.end(), scheme.begin(), [](unsigned char c) { return std::tolower(c); });
+    if (scheme == "file") return SourceKind::File;
+    if (scheme == "rtsp" || scheme == "rtsps") return SourceKind::Rtsp;
+    if (scheme == "http" || scheme == "https") {
+        std::string path = location.substr(0, location.find_first_of("?#", scheme_end));
+        std::transform(path.begin(), path.end(), path.begin(), [](unsigned char c) { return std::tolower(c); });
+        return path.ends_with(".m3u8") ? SourceKind::Hls : SourceKind::Http;
+    }
+    return SourceKind::Stream;
+}
+
+const char* source_kind_name(SourceKind kind) {
+    switch (kind) {
+        case SourceKind::File: return "file";
+        case SourceKind::Http: return "HTTP";
+        case SourceKind::Hls: return "HLS";
+        case SourceKind::Rtsp: return "RTSP";
+        case SourceKind::Stream: return "stream";
+    }
+    return "unknown";
+}
+
+void IoDeadline::arm(std::chrono::milliseconds timeout) {
+    this->deadline_ns_ = steady_now_ns() + std::chrono::duration_cast<std::chrono::nanoseconds>(timeout).count();
+}
+
+void IoDeadline::disarm() {
+    this->deadline_ns_ = 0;
+}
+
+void IoDeadline::abort() {
+    this->aborted_ = true;
+}
+
+void IoDeadline::clear_abort() {
+    this->aborted_ = false;
+}
+
+bool IoDeadline::expired() const {
+    if (this->aborted_.load()) return true;
+    int64_t deadline = this->deadline_ns_.load();
+    return deadline != 0 && steady_now_ns() >= deadline;
+}
+
+int IoDeadline::interrupt_cb(void* opaque) {
+    return static_cast<const IoDeadline*>(opaque)->expired() ? 1 : 0;
+}
+
+ReconnectBackoff::ReconnectBackoff(int min_ms, int max_ms)
+    : min_ms_(std::max(1, min_ms)), max_ms_(std::max(this->min_ms_, max_ms)) {}
+
+std::chrono::milliseconds ReconnectBackoff::next_delay() {
+    int64_t delay = this->min_ms_;
+    for (int i = 0; i < this->attempts_ && delay < this->max_ms_; ++i) delay *= 2;
+    this->attempts_++;
+    return std::chrono::milliseconds(std::min<int64_t>(delay, this->max_ms_));
+}
+
+} // namespace nuc_display::modules
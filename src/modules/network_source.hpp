@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace nuc_display::modules {
+
+// What a playlist entry points at. Anything with a URL scheme is a network source.
+enum class SourceKind {
+    File,
+    Http,   // Progressive download (MP4/MKV/TS over HTTP)
+    Hls,    // .m3u8 playlist over HTTP
+    Rtsp,
+    Stream  // udp://, rtmp://, srt://, ...: always live
+};
+
+SourceKind classify_source(const std::string& location);
+inline bool is_network_source(const std::string& location) { return classify_source(location) != SourceKind::File; }
+// Sources that are live by protocol (HTTP and HLS are live when the server gives no duration)
+inline bool is_live_protocol(SourceKind kind) { return kind == SourceKind::Rtsp || kind == SourceKind::Stream; }
+const char* source_kind_name(SourceKind kind);
+
+// Per-region policy for network sources ("network" in a video's config)
+struct NetworkSourceOptions {
+    int open_timeout_ms = 5000;     // Connect + probe, before the attempt counts as failed
+    int read_timeout_ms = 3000;     // No data for this long: reconnect
+    int jitter_buffer_ms = 500;     // Media buffered before (re)starting playback
+    bool low_latency = false;       // Small probe, no demuxer buffering, low_delay decode
+    int reconnect_min_ms = 500;     // First retry delay, doubled per failed attempt
+    int reconnect_max_ms = 30000;
+};
+
+// Deadline polled by FFmpeg's AVIOInterruptCB, so no blocking network call
+// (connect, probe, read) can outlive its timeout. Armed by the thread doing
+// the I/O; abort() may be called from any thread.
+class IoDeadline {
+public:
+    void arm(std::chrono::milliseconds timeout);
+    void disarm();
+    // Fail every blocking call, armed or not, until clear_abort()
+    void abort();
+    void clear_abort();
+    bool expired() const;
+
+    // AVIOInterruptCB::callback with opaque = IoDeadline*
+    static int interrupt_cb(void* opaque);
+
+private:
+    std::atomic<int64_t> deadline_ns_{0};  // steady_clock; 0 = none
+    std::atomic<bool> aborted_{false};
+};
+
+// Exponential reconnect delays: min, 2*min, 4*min ... capped at max
+class ReconnectBackoff {
+public:
+    ReconnectBackoff(int min_ms = 500, int max_ms = 30000);
+
+    std::chrono::milliseconds next_delay();
+    void reset() { this->attempts_ = 0; }
+    int attempts() const { return this->attempts_; }
+
+private:
+    int min_ms_;
+    int max_ms_;
+    int attempts_ = 0;
+};
+
+} // namespace nuc_display::modules
@@ -116,7 +116,8 @@ void PerformanceMonitor::update_temp() {
     }
 }
 
-void PerformanceMonitor::log() const {
+void PerformanceMonitor::log(const std::vector<std::pair<size_t, VideoDecoderStats>>& videos,
+                             const std::vector<std::pair<size_t, CameraStats>>& cameras) const {
     std::cout << "[Perf] "
               << std::fixed << std::setprecision(1)
               << "CPU: " << current_stats_.cpu_usage << "% | "
@@ -125,6 +126,55 @@ void PerformanceMonitor::log() const {
               << "Temp: " << current_stats_.temperature_c << "°C | "
               << "Uptime: " << (int)current_stats_.uptime_sec << "s"
               << std::endl;
+
+    for (const auto& [index, v] : videos) {
+        std::cout << "[Perf] Video " << index << ": "
+                  << v.backend << (v.hardware ? " (HW)" : " (SW)") << " decode, "
+                  << v.decoded_bytes_per_frame / 1024 << " KB/frame, "
+                  << "frames " << v.frames_decoded << " decoded / " << v.frames_presented << " presented / "
+                  << v.frames_late << " late, "
+                  << "dropped " << v.drops.dropped_late << " late / " << v.drops.skipped_nonref << " skipped / "
+                  << v.drops.seek_discarded << " before seek targets / " << v.drops.import_failed << " failed import"
+                  << std::fixed << std::setprecision(1)
+                  << " | queue " << v.fill.video_frames << "/" << v.fill.video_frame_limit << " frames ("
+                  << v.queued_frame_bytes / 1048576.0 << " MB), "
+                  << "packets " << v.fill.packet_bytes / 1048576.0 << "/" << v.fill.packet_byte_limit / 1048576.0 << " MB "
+                  << v.fill.packet_duration_sec << "/" << v.fill.packet_duration_limit_sec << " s, "
+                  << v.fill.bitrate_bps / 1e6 << " Mbps"
+                  << std::setprecision(2)
+                  << " | decode " << v.decode.p50_ms << "/" << v.decode.p95_ms << "/" << v.decode.p99_ms
+                  << " ms p50/p95/p99 (max " << v.decode.max_ms << "), load " << v.fill.decode_load
+                  << ", import " << v.import.p50_ms << "/" << v.import.p95_ms << "/" << v.import.p99_ms << " ms"
+                  << " | cadence " << v.cadence.vblanks_per_frame << " vblanks/frame, error "
+                  << v.cadence.mean_error_ms << "/" << v.cadence.max_error_ms << " ms avg/max, "
+                  << v.cadence.breaks << " breaks";
+        if (v.audio) {
+            std::cout << std::setprecision(0)
+                      << " | audio " << v.audio_buffer_ms << " ms buffered, " << v.audio_underruns << " underruns, "
+                      << v.audio_recoveries << " recoveries, A/V " << std::showpos << v.av_offset_ms
+                      << std::noshowpos << " ms";
+        }
+        std::cout << std::setprecision(1)
+                  << " | I/O " << (v.io.mapped ? "mapped" : "read-ahead") << " " << v.io.read_mbps << " MB/s, "
+                  << v.io.stalls << " stalls (" << v.io.stall_sec << " s), "
+                  << v.io.seeks_in_buffer << "/" << v.io.seeks << " seeks in buffer"
+                  << "\n" << std::defaultfloat;
+    }
+
+    for (const auto& [index, c] : cameras) {
+        if (!c.open) {
+            std::cout << "[Perf] Camera " << index << ": not connected\n";
+            continue;
+        }
+        std::cout << "[Perf] Camera " << index << ": "
+                  << c.capture_width << "x" << c.capture_height << " " << c.format;
+        if (c.decode_scale > 1) std::cout << " at 1/" << c.decode_scale;
+        std::cout << ", " << c.frames_captured << " frames"
+                  << std::fixed << std::setprecision(2)
+                  << " | decode " << c.decode.p50_ms << "/" << c.decode.p95_ms << "/" << c.decode.p99_ms
+                  << " ms p50/p95/p99 (max " << c.decode.max_ms << ")"
+                  << "\n" << std::defaultfloat;
+    }
 }
 
 } // namespace nuc_display::modules
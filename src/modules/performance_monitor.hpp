@@ -1,6 +1,8 @@
 #pragma once
 
+#include "modules/decoder_stats.hpp"
 #include <string>
+#include <utility>
 #include <vector>
 #include <chrono>
 #include <fstream>
@@ -25,8 +27,10 @@ public:
     // Updates all stats from system paths
     void update();
 
-    // logs stats to console or file
-    void log() const;
+    // logs stats to console or file, followed by one line per (region index, decoder stats)
+    // and one per (camera index, capture stats)
+    void log(const std::vector<std::pair<size_t, VideoDecoderStats>>& videos = {},
+             const std::vector<std::pair<size_t, CameraStats>>& cameras = {}) const;
 
     const PerformanceStats& stats() const { return current_stats_; }
 
@@ -0,0 +1,265 @@
+#include "modules/probe_cache.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <thread>
+#include <type_traits>
+#include <sys/stat.h>
+
+namespace nuc_display::modules {
+
+namespace {
+constexpr char kMagic[8] = {'N', 'U', 'C', 'P', 'R', 'O', 'B', 'E'};
+// Bump whenever ProbedStream/ProbeRecord or their serialization change
+constexpr uint32_t kFormatVersion = 1;
+// Guards against reading garbage sizes from a damaged entry
+constexpr uint64_t kMaxVectorElements = 16 * 1024 * 1024;
+
+struct FileStamp {
+    int64_t size = -1;
+    int64_t mtime_ns = 0;
+};
+
+std::optional<FileStamp> stamp_of(const std::string& path) {
+    struct stat st {};
+    if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) return std::nullopt;
+    return FileStamp{st.st_size, static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000LL + st.st_mtim.tv_nsec};
+}
+
+class Writer {
+public:
+    template <typename T>
+    void operator()(const T& value) {
+        if constexpr (std::is_same_v<T, std::string>) {
+            (*this)(static_cast<uint64_t>(value.size()));
+            this->out_.append(value);
+        } else if constexpr (std::is_same_v<T, std::vector<uint8_t>>) {
+            (*this)(static_cast<uint64_t>(value.size()));
+            this->out_.append(reinterpret_cast<const char*>(value.data()), value.size());
+        } else {
+            static_assert(std::is_trivially_copyable_v<T>);
+            this->out_.append(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+    }
+    const std::string& bytes() const { return this->out_; }
+
+private:
+    std::string out_;
+};
+
+class Reader {
+public:
+    explicit Reader(const std::string& in) : in_(in) {}
+
+    template <typename T>
+    void operator()(T& value) {
+        if constexpr (std::is_same_v<T, std::string> || std::is_same_v<T, std::vector<uint8_t>>) {
+            uint64_t size = 0;
+            (*this)(size);
+            if (!this->ok_ || size > this->in_.size() - this->pos_) {
+                this->ok_ = false;
+                return;
+            }
+            value.assign(this->in_.begin() + this->pos_, this->in_.begin() + this->pos_ + size);
+            this->pos_ += size;
+        } else {
+            static_assert(std::is_trivially_copyable_v<T>);
+            if (!this->ok_ || sizeof(T) > this->in_.size() - this->pos_) {
+                this->ok_ = false;
+                return;
+            }
+            std::memcpy(&value, this->in_.data() + this->pos_, sizeof(T));
+            this->pos_ += sizeof(T);
+        }
+    }
+    bool ok() const { return this->ok_; }
+    bool at_end() const { return this->pos_ == this->in_.size(); }
+
+private:
+    const std::string& in_;
+    size_t pos_ = 0;
+    bool ok_ = true;
+};
+
+// One field list for both directions, so reading can never drift from writing
+template <typename Archive, typename Stream>
+void visit_stream(Archive& ar, Stream& s) {
+    ar(s.codec_type); ar(s.codec_id); ar(s.codec_tag); ar(s.format); ar(s.bit_rate);
+    ar(s.profile); ar(s.level); ar(s.width); ar(s.height); ar(s.sar_num); ar(s.sar_den);
+    ar(s.field_order); ar(s.color_range); ar(s.color_primaries); ar(s.color_trc); ar(s.color_space);
+    ar(s.chroma_location); ar(s.video_delay); ar(s.sample_rate); ar(s.channel_order); ar(s.channels);
+    ar(s.channel_mask); ar(s.frame_size); ar(s.block_align); ar(s.extradata);
+    ar(s.avg_frame_rate_num); ar(s.avg_frame_rate_den); ar(s.r_frame_rate_num); ar(s.r_frame_rate_den);
+    ar(s.start_time); ar(s.duration); ar(s.nb_frames);
+}
+
+template <typename Archive, typename Record>
+void visit_record_header(Archive& ar, Record& r) {
+    ar(r.format_name); ar(r.start_time); ar(r.duration); ar(r.bit_rate);
+    ar(r.keyframe_stream); ar(r.keyframe_coverage);
+}
+
+// FNV-1a: stable across builds and runs, unlike std::hash
+uint64_t path_hash(const std::string& path) {
+    uint64_t h = 1469598103934665603ULL;
+    for (unsigned char c : path) {
+        h ^= c;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+} // namespace
+
+ProbeCache::ProbeCache(std::string directory) : directory_(std::move(directory)) {}
+
+ProbeCache& ProbeCache::shared() {
+    static ProbeCache cache(default_directory());
+    return cache;
+}
+
+std::string ProbeCache::default_directory() {
+    if (const char* xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg) {
+        return std::string(xdg) + "/nuc_display/probe";
+    }
+    if (const char* home = std::getenv("HOME"); home && *home) {
+        return std::string(home) + "/.cache/nuc_display/probe";
+    }
+    return "/tmp/nuc_display/probe";
+}
+
+std::string ProbeCache::entry_path(const std::string& path) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.probe", static_cast<unsigned long long>(path_hash(path)));
+    return this->directory_ + "/" + name;
+}
+
+std::optional<ProbeRecord> ProbeCache::load(const std::string& path) {
+    auto stamp = stamp_of(path);
+    std::string entry = this->entry_path(path);
+    std::ifstream in(entry, std::ios::binary);
+    if (!stamp || !in) {
+        this->misses_++;
+        return std::nullopt;
+    }
+    std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    Reader ar(bytes);
+    char magic[sizeof(kMagic)] = {};
+    for (char& c : magic) ar(c);
+    uint32_t version = 0;
+    std::string cached_path;
+    FileStamp cached_stamp;
+    ar(version);
+    bool valid = ar.ok() && std::memcmp(magic, kMagic, sizeof(kMagic)) == 0 && version == kFormatVersion;
+    if (valid) {
+        ar(cached_path);
+        ar(cached_stamp.size);
+        ar(cached_stamp.mtime_ns);
+        valid = ar.ok() && cached_path == path;
+    }
+    if (valid && (cached_stamp.size != stamp->size || cached_stamp.mtime_ns != stamp->mtime_ns)) {
+        // The file was edited or replaced since it was probed
+        std::error_code ec;
+        std::filesystem::remove(entry, ec);
+        this->invalidated_++;
+        this->misses_++;
+        return std::nullopt;
+    }
+
+    ProbeRecord record;
+    if (valid) {
+        visit_record_header(ar, record);
+        uint64_t count = 0;
+        ar(count);
+        valid = ar.ok() && count <= kMaxVectorElements;
+        for (uint64_t i = 0; valid && i < count; ++i) {
+            visit_stream(ar, record.streams.emplace_back());
+            valid = ar.ok();
+        }
+        ar(count);
+        valid = valid && ar.ok() && count <= kMaxVectorElements;
+        if (valid) record.keyframes.resize(count);
+        for (uint64_t i = 0; valid && i < count; ++i) {
+            ar(record.keyframes[i].time_sec);
+            ar(record.keyframes[i].timestamp);
+        }
+        valid = valid && ar.ok() && ar.at_end();
+    }
+    if (!valid) {
+        // Damaged, from an older version, or a hash collision: probe again and overwrite
+        this->misses_++;
+        return std::nullopt;
+    }
+    this->hits_++;
+    return record;
+}
+
+bool ProbeCache::store(const std::string& path, const ProbeRecord& record) {
+    auto stamp = stamp_of(path);
+    if (!stamp) return false;
+
+    Writer ar;
+    for (char c : kMagic) ar(c);
+    ar(kFormatVersion);
+    ar(path);
+    ar(stamp->size);
+    ar(stamp->mtime_ns);
+    visit_record_header(ar, record);
+    ar(static_cast<uint64_t>(record.streams.size()));
+    for (const auto& s : record.streams) visit_stream(ar, s);
+    ar(static_cast<uint64_t>(record.keyframes.size()));
+    for (const auto& k : record.keyframes) {
+        ar(k.time_sec);
+        ar(k.timestamp);
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(this->directory_, ec);
+    std::string entry = this->entry_path(path);
+    std::ostringstream tmp_name;
+    tmp_name << entry << ".tmp" << std::this_thread::get_id();
+    {
+        std::ofstream out(tmp_name.str(), std::ios::binary | std::ios::trunc);
+        if (!out.write(ar.bytes().data(), static_cast<std::streamsize>(ar.bytes().size()))) {
+            std::cerr << "ProbeCache: Cannot write " << tmp_name.str() << "\n";
+            std::filesystem::remove(tmp_name.str(), ec);
+            return false;
+        }
+    }
+    std::filesystem::rename(tmp_name.str(), entry, ec);
+    if (ec) {
+        std::filesystem::remove(tmp_name.str(), ec);
+        return false;
+    }
+    this->prune();
+    return true;
+}
+
+void ProbeCache::prune() {
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    std::vector<std::pair<fs::file_time_type, fs::path>> entries;
+    for (const auto& e : fs::directory_iterator(this->directory_, ec)) {
+        if (e.path().extension() == ".probe") entries.emplace_back(e.last_write_time(ec), e.path());
+    }
+    if (entries.size() <= kMaxEntries) return;
+    // Oldest first: files not played for the longest time
+    std::sort(entries.begin(), entries.end());
+    for (size_t i = 0; i < entries.size() - kMaxEntries; ++i) fs::remove(entries[i].second, ec);
+}
+
+ProbeCacheStats ProbeCache::stats() const {
+    ProbeCacheStats s;
+    s.hits = this->hits_.load();
+    s.misses = this->misses_.load();
+    s.invalidated = this->invalidated_.load();
+    return s;
+}
+
+} // namespace nuc_display::modules
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+#include "modules/keyframe_index.hpp"
+
+namespace nuc_display::modules {
+
+// What avformat_find_stream_info() found out about one stream. Plain integers
+// (FFmpeg enum values, AV_NOPTS_VALUE included) so this header stays FFmpeg-free.
+struct ProbedStream {
+    int32_t codec_type = -1;
+    int32_t codec_id = 0;
+    uint32_t codec_tag = 0;
+    int32_t format = -1;
+    int64_t bit_rate = 0;
+    int32_t profile = 0;
+    int32_t level = 0;
+    int32_t width = 0;
+    int32_t height = 0;
+    int32_t sar_num = 0;
+    int32_t sar_den = 1;
+    int32_t field_order = 0;
+    int32_t color_range = 0;
+    int32_t color_primaries = 0;
+    int32_t color_trc = 0;
+    int32_t color_space = 0;
+    int32_t chroma_location = 0;
+    int32_t video_delay = 0;
+    int32_t sample_rate = 0;
+    int32_t channel_order = 0;
+    int32_t channels = 0;
+    uint64_t channel_mask = 0;
+    int32_t frame_size = 0;
+    int32_t block_align = 0;
+    std::vector<uint8_t> extradata;
+    int32_t avg_frame_rate_num = 0;
+    int32_t avg_frame_rate_den = 1;
+    int32_t r_frame_rate_num = 0;
+    int32_t r_frame_rate_den = 1;
+    int64_t start_time = 0;
+    int64_t duration = 0;
+    int64_t nb_frames = 0;
+};
+
+// Everything ContainerReader needs to open a file again without probing it
+struct ProbeRecord {
+    std::string format_name;         // Demuxer that produced it; a different one means a different file
+    int64_t start_time = 0;
+    int64_t duration = 0;
+    int64_t bit_rate = 0;
+    std::vector<ProbedStream> streams;
+
+    // Seek table of one stream (empty until the keyframe index was built once)
+    int32_t keyframe_stream = -1;
+    std::vector<KeyframeEntry> keyframes;
+    double keyframe_coverage = 0.0;
+};
+
+struct ProbeCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t invalidated = 0;   // Entries dropped because the file changed
+};
+
+// On-disk cache of probe results, one small binary file per media file, keyed
+// by path and validated against the file's size and mtime on every lookup, so
+// an edited or replaced file is probed again automatically. Safe to use from
+// several decode threads: entries are written to a temporary file and renamed.
+class ProbeCache {
+public:
+    explicit ProbeCache(std::string directory);
+
+    // $XDG_CACHE_HOME/nuc_display/probe (~/.cache/... without it)
+    static ProbeCache& shared();
+    static std::string default_directory();
+
+    std::optional<ProbeRecord> load(const std::string& path);
+    bool store(const std::string& path, const ProbeRecord& record);
+
+    const std::string& directory() const { return this->directory_; }
+    ProbeCacheStats stats() const;
+
+    static constexpr size_t kMaxEntries = 1024;
+
+private:
+    std::string entry_path(const std::string& path) const;
+    void prune();
+
+    std::string directory_;
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+    std::atomic<uint64_t> invalidated_{0};
+};
+
+} // namespace nuc_display::modules
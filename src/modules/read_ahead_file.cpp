@@ -0,0 +1,240 @@
+#include "modules/read_ahead_file.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace nuc_display::modules {
+
+namespace {
+// WILLNEED hints run this far ahead of the reader thread
+constexpr int64_t kAdviseWindowBytes = 16LL * 1024 * 1024;
+}
+
+ReadAheadOptions ReadAheadOptions::for_platform() {
+#ifdef PLATFORM_RPI
+    // 512 MB boards: SD cards need the depth, but several regions share the RAM
+    return {8 * 1024 * 1024, 256 * 1024, 16 * 1024 * 1024};
+#else
+    return {32 * 1024 * 1024, 1024 * 1024, 64 * 1024 * 1024};
+#endif
+}
+
+ReadAheadFile::ReadAheadFile(const ReadAheadOptions& options) : options_(options) {}
+
+ReadAheadFile::~ReadAheadFile() {
+    this->close();
+}
+
+std::expected<void, MediaError> ReadAheadFile::open(const std::string& path) {
+    this->close();
+
+    this->fd_ = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (this->fd_ < 0) return std::unexpected(MediaError::FileNotFound);
+
+    struct stat st {};
+    if (fstat(this->fd_, &st) != 0 || !S_ISREG(st.st_mode)) {
+        this->close();
+        return std::unexpected(MediaError::FileNotFound);
+    }
+    this->size_ = st.st_size;
+    posix_fadvise(this->fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    if (this->size_ > 0 && static_cast<uint64_t>(this->size_) <= this->options_.mmap_max_bytes) {
+        void* map = mmap(nullptr, static_cast<size_t>(this->size_), PROT_READ, MAP_PRIVATE, this->fd_, 0);
+        if (map != MAP_FAILED) {
+            madvise(map, static_cast<size_t>(this->size_), MADV_SEQUENTIAL);
+            madvise(map, static_cast<size_t>(this->size_), MADV_WILLNEED);
+            this->map_ = static_cast<const uint8_t*>(map);
+            this->map_pos_ = 0;
+            return {};
+        }
+        std::cerr << "ReadAheadFile: mmap of " << path << " failed, using read-ahead instead\n";
+    }
+
+    this->ring_.assign(std::max(this->options_.ring_bytes, this->options_.chunk_bytes * 2), 0);
+    this->base_ = this->end_ = this->pos_ = 0;
+    this->eof_ = false;
+    this->error_ = false;
+    this->reader_ = std::jthread([this](std::stop_token stop) { this->run(stop); });
+    return {};
+}
+
+void ReadAheadFile::close() {
+    if (this->reader_.joinable()) {
+        this->reader_.request_stop();
+        this->space_cv_.notify_all();
+        this->reader_.join();
+    }
+    this->reader_ = std::jthread();
+    if (this->map_) {
+        munmap(const_cast<uint8_t*>(this->map_), static_cast<size_t>(this->size_));
+        this->map_ = nullptr;
+    }
+    if (this->fd_ >= 0) {
+        ::close(this->fd_);
+        this->fd_ = -1;
+    }
+    this->ring_.clear();
+    this->ring_.shrink_to_fit();
+    this->size_ = 0;
+}
+
+void ReadAheadFile::run(std::stop_token stop) {
+    const int64_t capacity = static_cast<int64_t>(this->ring_.size());
+    const int64_t chunk = static_cast<int64_t>(this->options_.chunk_bytes);
+    uint64_t advised_generation = 0;
+    int64_t advised_until = 0;  // POSIX_FADV_WILLNEED issued up to here
+
+    while (!stop.stop_requested()) {
+        uint64_t generation;
+        int64_t offset;
+        size_t length;
+        {
+            std::unique_lock<std::mutex> lock(this->mutex_);
+            // Room for a chunk means overwriting look-behind data, never anything unread
+            auto room = [&] {
+                int64_t lowest = std::min(this->pos_, this->end_ + chunk - capacity);
+                return std::max(this->base_, lowest);
+            };
+            if (!this->space_cv_.wait(lock, stop, [&] {
+                    return !this->eof_ && !this->error_ && this->end_ - room() + chunk <= capacity;
+                })) {
+                break;
+            }
+            this->base_ = room();
+            generation = this->generation_;
+            offset = this->end_;
+            // One contiguous stretch of the ring, up to a chunk
+            int64_t ring_offset = offset % capacity;
+            length = static_cast<size_t>(std::min({chunk, capacity - ring_offset, this->size_ - offset}));
+            if (length == 0) {
+                this->eof_ = true;
+                this->data_cv_.notify_all();
+                continue;
+            }
+        }
+
+        if (generation != advised_generation || offset >= advised_until) {
+            posix_fadvise(this->fd_, offset, kAdviseWindowBytes, POSIX_FADV_WILLNEED);
+            advised_generation = generation;
+            advised_until = offset + kAdviseWindowBytes / 2;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        ssize_t got = pread(this->fd_, this->ring_.data() + offset % capacity, length, offset);
+        int read_errno = errno;
+        auto elapsed = std::chrono::steady_clock::now() - start;
+
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        if (generation != this->generation_) continue; // A seek moved the window meanwhile
+        if (got < 0) {
+            if (read_errno == EINTR) continue;
+            std::cerr << "ReadAheadFile: read error at offset " << offset << ": " << std::strerror(read_errno) << "\n";
+            this->error_ = true;
+        } else if (got == 0) {
+            this->eof_ = true;
+        } else {
+            this->end_ += got;
+            this->bytes_read_ += static_cast<uint64_t>(got);
+            this->read_ns_ += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        }
+        this->data_cv_.notify_all();
+    }
+}
+
+int64_t ReadAheadFile::read(uint8_t* dst, size_t size) {
+    if (this->map_) {
+        size_t n = static_cast<size_t>(std::min<int64_t>(static_cast<int64_t>(size), this->size_ - this->map_pos_));
+        std::memcpy(dst, this->map_ + this->map_pos_, n);
+        this->map_pos_ += static_cast<int64_t>(n);
+        return static_cast<int64_t>(n);
+    }
+    if (this->ring_.empty()) return -1;
+
+    int64_t offset;
+    size_t n;
+    {
+        std::unique_lock<std::mutex> lock(this->mutex_);
+        if (this->pos_ == this->end_ && !this->eof_ && !this->error_) {
+            // The first fill after open/seek is expected; running dry later means storage
+            // fell behind the demuxer, which is what shows up as a video hitch
+            bool stall = this->end_ > this->base_;
+            auto start = std::chrono::steady_clock::now();
+            this->data_cv_.wait(lock, [this] { return this->pos_ < this->end_ || this->eof_ || this->error_; });
+            if (stall) {
+                this->stalls_++;
+                this->stall_ns_ += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - start).count());
+            }
+        }
+        if (this->pos_ == this->end_) return this->error_ ? -1 : 0;
+        offset = this->pos_;
+        n = static_cast<size_t>(std::min<int64_t>(static_cast<int64_t>(size), this->end_ - this->pos_));
+    }
+
+    // [pos_, end_) can't be overwritten until pos_ moves, so copy without the lock
+    const int64_t capacity = static_cast<int64_t>(this->ring_.size());
+    size_t ring_offset = static_cast<size_t>(offset % capacity);
+    size_t first = std::min(n, static_cast<size_t>(capacity) - ring_offset);
+    std::memcpy(dst, this->ring_.data() + ring_offset, first);
+    std::memcpy(dst + first, this->ring_.data(), n - first);
+
+    {
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        this->pos_ += static_cast<int64_t>(n);
+    }
+    this->space_cv_.notify_one();
+    return static_cast<int64_t>(n);
+}
+
+int64_t ReadAheadFile::seek(int64_t offset) {
+    if (offset < 0 || offset > this->size_) return -1;
+    this->seeks_++;
+    if (this->map_) {
+        this->map_pos_ = offset;
+        this->seeks_in_buffer_++;
+        return offset;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        if (offset >= this->base_ && offset <= this->end_) {
+            this->pos_ = offset;
+            this->seeks_in_buffer_++;
+        } else {
+            this->generation_++;
+            this->base_ = this->end_ = this->pos_ = offset;
+            this->eof_ = false;
+            this->error_ = false;
+        }
+    }
+    this->space_cv_.notify_one();
+    return offset;
+}
+
+int64_t ReadAheadFile::position() const {
+    if (this->map_) return this->map_pos_;
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    return this->pos_;
+}
+
+ReadAheadStats ReadAheadFile::stats() const {
+    ReadAheadStats s;
+    s.bytes_read = this->map_ ? static_cast<uint64_t>(this->size_) : this->bytes_read_.load();
+    double read_sec = this->read_ns_.load() / 1e9;
+    s.read_mbps = read_sec > 0.0 ? this->bytes_read_.load() / read_sec / (1024.0 * 1024.0) : 0.0;
+    s.stalls = this->stalls_.load();
+    s.stall_sec = this->stall_ns_.load() / 1e9;
+    s.seeks = this->seeks_.load();
+    s.seeks_in_buffer = this->seeks_in_buffer_.load();
+    s.mapped = this->map_ != nullptr;
+    return s;
+}
+
+} // namespace nuc_display::modules
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "modules/media_module.hpp"
+
+namespace nuc_display::modules {
+
+struct ReadAheadOptions {
+    size_t ring_bytes;       // Read-ahead (and look-behind for short backward seeks)
+    size_t chunk_bytes;      // Size of each background read
+    size_t mmap_max_bytes;   // Files up to this size are mapped whole instead (0 = never)
+
+    static ReadAheadOptions for_platform();
+};
+
+struct ReadAheadStats {
+    uint64_t bytes_read = 0;        // From storage, by the reader thread
+    double read_mbps = 0.0;         // Storage throughput while reading (MB/s)
+    uint64_t stalls = 0;            // Demuxer reads that had to wait for storage
+    double stall_sec = 0.0;
+    uint64_t seeks = 0;
+    uint64_t seeks_in_buffer = 0;   // Served from data already resident
+    bool mapped = false;
+};
+
+// A local media file read through a large ring buffer that a background thread
+// keeps filled, so demuxing never waits on SD card / USB stick latency as long
+// as the storage keeps up on average. Small files are mmap'ed whole instead.
+// FFmpeg-free (ContainerReader wraps it in an AVIOContext) so it can be unit
+// tested. One consumer thread: read() and seek() must not be called concurrently.
+class ReadAheadFile {
+public:
+    explicit ReadAheadFile(const ReadAheadOptions& options = ReadAheadOptions::for_platform());
+    ~ReadAheadFile();
+
+    ReadAheadFile(const ReadAheadFile&) = delete;
+    ReadAheadFile& operator=(const ReadAheadFile&) = delete;
+
+    std::expected<void, MediaError> open(const std::string& path);
+    void close();
+
+    // Bytes copied, 0 at end of file, -1 on an I/O error. Blocks (and counts a
+    // stall) only when the reader thread hasn't got the data yet.
+    int64_t read(uint8_t* dst, size_t size);
+    // New position, or -1 if out of range. Targets still in the ring cost nothing;
+    // anything else restarts the reader there.
+    int64_t seek(int64_t offset);
+
+    int64_t size() const { return this->size_; }
+    int64_t position() const;
+    bool is_mapped() const { return this->map_ != nullptr; }
+    ReadAheadStats stats() const;
+
+private:
+    void run(std::stop_token stop);
+
+    ReadAheadOptions options_;
+    int fd_ = -1;
+    int64_t size_ = 0;
+
+    // mmap mode
+    const uint8_t* map_ = nullptr;
+    int64_t map_pos_ = 0;
+
+    // Ring mode: file offsets [base_, end_) are resident at ring_[offset % capacity]
+    std::vector<uint8_t> ring_;
+    mutable std::mutex mutex_;
+    std::condition_variable data_cv_;
+    std::condition_variable_any space_cv_;
+    int64_t base_ = 0;
+    int64_t end_ = 0;
+    int64_t pos_ = 0;
+    uint64_t generation_ = 0;   // Bumped by every seek outside the ring
+    bool eof_ = false;
+    bool error_ = false;
+    std::jthread reader_;
+
+    std::atomic<uint64_t> bytes_read_{0};
+    std::atomic<uint64_t> read_ns_{0};
+    std::atomic<uint64_t> stalls_{0};
+    std::atomic<uint64_t> stall_ns_{0};
+    std::atomic<uint64_t> seeks_{0};
+    std::atomic<uint64_t> seeks_in_buffer_{0};
+};
+
+} // namespace nuc_display::modules
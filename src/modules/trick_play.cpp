@@ -0,0 +1,51 @@
+#include "modules/trick_play.hpp"
+#include <algorithm>
+#include <cstdlib>
+
+namespace nuc_display::modules {
+
+int TrickPlay::next_speed(int speed, int direction) {
+    int sign = direction < 0 ? -1 : 1;
+    if (speed == 0 || (speed > 0) != (sign > 0)) return 2 * sign;
+    int next = speed * 2;
+    return std::abs(next) > kMaxSpeed ? 0 : next;
+}
+
+void TrickPlay::start(int speed, double position_sec) {
+    this->speed_ = std::clamp(speed, -kMaxSpeed, kMaxSpeed);
+    this->anchor_pos_ = position_sec;
+    this->anchor_time_ = -1.0;
+    this->shown_sec_ = position_sec;
+}
+
+void TrickPlay::stop() {
+    this->speed_ = 0;
+    this->anchor_time_ = -1.0;
+}
+
+double TrickPlay::target(double now_sec, double end_sec) const {
+    double t = this->anchor_pos_ + this->speed_ * (now_sec - this->anchor_time_);
+    return std::clamp(t, 0.0, std::max(0.0, end_sec));
+}
+
+const KeyframeEntry* TrickPlay::next_keyframe(const KeyframeIndex& index, double now_sec, double end_sec) {
+    if (!this->active()) return nullptr;
+    if (this->anchor_time_ < 0.0) this->anchor_time_ = now_sec;
+
+    // A partial packet scan only knows the keyframes up to its coverage
+    const KeyframeEntry* keyframe = index.at_or_before(this->target(now_sec, std::min(end_sec, index.coverage())));
+    if (!keyframe) return nullptr;
+    bool moved = this->speed_ > 0 ? keyframe->time_sec > this->shown_sec_ : keyframe->time_sec < this->shown_sec_;
+    if (!moved) return nullptr;
+    this->shown_sec_ = keyframe->time_sec;
+    return keyframe;
+}
+
+bool TrickPlay::finished(const KeyframeIndex& index, double now_sec, double end_sec) const {
+    if (!this->active() || this->anchor_time_ < 0.0 || index.empty()) return false;
+    double end = std::min(end_sec, index.coverage());
+    double t = this->target(now_sec, end);
+    return this->speed_ > 0 ? t >= end : t <= 0.0;
+}
+
+} // namespace nuc_display::modules
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "modules/keyframe_index.hpp"
+
+namespace nuc_display::modules {
+
+// Fast forward / rewind ("scan") by showing keyframes only. The scan position
+// runs at `speed` times real time from where the scan started; each call hands
+// out the last keyframe the position has passed, so a slow decode skips
+// keyframes instead of falling behind the requested speed. FFmpeg-free so the
+// pacing can be unit tested; the decoder owns the seeking and decoding.
+class TrickPlay {
+public:
+    static constexpr int kMaxSpeed = 16;
+
+    // Speed after a scan key press in `direction` (+1 forward, -1 backward):
+    // 2x, 4x, 8x, 16x, then back to normal playback (0). Reversing starts over at 2x.
+    static int next_speed(int speed, int direction);
+
+    // Scan at `speed` (negative = backward) from position_sec; the clock starts
+    // with the first next_keyframe() call
+    void start(int speed, double position_sec);
+    void stop();
+    bool active() const { return this->speed_ != 0; }
+    int speed() const { return this->speed_; }
+    // Last keyframe handed out (the start position before the first one)
+    double position() const { return this->shown_sec_; }
+
+    // Keyframe to show at now_sec, or nullptr while the scan hasn't moved past the
+    // one already shown. end_sec is the media duration.
+    const KeyframeEntry* next_keyframe(const KeyframeIndex& index, double now_sec, double end_sec);
+    // The scan ran into the end (forward) or the start (backward) of the media
+    bool finished(const KeyframeIndex& index, double now_sec, double end_sec) const;
+
+private:
+    double target(double now_sec, double end_sec) const;
+
+    int speed_ = 0;
+    double anchor_pos_ = 0.0;
+    double anchor_time_ = -1.0;
+    double shown_sec_ = 0.0;
+};
+
+} // namespace nuc_display::modules
@@ -0,0 +1,125 @@
+#include "modules/vaapi_scaler.hpp"
+#include <iostream>
+
+extern "C" {
+#include <libavutil/hwcontext_vaapi.h>
+}
+
+namespace nuc_display::modules {
+
+VaapiScaler::~VaapiScaler() {
+    this->release();
+}
+
+void VaapiScaler::release() {
+    if (this->context_ != VA_INVALID_ID) {
+        vaDestroyContext(this->display_, this->context_);
+        this->context_ = VA_INVALID_ID;
+    }
+    if (this->config_ != VA_INVALID_ID) {
+        vaDestroyConfig(this->display_, this->config_);
+        this->config_ = VA_INVALID_ID;
+    }
+    if (this->frames_ctx_) {
+        av_buffer_unref(&this->frames_ctx_);
+    }
+    this->display_ = nullptr;
+    this->out_w_ = 0;
+    this->out_h_ = 0;
+}
+
+bool VaapiScaler::init(AVBufferRef* hw_device_ctx, int out_w, int out_h, int pool_size) {
+    this->release();
+    if (!hw_device_ctx || out_w <= 0 || out_h <= 0) return false;
+
+    auto* device = reinterpret_cast<AVHWDeviceContext*>(hw_device_ctx->data);
+    auto* va_device = static_cast<AVVAAPIDeviceContext*>(device->hwctx);
+    this->display_ = va_device->display;
+
+    // Fixed pool of right-sized output surfaces
+    this->frames_ctx_ = av_hwframe_ctx_alloc(hw_device_ctx);
+    if (!this->frames_ctx_) {
+        this->release();
+        return false;
+    }
+    auto* frames = reinterpret_cast<AVHWFramesContext*>(this->frames_ctx_->data);
+    frames->format = AV_PIX_FMT_VAAPI;
+    frames->sw_format = AV_PIX_FMT_NV12;
+    frames->width = out_w;
+    frames->height = out_h;
+    frames->initial_pool_size = pool_size;
+    if (av_hwframe_ctx_init(this->frames_ctx_) < 0) {
+        std::cerr << "[VaapiScaler] Failed to allocate " << pool_size << " output surfaces at "
+                  << out_w << "x" << out_h << "\n";
+        this->release();
+        return false;
+    }
+
+    if (vaCreateConfig(this->display_, VAProfileNone, VAEntrypointVideoProc, nullptr, 0, &this->config_) != VA_STATUS_SUCCESS) {
+        std::cerr << "[VaapiScaler] VAEntrypointVideoProc not supported by driver.\n";
+        this->config_ = VA_INVALID_ID;
+        this->release();
+        return false;
+    }
+
+    auto* va_frames = static_cast<AVVAAPIFramesContext*>(frames->hwctx);
+    if (vaCreateContext(this->display_, this->config_, out_w, out_h, VA_PROGRESSIVE,
+                        va_frames->surface_ids, va_frames->nb_surfaces, &this->context_) != VA_STATUS_SUCCESS) {
+        std::cerr << "[VaapiScaler] vaCreateContext failed.\n";
+        this->context_ = VA_INVALID_ID;
+        this->release();
+        return false;
+    }
+
+    this->out_w_ = out_w;
+    this->out_h_ = out_h;
+    std::cout << "[VaapiScaler] VPP scale step active: output " << out_w << "x" << out_h
+              << " (" << pool_size << " surfaces)\n";
+    return true;
+}
+
+AVFrame* VaapiScaler::scale(const AVFrame* src) {
+    if (!this->is_active() || !src || src->format != AV_PIX_FMT_VAAPI) return nullptr;
+
+    AVFrame* dst = av_frame_alloc();
+    if (av_hwframe_get_buffer(this->frames_ctx_, dst, 0) < 0) {
+        // Pool exhausted: presentation is holding every surface. Skip scaling this frame.
+        av_frame_free(&dst);
+        return nullptr;
+    }
+
+    VASurfaceID in_surface = static_cast<VASurfaceID>(reinterpret_cast<uintptr_t>(src->data[3]));
+    VASurfaceID out_surface = static_cast<VASurfaceID>(reinterpret_cast<uintptr_t>(dst->data[3]));
+
+    VARectangle in_rect = {0, 0, static_cast<uint16_t>(src->width), static_cast<uint16_t>(src->height)};
+    VARectangle out_rect = {0, 0, static_cast<uint16_t>(this->out_w_), static_cast<uint16_t>(this->out_h_)};
+
+    VAProcPipelineParameterBuffer params = {};
+    params.surface = in_surface;
+    params.surface_region = &in_rect;
+    params.output_region = &out_rect;
+    params.output_background_color = 0xff000000;
+    params.filter_flags = VA_FILTER_SCALING_FAST;
+
+    VABufferID params_buf = VA_INVALID_ID;
+    bool ok = vaCreateBuffer(this->display_, this->context_, VAProcPipelineParameterBufferType,
+                             sizeof(params), 1, &params, &params_buf) == VA_STATUS_SUCCESS;
+    ok = ok && vaBeginPicture(this->display_, this->context_, out_surface) == VA_STATUS_SUCCESS;
+    ok = ok && vaRenderPicture(this->display_, this->context_, &params_buf, 1) == VA_STATUS_SUCCESS;
+    ok = ok && vaEndPicture(this->display_, this->context_) == VA_STATUS_SUCCESS;
+    if (params_buf != VA_INVALID_ID) {
+        vaDestroyBuffer(this->display_, params_buf);
+    }
+
+    if (!ok) {
+        av_frame_free(&dst);
+        return nullptr;
+    }
+
+    av_frame_copy_props(dst, src);
+    dst->width = this->out_w_;
+    dst->height = this->out_h_;
+    return dst;
+}
+
+} // namespace nuc_display::modules
@@ -0,0 +1,46 @@
+#pragma once
+
+extern "C" {
+#include <libavutil/frame.h>
+#include <libavutil/hwcontext.h>
+#include <va/va.h>
+}
+
+namespace nuc_display::modules {
+
+// VA-API video-processing (VPP) scale step. Decoded surfaces are scaled on the
+// GPU into a small pool of right-sized NV12 surfaces, so frames queued for
+// presentation hold a fraction of the memory and the EGL sampler reads
+// proportionally less. The full-size decoder surface goes back to the
+// decoder pool as soon as the scale has been submitted.
+class VaapiScaler {
+public:
+    VaapiScaler() = default;
+    ~VaapiScaler();
+
+    VaapiScaler(const VaapiScaler&) = delete;
+    VaapiScaler& operator=(const VaapiScaler&) = delete;
+
+    // Create the VPP pipeline and output pool. pool_size must cover every
+    // scaled frame that can be alive at once (queued + presented).
+    bool init(AVBufferRef* hw_device_ctx, int out_w, int out_h, int pool_size);
+    bool is_active() const { return this->context_ != VA_INVALID_ID; }
+    int out_width() const { return this->out_w_; }
+    int out_height() const { return this->out_h_; }
+
+    // Returns a new VAAPI frame at the output size, or nullptr on failure
+    // (caller keeps using the original frame).
+    AVFrame* scale(const AVFrame* src);
+
+    void release();
+
+private:
+    VADisplay display_ = nullptr;
+    VAConfigID config_ = VA_INVALID_ID;
+    VAContextID context_ = VA_INVALID_ID;
+    AVBufferRef* frames_ctx_ = nullptr;
+    int out_w_ = 0;
+    int out_h_ = 0;
+};
+
+} // namespace nuc_display::modules
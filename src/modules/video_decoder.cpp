@@ -1,5 +1,12 @@
 #include "modules/video_decoder.hpp"
+#include "modules/audio_interleave.hpp"
+#include "modules/audio_mixer.hpp"
 #include <iostream>
+#include <cstring>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <utility>
 #include <drm_fourcc.h>
 
 namespace nuc_display::modules {
@@ -11,6 +18,10 @@ VideoDecoder::VideoDecoder() {
 
 VideoDecoder::~VideoDecoder() {
     this->cleanup_codec();
+    if (this->audio_stream_) {
+        AudioMixer::shared().remove_stream(this->audio_stream_);
+        this->audio_stream_.reset();
+    }
     
     // Free the persistent frames allocated in constructor
     if (this->hw_frame_) {
@@ -22,24 +33,36 @@ VideoDecoder::~VideoDecoder() {
     if (this->drm_frame_) {
         av_frame_free(&this->drm_frame_);
     }
-    if (this->hw_device_ctx_) {
-        av_buffer_unref(&this->hw_device_ctx_);
+    if (this->swr_ctx_) {
+        swr_free(&this->swr_ctx_);
     }
+    av_channel_layout_uninit(&this->swr_in_layout_);
 }
 
-std::expected<void, MediaError> VideoDecoder::init_vaapi(int drm_fd) {
-    (void)drm_fd;
-    std::cout << "Initializing FFmpeg VA-API Hardware Device Context\n";
-    
-    // Pass the DRM device path directly to FFmpeg to create the HW device context
-    int err = av_hwdevice_ctx_create(&this->hw_device_ctx_, AV_HWDEVICE_TYPE_VAAPI, "/dev/dri/renderD128", nullptr, 0);
-    if (err < 0) {
-        std::cerr << "Failed to create VA-API HW device context. Falling back to software.\n";
-        // Not a fatal error, FFmpeg can fallback to software decoding
-        return {}; 
+std::expected<void, MediaError> VideoDecoder::init_backends(const DecodeDevices& devices, const std::vector<DecodeBackendKind>& order) {
+    std::vector<std::unique_ptr<DecodeBackend>> backends;
+    for (DecodeBackendKind kind : order) {
+        auto backend = DecodeBackend::create(kind, devices);
+        if (!backend) {
+            std::cout << "VideoDecoder: " << decode_backend_name(kind) << " backend not built in, skipping.\n";
+            continue;
+        }
+        backends.push_back(std::move(backend));
     }
-    
-    std::cout << "VA-API HW device context initialized successfully.\n";
+    return this->init_backends(std::move(backends));
+}
+
+std::expected<void, MediaError> VideoDecoder::init_backends(std::vector<std::unique_ptr<DecodeBackend>> backends) {
+    this->backends_.clear();
+    for (auto& backend : backends) {
+        // A backend whose device is missing can't take any stream: leave it out
+        if (!backend || !backend->init_device()) continue;
+        this->backends_.push_back(std::move(backend));
+    }
+    std::cout << "VideoDecoder: Decode backends:";
+    for (const auto& backend : this->backends_) std::cout << " " << backend->name();
+    std::cout << "\n";
+    if (this->backends_.empty()) return std::unexpected(MediaError::HardwareError);
     return {};
 }
 
@@ -55,6 +78,7 @@ void VideoDecoder::rewind_stream() {
 }
 
 void VideoDecoder::cleanup_codec() {
+    this->end_scan();
     std::lock_guard<std::mutex> lock(this->queue_mutex_);
     
     while (!this->packet_queue_.empty()) {
@@ -63,7 +87,7 @@ void VideoDecoder::cleanup_codec() {
         this->packet_queue_.pop_front();
     }
     while (!this->video_frame_queue_.empty()) {
-        AVFrame* frame = this->video_frame_queue_.front();
+        AVFrame* frame = this->video_frame_queue_.front().frame;
         av_frame_free(&frame);
         this->video_frame_queue_.pop_front();
     }
@@ -81,10 +105,7 @@ void VideoDecoder::cleanup_codec() {
         avcodec_free_context(&this->audio_codec_ctx_);
         this->audio_codec_ctx_ = nullptr;
     }
-    if (this->swr_ctx_) {
-        swr_free(&this->swr_ctx_);
-        this->swr_ctx_ = nullptr;
-    }
+    // swr_ctx_ is kept: the next playlist item usually has the same audio parameters
     this->codec_ = nullptr;
     this->video_stream_index_ = -1;
     this->audio_stream_index_ = -1;
@@ -95,20 +116,31 @@ void VideoDecoder::cleanup_codec() {
     this->decoding_failure_count_ = 0;
     this->packets_sent_without_frame_ = 0;
     this->eof_reached_ = false;
+    this->video_draining_ = false;
+    this->packets_since_loop_ = 0;
+    this->frames_queued_ = 0;
+    this->loop_boundaries_.clear();
+    this->loops_completed_ = 0;
+    this->cadence_.reset();
+    this->skip_nonref_requested_ = false;
+    this->skip_nonref_active_ = false;
+    this->last_queued_ts_ = AV_NOPTS_VALUE;
+    this->frames_dropped_late_ = 0;
+    this->frames_skipped_nonref_ = 0;
+    this->frames_seek_discarded_ = 0;
+    this->frames_import_failed_ = 0;
     this->audio_spillover_.clear();
-    this->audio_prebuffering_ = true;
     this->is_seeking_ = false;
     this->current_pos_sec_ = 0.0;
     this->seek_offset_sec_ = 0.0;
-    this->alsa_error_count_ = 0;
+    this->seek_video_until_ = AV_NOPTS_VALUE;
+    this->seek_audio_until_ = AV_NOPTS_VALUE;
+    this->seek_frames_discarded_ = 0;
+    this->buffer_.reset();
 
-    // Properly drain and reset ALSA to prevent EIO errors on next video
-    if (this->pcm_handle_) {
-        // Drop any pending frames immediately
-        snd_pcm_drop(this->pcm_handle_);
-        // Free hardware parameters so the device falls back to SND_PCM_STATE_SETUP
-        // This is REQUIRED so that the next `load()` can successfully call `snd_pcm_hw_params`
-        snd_pcm_hw_free(this->pcm_handle_);
+    // The mixer keeps the device running; only this stream's queued samples go
+    if (this->audio_stream_) {
+        this->audio_stream_->flush();
     }
 
     // Cleanup EGL resources
@@ -127,6 +159,32 @@ void VideoDecoder::cleanup_codec() {
         glDeleteProgram(this->external_program_);
         this->external_program_ = 0;
     }
+    this->sw_uploader_.release();
+    this->sw_frame_active_ = false;
+    if (this->backend_) {
+        this->backend_->reset();
+        this->backend_ = nullptr;
+    }
+    this->backend_confirmed_ = false;
+    this->fallback_pending_ = false;
+    this->active_backend_ = "none";
+    this->active_hw_ = false;
+    this->scale_plan_ = DecodeScalePlan{};
+    this->decoded_frames_ = 0;
+    this->decoded_bytes_ = 0;
+    this->frames_presented_ = 0;
+    this->frames_late_ = 0;
+    this->decode_latency_.reset();
+    this->import_latency_.reset();
+    this->decode_busy_sec_ = 0.0;
+    this->published_fill_.publish(BufferFill{});
+    this->published_cadence_.publish(CadenceStats{});
+    this->published_io_.publish(ReadAheadStats{});
+    this->audio_end_sec_ = -1.0;
+    this->audio_attached_ = false;
+    this->audio_buffer_ms_ = 0.0;
+    this->audio_clock_sec_ = -1.0;
+    this->av_offset_ms_ = 0.0;
 }
 
 void VideoDecoder::load_playlist(const std::vector<std::string>& files) {
@@ -161,11 +219,27 @@ void VideoDecoder::unload() {
         this->playlist_.clear();
         this->playlist_index_ = 0;
     }
+    this->container_.interrupt();
+    std::lock_guard<std::mutex> connect_lock(this->connect_mutex_);
+    this->container_.clear_interrupt();
+    this->connecting_ = false;
+    this->reconnecting_ = false;
     this->cleanup_codec();
 }
 
 bool VideoDecoder::is_loaded() const {
-    return this->codec_ctx_ != nullptr;
+    // A network source counts from load(), while process() is still connecting
+    return this->connecting_.load() || this->codec_ctx_ != nullptr;
+}
+
+bool VideoDecoder::is_hw_accelerated() const {
+    if (this->connecting_.load() || !this->codec_ctx_ || !this->backend_) return false;
+    return this->backend_->is_hardware() && this->backend_->active(this->codec_ctx_);
+}
+
+const char* VideoDecoder::backend_name() const {
+    if (this->connecting_.load()) return "none";
+    return this->active_backend_.load(std::memory_order_relaxed);
 }
 
 void VideoDecoder::prev_video() {
@@ -188,7 +262,8 @@ void VideoDecoder::prev_video() {
 }
 
 void VideoDecoder::skip_forward(double seconds) {
-    if (!this->codec_ctx_ || !this->container_.format_ctx() || seconds <= 0) return;
+    if (this->connecting_.load() || this->reconnecting_) return;
+    if (!this->codec_ctx_ || !this->container_.format_ctx() || seconds <= 0 || this->container_.is_live()) return;
     
     double target_sec = this->current_pos_sec_ + seconds;
     double duration = this->container_.format_ctx()->duration / (double)AV_TIME_BASE;
@@ -197,80 +272,581 @@ void VideoDecoder::skip_forward(double seconds) {
         target_sec = duration - 0.5;
     }
     
-    int64_t seek_target = this->container_.format_ctx()->start_time + static_cast<int64_t>(target_sec * AV_TIME_BASE);
-    
     std::cout << "[VideoDecoder] Skipping forward " << seconds << "s (from " << this->current_pos_sec_ << "s to " << target_sec << "s)\n";
+    this->seek_to(target_sec);
+}
+
+void VideoDecoder::skip_backward(double seconds) {
+    if (this->connecting_.load() || this->reconnecting_) return;
+    if (!this->codec_ctx_ || !this->container_.format_ctx() || this->container_.is_live()) return;
+    
+    double target_sec = std::max(0.0, this->current_pos_sec_ - seconds);
+
+    std::cout << "[VideoDecoder] Skipping backward " << seconds << "s (from " << this->current_pos_sec_ << "s to " << target_sec << "s)\n";
+    this->seek_to(target_sec);
+}
+
+void VideoDecoder::scan(int direction) {
+    if (this->connecting_.load() || this->reconnecting_) return;
+    if (!this->codec_ctx_ || !this->container_.format_ctx() || this->container_.is_live()) return;
+    if (this->container_.keyframe_index().empty()) {
+        std::cout << "[VideoDecoder] No keyframe index for " << this->source_ << ", cannot scan.\n";
+        return;
+    }
+    int speed = TrickPlay::next_speed(this->trick_play_.speed(), direction);
+    if (speed == 0) {
+        this->stop_scan();
+        return;
+    }
+
+    bool starting = !this->trick_play_.active();
+    double from_sec = starting ? this->current_pos_sec_ : this->trick_play_.position();
+    std::cout << "[VideoDecoder] Scanning " << (speed > 0 ? "forward" : "backward") << " at " << std::abs(speed)
+              << "x from " << from_sec << "s\n";
+    this->trick_play_.start(speed, from_sec);
+    if (!starting) return;
+
     {
+        // Nothing buffered for normal playback is shown while scanning
         std::lock_guard<std::mutex> lock(this->queue_mutex_);
-        // Clear queues
         while (!this->packet_queue_.empty()) { av_packet_free(&this->packet_queue_.front()); this->packet_queue_.pop_front(); }
-        while (!this->video_frame_queue_.empty()) { av_frame_free(&this->video_frame_queue_.front()); this->video_frame_queue_.pop_front(); }
+        while (!this->video_frame_queue_.empty()) { av_frame_free(&this->video_frame_queue_.front().frame); this->video_frame_queue_.pop_front(); }
         while (!this->audio_frame_queue_.empty()) { av_frame_free(&this->audio_frame_queue_.front()); this->audio_frame_queue_.pop_front(); }
-        
+        this->buffer_.clear_packets();
         this->eof_reached_ = false;
+        this->video_draining_ = false;
+        this->loop_boundaries_.clear();
+        this->skip_nonref_requested_ = false;
         this->audio_spillover_.clear();
-        this->audio_prebuffering_ = true;
-        this->video_start_time_ = -1.0;
-        this->last_frame_time_ = -1.0;
-        this->frames_rendered_ = 0;
-        this->seek_offset_sec_ = target_sec;
-        this->current_pos_sec_ = target_sec; 
-        this->is_seeking_ = true;
+        this->seek_video_until_ = AV_NOPTS_VALUE;
+        this->seek_audio_until_ = AV_NOPTS_VALUE;
+        this->is_seeking_ = false;
     }
-    
-    // For forward seek, using no flags can sometimes be better if we want to land near target.
-    // However, FFmpeg often needs BACKWARD to find a reliable start point.
-    av_seek_frame(this->container_.format_ctx(), -1, seek_target, AVSEEK_FLAG_BACKWARD);
     avcodec_flush_buffers(this->codec_ctx_);
+    // Anything that slips past the keyframe seek is dropped before it costs a decode
+    this->codec_ctx_->skip_frame = AVDISCARD_NONKEY;
+    this->skip_nonref_active_ = false;
     if (this->audio_codec_ctx_) {
         avcodec_flush_buffers(this->audio_codec_ctx_);
-        if (this->pcm_handle_) {
-            snd_pcm_drop(this->pcm_handle_);
-            snd_pcm_prepare(this->pcm_handle_);
+    }
+    if (this->audio_stream_) {
+        // Muted: the mixer skips a paused stream
+        this->audio_stream_->flush();
+        this->audio_stream_->set_paused(true);
+    }
+    this->scanning_ = true;
+}
+
+void VideoDecoder::stop_scan() {
+    if (!this->trick_play_.active()) return;
+    double position = this->trick_play_.position();
+    std::cout << "[VideoDecoder] Scan stopped, playing from " << position << "s\n";
+    this->seek_to(position); // Ends the scan
+}
+
+void VideoDecoder::end_scan() {
+    if (!this->trick_play_.active()) return;
+    this->trick_play_.stop();
+    this->scanning_ = false;
+    if (this->codec_ctx_) this->codec_ctx_->skip_frame = AVDISCARD_DEFAULT;
+    this->skip_nonref_active_ = false;
+    if (this->audio_stream_) {
+        this->audio_stream_->set_paused(this->is_paused_);
+    }
+}
+
+std::expected<void, MediaError> VideoDecoder::process_scan(double time_sec) {
+    const KeyframeIndex& index = this->container_.keyframe_index();
+    double duration = this->container_.format_ctx()->duration / (double)AV_TIME_BASE;
+    if (duration <= 0.0) duration = index.entries().back().time_sec;
+
+    const KeyframeEntry* keyframe = this->trick_play_.next_keyframe(index, time_sec, duration);
+    if (!keyframe) {
+        if (this->trick_play_.finished(index, time_sec, duration)) {
+            std::cout << "[VideoDecoder] Scan reached the " << (this->trick_play_.speed() > 0 ? "end" : "start") << ".\n";
+            this->stop_scan();
         }
+        return {};
+    }
+
+    AVFrame* frame = this->decode_keyframe(keyframe->time_sec);
+    if (!frame) return {}; // Unreadable keyframe: the scan moves on to the next one
+    if (!this->confirm_backend()) {
+        av_frame_free(&frame);
+        return {};
+    }
+    frame = this->backend_->postprocess(frame);
+    this->account_decoded_frame(frame);
+    std::lock_guard<std::mutex> lock(this->queue_mutex_);
+    // One keyframe at a time: a newer one replaces any render() hasn't taken yet,
+    // so a slow render skips keyframes instead of holding the scan back
+    while (!this->video_frame_queue_.empty()) {
+        av_frame_free(&this->video_frame_queue_.front().frame);
+        this->video_frame_queue_.pop_front();
     }
+    this->video_frame_queue_.push_back({frame, this->frames_queued_++});
+    this->scan_frame_sec_ = keyframe->time_sec;
+    return {};
 }
 
-void VideoDecoder::skip_backward(double seconds) {
-    if (!this->codec_ctx_ || !this->container_.format_ctx()) return;
-    
-    double target_sec = std::max(0.0, this->current_pos_sec_ - seconds);
-    int64_t seek_target = this->container_.format_ctx()->start_time + static_cast<int64_t>(target_sec * AV_TIME_BASE);
+AVFrame* VideoDecoder::decode_keyframe(double time_sec) {
+    this->container_.seek_to_keyframe(this->video_stream_index_, time_sec);
+    avcodec_flush_buffers(this->codec_ctx_);
+
+    // Audio and everything else up to the keyframe is never decoded while scanning
+    const AVPacket* keyframe = nullptr;
+    for (int i = 0; i < kMaxScanPackets && !keyframe; ++i) {
+        auto packet_res = this->container_.read_packet();
+        if (!packet_res) return nullptr;
+        const AVPacket* packet = packet_res.value();
+        if (packet->stream_index == this->video_stream_index_ && (packet->flags & AV_PKT_FLAG_KEY)) keyframe = packet;
+    }
+    if (!keyframe || avcodec_send_packet(this->codec_ctx_, keyframe) < 0) return nullptr;
+
+    // Drain at once: decoders that hold frames back for reordering or frame
+    // threading give up the keyframe without waiting for the packets after it
+    avcodec_send_packet(this->codec_ctx_, nullptr);
+    AVFrame* frame = av_frame_alloc();
+    int receive_res = avcodec_receive_frame(this->codec_ctx_, frame);
+    avcodec_flush_buffers(this->codec_ctx_); // Out of draining mode for the next keyframe
+    if (receive_res != 0) {
+        av_frame_free(&frame);
+        return nullptr;
+    }
+    return frame;
+}
+
+void VideoDecoder::seek_to(double target_sec) {
+    this->end_scan();
+    AVStream* v_stream = this->container_.format_ctx()->streams[this->video_stream_index_];
+    AVStream* a_stream = this->audio_stream_index_ >= 0 ? this->container_.format_ctx()->streams[this->audio_stream_index_] : nullptr;
+    auto to_stream_ts = [target_sec](const AVStream* st) {
+        int64_t start = st->start_time != AV_NOPTS_VALUE ? st->start_time : 0;
+        return start + av_rescale_q(static_cast<int64_t>(target_sec * AV_TIME_BASE), av_get_time_base_q(), st->time_base);
+    };
 
-    std::cout << "[VideoDecoder] Skipping backward " << seconds << "s (from " << this->current_pos_sec_ << "s to " << target_sec << "s)\n";
     {
         std::lock_guard<std::mutex> lock(this->queue_mutex_);
         // Clear queues
         while (!this->packet_queue_.empty()) { av_packet_free(&this->packet_queue_.front()); this->packet_queue_.pop_front(); }
-        while (!this->video_frame_queue_.empty()) { av_frame_free(&this->video_frame_queue_.front()); this->video_frame_queue_.pop_front(); }
+        while (!this->video_frame_queue_.empty()) { av_frame_free(&this->video_frame_queue_.front().frame); this->video_frame_queue_.pop_front(); }
         while (!this->audio_frame_queue_.empty()) { av_frame_free(&this->audio_frame_queue_.front()); this->audio_frame_queue_.pop_front(); }
-
+        this->buffer_.clear_packets();
+        
         this->eof_reached_ = false;
+        this->video_draining_ = false; // The flush below ends any loop drain
+        this->frames_queued_ = 0;
+        this->loop_boundaries_.clear();
+        this->skip_nonref_requested_ = false; // Nothing to catch up with at a new position
+        this->last_queued_ts_ = AV_NOPTS_VALUE;
         this->audio_spillover_.clear();
-        this->audio_prebuffering_ = true;
         this->video_start_time_ = -1.0;
         this->last_frame_time_ = -1.0;
         this->frames_rendered_ = 0;
         this->seek_offset_sec_ = target_sec;
         this->current_pos_sec_ = target_sec;
         this->is_seeking_ = true;
-    }
 
-    av_seek_frame(this->container_.format_ctx(), -1, seek_target, AVSEEK_FLAG_BACKWARD);
+        // Everything between the keyframe and the target is decoded (it is needed as
+        // reference) but never presented, so playback resumes exactly at target_sec
+        this->seek_video_until_ = to_stream_ts(v_stream);
+        this->seek_audio_until_ = a_stream ? to_stream_ts(a_stream) : AV_NOPTS_VALUE;
+        this->seek_frames_discarded_ = 0;
+    }
+    
+    // Jump straight to the closest preceding keyframe from the index built at load()
+    double keyframe_sec = this->container_.seek_to_keyframe(this->video_stream_index_, target_sec);
+    if (keyframe_sec < target_sec) {
+        std::cout << "[VideoDecoder] Seek landed on keyframe at " << keyframe_sec << "s, decoding "
+                  << (target_sec - keyframe_sec) << "s ahead to target.\n";
+    }
     avcodec_flush_buffers(this->codec_ctx_);
     if (this->audio_codec_ctx_) {
         avcodec_flush_buffers(this->audio_codec_ctx_);
-        if (this->pcm_handle_) {
-            snd_pcm_drop(this->pcm_handle_);
-            snd_pcm_prepare(this->pcm_handle_);
+        if (this->audio_stream_) {
+            this->audio_stream_->flush();
         }
     }
 }
 
+bool VideoDecoder::discard_before_seek_target(const AVFrame* frame) {
+    std::lock_guard<std::mutex> lock(this->queue_mutex_);
+    if (this->seek_video_until_ == AV_NOPTS_VALUE) return false;
+
+    int64_t pts = frame->best_effort_timestamp != AV_NOPTS_VALUE ? frame->best_effort_timestamp : frame->pts;
+    if (pts != AV_NOPTS_VALUE && pts < this->seek_video_until_) {
+        this->seek_frames_discarded_++;
+        this->frames_seek_discarded_++;
+        return true;
+    }
+    if (this->seek_frames_discarded_ > 0) {
+        std::cout << "[VideoDecoder] Precise seek: discarded " << this->seek_frames_discarded_ << " frames before target.\n";
+    }
+    this->seek_video_until_ = AV_NOPTS_VALUE;
+    return false;
+}
+
+namespace {
+// Marker queued behind the last packet of a loop iteration; never sent to a decoder
+char loop_marker_tag;
+bool is_loop_marker(const AVPacket* packet) { return packet->opaque == &loop_marker_tag; }
+}
+
+bool VideoDecoder::loop_to_start() {
+    // Only a single-item playlist loops in place; an iteration that yields no
+    // packets at all (unreadable file) ends playback as before
+    if (this->playlist_.size() != 1 || this->packets_since_loop_ == 0) return false;
+    this->packets_since_loop_ = 0;
+    this->container_.rewind();
+
+    // Each decoder drains its last frames and is flushed when it reaches the marker,
+    // so nothing of the next iteration is decoded against stale references
+    std::lock_guard<std::mutex> lock(this->queue_mutex_);
+    for (int stream : {this->video_stream_index_, this->audio_stream_index_}) {
+        if (stream < 0) continue;
+        AVPacket* marker = av_packet_alloc();
+        marker->stream_index = stream;
+        marker->opaque = &loop_marker_tag;
+        this->packet_queue_.push_back(marker);
+        this->buffer_.on_packet_queued(0, this->packet_seconds(marker), stream == this->video_stream_index_);
+    }
+    return true;
+}
+
+void VideoDecoder::configure_audio_conversion(AVSampleFormat out_fmt) {
+    const AVCodecContext* a = this->audio_codec_ctx_;
+    int out_rate = static_cast<int>(this->negotiated_rate_);
+    this->audio_out_fmt_ = out_fmt;
+    this->audio_frame_bytes_ = 2 * av_get_bytes_per_sample(out_fmt);
+
+    // Fast paths: the source already matches the device, only the layout may differ
+    if (a->ch_layout.nb_channels == 2 && a->sample_rate == out_rate && av_get_packed_sample_fmt(a->sample_fmt) == out_fmt) {
+        bool planar = av_sample_fmt_is_planar(a->sample_fmt);
+        this->audio_path_ = planar ? AudioPath::Interleave : AudioPath::Copy;
+        std::cout << "VideoDecoder: Audio " << av_get_sample_fmt_name(a->sample_fmt) << " " << out_rate
+                  << "Hz stereo matches the device: " << (planar ? "interleave only" : "direct copy") << ", no resampler\n";
+        return;
+    }
+
+    this->audio_path_ = AudioPath::Resample;
+    // Reuse the resampler from the previous playlist item when nothing changed
+    if (this->swr_ctx_ && this->swr_in_fmt_ == a->sample_fmt && this->swr_in_rate_ == a->sample_rate &&
+        this->swr_out_fmt_ == out_fmt && this->swr_out_rate_ == out_rate &&
+        av_channel_layout_compare(&this->swr_in_layout_, &a->ch_layout) == 0 &&
+        swr_init(this->swr_ctx_) >= 0) {
+        // swr_init() on the live context drops the samples and filter delay left from the previous item
+        std::cout << "VideoDecoder: Reusing SwrContext for " << av_get_sample_fmt_name(a->sample_fmt)
+                  << " (" << a->sample_rate << "Hz)\n";
+        return;
+    }
+    if (this->swr_ctx_) {
+        swr_free(&this->swr_ctx_);
+    }
+    av_channel_layout_uninit(&this->swr_in_layout_);
+
+    AVChannelLayout out_layout;
+    av_channel_layout_default(&out_layout, 2);
+    int swr_ret = swr_alloc_set_opts2(&this->swr_ctx_,
+        &out_layout, out_fmt, out_rate,
+        &a->ch_layout, a->sample_fmt, a->sample_rate,
+        0, nullptr);
+    av_channel_layout_uninit(&out_layout);
+
+    if (swr_ret == 0 && swr_init(this->swr_ctx_) == 0) {
+        av_channel_layout_copy(&this->swr_in_layout_, &a->ch_layout);
+        this->swr_in_fmt_ = a->sample_fmt;
+        this->swr_in_rate_ = a->sample_rate;
+        this->swr_out_fmt_ = out_fmt;
+        this->swr_out_rate_ = out_rate;
+        std::cout << "VideoDecoder: SwrContext initialized for " << av_get_sample_fmt_name(a->sample_fmt)
+                  << " (" << a->sample_rate << "Hz) -> " << av_get_sample_fmt_name(out_fmt) << " (" << out_rate << "Hz)\n";
+    } else if (this->swr_ctx_) {
+        swr_free(&this->swr_ctx_);
+    }
+}
+
+void VideoDecoder::append_audio_frame(const AVFrame* frame) {
+    // Decoded samples go straight into the tail of audio_spillover_, no staging buffer
+    size_t offset = this->audio_spillover_.size();
+    size_t samples = static_cast<size_t>(frame->nb_samples);
+
+    switch (this->audio_path_) {
+        case AudioPath::Copy:
+            this->audio_spillover_.resize(offset + samples * this->audio_frame_bytes_);
+            std::memcpy(this->audio_spillover_.data() + offset, frame->data[0], samples * this->audio_frame_bytes_);
+            break;
+        case AudioPath::Interleave:
+            this->audio_spillover_.resize(offset + samples * this->audio_frame_bytes_);
+            if (this->audio_out_fmt_ == AV_SAMPLE_FMT_FLT) {
+                interleave_stereo_f32(reinterpret_cast<const float*>(frame->data[0]), reinterpret_cast<const float*>(frame->data[1]),
+                                      reinterpret_cast<float*>(this->audio_spillover_.data() + offset), samples);
+            } else {
+                interleave_stereo_s16(reinterpret_cast<const int16_t*>(frame->data[0]), reinterpret_cast<const int16_t*>(frame->data[1]),
+                                      reinterpret_cast<int16_t*>(this->audio_spillover_.data() + offset), samples);
+            }
+            break;
+        case AudioPath::Resample: {
+            if (!this->swr_ctx_) return;
+            int64_t delay = swr_get_delay(this->swr_ctx_, this->audio_codec_ctx_->sample_rate);
+            int out_samples = av_rescale_rnd(delay + frame->nb_samples, this->negotiated_rate_, this->audio_codec_ctx_->sample_rate, AV_ROUND_UP);
+            this->audio_spillover_.resize(offset + static_cast<size_t>(out_samples) * this->audio_frame_bytes_);
+            uint8_t* out_data[1] = {this->audio_spillover_.data() + offset};
+            int converted = swr_convert(this->swr_ctx_, out_data, out_samples, (const uint8_t**)frame->data, frame->nb_samples);
+            this->audio_spillover_.resize(offset + static_cast<size_t>(std::max(converted, 0)) * this->audio_frame_bytes_);
+            if (converted < 0) {
+                char err_buf[AV_ERROR_MAX_STRING_SIZE];
+                av_strerror(converted, err_buf, sizeof(err_buf));
+                std::cerr << "VideoDecoder: swr_convert error: " << err_buf << "\n";
+            }
+            break;
+        }
+    }
+}
+
+double VideoDecoder::packet_seconds(const AVPacket* packet) const {
+    if (packet->duration > 0) {
+        return packet->duration * av_q2d(this->container_.get_stream_timebase(packet->stream_index));
+    }
+    // Some containers (MPEG-TS, raw streams) leave durations unset: assume one video frame
+    if (packet->stream_index == this->video_stream_index_ && this->codec_ctx_) {
+        double fps = av_q2d(this->codec_ctx_->framerate);
+        return fps > 0.0 ? 1.0 / fps : 0.0;
+    }
+    return 0.0;
+}
+
+BufferFill VideoDecoder::buffer_fill() const {
+    std::lock_guard<std::mutex> lock(this->queue_mutex_);
+    return this->buffer_.fill(this->video_frame_queue_.size());
+}
+
+void VideoDecoder::set_presentation_timing(double next_vblank_sec, double refresh_period_sec) {
+    std::lock_guard<std::mutex> lock(this->queue_mutex_);
+    this->next_vblank_sec_ = next_vblank_sec;
+    this->cadence_.set_refresh_period(refresh_period_sec);
+}
+
+CadenceStats VideoDecoder::cadence_stats() const {
+    std::lock_guard<std::mutex> lock(this->queue_mutex_);
+    return this->cadence_.stats();
+}
+
+FrameDropStats VideoDecoder::drop_stats() const {
+    FrameDropStats stats;
+    stats.dropped_late = this->frames_dropped_late_.load();
+    stats.skipped_nonref = this->frames_skipped_nonref_.load();
+    stats.seek_discarded = this->frames_seek_discarded_.load();
+    stats.import_failed = this->frames_import_failed_.load();
+    return stats;
+}
+
+double VideoDecoder::next_frame_sec() const {
+    std::lock_guard<std::mutex> lock(this->queue_mutex_);
+    if (this->video_frame_queue_.empty() || !this->container_.format_ctx()) return -1.0;
+    const AVFrame* frame = this->video_frame_queue_.front().frame;
+    int64_t pts = frame->best_effort_timestamp != AV_NOPTS_VALUE ? frame->best_effort_timestamp : frame->pts;
+    if (pts == AV_NOPTS_VALUE) return -1.0;
+    // Same origin as seek targets: relative to the stream's start time
+    const AVStream* st = this->container_.format_ctx()->streams[this->video_stream_index_];
+    int64_t start = st->start_time != AV_NOPTS_VALUE ? st->start_time : 0;
+    return (pts - start) * av_q2d(st->time_base);
+}
+
+VideoDecoderStats VideoDecoder::stats() const {
+    VideoDecoderStats s;
+    s.backend = this->backend_name();
+    s.hardware = this->active_hw_.load(std::memory_order_relaxed);
+    s.frames_decoded = this->decoded_frames_.load(std::memory_order_relaxed);
+    s.frames_presented = this->frames_presented_.load(std::memory_order_relaxed);
+    s.frames_late = this->frames_late_.load(std::memory_order_relaxed);
+    s.drops = this->drop_stats();
+    s.decoded_bytes_per_frame = this->decoded_bytes_per_frame();
+    s.fill = this->published_fill_.load();
+    s.queued_frame_bytes = s.fill.video_frames * s.decoded_bytes_per_frame;
+    s.cadence = this->published_cadence_.load();
+    s.decode = this->decode_latency_.summary();
+    s.import = this->import_latency_.summary();
+    s.audio = this->audio_attached_.load(std::memory_order_relaxed);
+    if (s.audio) {
+        s.audio_buffer_ms = this->audio_buffer_ms_.load(std::memory_order_relaxed);
+        s.audio_underruns = this->audio_underruns_.load(std::memory_order_relaxed);
+        s.audio_recoveries = AudioMixer::shared().recoveries();
+        s.av_offset_ms = this->av_offset_ms_.load(std::memory_order_relaxed);
+    }
+    s.io = this->io_stats();
+    return s;
+}
+
+void VideoDecoder::set_network_options(const NetworkSourceOptions& options) {
+    this->network_options_ = options;
+    this->container_.set_network_options(options);
+}
+
 std::expected<void, MediaError> VideoDecoder::load(const std::string& filepath) {
+    return this->load_source(filepath, 0.0);
+}
+
+std::expected<void, MediaError> VideoDecoder::load_source(const std::string& filepath, double start_sec) {
     std::cout << "VideoDecoder: Loading " << filepath << std::endl;
+    // A connect attempt still running on the decode thread gives up instead of holding us up
+    this->container_.interrupt();
+    std::lock_guard<std::mutex> connect_lock(this->connect_mutex_);
+    this->container_.clear_interrupt();
     this->cleanup_codec();
-    
+    if (this->suspended_) {
+        this->suspended_ = false;
+        if (!this->current_audio_device_.empty()) this->init_audio(this->current_audio_device_);
+    }
+
+    this->source_ = filepath;
+    this->start_pos_sec_ = start_sec;
+    this->network_source_ = is_network_source(filepath);
+    this->connecting_ = false;
+    this->source_failed_ = false;
+    this->reconnecting_ = false;
+    this->reconnects_ = 0;
+    this->backoff_ = ReconnectBackoff(this->network_options_.reconnect_min_ms, this->network_options_.reconnect_max_ms);
+    this->last_video_dts_ = AV_NOPTS_VALUE;
+    this->last_audio_dts_ = AV_NOPTS_VALUE;
+    this->resume_video_after_ = AV_NOPTS_VALUE;
+    this->resume_audio_after_ = AV_NOPTS_VALUE;
+    {
+        std::lock_guard<std::mutex> lock(this->queue_mutex_);
+        this->prebuffering_ = false;
+        // The demux queue has to be able to hold the whole jitter buffer
+        this->buffer_.set_min_duration(this->network_source_ ? this->network_options_.jitter_buffer_ms / 1000.0 : 0.0);
+    }
+
+    if (this->network_source_) {
+        // Connecting and probing can take seconds: process() does it on the decode thread
+        this->can_skip_source_ = this->playlist_.size() > 1;
+        this->next_attempt_ = std::chrono::steady_clock::time_point{};
+        this->connecting_ = true;
+        return {};
+    }
+    auto res = this->open_source(filepath);
+    if (res) this->seek_to_start_position();
+    return res;
+}
+
+void VideoDecoder::seek_to_start_position() {
+    double start_sec = std::exchange(this->start_pos_sec_, 0.0);
+    if (start_sec <= 0.0 || !this->codec_ctx_ || this->container_.is_live()) return;
+    double duration = this->container_.format_ctx()->duration / (double)AV_TIME_BASE;
+    if (duration > 0 && start_sec >= duration) return;
+    this->seek_to(start_sec);
+}
+
+bool VideoDecoder::connect_source() {
+    std::lock_guard<std::mutex> connect_lock(this->connect_mutex_);
+    if (!this->connecting_ || this->source_failed_ || std::chrono::steady_clock::now() < this->next_attempt_) {
+        return false;
+    }
+
+    if (this->open_source(this->source_)) {
+        this->backoff_.reset();
+        this->seek_to_start_position();
+        {
+            std::lock_guard<std::mutex> lock(this->queue_mutex_);
+            this->prebuffering_ = true;
+        }
+        std::cout << "[VideoDecoder] Connected to " << this->source_ << "\n";
+        this->connecting_ = false; // Publishes the decoder state to render()
+        return true;
+    }
+
+    // render() has shown nothing from this source, so no GL resources are freed here
+    this->cleanup_codec();
+    auto delay = this->backoff_.next_delay();
+    this->next_attempt_ = std::chrono::steady_clock::now() + delay;
+    if (this->can_skip_source_ && this->backoff_.attempts() >= kMaxConnectAttempts) {
+        std::cerr << "[VideoDecoder] Giving up on " << this->source_ << " after "
+                  << this->backoff_.attempts() << " attempts.\n";
+        this->source_failed_ = true;
+    } else {
+        std::cerr << "[VideoDecoder] Could not open " << this->source_ << ", retrying in " << delay.count() << " ms.\n";
+    }
+    return false;
+}
+
+void VideoDecoder::begin_reconnect() {
+    auto delay = this->backoff_.next_delay();
+    this->next_attempt_ = std::chrono::steady_clock::now() + delay;
+    this->reconnecting_ = true;
+    std::cerr << "[VideoDecoder] " << this->source_ << (this->container_.at_eof() ? " ended" : " stalled")
+              << ", reconnecting in " << delay.count() << " ms.\n";
+}
+
+void VideoDecoder::reconnect_source() {
+    std::lock_guard<std::mutex> connect_lock(this->connect_mutex_);
+    if (!this->reconnecting_ || std::chrono::steady_clock::now() < this->next_attempt_) return;
+
+    // Only the connection is replaced: codec, texture and mixer stream carry on
+    if (!this->container_.open(this->source_)) {
+        auto delay = this->backoff_.next_delay();
+        this->next_attempt_ = std::chrono::steady_clock::now() + delay;
+        if (this->can_skip_source_ && this->backoff_.attempts() >= kMaxConnectAttempts) {
+            std::cerr << "[VideoDecoder] Giving up on " << this->source_ << " after "
+                      << this->backoff_.attempts() << " attempts.\n";
+            std::lock_guard<std::mutex> lock(this->queue_mutex_);
+            this->reconnecting_ = false;
+            this->eof_reached_ = true;
+        } else {
+            std::cerr << "[VideoDecoder] Reconnect to " << this->source_ << " failed, retrying in " << delay.count() << " ms.\n";
+        }
+        return;
+    }
+
+    AVCodecParameters* params = this->container_.get_codec_params(this->video_stream_index_);
+    bool same_layout = this->container_.find_video_stream() == this->video_stream_index_ && params &&
+                       params->codec_id == this->codec_ctx_->codec_id &&
+                       (!this->audio_codec_ctx_ || this->container_.find_audio_stream() == this->audio_stream_index_);
+    if (!same_layout) {
+        // Finish this item instead; the next load() sets everything up for the new stream
+        std::cerr << "[VideoDecoder] " << this->source_ << " came back with different streams, reloading.\n";
+        std::lock_guard<std::mutex> lock(this->queue_mutex_);
+        this->reconnecting_ = false;
+        this->eof_reached_ = true;
+        return;
+    }
+
+    if (!this->container_.is_live() && this->last_video_dts_ != AV_NOPTS_VALUE) {
+        // Progressive download: continue where the old connection stopped
+        AVStream* st = this->container_.format_ctx()->streams[this->video_stream_index_];
+        int64_t start = st->start_time != AV_NOPTS_VALUE ? st->start_time : 0;
+        this->container_.build_keyframe_index(this->video_stream_index_);
+        this->container_.seek_to_keyframe(this->video_stream_index_, (this->last_video_dts_ - start) * av_q2d(st->time_base));
+        this->resume_video_after_ = this->last_video_dts_;
+        this->resume_audio_after_ = this->last_audio_dts_;
+    }
+
+    this->backoff_.reset();
+    this->reconnecting_ = false;
+    this->reconnects_++;
+    {
+        std::lock_guard<std::mutex> lock(this->queue_mutex_);
+        this->stream_timebase_ = this->container_.get_stream_timebase(this->video_stream_index_);
+    }
+    std::cout << "[VideoDecoder] Reconnected to " << this->source_ << " (" << this->reconnects_ << " so far).\n";
+}
+
+bool VideoDecoder::already_demuxed(const AVPacket* packet) {
+    bool is_video = packet->stream_index == this->video_stream_index_;
+    if (!is_video && packet->stream_index != this->audio_stream_index_) return false;
+    // DTS rises in demux order, PTS doesn't with B-frames
+    int64_t ts = packet->dts != AV_NOPTS_VALUE ? packet->dts : packet->pts;
+    if (ts == AV_NOPTS_VALUE) return false;
+
+    int64_t& resume_after = is_video ? this->resume_video_after_ : this->resume_audio_after_;
+    if (resume_after != AV_NOPTS_VALUE) {
+        if (ts <= resume_after) return true;
+        resume_after = AV_NOPTS_VALUE;
+    }
+    (is_video ? this->last_video_dts_ : this->last_audio_dts_) = ts;
+    return false;
+}
+
+std::expected<void, MediaError> VideoDecoder::open_source(const std::string& filepath) {
     auto open_res = this->container_.open(filepath);
     if (!open_res) return open_res;
 
@@ -279,39 +855,12 @@ std::expected<void, MediaError> VideoDecoder::load(const std::string& filepath)
         return std::unexpected(MediaError::UnsupportedFormat);
     }
 
-    AVCodecParameters* codec_params = this->container_.get_codec_params(this->video_stream_index_);
+    // Keyframe positions for precise seeking (cached across reloads of the same file)
+    this->container_.build_keyframe_index(this->video_stream_index_);
+
     this->stream_timebase_ = this->container_.get_stream_timebase(this->video_stream_index_);
-    this->codec_ = const_cast<AVCodec*>(avcodec_find_decoder(codec_params->codec_id));
-    
-    if (this->codec_) {
-        this->codec_ctx_ = avcodec_alloc_context3(this->codec_);
-        avcodec_parameters_to_context(this->codec_ctx_, codec_params);
-        
-        // Setup hardware decoding if context is available
-        if (this->hw_device_ctx_) {
-            this->codec_ctx_->hw_device_ctx = av_buffer_ref(this->hw_device_ctx_);
-            this->codec_ctx_->get_format = [](AVCodecContext* ctx, const enum AVPixelFormat* pix_fmts) -> enum AVPixelFormat {
-                for (const enum AVPixelFormat* p = pix_fmts; *p != AV_PIX_FMT_NONE; p++) {
-                    if (*p == AV_PIX_FMT_VAAPI) {
-                        return *p;
-                    }
-                }
-                std::cerr << "VideoDecoder: VAAPI pixel format not supported by decoder. Falling back to software.\n";
-                // CRITICAL: If we fallback to software, we MUST clear the hw_device_ctx
-                // Otherwise FFmpeg tries to allocate VA-API surfaces for a software decoder, causing get_buffer() failures.
-                av_buffer_unref(&ctx->hw_device_ctx);
-                return pix_fmts[0];
-            };
-            // Headroom for internal queueing + reference frames
-            this->codec_ctx_->extra_hw_frames = 32;
-        }
-        
-        if (avcodec_open2(this->codec_ctx_, this->codec_, nullptr) < 0) {
-            return std::unexpected(MediaError::DecodeFailed);
-        }
-    } else {
-        return std::unexpected(MediaError::UnsupportedFormat);
-    }
+    auto codec_res = this->open_video_codec(0);
+    if (!codec_res) return codec_res;
     
     // Setup audio decoder if enabled
     if (this->audio_enabled_) {
@@ -324,66 +873,11 @@ std::expected<void, MediaError> VideoDecoder::load(const std::string& filepath)
             if (a_codec) {
                 this->audio_codec_ctx_ = avcodec_alloc_context3(a_codec);
                 avcodec_parameters_to_context(this->audio_codec_ctx_, a_params);
-                if (avcodec_open2(this->audio_codec_ctx_, a_codec, nullptr) == 0 && this->pcm_handle_) {
+                if (avcodec_open2(this->audio_codec_ctx_, a_codec, nullptr) == 0 && this->audio_stream_) {
                     this->audio_spillover_.clear();
-                    // ... (rest of init)
-                    // HDMI strictly prefers 48000Hz Stereo
-                    int channels = 2; 
-                    unsigned int rate = 48000;
-                    std::cout << "VideoDecoder: Initializing ALSA PCM for " << rate << "Hz, " << channels << " channels (FORCED)\n";
-                    
-                    snd_pcm_hw_params_t *params;
-                    snd_pcm_hw_params_alloca(&params);
-                    snd_pcm_hw_params_any(this->pcm_handle_, params);
-                    snd_pcm_hw_params_set_access(this->pcm_handle_, params, SND_PCM_ACCESS_RW_INTERLEAVED);
-                    int dir = 0;
-                    // We are converting everything to S16 interleaved via swr_convert
-                    snd_pcm_hw_params_set_format(this->pcm_handle_, params, SND_PCM_FORMAT_S16_LE);
-                    snd_pcm_hw_params_set_channels(this->pcm_handle_, params, channels);
-                    snd_pcm_hw_params_set_rate_near(this->pcm_handle_, params, &rate, &dir);
-                    
-                    // Set buffer and period sizes for smoother playback at ~30fps
-                    // Increase buffer size to 1.5s to be extremely resilient to video thread decode spikes
-                    snd_pcm_uframes_t buffer_size = rate + (rate / 2); // 1.5 seconds (72000 samples at 48k)
-                    snd_pcm_hw_params_set_buffer_size_near(this->pcm_handle_, params, &buffer_size);
-                    // 0.1s period
-                    snd_pcm_uframes_t period_size = rate / 10;
-                    snd_pcm_hw_params_set_period_size_near(this->pcm_handle_, params, &period_size, &dir);
-                    
-                    int hw_err = snd_pcm_hw_params(this->pcm_handle_, params);
-                    if (hw_err < 0) {
-                        std::cerr << "ALSA: FATAL: Failed to apply hardware parameters: " << snd_strerror(hw_err) << "\n";
-                        snd_pcm_close(this->pcm_handle_);
-                        this->pcm_handle_ = nullptr;
-                    } else {
-                        // Configure Software Parameters to fix playback stalling
-                        snd_pcm_sw_params_t *sw_params;
-                        snd_pcm_sw_params_alloca(&sw_params);
-                        snd_pcm_sw_params_current(this->pcm_handle_, sw_params);
-                        
-                        // Start playback as soon as we write ANY data (we manually pre-buffer 0.2s before the first write anyway)
-                        snd_pcm_sw_params_set_start_threshold(this->pcm_handle_, sw_params, 1);
-                        // Minimum available frames to consider ALSA ready for writing
-                        snd_pcm_sw_params_set_avail_min(this->pcm_handle_, sw_params, period_size);
-                        
-                        snd_pcm_sw_params(this->pcm_handle_, sw_params);
-    
-                        // Initialize SwrContext for conversion to S16 interleaved Stereo
-                        AVChannelLayout out_layout;
-                        av_channel_layout_default(&out_layout, 2);
-                        int swr_ret = swr_alloc_set_opts2(&this->swr_ctx_,
-                            &out_layout, AV_SAMPLE_FMT_S16, (int)rate,
-                            &this->audio_codec_ctx_->ch_layout, this->audio_codec_ctx_->sample_fmt, this->audio_codec_ctx_->sample_rate,
-                            0, nullptr);
-                        av_channel_layout_uninit(&out_layout);
-                        
-                        if (swr_ret == 0) {
-                            this->negotiated_rate_ = rate;
-                            swr_init(this->swr_ctx_);
-                            std::cout << "VideoDecoder: SwrContext initialized for " << av_get_sample_fmt_name(this->audio_codec_ctx_->sample_fmt) 
-                                      << " (" << this->audio_codec_ctx_->sample_rate << "Hz) -> S16 (" << this->negotiated_rate_ << "Hz)\n";
-                        }
-                    }
+                    // The shared mixer owns the device; convert to its format and rate
+                    this->negotiated_rate_ = this->audio_stream_->rate();
+                    this->configure_audio_conversion(this->audio_stream_->is_float() ? AV_SAMPLE_FMT_FLT : AV_SAMPLE_FMT_S16);
                 }
             }
         }
@@ -393,37 +887,148 @@ std::expected<void, MediaError> VideoDecoder::load(const std::string& filepath)
     return {};
 }
 
+std::expected<void, MediaError> VideoDecoder::open_video_codec(size_t first) {
+    if (this->backends_.empty()) {
+        // init_backends() was never called (headless tools, tests): plain software decode
+        this->backends_.push_back(DecodeBackend::create(DecodeBackendKind::Software));
+    }
+    AVCodecParameters* codec_params = this->container_.get_codec_params(this->video_stream_index_);
+    MediaError error = MediaError::UnsupportedFormat;
+
+    for (size_t i = first; i < this->backends_.size(); ++i) {
+        DecodeBackend* backend = this->backends_[i].get();
+        const AVCodec* codec = backend->find_decoder(codec_params);
+        if (!codec) continue; // Nothing for this codec on this backend
+
+        this->codec_ctx_ = avcodec_alloc_context3(codec);
+        avcodec_parameters_to_context(this->codec_ctx_, codec_params);
+        this->scale_plan_ = plan_decode_scale(codec_params->width, codec_params->height,
+                                              this->target_w_, this->target_h_, codec->max_lowres);
+        DecodeSetup setup;
+        setup.scale = this->scale_plan_;
+        setup.queued_frames = static_cast<int>(this->buffer_.profile().max_video_frames);
+        // Headroom beyond the codec's reference frames: the decoded-frame queue plus the
+        // presented and mapped frame. Never more than the DecodeScheduler granted.
+        setup.extra_hw_frames = std::min(this->surface_budget_, setup.queued_frames + 2);
+        backend->configure(this->codec_ctx_, setup);
+
+        if (avcodec_open2(this->codec_ctx_, codec, nullptr) < 0) {
+            std::cerr << "VideoDecoder: " << backend->name() << " could not open " << codec->name << ", trying the next backend.\n";
+            avcodec_free_context(&this->codec_ctx_);
+            backend->reset();
+            error = MediaError::DecodeFailed;
+            continue;
+        }
+        this->codec_ = const_cast<AVCodec*>(codec);
+        this->backend_ = backend;
+        this->backend_index_ = i;
+        this->backend_confirmed_ = false;
+        this->active_backend_ = backend->name();
+        this->active_hw_ = backend->is_hardware();
+        std::cout << "VideoDecoder: Decoding " << avcodec_get_name(codec_params->codec_id) << " with "
+                  << codec->name << " (" << backend->name() << ").\n";
+        return {};
+    }
+    std::cerr << "VideoDecoder: No decode backend can handle " << avcodec_get_name(codec_params->codec_id) << ".\n";
+    return std::unexpected(error);
+}
+
+void VideoDecoder::apply_backend_fallback() {
+    if (!this->fallback_pending_.exchange(false) || !this->codec_ctx_ || !this->backend_) return;
+    this->fall_back_backend();
+}
+
+bool VideoDecoder::confirm_backend() {
+    if (this->backend_confirmed_) return true;
+    this->backend_confirmed_ = true;
+    if (!this->backend_->active(this->codec_ctx_) && this->backend_index_ + 1 < this->backends_.size()) {
+        this->fallback_pending_ = true;
+        return false;
+    }
+    this->active_hw_ = this->is_hw_accelerated();
+    return true;
+}
+
+void VideoDecoder::fall_back_backend() {
+    std::cerr << "VideoDecoder: " << this->backend_->name() << " dropped the stream, reopening with the next backend.\n";
+    avcodec_free_context(&this->codec_ctx_);
+    this->backend_->reset();
+    this->backend_ = nullptr;
+    if (!this->open_video_codec(this->backend_index_ + 1)) {
+        this->next_video();
+        return;
+    }
+    if (this->scanning_) {
+        // process_scan() seeks to each keyframe itself; the new codec only needs to skip the rest
+        this->codec_ctx_->skip_frame = AVDISCARD_NONKEY;
+        return;
+    }
+    // Start over from the closest keyframe, like a skip to the current position
+    if (!this->container_.is_live()) {
+        this->seek_to(std::max(0.0, this->current_pos_sec_));
+    }
+}
+
 void VideoDecoder::set_audio_enabled(bool enabled) {
     this->audio_enabled_ = enabled;
 }
 
+void VideoDecoder::set_surface_budget(int surfaces) {
+    // Takes effect on the next load()
+    this->surface_budget_ = std::max(1, surfaces);
+}
+
+void VideoDecoder::set_target_size(int width, int height) {
+    this->target_w_ = std::max(0, width);
+    this->target_h_ = std::max(0, height);
+}
+
+uint64_t VideoDecoder::decoded_bytes_per_frame() const {
+    uint64_t frames = this->decoded_frames_.load(std::memory_order_relaxed);
+    return frames ? this->decoded_bytes_.load(std::memory_order_relaxed) / frames : 0;
+}
+
+void VideoDecoder::account_decoded_frame(const AVFrame* frame) {
+    // Hardware frames report their surface layout through the frames context
+    AVPixelFormat fmt = static_cast<AVPixelFormat>(frame->format);
+    if (frame->hw_frames_ctx) {
+        fmt = reinterpret_cast<AVHWFramesContext*>(frame->hw_frames_ctx->data)->sw_format;
+    } else if (fmt == AV_PIX_FMT_DRM_PRIME) {
+        fmt = AV_PIX_FMT_NV12;
+    }
+    int bytes = av_image_get_buffer_size(fmt, frame->width, frame->height, 1);
+    if (bytes > 0) {
+        this->decoded_bytes_.fetch_add(static_cast<uint64_t>(bytes), std::memory_order_relaxed);
+        this->decoded_frames_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
 void VideoDecoder::init_audio(const std::string& device_name) {
     this->current_audio_device_ = device_name;
-    if (this->pcm_handle_) {
-        snd_pcm_close(this->pcm_handle_);
-        this->pcm_handle_ = nullptr;
-    }
-
-    std::cout << "Initializing ALSA VideoDecoder Audio Device (Non-blocking): " << device_name << "\n";
-    // Using SND_PCM_NONBLOCK to ensure we don't freeze the main display loop if the audio buffer is full
-    int err = snd_pcm_open(&this->pcm_handle_, device_name.c_str(), SND_PCM_STREAM_PLAYBACK, SND_PCM_NONBLOCK);
-    if (err < 0) {
-        std::cerr << "ALSA: Cannot open audio device " << device_name << ": " << snd_strerror(err) << "\n";
-        
-        // Strategy: if 'default' fails due to dmix/slave issues, try hardware directly
-        // Card 0 Device 3 is ARZOPA (common display)
-        std::vector<std::string> fallbacks = {"plughw:0,3", "plughw:0,7", "plughw:0,8", "plughw:0,0", "default"};
-        for (const auto& fb : fallbacks) {
-            if (fb == device_name) continue;
-            std::cout << "ALSA: Trying fallback device '" << fb << "'...\n";
-            err = snd_pcm_open(&this->pcm_handle_, fb.c_str(), SND_PCM_STREAM_PLAYBACK, SND_PCM_NONBLOCK);
-            if (err >= 0) {
-                std::cout << "ALSA: Successfully opened fallback device '" << fb << "'\n";
-                return;
-            }
-            std::cerr << "ALSA: Fallback to '" << fb << "' failed: " << snd_strerror(err) << "\n";
-        }
-        this->pcm_handle_ = nullptr;
+    if (this->audio_stream_) {
+        AudioMixer::shared().remove_stream(this->audio_stream_);
+        this->audio_stream_.reset();
+    }
+
+    // One process-wide mixer owns the PCM handle; every audio-enabled region is a stream on it
+    this->audio_stream_ = AudioMixer::shared().add_stream(device_name);
+    if (!this->audio_stream_) return;
+    this->audio_stream_->set_gain(this->audio_gain_);
+    this->audio_stream_->set_ducking(this->audio_ducking_);
+    this->audio_stream_->set_paused(this->is_paused_);
+    if (this->audio_codec_ctx_) {
+        // Reopened after load(): the codec is already running
+        this->negotiated_rate_ = this->audio_stream_->rate();
+        this->configure_audio_conversion(this->audio_stream_->is_float() ? AV_SAMPLE_FMT_FLT : AV_SAMPLE_FMT_S16);
+    }
+}
+
+void VideoDecoder::set_audio_mix(float gain, bool ducking) {
+    this->audio_gain_ = gain;
+    this->audio_ducking_ = ducking;
+    if (this->audio_stream_) {
+        this->audio_stream_->set_gain(gain);
+        this->audio_stream_->set_ducking(ducking);
     }
 }
 
@@ -435,16 +1040,9 @@ void VideoDecoder::set_paused(bool paused, double time_sec) {
         this->is_paused_ = true;
         this->pause_start_time_ = time_sec;
         
-        if (this->pcm_handle_) {
-            // Try to pause audio hardware playback immediately
-            int err = snd_pcm_pause(this->pcm_handle_, 1);
-            if (err < 0) {
-                // If hardware pause is not supported, drop the buffer entirely
-                // to stop audio immediately as requested.
-                std::cout << "[VideoDecoder] ALSA pause not supported (" << snd_strerror(err) 
-                          << "). Dropping PCM buffer.\n";
-                snd_pcm_drop(this->pcm_handle_);
-            }
+        if (this->audio_stream_) {
+            // The mixer skips paused streams and keeps their queued samples
+            this->audio_stream_->set_paused(true);
         }
     } else {
         std::cout << "[VideoDecoder] Resuming playback at " << time_sec << "s\n";
@@ -456,64 +1054,177 @@ void VideoDecoder::set_paused(bool paused, double time_sec) {
         this->is_paused_ = false;
         this->pause_start_time_ = -1.0;
         
-        if (this->pcm_handle_) {
-            int err = snd_pcm_pause(this->pcm_handle_, 0);
-            if (err < 0) {
-                // If it was dropped, we need to prepare it again.
-                // snd_pcm_prepare is safe even if it wasn't dropped.
-                snd_pcm_prepare(this->pcm_handle_);
-                this->audio_prebuffering_ = true; // Refill prebuffer after drop
-            }
+        if (this->audio_stream_) {
+            this->audio_stream_->set_paused(false);
         }
     }
 }
 
+void VideoDecoder::suspend() {
+    if (this->suspended_ || !this->is_loaded()) return;
+    // Live sources come back at the live edge; files and downloads on the frame they left
+    this->suspended_pos_sec_ = this->container_.is_live() ? 0.0 : std::max(0.0, this->current_pos_sec_);
+    std::cout << "[VideoDecoder] Suspending " << this->source_ << " at " << this->suspended_pos_sec_ << "s\n";
+
+    this->container_.interrupt();
+    std::lock_guard<std::mutex> connect_lock(this->connect_mutex_);
+    this->container_.clear_interrupt();
+    this->connecting_ = false;
+    this->reconnecting_ = false;
+    this->cleanup_codec();
+    // The presented frame holds a reference on the decoder's surface pool
+    if (this->drm_frame_) av_frame_unref(this->drm_frame_);
+    av_frame_unref(this->hw_frame_);
+    this->container_.close();
+    if (this->audio_stream_) {
+        // The mixer closes the ALSA device once its last stream is gone
+        AudioMixer::shared().remove_stream(this->audio_stream_);
+        this->audio_stream_.reset();
+    }
+    this->suspended_ = true;
+}
+
+void VideoDecoder::resume() {
+    if (!this->suspended_ || this->source_.empty()) return;
+    std::cout << "[VideoDecoder] Resuming " << this->source_ << " at " << this->suspended_pos_sec_ << "s\n";
+    if (!this->load_source(this->source_, this->suspended_pos_sec_) && this->playlist_.size() > 1) {
+        // The file went away while suspended: carry on with the rest of the playlist
+        this->next_video();
+    }
+}
+
 std::expected<void, MediaError> VideoDecoder::process(double time_sec) {
-    (void)time_sec;
+    // Network source not open yet: connect when the backoff allows, nothing to decode until then
+    if (this->connecting_.load() && !this->connect_source()) return {};
     if (!this->codec_ctx_ || this->is_paused_) return {};
+    // Nothing more to decode with a backend that gave up; the render thread reopens the codec
+    if (this->fallback_pending_.load()) return {};
+    if (this->reconnecting_) this->reconnect_source();
+    if (this->scanning_) {
+        auto scan_res = this->process_scan(time_sec);
+        this->published_io_.publish(this->container_.io_stats());
+        if (this->audio_stream_ && this->negotiated_rate_ > 0) {
+            // Muted: scan() flushed the stream and nothing is converted until playback resumes
+            double queued_sec = static_cast<double>(this->audio_stream_->queued_frames()) / this->negotiated_rate_;
+            this->audio_buffer_ms_.store(queued_sec * 1000.0, std::memory_order_relaxed);
+        }
+        return scan_res;
+    }
 
     // 1. Buffer Management: Refill queues if they are running low
     // 1a. Fill Packet Queue from Container
+    auto demux_start = std::chrono::steady_clock::now();
     while (true) {
         {
             std::lock_guard<std::mutex> lock(this->queue_mutex_);
-            if (this->packet_queue_.size() >= this->max_packets_ || this->eof_reached_) break;
+            if (this->buffer_.packets_full() || this->eof_reached_) break;
+        }
+        if (this->reconnecting_) break;
+        // Network reads wait for data to arrive: leave the rest of this call to decoding
+        if (this->network_source_ &&
+            std::chrono::steady_clock::now() - demux_start > std::chrono::duration<double>(kNetworkDemuxBudgetSec)) {
+            break;
         }
         
         auto packet_res = this->container_.read_packet();
         if (!packet_res) {
+            // A live stream never ends, and a dropped download isn't the end of the file either
+            if (this->network_source_ && (this->container_.is_live() || !this->container_.at_eof())) {
+                this->begin_reconnect();
+                break;
+            }
+            if (this->loop_to_start()) continue;
             std::lock_guard<std::mutex> lock(this->queue_mutex_);
             this->eof_reached_ = true;
             break;
         }
+        if (this->network_source_ && this->already_demuxed(packet_res.value())) continue;
         AVPacket* packet = av_packet_clone(packet_res.value());
+        this->packets_since_loop_++;
+        double packet_sec = this->packet_seconds(packet);
+        bool is_video = packet->stream_index == this->video_stream_index_;
         {
             std::lock_guard<std::mutex> lock(this->queue_mutex_);
             this->packet_queue_.push_back(packet);
+            this->buffer_.observe_demuxed(packet->size, is_video ? packet_sec : 0.0);
+            this->buffer_.on_packet_queued(packet->size, packet_sec, is_video);
             this->is_seeking_ = false; // Successfully read a packet after seek
         }
     }
+    // Read-ahead counters for stats(), published here so readers never touch the container
+    this->published_io_.publish(this->container_.io_stats());
     
+    auto decode_start = std::chrono::steady_clock::now();
+    int frames_decoded = 0;
+
+    // Catch-up requested by render(): skip non-reference frames until it is back on time
+    bool skip_nonref = this->skip_nonref_requested_.load();
+    if (skip_nonref != this->skip_nonref_active_) {
+        this->codec_ctx_->skip_frame = skip_nonref ? AVDISCARD_NONREF : AVDISCARD_DEFAULT;
+        this->skip_nonref_active_ = skip_nonref;
+    }
+
     // 1b. Decode Packets into Frame Queues
     // Unconditionally drain the decoder FIRST to free internal hardware buffers.
     while (true) {
         bool space_available = false;
         {
             std::lock_guard<std::mutex> lock(this->queue_mutex_);
-            space_available = (this->video_frame_queue_.size() < this->max_video_frames_);
+            space_available = (this->video_frame_queue_.size() < this->buffer_.video_frame_limit());
         }
         if (!space_available) break;
 
         AVFrame* frame = av_frame_alloc();
+        auto receive_start = std::chrono::steady_clock::now();
         int receive_res = avcodec_receive_frame(this->codec_ctx_, frame);
+        this->decode_busy_sec_ += std::chrono::duration<double>(std::chrono::steady_clock::now() - receive_start).count();
         if (receive_res == 0) {
+            frames_decoded++;
+            if (this->discard_before_seek_target(frame)) {
+                // Decode-and-discard towards a precise seek target: never presented
+                av_frame_free(&frame);
+                this->packets_sent_without_frame_ = 0;
+                this->decode_busy_sec_ = 0.0;
+                continue;
+            }
+            if (!this->confirm_backend()) {
+                av_frame_free(&frame);
+                return {};
+            }
+            int64_t frame_ts = frame->best_effort_timestamp;
+            frame = this->backend_->postprocess(frame);
+            this->decode_latency_.record(this->decode_busy_sec_);
+            this->decode_busy_sec_ = 0.0;
+            this->account_decoded_frame(frame);
             this->packets_sent_without_frame_ = 0; // Reset on successful decode
             this->get_buffer_retry_count_ = 0; // Reset on success
             this->decoding_failure_count_ = 0;
             std::lock_guard<std::mutex> lock(this->queue_mutex_);
-            this->video_frame_queue_.push_back(frame);
+            int64_t index = this->frames_queued_;
+            if (this->skip_nonref_active_ && frame_ts != AV_NOPTS_VALUE && this->last_queued_ts_ != AV_NOPTS_VALUE) {
+                // Frames the decoder skipped keep their slot on the timeline
+                double fps = av_q2d(this->codec_ctx_->framerate);
+                double gap = (frame_ts - this->last_queued_ts_) * av_q2d(this->container_.get_stream_timebase(this->video_stream_index_)) * fps;
+                int64_t skipped = std::clamp<int64_t>(std::llround(gap) - 1, 0, 15);
+                index += skipped;
+                this->frames_skipped_nonref_ += skipped;
+            }
+            this->last_queued_ts_ = frame_ts;
+            this->video_frame_queue_.push_back({frame, index});
+            this->frames_queued_ = index + 1;
         } else {
             av_frame_free(&frame);
+            if (receive_res == AVERROR_EOF && this->video_draining_) {
+                // Loop drain finished: every frame of the last iteration is queued.
+                // Same codec, surfaces and GL state carry on into the next one.
+                avcodec_flush_buffers(this->codec_ctx_);
+                this->video_draining_ = false;
+                uint64_t loops = ++this->loops_completed_;
+                std::lock_guard<std::mutex> lock(this->queue_mutex_);
+                this->loop_boundaries_.push_back(this->frames_queued_);
+                std::cout << "VideoDecoder: Loop " << loops << " complete, continuing from start.\n";
+                break;
+            }
             if (receive_res == AVERROR(EAGAIN) || receive_res == AVERROR_EOF) {
                 break; // Decoder is empty or EOF
             }
@@ -529,10 +1240,11 @@ std::expected<void, MediaError> VideoDecoder::process(double time_sec) {
                      
                      std::lock_guard<std::mutex> lock(this->queue_mutex_);
                      while (!this->video_frame_queue_.empty()) {
-                         AVFrame* f = this->video_frame_queue_.front();
+                         AVFrame* f = this->video_frame_queue_.front().frame;
                          av_frame_free(&f);
                          this->video_frame_queue_.pop_front();
                      }
+                     this->frames_queued_ = this->frames_rendered_;
                      while (!this->audio_frame_queue_.empty()) {
                          AVFrame* f = this->audio_frame_queue_.front();
                          av_frame_free(&f);
@@ -559,22 +1271,50 @@ std::expected<void, MediaError> VideoDecoder::process(double time_sec) {
     // 1c. Send Packets to Decoder
     while (true) {
         AVPacket* packet = nullptr;
+        bool skip_packet = false;
         {
             std::lock_guard<std::mutex> lock(this->queue_mutex_);
             if (this->packet_queue_.empty()) break;
-            if (this->video_frame_queue_.size() >= this->max_video_frames_ && 
+            if (this->video_frame_queue_.size() >= this->buffer_.video_frame_limit() && 
                 (!this->audio_enabled_ || this->audio_frame_queue_.size() >= this->max_audio_frames_)) {
                 break; // Yield to render()
             }
 
             packet = this->packet_queue_.front();
             this->packet_queue_.pop_front();
+            this->buffer_.on_packet_dequeued(packet->size, this->packet_seconds(packet),
+                                             packet->stream_index == this->video_stream_index_);
+
+            // Precise seek: audio before the target would play ahead of the first shown frame
+            if (packet->stream_index == this->audio_stream_index_ && this->seek_audio_until_ != AV_NOPTS_VALUE) {
+                if (packet->pts != AV_NOPTS_VALUE && packet->pts < this->seek_audio_until_) {
+                    skip_packet = true;
+                } else {
+                    this->seek_audio_until_ = AV_NOPTS_VALUE;
+                }
+            }
+        }
+        if (skip_packet) {
+            av_packet_free(&packet);
+            continue;
         }
         
         bool packet_consumed = true;
         
-        if (packet->stream_index == this->video_stream_index_) {
+        if (packet->stream_index == this->video_stream_index_ && this->video_draining_) {
+            // Next iteration waits until 1b has flushed the decoder
+            std::lock_guard<std::mutex> lock(this->queue_mutex_);
+            this->packet_queue_.push_front(packet);
+            this->buffer_.on_packet_queued(packet->size, this->packet_seconds(packet), true);
+            packet_consumed = false;
+            break;
+        } else if (packet->stream_index == this->video_stream_index_ && is_loop_marker(packet)) {
+            avcodec_send_packet(this->codec_ctx_, nullptr);
+            this->video_draining_ = true;
+        } else if (packet->stream_index == this->video_stream_index_) {
+            auto send_start = std::chrono::steady_clock::now();
             int send_res = avcodec_send_packet(this->codec_ctx_, packet);
+            this->decode_busy_sec_ += std::chrono::duration<double>(std::chrono::steady_clock::now() - send_start).count();
             if (send_res == 0) {
                 this->packets_sent_without_frame_++;
                 
@@ -588,22 +1328,32 @@ std::expected<void, MediaError> VideoDecoder::process(double time_sec) {
                 // Decoder internal queue is FULL. Push back to top of queue.
                 std::lock_guard<std::mutex> lock(this->queue_mutex_);
                 this->packet_queue_.push_front(packet);
+                this->buffer_.on_packet_queued(packet->size, this->packet_seconds(packet), true);
                 packet_consumed = false;
                 break; // Yield to render()
             } else {
                 // Error (EOF or invalid). Drop packet.
             }
+        } else if (is_loop_marker(packet)) {
+            if (this->audio_enabled_ && packet->stream_index == this->audio_stream_index_ && this->audio_codec_ctx_) {
+                // Drain the audio tail of this iteration, then start the next one clean
+                avcodec_send_packet(this->audio_codec_ctx_, nullptr);
+                while (true) {
+                    AVFrame* frame = av_frame_alloc();
+                    if (avcodec_receive_frame(this->audio_codec_ctx_, frame) != 0) {
+                        av_frame_free(&frame);
+                        break;
+                    }
+                    std::lock_guard<std::mutex> lock(this->queue_mutex_);
+                    this->audio_frame_queue_.push_back(frame);
+                }
+                avcodec_flush_buffers(this->audio_codec_ctx_);
+            }
         } else if (this->audio_enabled_ && packet->stream_index == this->audio_stream_index_ && this->audio_codec_ctx_) {
             if (avcodec_send_packet(this->audio_codec_ctx_, packet) == 0) {
                 while (true) {
                     AVFrame* frame = av_frame_alloc();
                     if (avcodec_receive_frame(this->audio_codec_ctx_, frame) == 0) {
-                        // Diagnostic: log every 100th audio frame
-                        static int a_frames = 0;
-                        if (++a_frames % 300 == 0) {
-                            std::cout << "VideoDecoder: Decoded 300 audio frames. Current spillover: " 
-                                      << this->audio_spillover_.size() << " bytes\n";
-                        }
                         std::lock_guard<std::mutex> lock(this->queue_mutex_);
                         this->audio_frame_queue_.push_back(frame);
                         if (this->audio_frame_queue_.size() >= this->max_audio_frames_) break;
@@ -620,6 +1370,15 @@ std::expected<void, MediaError> VideoDecoder::process(double time_sec) {
         }
     }
     
+    // Feed the measured decode cost back into the buffer limits
+    {
+        double decode_sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - decode_start).count();
+        double fps = av_q2d(this->codec_ctx_->framerate);
+        if (fps <= 0.0) fps = 30.0;
+        std::lock_guard<std::mutex> lock(this->queue_mutex_);
+        this->buffer_.observe_decode(decode_sec, frames_decoded, 1.0 / fps);
+    }
+
     // 1c. Convert Audio Frames to PCM and push to ALSA spillover
     while (true) {
         AVFrame* frame = nullptr;
@@ -630,30 +1389,19 @@ std::expected<void, MediaError> VideoDecoder::process(double time_sec) {
             this->audio_frame_queue_.pop_front();
         }
         
-        if (this->pcm_handle_ && this->swr_ctx_) {
-            uint8_t* out_data[1];
-            int64_t delay = swr_get_delay(this->swr_ctx_, this->audio_codec_ctx_->sample_rate);
-            int out_samples = av_rescale_rnd(delay + frame->nb_samples, this->negotiated_rate_, this->audio_codec_ctx_->sample_rate, AV_ROUND_UP);
-            
-            std::vector<uint8_t> output_buffer(out_samples * 4); // S16 Stereo
-            out_data[0] = output_buffer.data();
-            int converted = swr_convert(this->swr_ctx_, out_data, out_samples, (const uint8_t**)frame->data, frame->nb_samples);
-            
-            if (converted > 0) {
-                // Already holding queue_mutex_ via lock_guard at top of process()
-                this->audio_spillover_.insert(this->audio_spillover_.end(), output_buffer.data(), output_buffer.data() + (converted * 4));
-            } else if (converted < 0) {
-                char err_buf[AV_ERROR_MAX_STRING_SIZE];
-                av_strerror(converted, err_buf, sizeof(err_buf));
-                std::cerr << "VideoDecoder: swr_convert error: " << err_buf << "\n";
+        if (this->audio_stream_ && this->audio_codec_ctx_) {
+            this->append_audio_frame(frame);
+            int64_t pts = frame->best_effort_timestamp != AV_NOPTS_VALUE ? frame->best_effort_timestamp : frame->pts;
+            if (pts != AV_NOPTS_VALUE && frame->sample_rate > 0) {
+                this->audio_end_sec_ = pts * av_q2d(this->container_.get_stream_timebase(this->audio_stream_index_))
+                                     + static_cast<double>(frame->nb_samples) / frame->sample_rate;
             }
         }
         av_frame_free(&frame);
     }
 
-    // 1d. Move as much as possible from audio spillover to ALSA hardware
-    // Persistent ALSA recovery: if pcm_handle is null and audio is enabled, try to re-init
-    if (this->audio_enabled_ && !this->pcm_handle_ && !this->current_audio_device_.empty()) {
+    // 1d. Persistent audio recovery: if the mixer had no device for us, retry every 5 seconds
+    if (this->audio_enabled_ && !this->audio_stream_ && !this->current_audio_device_.empty()) {
         static auto last_retry = std::chrono::steady_clock::now();
         auto now = std::chrono::steady_clock::now();
         if (std::chrono::duration_cast<std::chrono::seconds>(now - last_retry).count() >= 5) {
@@ -663,81 +1411,29 @@ std::expected<void, MediaError> VideoDecoder::process(double time_sec) {
         }
     }
 
-    while (true) {
-        if (!this->pcm_handle_ || this->audio_spillover_.empty()) break;
-        
-        size_t frame_size = 4; // S16 Stereo
-        // Limit max buffer size (e.g. 2.5 seconds) to prevent infinite memory usage if ALSA hangs
-        if (this->audio_spillover_.size() > 48000 * 2.5 * frame_size) {
-                this->audio_spillover_.erase(this->audio_spillover_.begin(), this->audio_spillover_.end() - (size_t)(48000 * 2.5 * frame_size));
-        }
-        
-        if (this->audio_spillover_.size() < frame_size) break;
-        
-        // Pre-buffering chunk: Wait until we have at least 0.2s of audio before sending to avoid immediate under-runs
-        size_t prebuffer_threshold = 48000 * 0.2 * frame_size;
-        if (this->audio_prebuffering_) {
-            if (this->audio_spillover_.size() < prebuffer_threshold) {
-                break; // Still prebuffering, don't write to ALSA yet
-            }
-            this->audio_prebuffering_ = false; // Threshold reached, start writing
-            std::cout << "ALSA: Pre-buffering complete (" << this->audio_spillover_.size() << " bytes ready)\n";
+    // 1e. Hand converted audio to the mixer; whatever its ring can't take yet waits in the spillover
+    if (this->audio_stream_ && !this->audio_spillover_.empty()) {
+        size_t frame_size = this->audio_frame_bytes_;
+        // Limit the backlog (Pi 1 s, NUC 2.5 s) to prevent unbounded growth if the mixer stalls
+        size_t max_bytes = static_cast<size_t>(this->negotiated_rate_ * kMaxSpilloverSec) * frame_size;
+        if (this->audio_spillover_.size() > max_bytes) {
+            this->audio_spillover_.erase(this->audio_spillover_.begin(), this->audio_spillover_.end() - max_bytes);
         }
-        
-        size_t bytes_to_grab = std::min(this->audio_spillover_.size(), (size_t)(4800 * 2) * frame_size); // write up to 0.2s at a time
-        std::vector<uint8_t> block(this->audio_spillover_.begin(), this->audio_spillover_.begin() + bytes_to_grab);
-        
-        snd_pcm_sframes_t frames_to_write = block.size() / 4;
-        snd_pcm_sframes_t written = snd_pcm_writei(this->pcm_handle_, block.data(), frames_to_write);
-        
-        if (written > 0) {
-            this->alsa_error_count_ = 0;
-            static int total_written = 0;
-            total_written += written;
-            if (total_written > 48000 * 5) { // every 5 seconds of audio
-                std::cout << "VideoDecoder: ALSA Playback Check: Written " << written << " frames. Total in current run: " << total_written << "\n";
-                total_written = 0;
-            }
-            size_t bytes_written = written * 4;
-            this->audio_spillover_.erase(this->audio_spillover_.begin(), this->audio_spillover_.begin() + bytes_written);
-            if (written < frames_to_write) break;
-        } else if (written == -EAGAIN) {
-            break;
-        } else if (written == -EPIPE) {
-            std::cerr << "ALSA: Underrun (EPIPE). Preparing and entering pre-buffering state...\n";
-            snd_pcm_prepare(this->pcm_handle_); // Recover stream state
-            this->audio_prebuffering_ = true;   // Wait for buffer to fill again
-            break;
-        } else if (written == -ESTRPIPE) {
-            std::cerr << "ALSA: Suspended (ESTRPIPE). Resuming...\n";
-            while ((written = snd_pcm_resume(this->pcm_handle_)) == -EAGAIN) sleep(1);
-            if (written < 0) {
-                snd_pcm_prepare(this->pcm_handle_);
-                this->audio_prebuffering_ = true;
-            }
-            break;
-        } else {
-            if (written < 0) {
-                // Log and try recover
-                auto now = std::chrono::steady_clock::now();
-                if (std::chrono::duration_cast<std::chrono::seconds>(now - this->last_alsa_error_log_).count() >= 5) {
-                    std::cerr << "ALSA: Write error: " << snd_strerror(written) << " (" << written << "). Recovering (Count: " << alsa_error_count_ << ")...\n";
-                    this->last_alsa_error_log_ = now;
-                }
-                
-                // Try ALSA's built-in recover first
-                int res = snd_pcm_recover(this->pcm_handle_, written, 0);
-                if (res < 0) {
-                    // Persistent failure - close for re-init
-                    if (++this->alsa_error_count_ > 10) {
-                        std::cerr << "ALSA: Persistent failure. Forcing device close/reopen.\n";
-                        snd_pcm_close(this->pcm_handle_);
-                        this->pcm_handle_ = nullptr;
-                        this->alsa_error_count_ = 0;
-                    }
-                }
-                break;
-            }
+        size_t accepted = this->audio_stream_->write(this->audio_spillover_.data(), this->audio_spillover_.size() / frame_size);
+        this->audio_spillover_.erase(this->audio_spillover_.begin(), this->audio_spillover_.begin() + accepted * frame_size);
+    }
+
+    // Audio telemetry for stats(): what is buffered ahead of the device, and which
+    // stream time is being heard (for the A/V offset render() reports)
+    if (this->audio_stream_ && this->audio_frame_bytes_ > 0 && this->negotiated_rate_ > 0) {
+        size_t queued = this->audio_stream_->queued_frames() + this->audio_spillover_.size() / this->audio_frame_bytes_;
+        double queued_sec = static_cast<double>(queued) / this->negotiated_rate_;
+        this->audio_attached_.store(true, std::memory_order_relaxed);
+        this->audio_buffer_ms_.store(queued_sec * 1000.0, std::memory_order_relaxed);
+        this->audio_underruns_.store(this->audio_stream_->underruns(), std::memory_order_relaxed);
+        if (this->audio_end_sec_ >= 0.0) {
+            double heard_sec = this->audio_end_sec_ - queued_sec - AudioMixer::shared().output_latency_sec();
+            this->audio_clock_sec_.store(heard_sec, std::memory_order_relaxed);
         }
     }
     
@@ -747,6 +1443,8 @@ std::expected<void, MediaError> VideoDecoder::process(double time_sec) {
 bool VideoDecoder::render(core::Renderer& renderer, EGLDisplay egl_display, 
                           float src_x, float src_y, float src_w, float src_h,
                           float x, float y, float w, float h, double time_sec) {
+    // A network source still connecting has nothing to show, but isn't finished either
+    if (this->connecting_.load()) return !this->source_failed_.load();
     if (!this->codec_ctx_) return false;
     
     // 1. Initialize EGL Extension Pointers and Shader (Once)
@@ -795,43 +1493,131 @@ bool VideoDecoder::render(core::Renderer& renderer, EGLDisplay egl_display,
     
     // 2. Determine if it's time to show a new frame
     AVFrame* frame_to_render = nullptr;
-    {
+    if (this->scanning_) {
+        // Scan: process() paced the keyframes by the scan speed, each one is shown as it arrives
+        std::lock_guard<std::mutex> lock(this->queue_mutex_);
+        if (!this->is_paused_ && !this->video_frame_queue_.empty()) {
+            frame_to_render = this->video_frame_queue_.front().frame;
+            this->video_frame_queue_.pop_front();
+            this->current_pos_sec_ = this->scan_frame_sec_;
+        }
+    } else {
         std::lock_guard<std::mutex> lock(this->queue_mutex_);
+        // Queue fill and cadence for stats(), published here so readers never take the queue lock
+        this->published_fill_.publish(this->buffer_.fill(this->video_frame_queue_.size()));
+        this->published_cadence_.publish(this->cadence_.stats());
         if (!this->codec_ctx_ || this->is_paused_) return true; // Keep old frame if paused
+        if (this->prebuffering_) {
+            // Jitter buffer: (re)start the clock only once enough media is queued to ride out network hiccups
+            double fps = av_q2d(this->codec_ctx_->framerate);
+            if (fps <= 0.0) fps = 30.0;
+            double buffered_ms = (this->buffer_.fill(0).packet_duration_sec + this->video_frame_queue_.size() / fps) * 1000.0;
+            if (buffered_ms < this->network_options_.jitter_buffer_ms && !this->eof_reached_ && !this->buffer_.packets_full()) {
+                return true;
+            }
+            this->prebuffering_ = false;
+            this->video_start_time_ = -1.0; // Anchored again on the next frame
+            std::cout << "[VideoDecoder] Jitter buffer filled (" << static_cast<int>(buffered_ms) << " ms).\n";
+        }
         if (this->video_frame_queue_.empty()) {
             // Only signal "done" when EOF is reached AND all packets have been consumed AND all frames shown
             // AND we are not currently waiting for a seek to complete.
             if (!this->is_seeking_ && this->eof_reached_ && this->packet_queue_.empty()) return false;
+            if (this->network_source_ && !this->eof_reached_ && this->packet_queue_.empty() && this->video_start_time_ >= 0.0) {
+                // The network fell behind: wait for the jitter buffer again instead of stuttering
+                std::cout << "[VideoDecoder] " << this->source_ << " ran dry, rebuffering.\n";
+                this->prebuffering_ = true;
+            }
+            if (this->cadence_.refresh_period() > 0.0 && this->next_vblank_sec_ >= 0.0 && this->video_start_time_ >= 0.0) {
+                // Starved: the frame on screen stays up another vblank
+                double fps = av_q2d(this->codec_ctx_->framerate);
+                this->cadence_.select(this->next_vblank_sec_, this->video_start_time_, fps > 0.0 ? 1.0 / fps : 1.0 / 30.0);
+                this->cadence_.present(this->frames_rendered_ - 1);
+            }
             return true; // Still have packets to decode or waiting for more
         }
         
         // Peek at the first frame for timing
-        AVFrame* first = this->video_frame_queue_.front();
+        QueuedFrame first = this->video_frame_queue_.front();
         // Hardware decoding (VA-API) often drops or misreports PTS (e.g. 0.0). 
         // Synthesize perfect uniform pacing using the codec framerate.
         double fps = av_q2d(this->codec_ctx_->framerate);
         if (fps <= 0.0) fps = 30.0; // Fallback to 30 FPS if framerate is unknown or vfr
-        double frame_pts = this->frames_rendered_ * (1.0 / fps);
+        double frame_pts = first.index * (1.0 / fps);
+        
+        // With vblank timing, pace against the predicted scanout of this frame instead of the loop time
+        bool vsync_paced = this->cadence_.refresh_period() > 0.0 && this->next_vblank_sec_ >= 0.0;
+        double present_sec = vsync_paced ? this->next_vblank_sec_ : time_sec;
         
         if (this->video_start_time_ < 0) {
-            this->video_start_time_ = time_sec - frame_pts; // Anchor the video time
+            this->video_start_time_ = present_sec - frame_pts; // Anchor the video time
+            this->cadence_.restart();
         }
         
         if (this->last_frame_time_ < 0) {
             this->last_frame_time_ = time_sec; // Initialize last_frame_time_
         }
         
-        // Pacing logic: if current program time has passed frame PTS, show it
-        if (time_sec >= this->video_start_time_ + frame_pts) {
-            frame_to_render = first;
+        // Newest frame due: the one closest to scanout (without vblank timing: the
+        // last one whose PTS the program time has passed)
+        int64_t due_index = vsync_paced
+            ? this->cadence_.select(present_sec, this->video_start_time_, 1.0 / fps)
+            : static_cast<int64_t>(std::floor((time_sec - this->video_start_time_) * fps));
+
+        // Catch-up after a stall: a frame whose successor is already due would only ever be late
+        while (this->video_frame_queue_.size() > 1 && this->video_frame_queue_[1].index <= due_index) {
+            av_frame_free(&this->video_frame_queue_.front().frame);
+            this->video_frame_queue_.pop_front();
+            this->frames_dropped_late_++;
+        }
+        first = this->video_frame_queue_.front();
+        frame_pts = first.index * (1.0 / fps);
+
+        // Even the newest decoded frame is far behind: decode less until back on time
+        double lag_sec = (due_index - this->video_frame_queue_.back().index) / fps;
+        if (!this->skip_nonref_requested_ && lag_sec >= kCatchUpSkipSec) {
+            std::cout << "VideoDecoder: " << lag_sec << "s behind, skipping non-reference frames to catch up.\n";
+            this->skip_nonref_requested_ = true;
+        } else if (this->skip_nonref_requested_ && lag_sec <= 1.0 / fps) {
+            std::cout << "VideoDecoder: Caught up, decoding every frame again.\n";
+            this->skip_nonref_requested_ = false;
+        }
+
+        if (first.index <= due_index) {
+            frame_to_render = first.frame;
             this->video_frame_queue_.pop_front();
             this->last_frame_time_ = time_sec;
-            this->frames_rendered_++;
+            if (first.index < due_index) this->frames_late_++; // Its own vblank already went by
+            while (!this->loop_boundaries_.empty() && first.index >= this->loop_boundaries_.front()) {
+                // First frame of the next loop: the position wraps, the clock keeps running
+                this->seek_offset_sec_ = -(this->loop_boundaries_.front() / fps);
+                this->loop_boundaries_.pop_front();
+            }
+            this->frames_rendered_ = first.index + 1;
             this->current_pos_sec_ = this->seek_offset_sec_ + frame_pts; // Absolute position
+            double audio_sec = this->audio_clock_sec_.load(std::memory_order_relaxed);
+            if (audio_sec >= 0.0) {
+                this->av_offset_ms_.store((audio_sec - this->current_pos_sec_) * 1000.0, std::memory_order_relaxed);
+            }
+        }
+        if (vsync_paced) {
+            this->cadence_.present(this->frames_rendered_ - 1);
         }
     }
     
     // 3. If a new frame is ready, update the EGL texture. Otherwise, keep the old one.
+    // 3a. Software-decoded frames live in system memory: upload planes into GL textures
+    // A frame only counts as presented once its texture holds it
+    bool new_frame = frame_to_render != nullptr;
+    bool imported = false;
+    auto import_start = std::chrono::steady_clock::now();
+    if (frame_to_render && !frame_to_render->hw_frames_ctx && frame_to_render->format != AV_PIX_FMT_DRM_PRIME) {
+        this->sw_frame_active_ = this->sw_uploader_.upload(renderer, frame_to_render);
+        imported = this->sw_frame_active_;
+        av_frame_free(&frame_to_render);
+        this->import_latency_.record(std::chrono::duration<double>(std::chrono::steady_clock::now() - import_start).count());
+    }
+    
     if (frame_to_render) {
         // Map Frame to DMA-BUF and Create EGLImage (Zero-Copy)
         av_frame_unref(this->hw_frame_);
@@ -844,9 +1630,22 @@ bool VideoDecoder::render(core::Renderer& renderer, EGLDisplay egl_display,
         // (The previous one was kept alive so the GPU could safely read from it.)
         av_frame_unref(this->drm_frame_);
         this->drm_frame_->format = AV_PIX_FMT_DRM_PRIME;
-        if (av_hwframe_map(this->drm_frame_, this->hw_frame_, AV_HWFRAME_MAP_READ) == 0) {
-            AVDRMFrameDescriptor* desc = (AVDRMFrameDescriptor*)this->drm_frame_->data[0];
-            
+        
+        // V4L2 M2M and DRM PRIME backends hand out DMA-BUF descriptors already;
+        // VA-API surfaces are mapped to one
+        int map_result = -1;
+        AVDRMFrameDescriptor* desc = nullptr;
+        if (this->hw_frame_->format == AV_PIX_FMT_DRM_PRIME) {
+            desc = (AVDRMFrameDescriptor*)this->hw_frame_->data[0];
+            map_result = 0;
+        } else {
+            map_result = av_hwframe_map(this->drm_frame_, this->hw_frame_, AV_HWFRAME_MAP_READ);
+            if (map_result == 0) {
+                desc = (AVDRMFrameDescriptor*)this->drm_frame_->data[0];
+            }
+        }
+        
+        if (map_result == 0 && desc) {
             PFNEGLCREATEIMAGEKHRPROC eglCreateImageKHR_ptr = (PFNEGLCREATEIMAGEKHRPROC)eglGetProcAddress("eglCreateImageKHR");
             PFNEGLDESTROYIMAGEKHRPROC eglDestroyImageKHR_ptr = (PFNEGLDESTROYIMAGEKHRPROC)eglGetProcAddress("eglDestroyImageKHR");
             PFNGLEGLIMAGETARGETTEXTURE2DOESPROC glEGLImageTargetTexture2DOES_ptr = (PFNGLEGLIMAGETARGETTEXTURE2DOESPROC)eglGetProcAddress("glEGLImageTargetTexture2DOES");
@@ -861,8 +1660,9 @@ bool VideoDecoder::render(core::Renderer& renderer, EGLDisplay egl_display,
                 }
                 
                 std::vector<EGLint> attribs;
-                attribs.push_back(EGL_WIDTH); attribs.push_back(this->codec_ctx_->width);
-                attribs.push_back(EGL_HEIGHT); attribs.push_back(this->codec_ctx_->height);
+                // Frame size, not codec size: VPP-scaled or lowres frames are smaller than the stream
+                attribs.push_back(EGL_WIDTH); attribs.push_back(this->hw_frame_->width);
+                attribs.push_back(EGL_HEIGHT); attribs.push_back(this->hw_frame_->height);
                 
                 // Intelligent format selection: If multiple planes/layers exist, it's likely NV12 
                 // regardless of what FFmpeg's DRM_PRIME mapping claims for the first layer format.
@@ -917,6 +1717,9 @@ bool VideoDecoder::render(core::Renderer& renderer, EGLDisplay egl_display,
             if (this->current_egl_image_ != EGL_NO_IMAGE_KHR) {
                 glBindTexture(GL_TEXTURE_EXTERNAL_OES, this->current_texture_id_);
                 glEGLImageTargetTexture2DOES_ptr(GL_TEXTURE_EXTERNAL_OES, this->current_egl_image_);
+                this->sw_frame_active_ = false;
+                imported = true;
+                this->import_latency_.record(std::chrono::duration<double>(std::chrono::steady_clock::now() - import_start).count());
             } else {
                 std::cerr << "VideoDecoder: Failed to create EGLImageKHR from DMA-BUF.\n";
             }
@@ -930,12 +1733,32 @@ bool VideoDecoder::render(core::Renderer& renderer, EGLDisplay egl_display,
         // the GPU is still reading from it — causing character-level flickering.
         // They will be unreffed at the TOP of this block when the NEXT frame arrives.
         } else {
-            std::cerr << "VideoDecoder: Failed to map VAAPI frame to DRM PRIME.\n";
+            std::cerr << "VideoDecoder: Failed to map " << this->backend_name() << " frame to DRM PRIME.\n";
         }
     } // end if (frame_to_render)
+    if (new_frame) {
+        if (imported) {
+            this->frames_presented_++;
+        } else {
+            this->frames_import_failed_++;
+        }
+    }
     
     // 4. Draw the Texture (ALWAYS — even when reusing the previous frame's texture)
-    if (this->current_texture_id_ > 0 && this->current_egl_image_ != EGL_NO_IMAGE_KHR) {
+    this->draw(renderer, src_x, src_y, src_w, src_h, x, y, w, h);
+    
+    // The true end-of-video condition (eof_reached_ AND empty queue) is handled
+    // by the early return at the top of this function. Here we always return true
+    // to keep playing — there may still be decoded frames waiting to be displayed
+    // even after the container has been fully read.
+    return true;
+}
+
+void VideoDecoder::draw(core::Renderer& renderer, float src_x, float src_y, float src_w, float src_h,
+                        float x, float y, float w, float h) {
+    if (this->sw_frame_active_) {
+        this->sw_uploader_.draw(renderer, src_x, src_y, src_w, src_h, x, y, w, h);
+    } else if (this->current_texture_id_ > 0 && this->current_egl_image_ != EGL_NO_IMAGE_KHR) {
         glUseProgram(this->external_program_);
         
         // Map UI coords [0..1] x [0..1] to projection coordinates
@@ -982,12 +1805,6 @@ bool VideoDecoder::render(core::Renderer& renderer, EGLDisplay egl_display,
         // Restore the global Renderer VBO. Text and sprites assume `vbo_` is always bound.
         glBindBuffer(GL_ARRAY_BUFFER, renderer.vbo());
     }
-    
-    // The true end-of-video condition (eof_reached_ AND empty queue) is handled
-    // by the early return at the top of this function. Here we always return true
-    // to keep playing — there may still be decoded frames waiting to be displayed
-    // even after the container has been fully read.
-    return true;
 }
 
 } // namespace nuc_display::modules
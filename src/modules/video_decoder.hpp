@@ -12,20 +12,26 @@ extern "C" {
 #include <libavutil/hwcontext.h>
 #include <libavutil/imgutils.h>
 #include <libavutil/hwcontext_drm.h>
-#ifndef PLATFORM_RPI
-#include <va/va.h>
-#include <va/va_drm.h>
-#endif
 #include <EGL/egl.h>
 #include <EGL/eglext.h>
 #include <GLES2/gl2.h>
 #include <GLES2/gl2ext.h>
-#include <alsa/asoundlib.h>
 }
 
 #include <deque>
 #include <mutex>
+#include <atomic>
+#include <chrono>
 #include "modules/container_reader.hpp"
+#include "modules/network_source.hpp"
+#include "modules/yuv_texture_uploader.hpp"
+#include "modules/decode_scale_policy.hpp"
+#include "modules/decode_backend.hpp"
+#include "modules/adaptive_buffer.hpp"
+#include "modules/decoder_stats.hpp"
+#include "modules/frame_cadence.hpp"
+#include "modules/trick_play.hpp"
+#include "modules/audio_mixer.hpp"
 #include "core/renderer.hpp"
 
 namespace nuc_display::modules {
@@ -38,18 +44,23 @@ public:
     std::expected<void, MediaError> load(const std::string& filepath) override;
     std::expected<void, MediaError> process(double time_sec) override;
 
-#ifndef PLATFORM_RPI
-    // VA-API specific initialization (NUC only)
-    std::expected<void, MediaError> init_vaapi(int drm_fd);
-#else
-    // V4L2 M2M initialization (Raspberry Pi only)
-    std::expected<void, MediaError> init_v4l2(int drm_fd);
-#endif
+    // Decode backends to try, in priority order. Backends whose device can't be opened
+    // on this machine are dropped; each load() then uses the first one that opens the
+    // stream. Hardware backends open the given DRM nodes. Without this call streams
+    // are decoded in software.
+    std::expected<void, MediaError> init_backends(const DecodeDevices& devices,
+        const std::vector<DecodeBackendKind>& order = default_decode_backends());
+    // Same with ready-made backends (custom or instrumented ones), in priority order
+    std::expected<void, MediaError> init_backends(std::vector<std::unique_ptr<DecodeBackend>> backends);
 
     // Optional: render the current frame to OpenGL via EGLImage zero-copy
     bool render(core::Renderer& renderer, EGLDisplay egl_display, 
                 float src_x, float src_y, float src_w, float src_h,
                 float x, float y, float w, float h, double time_sec);
+    // Draw the current frame again with another crop and destination, without advancing
+    // playback: one decode shown in several layout layers
+    void draw(core::Renderer& renderer, float src_x, float src_y, float src_w, float src_h,
+              float x, float y, float w, float h);
 
     void rewind_stream();
     void load_playlist(const std::vector<std::string>& files);
@@ -57,15 +68,97 @@ public:
     void prev_video();
     void unload();
     bool is_loaded() const;
+    bool is_hw_accelerated() const;
+    // Backend decoding the current stream ("vaapi", "v4l2", "drm", "sw"; "none" before load())
+    const char* backend_name() const;
+    // The backend gave up on the stream after opening (hwaccel without its profile): process()
+    // only flags it. The caller reopens with the next backend here, from the render thread with
+    // no process() running, since that frees the codec render() reads and may touch GL state.
+    bool backend_fallback_pending() const { return this->fallback_pending_.load(); }
+    void apply_backend_fallback();
     void skip_forward(double seconds = 10.0);
     void skip_backward(double seconds = 10.0);
+    // Trick play: each call scans in `direction` (+1 forward, -1 backward) at 2x, 4x, 8x, 16x,
+    // then plays normally again. Only keyframes are decoded and audio is muted while scanning.
+    void scan(int direction);
+    // Back to normal playback from the keyframe on screen
+    void stop_scan();
+    int scan_speed() const { return this->trick_play_.speed(); }
+    
+    // On-screen pixel size of the source area this decoder feeds (0 = unknown, decode at full size).
+    // Used to pick lowres/skip heuristics (software) or a VPP scale step (VA-API).
+    void set_target_size(int width, int height);
+    // extra_hw_frames granted by the DecodeScheduler (applied on the next load())
+    void set_surface_budget(int surfaces);
+    // Average bytes of decoded picture data per frame since load()
+    uint64_t decoded_bytes_per_frame() const;
+    // Current demux/frame queue fill against the adaptive limits
+    BufferFill buffer_fill() const;
+    // Predicted scanout of the frame about to be rendered and the display refresh period,
+    // both in render() time. Without them (period 0) frames are paced by the loop time.
+    void set_presentation_timing(double next_vblank_sec, double refresh_period_sec);
+    CadenceStats cadence_stats() const;
+    FrameDropStats drop_stats() const;
+    // Stream time of the next frame render() will present, -1 if none is queued
+    double next_frame_sec() const;
+    // Read-ahead of the current file as of the last process() (all zero for network sources)
+    ReadAheadStats io_stats() const { return this->published_io_.load(); }
+    // Everything above plus presentation, latency and audio telemetry in one snapshot.
+    // Lock-free: the decode and render threads publish, any thread may read.
+    VideoDecoderStats stats() const;
     
     void set_audio_enabled(bool enabled);
     void init_audio(const std::string& device_name = "default");
+    // Stream gain (0..1) in the shared mixer; a ducking stream lowers every other region while it plays
+    void set_audio_mix(float gain, bool ducking);
     void set_paused(bool paused, double time_sec);
+    // Hidden or idle region: remember the playlist item and position, then free the codec,
+    // hardware surfaces, queues, demuxer buffers and the mixer stream. resume() reopens the
+    // item (probe cache and keyframe index make that cheap) and seeks back to the same frame.
+    void suspend();
+    void resume();
+    bool is_suspended() const { return this->suspended_; }
+    // Timeouts, jitter buffer and reconnect policy for URL playlist entries (applied on the next load())
+    void set_network_options(const NetworkSourceOptions& options);
+    // Times a network source dropped and was reopened in place since load()
+    uint64_t reconnects() const { return this->reconnects_.load(); }
+    // Times a single-item playlist wrapped around in place since load()
+    uint64_t loops_completed() const { return this->loops_completed_.load(); }
 
 private:
+    // load(), starting playback at start_sec (resume())
+    std::expected<void, MediaError> load_source(const std::string& filepath, double start_sec);
+    // Precise seek to the position load_source() was asked for, once the source is open
+    void seek_to_start_position();
+    // load() minus the teardown: open the container and set up the decoders
+    std::expected<void, MediaError> open_source(const std::string& filepath);
+    // Decode thread: first open of a network source, true once it is playing
+    bool connect_source();
+    // Decode thread: the stream dropped mid-play; reopen it in place with backoff
+    void begin_reconnect();
+    void reconnect_source();
+    // Reconnected mid-file: packets the old connection already delivered are dropped
+    bool already_demuxed(const AVPacket* packet);
     void cleanup_codec();
+    void seek_to(double target_sec);
+    bool discard_before_seek_target(const AVFrame* frame);
+    // process() while scanning: decode the next keyframe once the scan position has passed it
+    std::expected<void, MediaError> process_scan(double time_sec);
+    AVFrame* decode_keyframe(double time_sec);
+    // Full decode and audio again, without seeking (seek_to() and teardown)
+    void end_scan();
+    bool loop_to_start();
+    double packet_seconds(const AVPacket* packet) const;
+    void configure_audio_conversion(AVSampleFormat out_fmt);
+    void append_audio_frame(const AVFrame* frame);
+    void account_decoded_frame(const AVFrame* frame);
+    // Open the video codec with the first backend from backends_[first] on that takes the stream
+    std::expected<void, MediaError> open_video_codec(size_t first);
+    // Reopen with the next backend and restart decoding where playback is (apply_backend_fallback())
+    void fall_back_backend();
+    // Decode thread, first frame out of a new codec: false if the backend dropped the
+    // stream, with the fallback flagged for the render thread
+    bool confirm_backend();
     
     std::vector<std::string> playlist_;
     size_t playlist_index_ = 0;
@@ -76,32 +169,69 @@ private:
     int video_stream_index_ = -1;
     AVCodecContext* codec_ctx_ = nullptr;
     AVCodec* codec_ = nullptr;
-    AVBufferRef* hw_device_ctx_ = nullptr;
+    std::vector<std::unique_ptr<DecodeBackend>> backends_;
+    DecodeBackend* backend_ = nullptr;   // The one codec_ctx_ was opened with
+    size_t backend_index_ = 0;
+    bool backend_confirmed_ = false;     // First frame seen: backend_->active() checked
+    std::atomic<bool> fallback_pending_{false}; // Set by process(), applied by apply_backend_fallback()
+    std::atomic<const char*> active_backend_{"none"}; // backend_->name() for other threads
+    std::atomic<bool> active_hw_{false};
     
     // Buffering State
     std::deque<AVPacket*> packet_queue_;
-    std::deque<AVFrame*> video_frame_queue_;
+    // Decoded frames with their slot on the playback timeline (frames_rendered_ units)
+    struct QueuedFrame {
+        AVFrame* frame;
+        int64_t index;
+    };
+    std::deque<QueuedFrame> video_frame_queue_;
     std::deque<AVFrame*> audio_frame_queue_;
+    // Packet and video frame limits in bytes / media time, from the platform profile
+    AdaptiveBuffer buffer_;
 #ifdef PLATFORM_RPI
-    const size_t max_packets_ = 30;       // Reduced for 512MB RAM
-    const size_t max_video_frames_ = 3;
     const size_t max_audio_frames_ = 8;
+    static constexpr double kMaxSpilloverSec = 1.0;
 #else
-    const size_t max_packets_ = 100;
-    const size_t max_video_frames_ = 4;
     const size_t max_audio_frames_ = 20;
+    static constexpr double kMaxSpilloverSec = 2.5;
 #endif
     bool eof_reached_ = false;
+    // Seamless loop: the demuxer wrapped and the video decoder is draining the
+    // previous iteration; packets of the next one wait until it is flushed
+    bool video_draining_ = false;
+    uint64_t packets_since_loop_ = 0;
+    int64_t frames_queued_ = 0;    // Timeline index of the next decoded frame
+    // frames_queued_ values at which a new iteration starts (applied in render())
+    std::deque<int64_t> loop_boundaries_;
+    std::atomic<uint64_t> loops_completed_{0};
+#ifdef PLATFORM_RPI
+    int surface_budget_ = 8;
+#else
+    int surface_budget_ = 32;
+#endif
     
     // Audio State
     bool audio_enabled_ = false;
     int audio_stream_index_ = -1;
-    snd_pcm_t* pcm_handle_ = nullptr;
+    std::shared_ptr<AudioStream> audio_stream_;  // Our input on AudioMixer::shared()
+    float audio_gain_ = 1.0f;
+    bool audio_ducking_ = false;
     AVCodecContext* audio_codec_ctx_ = nullptr;
     AVFrame* audio_frame_ = nullptr;
     SwrContext* swr_ctx_ = nullptr;
+    // Resampler input/output, so an identical next playlist item can reuse swr_ctx_
+    AVChannelLayout swr_in_layout_{};
+    AVSampleFormat swr_in_fmt_ = AV_SAMPLE_FMT_NONE;
+    int swr_in_rate_ = 0;
+    AVSampleFormat swr_out_fmt_ = AV_SAMPLE_FMT_NONE;
+    int swr_out_rate_ = 0;
+    // Mixer format: interleaved stereo S16 or FLOAT
+    enum class AudioPath { Resample, Interleave, Copy };
+    AudioPath audio_path_ = AudioPath::Resample;
+    AVSampleFormat audio_out_fmt_ = AV_SAMPLE_FMT_S16;
+    size_t audio_frame_bytes_ = 4;
+    // Converted samples the mixer ring couldn't take yet
     std::vector<uint8_t> audio_spillover_;
-    bool audio_prebuffering_ = true;
     
     AVFrame* hw_frame_ = nullptr;
     AVFrame* drm_frame_ = nullptr;
@@ -110,36 +240,104 @@ private:
     EGLImageKHR current_egl_image_ = EGL_NO_IMAGE_KHR;
     EGLDisplay egl_display_ = EGL_NO_DISPLAY;
     
+    // Destination-aware decode sizing
+    int target_w_ = 0;
+    int target_h_ = 0;
+    DecodeScalePlan scale_plan_;
+    std::atomic<uint64_t> decoded_frames_{0};
+    std::atomic<uint64_t> decoded_bytes_{0};
+    
+    // Software decode path: CPU frames are uploaded into double-buffered YUV textures
+    YuvTextureUploader sw_uploader_;
+    bool sw_frame_active_ = false;   // True when the last presented frame came from sw_uploader_
+    
     // Shader components for external OES
     GLuint external_program_ = 0;
     GLuint external_pos_loc_ = 0;
     GLuint external_tex_coord_loc_ = 0;
     GLuint external_sampler_loc_ = 0;
     
-#ifndef PLATFORM_RPI
-    VADisplay va_display_ = nullptr;
-#endif
     double last_frame_time_ = -1.0;
     double video_start_time_ = -1.0;
     AVRational stream_timebase_ = {1, 1};
-    int frames_rendered_ = 0;
+    int64_t frames_rendered_ = 0;  // Keeps counting across seamless loops
+    // Refresh-aware frame selection (the frame closest to the next scanout)
+    CadenceSelector cadence_;
+    double next_vblank_sec_ = -1.0;
+    // Catch-up: render() asks for AVDISCARD_NONREF once this far behind, process() applies it
+    static constexpr double kCatchUpSkipSec = 0.25;
+    std::atomic<bool> skip_nonref_requested_{false};
+    bool skip_nonref_active_ = false;
+    int64_t last_queued_ts_ = AV_NOPTS_VALUE;
+    std::atomic<uint64_t> frames_dropped_late_{0};
+    std::atomic<uint64_t> frames_skipped_nonref_{0};
+    std::atomic<uint64_t> frames_seek_discarded_{0};
+    std::atomic<uint64_t> frames_import_failed_{0};
+
+    // Telemetry for stats(), reset with the codec
+    std::atomic<uint64_t> frames_presented_{0};
+    std::atomic<uint64_t> frames_late_{0};
+    AtomicLatencyHistogram decode_latency_;
+    AtomicLatencyHistogram import_latency_;
+    double decode_busy_sec_ = 0.0;   // Decode thread: codec time since the last frame came out
+    StatsSnapshot<BufferFill> published_fill_;
+    StatsSnapshot<CadenceStats> published_cadence_;
+    StatsSnapshot<ReadAheadStats> published_io_;   // Decode thread: the container reopens under it
+    double audio_end_sec_ = -1.0;    // Decode thread: stream time just past the last converted sample
+    std::atomic<bool> audio_attached_{false};
+    std::atomic<double> audio_buffer_ms_{0.0};
+    std::atomic<uint64_t> audio_underruns_{0};
+    std::atomic<double> audio_clock_sec_{-1.0};  // Stream time of the audio being heard
+    std::atomic<double> av_offset_ms_{0.0};
     
     uint32_t negotiated_rate_ = 48000;
-    std::mutex queue_mutex_;
+    mutable std::mutex queue_mutex_;
     int get_buffer_retry_count_ = 0;
     int decoding_failure_count_ = 0;
     int packets_sent_without_frame_ = 0;
     
-    // ALSA Resilience
-    int alsa_error_count_ = 0;
-    std::chrono::steady_clock::time_point last_alsa_error_log_ = std::chrono::steady_clock::now();
     std::string current_audio_device_;
     bool is_seeking_ = false;
     double current_pos_sec_ = 0.0;
     double seek_offset_sec_ = 0.0;
+    // Precise seek: frames/audio before these stream timestamps are decoded but dropped
+    int64_t seek_video_until_ = AV_NOPTS_VALUE;
+    int64_t seek_audio_until_ = AV_NOPTS_VALUE;
+    int seek_frames_discarded_ = 0;
+
+    // Trick play: process() hands render() one keyframe at a time, paced by the scan speed
+    TrickPlay trick_play_;
+    std::atomic<bool> scanning_{false};
+    double scan_frame_sec_ = 0.0;               // Position of the queued keyframe
+    static constexpr int kMaxScanPackets = 500; // Read after a seek before giving up on a keyframe
 
     bool is_paused_ = false;
     double pause_start_time_ = -1.0;
+
+    bool suspended_ = false;
+    double suspended_pos_sec_ = 0.0;
+    double start_pos_sec_ = 0.0;   // Consumed by seek_to_start_position()
+
+    // Network sources are opened on the decode thread (process()), never in load(),
+    // so connecting and reconnecting can't hold up the render loop
+    NetworkSourceOptions network_options_;
+    std::string source_;
+    bool network_source_ = false;
+    std::atomic<bool> connecting_{false};     // load() returned; process() opens the source
+    std::atomic<bool> source_failed_{false};  // Gave up on it: render() moves to the next item
+    bool can_skip_source_ = false;            // Playlist has another item to move on to
+    bool reconnecting_ = false;
+    std::chrono::steady_clock::time_point next_attempt_{};
+    ReconnectBackoff backoff_;
+    std::mutex connect_mutex_;                // Held by the decode thread while (re)connecting
+    bool prebuffering_ = false;               // Jitter buffer filling: render() holds the clock
+    std::atomic<uint64_t> reconnects_{0};
+    int64_t last_video_dts_ = AV_NOPTS_VALUE;
+    int64_t last_audio_dts_ = AV_NOPTS_VALUE;
+    int64_t resume_video_after_ = AV_NOPTS_VALUE;
+    int64_t resume_audio_after_ = AV_NOPTS_VALUE;
+    static constexpr int kMaxConnectAttempts = 3;          // Before moving on, if there is somewhere to go
+    static constexpr double kNetworkDemuxBudgetSec = 0.02; // Per process() call: live reads block until data arrives
 };
 
 } // namespace nuc_display::modules
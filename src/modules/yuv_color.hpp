@@ -0,0 +1,31 @@
+#pragma once
+
+namespace nuc_display::modules {
+
+// YUV -> RGB for the fragment shaders, on normalised values:
+//   rgb = matrix * (yuv - offset)
+struct YuvColorMatrix {
+    float matrix[9];  // Column-major mat3 (GLES2 does not allow transpose=GL_TRUE)
+    float offset[3];
+};
+
+inline YuvColorMatrix yuv_color_matrix(bool bt709, bool full_range) {
+    float kr_v = bt709 ? 1.5748f : 1.402f;
+    float kg_u = bt709 ? 0.187324f : 0.344136f;
+    float kg_v = bt709 ? 0.468124f : 0.714136f;
+    float kb_u = bt709 ? 1.8556f : 1.772f;
+
+    float y_scale = full_range ? 1.0f : 255.0f / 219.0f;
+    float c_scale = full_range ? 1.0f : 255.0f / 224.0f;
+
+    return YuvColorMatrix{
+        {
+            y_scale,          y_scale,                  y_scale,
+            0.0f,             -kg_u * c_scale,          kb_u * c_scale,
+            kr_v * c_scale,   -kg_v * c_scale,          0.0f,
+        },
+        {full_range ? 0.0f : 16.0f / 255.0f, 128.0f / 255.0f, 128.0f / 255.0f},
+    };
+}
+
+} // namespace nuc_display::modules
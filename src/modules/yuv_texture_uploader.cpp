@@ -0,0 +1,275 @@
+#include "modules/yuv_texture_uploader.hpp"
+#include "modules/yuv_color.hpp"
+#include "core/renderer.hpp"
+#include <iostream>
+
+extern "C" {
+#include <libavutil/pixdesc.h>
+}
+
+namespace nuc_display::modules {
+
+YuvTextureUploader::~YuvTextureUploader() {
+    // GL objects are owned by the render thread and freed through release();
+    // only CPU-side resources are safe to drop here.
+    if (this->sws_ctx_) {
+        sws_freeContext(this->sws_ctx_);
+        this->sws_ctx_ = nullptr;
+    }
+    if (this->converted_) {
+        av_frame_free(&this->converted_);
+    }
+}
+
+void YuvTextureUploader::release() {
+    for (auto& set : this->sets_) {
+        for (int p = 0; p < 3; ++p) {
+            if (set.tex[p] != 0) {
+                glDeleteTextures(1, &set.tex[p]);
+            }
+        }
+        set = PlaneSet{};
+    }
+    this->front_ = -1;
+    if (this->program_ != 0) {
+        glDeleteProgram(this->program_);
+        this->program_ = 0;
+    }
+    if (this->sws_ctx_) {
+        sws_freeContext(this->sws_ctx_);
+        this->sws_ctx_ = nullptr;
+    }
+    if (this->converted_) {
+        av_frame_free(&this->converted_);
+    }
+}
+
+void YuvTextureUploader::init_program(core::Renderer& renderer) {
+    const char* vs = R"(
+        attribute vec4 a_position;
+        attribute vec2 a_texCoord;
+        varying vec2 v_texCoord;
+        void main() {
+            gl_Position = a_position;
+            v_texCoord = a_texCoord;
+        }
+    )";
+    // Textures are allocated at linesize width (GLES2 has no UNPACK_ROW_LENGTH),
+    // so u_crop rescales S to the visible part of each plane.
+    const char* fs = R"(
+        #ifdef GL_FRAGMENT_PRECISION_HIGH
+        precision highp float;
+        #else
+        precision mediump float;
+        #endif
+        varying vec2 v_texCoord;
+        uniform sampler2D s_y;
+        uniform sampler2D s_u;
+        uniform sampler2D s_v;
+        uniform int u_semi_planar;
+        uniform vec2 u_crop;
+        uniform mat3 u_yuv_matrix;
+        uniform vec3 u_yuv_offset;
+        void main() {
+            float y = texture2D(s_y, vec2(v_texCoord.x * u_crop.x, v_texCoord.y)).r;
+            vec2 c_tc = vec2(v_texCoord.x * u_crop.y, v_texCoord.y);
+            vec2 uv;
+            if (u_semi_planar == 1) {
+                vec4 c = texture2D(s_u, c_tc);
+                uv = vec2(c.r, c.a);
+            } else {
+                uv = vec2(texture2D(s_u, c_tc).r, texture2D(s_v, c_tc).r);
+            }
+            vec3 rgb = u_yuv_matrix * (vec3(y, uv) - u_yuv_offset);
+            gl_FragColor = vec4(clamp(rgb, 0.0, 1.0), 1.0);
+        }
+    )";
+
+    GLuint vs_id = renderer.compile_shader(GL_VERTEX_SHADER, vs);
+    GLuint fs_id = renderer.compile_shader(GL_FRAGMENT_SHADER, fs);
+    this->program_ = renderer.link_program(vs_id, fs_id);
+    glDeleteShader(vs_id);
+    glDeleteShader(fs_id);
+
+    this->pos_loc_ = glGetAttribLocation(this->program_, "a_position");
+    this->tex_coord_loc_ = glGetAttribLocation(this->program_, "a_texCoord");
+    this->y_loc_ = glGetUniformLocation(this->program_, "s_y");
+    this->u_loc_ = glGetUniformLocation(this->program_, "s_u");
+    this->v_loc_ = glGetUniformLocation(this->program_, "s_v");
+    this->semi_planar_loc_ = glGetUniformLocation(this->program_, "u_semi_planar");
+    this->crop_loc_ = glGetUniformLocation(this->program_, "u_crop");
+    this->matrix_loc_ = glGetUniformLocation(this->program_, "u_yuv_matrix");
+    this->offset_loc_ = glGetUniformLocation(this->program_, "u_yuv_offset");
+}
+
+void YuvTextureUploader::update_color_matrix(const AVFrame* frame) {
+    // BT.709 for HD content or when tagged, BT.601 otherwise
+    bool bt709 = frame->colorspace == AVCOL_SPC_BT709 ||
+                 (frame->colorspace == AVCOL_SPC_UNSPECIFIED && frame->height > 576);
+    bool full_range = frame->color_range == AVCOL_RANGE_JPEG ||
+                      frame->format == AV_PIX_FMT_YUVJ420P;
+
+    YuvColorMatrix color = yuv_color_matrix(bt709, full_range);
+    for (int i = 0; i < 9; ++i) this->yuv_matrix_[i] = color.matrix[i];
+    for (int i = 0; i < 3; ++i) this->yuv_offset_[i] = color.offset[i];
+}
+
+void YuvTextureUploader::upload_plane(GLuint tex, int& tex_w, int& tex_h, GLenum format,
+                                      int width, int height, const uint8_t* data) {
+    glBindTexture(GL_TEXTURE_2D, tex);
+    if (tex_w != width || tex_h != height) {
+        // (Re)allocate storage only when geometry changes; every other frame is a SubImage update
+        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, nullptr);
+        tex_w = width;
+        tex_h = height;
+    }
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, format, GL_UNSIGNED_BYTE, data);
+}
+
+bool YuvTextureUploader::upload(core::Renderer& renderer, const AVFrame* frame) {
+    if (!frame || frame->width <= 0 || frame->height <= 0) return false;
+
+    if (this->program_ == 0) {
+        this->init_program(renderer);
+    }
+
+    const AVFrame* src = frame;
+    auto fmt = static_cast<AVPixelFormat>(frame->format);
+    bool semi_planar = (fmt == AV_PIX_FMT_NV12);
+    bool planar_420 = (fmt == AV_PIX_FMT_YUV420P || fmt == AV_PIX_FMT_YUVJ420P);
+
+    if (!semi_planar && !planar_420) {
+        // Anything else (10-bit, 4:2:2, 4:4:4 ...) goes through swscale once into YUV420P
+        this->sws_ctx_ = sws_getCachedContext(this->sws_ctx_,
+            frame->width, frame->height, fmt,
+            frame->width, frame->height, AV_PIX_FMT_YUV420P,
+            SWS_FAST_BILINEAR, nullptr, nullptr, nullptr);
+        if (!this->sws_ctx_) {
+            std::cerr << "[YuvTextureUploader] Unsupported pixel format: "
+                      << (av_get_pix_fmt_name(fmt) ? av_get_pix_fmt_name(fmt) : "unknown") << "\n";
+            return false;
+        }
+        if (!this->converted_ || this->converted_->width != frame->width || this->converted_->height != frame->height) {
+            if (this->converted_) av_frame_free(&this->converted_);
+            this->converted_ = av_frame_alloc();
+            this->converted_->format = AV_PIX_FMT_YUV420P;
+            this->converted_->width = frame->width;
+            this->converted_->height = frame->height;
+            if (av_frame_get_buffer(this->converted_, 0) < 0) {
+                av_frame_free(&this->converted_);
+                return false;
+            }
+        }
+        sws_scale(this->sws_ctx_, frame->data, frame->linesize, 0, frame->height,
+                  this->converted_->data, this->converted_->linesize);
+        this->converted_->colorspace = frame->colorspace;
+        this->converted_->color_range = frame->color_range;
+        src = this->converted_;
+        semi_planar = false;
+    }
+
+    // Write into the set the GPU is NOT currently sampling
+    int back = (this->front_ < 0) ? 0 : (this->front_ + 1) % 2;
+    PlaneSet& set = this->sets_[back];
+    if (set.tex[0] == 0) {
+        glGenTextures(3, set.tex);
+        for (int p = 0; p < 3; ++p) {
+            glBindTexture(GL_TEXTURE_2D, set.tex[p]);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        }
+    }
+
+    int chroma_w = (src->width + 1) / 2;
+    int chroma_h = (src->height + 1) / 2;
+
+    glActiveTexture(GL_TEXTURE1);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    this->upload_plane(set.tex[0], set.tex_w[0], set.tex_h[0], GL_LUMINANCE,
+                       src->linesize[0], src->height, src->data[0]);
+    if (semi_planar) {
+        this->upload_plane(set.tex[1], set.tex_w[1], set.tex_h[1], GL_LUMINANCE_ALPHA,
+                           src->linesize[1] / 2, chroma_h, src->data[1]);
+        set.crop_s[1] = static_cast<float>(chroma_w) / (src->linesize[1] / 2);
+    } else {
+        this->upload_plane(set.tex[1], set.tex_w[1], set.tex_h[1], GL_LUMINANCE,
+                           src->linesize[1], chroma_h, src->data[1]);
+        this->upload_plane(set.tex[2], set.tex_w[2], set.tex_h[2], GL_LUMINANCE,
+                           src->linesize[2], chroma_h, src->data[2]);
+        set.crop_s[1] = static_cast<float>(chroma_w) / src->linesize[1];
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+
+    set.crop_s[0] = static_cast<float>(src->width) / src->linesize[0];
+    set.semi_planar = semi_planar;
+    this->update_color_matrix(src);
+    this->front_ = back;
+    return true;
+}
+
+void YuvTextureUploader::draw(core::Renderer& renderer,
+                              float src_x, float src_y, float src_w, float src_h,
+                              float x, float y, float w, float h) {
+    if (this->front_ < 0 || this->program_ == 0) return;
+    const PlaneSet& set = this->sets_[this->front_];
+
+    glUseProgram(this->program_);
+
+    float nx = x * 2.0f - 1.0f;
+    float ny = 1.0f - y * 2.0f;
+    float nw = w * 2.0f;
+    float nh = h * 2.0f;
+
+    float vertices[] = {
+        nx,      ny - nh, src_x,         src_y + src_h,
+        nx + nw, ny - nh, src_x + src_w, src_y + src_h,
+        nx,      ny,      src_x,         src_y,
+        nx + nw, ny,      src_x + src_w, src_y,
+    };
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glVertexAttribPointer(this->pos_loc_, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), &vertices[0]);
+    glEnableVertexAttribArray(this->pos_loc_);
+    glVertexAttribPointer(this->tex_coord_loc_, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), &vertices[2]);
+    glEnableVertexAttribArray(this->tex_coord_loc_);
+
+    // Units 1/3/4: unit 0 belongs to the UI, unit 2 to cameras
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, set.tex[0]);
+    glActiveTexture(GL_TEXTURE3);
+    glBindTexture(GL_TEXTURE_2D, set.tex[1]);
+    glActiveTexture(GL_TEXTURE4);
+    glBindTexture(GL_TEXTURE_2D, set.semi_planar ? set.tex[1] : set.tex[2]);
+
+    glUniform1i(this->y_loc_, 1);
+    glUniform1i(this->u_loc_, 3);
+    glUniform1i(this->v_loc_, 4);
+    glUniform1i(this->semi_planar_loc_, set.semi_planar ? 1 : 0);
+    glUniform2f(this->crop_loc_, set.crop_s[0], set.crop_s[1]);
+    glUniformMatrix3fv(this->matrix_loc_, 1, GL_FALSE, this->yuv_matrix_);
+    glUniform3fv(this->offset_loc_, 1, this->yuv_offset_);
+
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+    glDisableVertexAttribArray(this->pos_loc_);
+    glDisableVertexAttribArray(this->tex_coord_loc_);
+
+    // Restore texture state expected by the UI renderer
+    glActiveTexture(GL_TEXTURE4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE3);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glBindBuffer(GL_ARRAY_BUFFER, renderer.vbo());
+}
+
+} // namespace nuc_display::modules
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+
+extern "C" {
+#include <libavutil/frame.h>
+#include <libavutil/pixfmt.h>
+#include <libswscale/swscale.h>
+#include <GLES2/gl2.h>
+}
+
+namespace nuc_display::core { class Renderer; }
+
+namespace nuc_display::modules {
+
+// Uploads software-decoded YUV frames into persistent GL textures and draws
+// them through a YUV->RGB fragment shader. Used when no hardware decoder is
+// available and frames live in system memory instead of a DMA-BUF.
+//
+// Two texture sets are kept: each upload goes into the set the GPU is not
+// currently sampling, so glTexSubImage2D never has to wait for the previous
+// draw to finish.
+class YuvTextureUploader {
+public:
+    YuvTextureUploader() = default;
+    ~YuvTextureUploader();
+
+    YuvTextureUploader(const YuvTextureUploader&) = delete;
+    YuvTextureUploader& operator=(const YuvTextureUploader&) = delete;
+
+    // Upload a CPU frame. Planar 4:2:0 and NV12 are uploaded directly; any
+    // other software format is converted to YUV420P via swscale first.
+    bool upload(core::Renderer& renderer, const AVFrame* frame);
+
+    // Draw the most recently uploaded frame (same coordinate convention as VideoDecoder::render)
+    void draw(core::Renderer& renderer,
+              float src_x, float src_y, float src_w, float src_h,
+              float x, float y, float w, float h);
+
+    bool has_frame() const { return front_ >= 0; }
+
+    // Free all GL and swscale resources. Must be called with the GL context current.
+    void release();
+
+private:
+    struct PlaneSet {
+        GLuint tex[3] = {0, 0, 0};
+        int tex_w[3] = {0, 0, 0};   // Allocated texture width in texels (covers linesize padding)
+        int tex_h[3] = {0, 0, 0};
+        float crop_s[2] = {1.0f, 1.0f}; // Visible fraction of luma / chroma textures horizontally
+        bool semi_planar = false;       // NV12: tex[1] holds interleaved UV as LUMINANCE_ALPHA
+    };
+
+    void init_program(core::Renderer& renderer);
+    void upload_plane(GLuint tex, int& tex_w, int& tex_h, GLenum format,
+                      int width, int height, const uint8_t* data);
+    void update_color_matrix(const AVFrame* frame);
+
+    PlaneSet sets_[2];
+    int front_ = -1;   // Index of the set holding the latest frame, -1 = none
+
+    GLuint program_ = 0;
+    GLint pos_loc_ = -1;
+    GLint tex_coord_loc_ = -1;
+    GLint y_loc_ = -1;
+    GLint u_loc_ = -1;
+    GLint v_loc_ = -1;
+    GLint semi_planar_loc_ = -1;
+    GLint crop_loc_ = -1;
+    GLint matrix_loc_ = -1;
+    GLint offset_loc_ = -1;
+
+    float yuv_matrix_[9] = {};
+    float yuv_offset_[3] = {};
+
+    // Fallback conversion for formats the shader can't sample directly (e.g. 10-bit)
+    SwsContext* sws_ctx_ = nullptr;
+    AVFrame* converted_ = nullptr;
+};
+
+} // namespace nuc_display::modules
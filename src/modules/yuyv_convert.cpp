@@ -0,0 +1,248 @@
+#include "modules/yuyv_convert.hpp"
+#include "utils/thread_pool.hpp"
+#include <algorithm>
+#include <future>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// AVX2 is built with a function target attribute and only run after a CPU check,
+// so the binary still starts on x86-64 machines without it
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define YUYV_HAVE_AVX2 1
+#include <immintrin.h>
+#endif
+
+namespace nuc_display::modules {
+
+namespace {
+
+// BT.601 limited range in 8.8 fixed point:
+//   R = (298c + 409e + 128) >> 8,  G = (298c - 100d - 208e + 128) >> 8,  B = (298c + 516d + 128) >> 8
+// with c = Y - 16, d = U - 128, e = V - 128. The SIMD kernels keep the 32-bit
+// intermediates (madd / widening multiplies) so they round exactly like this.
+void row_scalar(const uint8_t* src, uint8_t* dst, int width) {
+    for (int i = 0; i + 1 < width; i += 2) {
+        int c0 = src[0] - 16, d = src[1] - 128, c1 = src[2] - 16, e = src[3] - 128;
+        src += 4;
+        dst[0] = std::clamp((298 * c0 + 409 * e + 128) >> 8, 0, 255);
+        dst[1] = std::clamp((298 * c0 - 100 * d - 208 * e + 128) >> 8, 0, 255);
+        dst[2] = std::clamp((298 * c0 + 516 * d + 128) >> 8, 0, 255);
+        dst[3] = 255;
+        dst[4] = std::clamp((298 * c1 + 409 * e + 128) >> 8, 0, 255);
+        dst[5] = std::clamp((298 * c1 - 100 * d - 208 * e + 128) >> 8, 0, 255);
+        dst[6] = std::clamp((298 * c1 + 516 * d + 128) >> 8, 0, 255);
+        dst[7] = 255;
+        dst += 8;
+    }
+}
+
+#if defined(__SSE2__)
+void row_sse2(const uint8_t* src, uint8_t* dst, int width) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i bias = _mm_setr_epi16(16, 128, 16, 128, 16, 128, 16, 128);
+    const __m128i k_r = _mm_setr_epi16(298, 409, 298, 409, 298, 409, 298, 409);      // (c, e)
+    const __m128i k_gd = _mm_setr_epi16(298, -100, 298, -100, 298, -100, 298, -100); // (c, d)
+    const __m128i k_ge = _mm_setr_epi16(0, -208, 0, -208, 0, -208, 0, -208);         // (c, e)
+    const __m128i k_b = _mm_setr_epi16(298, 516, 298, 516, 298, 516, 298, 516);      // (c, d)
+    const __m128i round = _mm_set1_epi32(128);
+    const __m128i alpha = _mm_set1_epi16(255);
+
+    // Four pixels as 16-bit [c0 d c1 e c2 d' c3 e'] -> R, G, B in 32-bit lanes
+    auto convert4 = [&](__m128i v, __m128i& r, __m128i& g, __m128i& b) {
+        __m128i cd = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(1, 2, 1, 0)), _MM_SHUFFLE(1, 2, 1, 0));
+        __m128i ce = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(3, 2, 3, 0)), _MM_SHUFFLE(3, 2, 3, 0));
+        r = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(ce, k_r), round), 8);
+        g = _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(_mm_madd_epi16(cd, k_gd), _mm_madd_epi16(ce, k_ge)), round), 8);
+        b = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(cd, k_b), round), 8);
+    };
+
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2 * x));
+        __m128i r0, g0, b0, r1, g1, b1;
+        convert4(_mm_sub_epi16(_mm_unpacklo_epi8(v, zero), bias), r0, g0, b0);
+        convert4(_mm_sub_epi16(_mm_unpackhi_epi8(v, zero), bias), r1, g1, b1);
+
+        // Saturating packs do the clamp: [R0..7 B0..7], [G0..7 A0..7], then interleave
+        __m128i rb = _mm_packus_epi16(_mm_packs_epi32(r0, r1), _mm_packs_epi32(b0, b1));
+        __m128i ga = _mm_packus_epi16(_mm_packs_epi32(g0, g1), alpha);
+        __m128i rg = _mm_unpacklo_epi8(rb, ga);
+        __m128i ba = _mm_unpackhi_epi8(rb, ga);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4 * x), _mm_unpacklo_epi16(rg, ba));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4 * x + 16), _mm_unpackhi_epi16(rg, ba));
+    }
+    row_scalar(src + 2 * x, dst + 4 * x, width - x);
+}
+#endif
+
+#if defined(YUYV_HAVE_AVX2)
+// Same steps as row_sse2 on two 128-bit lanes (pixels 0-7 and 8-15). Lambdas
+// don't inherit the target attribute, so the per-step math is a helper.
+struct Avx2Coeffs {
+    __m256i k_r, k_gd, k_ge, k_b, round;
+};
+
+__attribute__((target("avx2"), always_inline))
+inline void avx2_convert4(__m256i v, const Avx2Coeffs& k, __m256i& r, __m256i& g, __m256i& b) {
+    __m256i cd = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(v, _MM_SHUFFLE(1, 2, 1, 0)), _MM_SHUFFLE(1, 2, 1, 0));
+    __m256i ce = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(v, _MM_SHUFFLE(3, 2, 3, 0)), _MM_SHUFFLE(3, 2, 3, 0));
+    r = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(ce, k.k_r), k.round), 8);
+    g = _mm256_srai_epi32(_mm256_add_epi32(_mm256_add_epi32(_mm256_madd_epi16(cd, k.k_gd),
+                                                            _mm256_madd_epi16(ce, k.k_ge)), k.round), 8);
+    b = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(cd, k.k_b), k.round), 8);
+}
+
+__attribute__((target("avx2")))
+void row_avx2(const uint8_t* src, uint8_t* dst, int width) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i bias = _mm256_set1_epi32((128 << 16) | 16);
+    const __m256i alpha = _mm256_set1_epi16(255);
+    const Avx2Coeffs k = {
+        _mm256_set1_epi32((409 << 16) | 298),
+        _mm256_set1_epi32(static_cast<int>((static_cast<uint32_t>(-100) << 16) | 298)),
+        _mm256_set1_epi32(static_cast<int>(static_cast<uint32_t>(-208) << 16)),
+        _mm256_set1_epi32((516 << 16) | 298),
+        _mm256_set1_epi32(128),
+    };
+
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 2 * x));
+        __m256i r0, g0, b0, r1, g1, b1;
+        avx2_convert4(_mm256_sub_epi16(_mm256_unpacklo_epi8(v, zero), bias), k, r0, g0, b0);
+        avx2_convert4(_mm256_sub_epi16(_mm256_unpackhi_epi8(v, zero), bias), k, r1, g1, b1);
+
+        __m256i rb = _mm256_packus_epi16(_mm256_packs_epi32(r0, r1), _mm256_packs_epi32(b0, b1));
+        __m256i ga = _mm256_packus_epi16(_mm256_packs_epi32(g0, g1), alpha);
+        __m256i rg = _mm256_unpacklo_epi8(rb, ga);
+        __m256i ba = _mm256_unpackhi_epi8(rb, ga);
+        __m256i lo = _mm256_unpacklo_epi16(rg, ba);  // Pixels 0-3 | 8-11
+        __m256i hi = _mm256_unpackhi_epi16(rg, ba);  // Pixels 4-7 | 12-15
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 4 * x), _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 4 * x + 32), _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+    row_scalar(src + 2 * x, dst + 4 * x, width - x);
+}
+#endif
+
+#if defined(__ARM_NEON)
+// 298c + ka*a + kb*b, rounded and clamped to 8 bits
+inline uint8x8_t neon_channel(int16x8_t c, int16x8_t a, int16_t ka, int16x8_t b, int16_t kb) {
+    int32x4_t lo = vmull_n_s16(vget_low_s16(c), 298);
+    lo = vmlal_n_s16(lo, vget_low_s16(a), ka);
+    lo = vmlal_n_s16(lo, vget_low_s16(b), kb);
+    int32x4_t hi = vmull_n_s16(vget_high_s16(c), 298);
+    hi = vmlal_n_s16(hi, vget_high_s16(a), ka);
+    hi = vmlal_n_s16(hi, vget_high_s16(b), kb);
+    return vqmovun_s16(vcombine_s16(vqrshrn_n_s32(lo, 8), vqrshrn_n_s32(hi, 8)));
+}
+
+void row_neon(const uint8_t* src, uint8_t* dst, int width) {
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        uint8x8x4_t p = vld4_u8(src + 2 * x);  // Y even, U, Y odd, V for 8 pixel pairs
+        int16x8_t c0 = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(p.val[0])), vdupq_n_s16(16));
+        int16x8_t d = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(p.val[1])), vdupq_n_s16(128));
+        int16x8_t c1 = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(p.val[2])), vdupq_n_s16(16));
+        int16x8_t e = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(p.val[3])), vdupq_n_s16(128));
+
+        uint8x8x2_t r = vzip_u8(neon_channel(c0, e, 409, d, 0), neon_channel(c1, e, 409, d, 0));
+        uint8x8x2_t g = vzip_u8(neon_channel(c0, d, -100, e, -208), neon_channel(c1, d, -100, e, -208));
+        uint8x8x2_t b = vzip_u8(neon_channel(c0, d, 516, e, 0), neon_channel(c1, d, 516, e, 0));
+        uint8x16x4_t rgba = {{vcombine_u8(r.val[0], r.val[1]), vcombine_u8(g.val[0], g.val[1]),
+                              vcombine_u8(b.val[0], b.val[1]), vdupq_n_u8(255)}};
+        vst4q_u8(dst + 4 * x, rgba);
+    }
+    row_scalar(src + 2 * x, dst + 4 * x, width - x);
+}
+#endif
+
+using RowKernel = void (*)(const uint8_t*, uint8_t*, int);
+
+RowKernel row_kernel(YuyvKernel kernel) {
+    switch (kernel) {
+#if defined(__SSE2__)
+        case YuyvKernel::Sse2: return row_sse2;
+#endif
+#if defined(YUYV_HAVE_AVX2)
+        case YuyvKernel::Avx2: return __builtin_cpu_supports("avx2") ? row_avx2 : row_scalar;
+#endif
+#if defined(__ARM_NEON)
+        case YuyvKernel::Neon: return row_neon;
+#endif
+        default: return row_scalar; // Not built for this CPU
+    }
+}
+
+} // namespace
+
+const char* yuyv_kernel_name(YuyvKernel kernel) {
+    switch (kernel) {
+        case YuyvKernel::Scalar: return "scalar";
+        case YuyvKernel::Sse2:   return "sse2";
+        case YuyvKernel::Avx2:   return "avx2";
+        case YuyvKernel::Neon:   return "neon";
+    }
+    return "?";
+}
+
+std::vector<YuyvKernel> available_yuyv_kernels() {
+    std::vector<YuyvKernel> kernels;
+#if defined(YUYV_HAVE_AVX2)
+    if (__builtin_cpu_supports("avx2")) kernels.push_back(YuyvKernel::Avx2);
+#endif
+#if defined(__SSE2__)
+    kernels.push_back(YuyvKernel::Sse2);
+#endif
+#if defined(__ARM_NEON)
+    kernels.push_back(YuyvKernel::Neon);
+#endif
+    kernels.push_back(YuyvKernel::Scalar);
+    return kernels;
+}
+
+void yuyv_to_rgba(const uint8_t* src, size_t src_stride, uint8_t* dst, size_t dst_stride,
+                  int width, int height, YuyvKernel kernel) {
+    RowKernel row = row_kernel(kernel);
+    for (int y = 0; y < height; ++y) {
+        row(src + y * src_stride, dst + y * dst_stride, width);
+    }
+}
+
+YuyvConverter::YuyvConverter(unsigned threads)
+    : kernel_(available_yuyv_kernels().front()), threads_(threads) {
+    if (this->threads_ == 0) {
+        this->threads_ = std::clamp(std::thread::hardware_concurrency() / 2, 1u, 4u);
+    }
+}
+
+YuyvConverter::~YuyvConverter() = default;
+
+void YuyvConverter::convert(const uint8_t* src, size_t src_stride, uint8_t* dst, size_t dst_stride,
+                            int width, int height) {
+    int bands = std::min(static_cast<int>(this->threads_), std::max(1, height / kMinBandRows));
+    if (bands <= 1) {
+        yuyv_to_rgba(src, src_stride, dst, dst_stride, width, height, this->kernel_);
+        return;
+    }
+    // Started on the first frame big enough to split; the caller converts one band itself
+    if (!this->pool_) this->pool_ = std::make_unique<utils::ThreadPool>(this->threads_ - 1);
+
+    int rows = (height + bands - 1) / bands;
+    std::vector<std::future<void>> pending;
+    pending.reserve(bands - 1);
+    for (int y0 = rows; y0 < height; y0 += rows) {
+        int n = std::min(rows, height - y0);
+        pending.push_back(this->pool_->enqueue([=, kernel = this->kernel_]() {
+            yuyv_to_rgba(src + y0 * src_stride, src_stride, dst + y0 * dst_stride, dst_stride, width, n, kernel);
+        }));
+    }
+    yuyv_to_rgba(src, src_stride, dst, dst_stride, width, std::min(rows, height), this->kernel_);
+    for (auto& band : pending) band.get();
+}
+
+} // namespace nuc_display::modules
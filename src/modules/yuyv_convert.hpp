@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace nuc_display::utils { class ThreadPool; }
+
+namespace nuc_display::modules {
+
+// YUYV (4:2:2, BT.601 limited range) -> RGBA kernels for the camera software
+// path. Every kernel produces the same bytes as the scalar reference; they only
+// differ in how many pixels a step converts. RGBA rows upload with GL_RGBA and
+// need no unpack alignment tweaks.
+enum class YuyvKernel {
+    Scalar,
+    Sse2,    // x86-64 baseline, 8 pixels per step
+    Avx2,    // Picked at runtime when the CPU has it, 16 pixels per step
+    Neon     // ARM, 16 pixels per step
+};
+
+const char* yuyv_kernel_name(YuyvKernel kernel);
+// Kernels this CPU can run, fastest first; Scalar is always last
+std::vector<YuyvKernel> available_yuyv_kernels();
+
+// Convert `height` rows of `width` pixels (even). Strides are in bytes.
+void yuyv_to_rgba(const uint8_t* src, size_t src_stride, uint8_t* dst, size_t dst_stride,
+                  int width, int height, YuyvKernel kernel);
+
+// Splits a frame into row bands converted in parallel: the calling thread takes
+// one band, a small pool the rest. One converter per capture thread; the pool
+// starts with the first convert(), so cameras that never need it cost no threads.
+class YuyvConverter {
+public:
+    // threads == 0: half the cores, at most 4
+    explicit YuyvConverter(unsigned threads = 0);
+    ~YuyvConverter();
+
+    void convert(const uint8_t* src, size_t src_stride, uint8_t* dst, size_t dst_stride,
+                 int width, int height);
+
+    YuyvKernel kernel() const { return this->kernel_; }
+    void set_kernel(YuyvKernel kernel) { this->kernel_ = kernel; }
+    unsigned threads() const { return this->threads_; }
+
+private:
+    static constexpr int kMinBandRows = 64;  // Smaller bands cost more to hand out than to convert
+
+    YuyvKernel kernel_;
+    unsigned threads_;
+    std::unique_ptr<utils::ThreadPool> pool_;
+};
+
+} // namespace nuc_display::modules
@@ -27,10 +27,34 @@ int snd_pcm_hw_params_any(snd_pcm_t *pcm, snd_pcm_hw_params_t *params) {
 }
 
 int snd_pcm_hw_params_set_access(snd_pcm_t *pcm, snd_pcm_hw_params_t *params, snd_pcm_access_t _access) { (void)pcm; (void)params; (void)_access; return 0; }
-int snd_pcm_hw_params_set_format(snd_pcm_t *pcm, snd_pcm_hw_params_t *params, snd_pcm_format_t val) { (void)pcm; (void)params; (void)val; return 0; }
+int snd_pcm_hw_params_set_format(snd_pcm_t *pcm, snd_pcm_hw_params_t *params, snd_pcm_format_t val) {
+    (void)pcm; (void)params;
+    g_alsa_mock.format = val;
+    return 0;
+}
 int snd_pcm_hw_params_set_channels(snd_pcm_t *pcm, snd_pcm_hw_params_t *params, unsigned int val) { (void)pcm; (void)params; (void)val; return 0; }
-int snd_pcm_hw_params_set_rate_near(snd_pcm_t *pcm, snd_pcm_hw_params_t *params, unsigned int *val, int *dir) { (void)pcm; (void)params; (void)val; (void)dir; return 0; }
-int snd_pcm_hw_params_set_buffer_size_near(snd_pcm_t *pcm, snd_pcm_hw_params_t *params, snd_pcm_uframes_t *val) { (void)pcm; (void)params; (void)val; return 0; }
+int snd_pcm_hw_params_set_rate_near(snd_pcm_t *pcm, snd_pcm_hw_params_t *params, unsigned int *val, int *dir) {
+    (void)pcm; (void)params; (void)dir;
+    g_alsa_mock.rate = *val;
+    return 0;
+}
+int snd_pcm_hw_params_test_format(snd_pcm_t *pcm, snd_pcm_hw_params_t *params, snd_pcm_format_t val) {
+    (void)pcm; (void)params;
+    if (val == SND_PCM_FORMAT_S16_LE) return 0;
+    return (val == SND_PCM_FORMAT_FLOAT_LE && g_alsa_mock.supports_float) ? 0 : -EINVAL;
+}
+int snd_pcm_hw_params_test_rate(snd_pcm_t *pcm, snd_pcm_hw_params_t *params, unsigned int val, int dir) {
+    (void)pcm; (void)params; (void)dir;
+    for (unsigned int r : g_alsa_mock.supported_rates) {
+        if (r == val) return 0;
+    }
+    return -EINVAL;
+}
+int snd_pcm_hw_params_set_buffer_size_near(snd_pcm_t *pcm, snd_pcm_hw_params_t *params, snd_pcm_uframes_t *val) {
+    (void)pcm; (void)params;
+    g_alsa_mock.buffer_size = *val;
+    return 0;
+}
 int snd_pcm_hw_params_set_period_size_near(snd_pcm_t *pcm, snd_pcm_hw_params_t *params, snd_pcm_uframes_t *val, int *dir) { (void)pcm; (void)params; (void)val; (void)dir; return 0; }
 
 int snd_pcm_hw_params(snd_pcm_t *pcm, snd_pcm_hw_params_t *params) {
@@ -97,8 +121,13 @@ int snd_pcm_drain(snd_pcm_t *pcm) {
     return 0;
 }
 
+snd_pcm_sframes_t snd_pcm_avail_update(snd_pcm_t *pcm) {
+    (void)pcm;
+    return static_cast<snd_pcm_sframes_t>(g_alsa_mock.buffer_size);
+}
+
 snd_pcm_sframes_t snd_pcm_writei(snd_pcm_t *pcm, const void *buffer, snd_pcm_uframes_t size) {
-    (void)pcm; (void)buffer;
+    (void)pcm;
     if (g_alsa_mock.state == PcmState::PREPARED) {
         g_alsa_mock.state = PcmState::RUNNING;
     }
@@ -108,6 +137,9 @@ snd_pcm_sframes_t snd_pcm_writei(snd_pcm_t *pcm, const void *buffer, snd_pcm_ufr
         return -EPIPE; 
     }
     g_alsa_mock.written_frames.push_back((int)size);
+    size_t frame_bytes = g_alsa_mock.format == SND_PCM_FORMAT_FLOAT_LE ? 8 : 4;
+    const uint8_t* bytes = static_cast<const uint8_t*>(buffer);
+    g_alsa_mock.last_written.assign(bytes, bytes + size * frame_bytes);
     return size;
 }
 
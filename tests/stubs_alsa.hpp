@@ -3,6 +3,7 @@
 
 #include <alsa/asoundlib.h>
 #include <curl/curl.h>
+#include <cstdint>
 #include <vector>
 #include <string>
 #include <map>
@@ -30,6 +31,16 @@ struct AlsaMockState {
     int sw_start_threshold = 0;
     
     std::vector<int> written_frames;
+
+    // Device capabilities reported to snd_pcm_hw_params_test_*
+    bool supports_float = false;
+    std::vector<unsigned int> supported_rates = {48000};
+    // Parameters the decoder configured
+    snd_pcm_format_t format = SND_PCM_FORMAT_UNKNOWN;
+    unsigned int rate = 0;
+    snd_pcm_uframes_t buffer_size = 0;
+    // Samples of the last snd_pcm_writei (the device drains instantly: avail == buffer_size)
+    std::vector<uint8_t> last_written;
     
     void reset() {
         fail_open = false;
@@ -40,6 +51,12 @@ struct AlsaMockState {
         hw_params_any_called = false;
         sw_start_threshold = 0;
         written_frames.clear();
+        supports_float = false;
+        supported_rates = {48000};
+        format = SND_PCM_FORMAT_UNKNOWN;
+        rate = 0;
+        buffer_size = 0;
+        last_written.clear();
     }
 };
 
@@ -445,6 +445,1119 @@ TEST(NewsModuleTest, MalformedAndEmptyRSS) {
     SUCCEED();
 }
 
+#include "modules/decode_scale_policy.hpp"
+
+TEST(DecodeScalePolicyTest, FullSizeRegionKeepsFullDecode) {
+    auto plan = plan_decode_scale(1920, 1080, 1920, 1080, 3);
+    EXPECT_EQ(plan.target_w, 1920);
+    EXPECT_EQ(plan.target_h, 1080);
+    EXPECT_EQ(plan.lowres, 0);
+    EXPECT_EQ(plan.skip_loop_filter, 0);
+    EXPECT_FALSE(plan.worth_scaling);
+}
+
+TEST(DecodeScalePolicyTest, SmallTileEnablesHeuristics) {
+    // 0.25 x 0.20 of a 1080p panel showing UHD content
+    auto plan = plan_decode_scale(3840, 2160, 480, 216, 3);
+    EXPECT_EQ(plan.target_w, 480);
+    EXPECT_EQ(plan.target_h, 216);
+    EXPECT_DOUBLE_EQ(plan.reduction, 8.0);
+    EXPECT_EQ(plan.lowres, 3);
+    EXPECT_EQ(plan.skip_loop_filter, 2);
+    EXPECT_EQ(plan.skip_idct, 1);
+    EXPECT_TRUE(plan.worth_scaling);
+}
+
+TEST(DecodeScalePolicyTest, LowresClampedAndNeverUpscales) {
+    auto plan = plan_decode_scale(1280, 720, 320, 180, 0);  // Codec without lowres support
+    EXPECT_EQ(plan.lowres, 0);
+    EXPECT_EQ(plan.skip_loop_filter, 2);
+
+    auto up = plan_decode_scale(640, 360, 1921, 1081, 3);
+    EXPECT_EQ(up.target_w, 640);
+    EXPECT_EQ(up.target_h, 360);
+    EXPECT_FALSE(up.worth_scaling);
+}
+
+#include "modules/decode_scheduler.hpp"
+
+TEST(DecodeSchedulerTest, FullyCoveredRegionIsSuspended) {
+    DecodeScheduler sched(64);
+    sched.update_layout({
+        {0, {0.0f, 0.0f, 0.5f, 0.5f}},
+        {1, {0.0f, 0.0f, 1.0f, 1.0f}},  // Fullscreen video on top
+    });
+    EXPECT_EQ(sched.state(0), DecodeState::Suspended);
+    EXPECT_DOUBLE_EQ(sched.visible_area(0), 0.0);
+    EXPECT_FALSE(sched.should_decode(0, 0));
+    EXPECT_EQ(sched.state(1), DecodeState::Active);
+    EXPECT_EQ(sched.dispatch_order(), std::vector<int>({1}));
+}
+
+TEST(DecodeSchedulerTest, PartialOverlapThrottles) {
+    DecodeScheduler sched(64);
+    sched.update_layout({
+        {0, {0.0f, 0.0f, 0.5f, 0.5f}},
+        {-1, {0.0f, 0.0f, 0.5f, 0.375f}},  // Camera covers 75% of video 0
+        {1, {0.5f, 0.0f, 0.5f, 0.5f}},
+    });
+    EXPECT_NEAR(sched.visible_fraction(0), 0.25, 1e-6);
+    EXPECT_EQ(sched.state(0), DecodeState::Throttled);
+    EXPECT_TRUE(sched.should_decode(0, 0));
+    EXPECT_FALSE(sched.should_decode(0, 1));
+    EXPECT_NEAR(sched.visible_fraction(1), 1.0, 1e-6);
+    EXPECT_EQ(sched.dispatch_order(), std::vector<int>({1, 0}));
+}
+
+TEST(DecodeSchedulerTest, SurfaceBudgetFollowsVisibleArea) {
+    DecodeScheduler sched(40);
+    sched.update_layout({
+        {0, {0.0f, 0.0f, 0.75f, 1.0f}},
+        {1, {0.75f, 0.0f, 0.25f, 1.0f}},
+        {2, {0.0f, 0.0f, 0.1f, 0.1f}},
+        {3, {0.0f, 0.0f, 0.1f, 0.1f}},  // Covers video 2 exactly
+    });
+    // 40 - 4 * 4 = 24 spare surfaces shared by visible area (0.74, 0.25, 0, 0.01)
+    EXPECT_EQ(sched.state(2), DecodeState::Suspended);
+    EXPECT_EQ(sched.surface_budget(2), DecodeScheduler::kMinSurfacesPerDecoder);
+    EXPECT_GT(sched.surface_budget(0), sched.surface_budget(1));
+    EXPECT_GT(sched.surface_budget(1), sched.surface_budget(3));
+    int total = 0;
+    for (int i = 0; i < sched.slot_count(); ++i) total += sched.surface_budget(i);
+    EXPECT_LE(total, 40);
+
+    // A single decoder never exceeds the per-decoder cap
+    DecodeScheduler big(256);
+    big.update_layout({{0, {0.0f, 0.0f, 1.0f, 1.0f}}});
+    EXPECT_EQ(big.surface_budget(0), DecodeScheduler::kMaxSurfacesPerDecoder);
+
+    // Decoders missing from the layout are never scheduled
+    EXPECT_EQ(big.state(5), DecodeState::Suspended);
+}
+
+TEST(DecodeSchedulerTest, SharedSourceCountsEveryLayer) {
+    DecodeScheduler sched(64);
+    sched.update_layout({
+        {0, {0.0f, 0.0f, 0.5f, 1.0f}},    // Left half of one feed
+        {1, {0.0f, 0.0f, 0.2f, 0.2f}},
+        {0, {0.5f, 0.0f, 0.5f, 1.0f}},    // Right half, same decoder
+    });
+    EXPECT_NEAR(sched.visible_area(0), 1.0 - 0.04, 1e-6);
+    EXPECT_NEAR(sched.visible_fraction(0), 0.96, 1e-6);
+    EXPECT_EQ(sched.state(0), DecodeState::Active);
+    EXPECT_EQ(sched.dispatch_order(), std::vector<int>({0, 1}));
+
+    // A slot only reached through another one's source is never decoded on its own
+    sched.update_layout({{0, {0.0f, 0.0f, 0.5f, 0.5f}}, {2, {0.5f, 0.5f, 0.5f, 0.5f}}});
+    EXPECT_EQ(sched.state(1), DecodeState::Suspended);
+    EXPECT_EQ(sched.dispatch_order(), std::vector<int>({0, 2}));
+}
+
+#include "modules/keyframe_index.hpp"
+
+TEST(KeyframeIndexTest, FindsPrecedingKeyframe) {
+    KeyframeIndex index;
+    // Out of order with a duplicate, as a packet scan of a remuxed file may produce
+    index.add(4.0, 4000);
+    index.add(0.0, 0);
+    index.add(2.0, 2000);
+    index.add(2.0, 2000);
+    index.finalize();
+    ASSERT_EQ(index.size(), 3u);
+
+    EXPECT_EQ(index.at_or_before(3.9)->timestamp, 2000);
+    EXPECT_EQ(index.at_or_before(4.0)->timestamp, 4000);
+    EXPECT_EQ(index.at_or_before(100.0)->timestamp, 4000);
+    // Before the first keyframe: start from the first one
+    EXPECT_EQ(index.at_or_before(-1.0)->timestamp, 0);
+}
+
+TEST(KeyframeIndexTest, PartialScanOnlyCoversScannedRange) {
+    KeyframeIndex index;
+    EXPECT_EQ(index.at_or_before(1.0), nullptr);
+
+    index.add(0.0, 0);
+    index.add(10.0, 900000);
+    index.finalize();
+    index.set_coverage(12.0);
+    EXPECT_NE(index.at_or_before(11.0), nullptr);
+    EXPECT_EQ(index.at_or_before(30.0), nullptr);
+}
+
+#include "modules/adaptive_buffer.hpp"
+
+namespace {
+BufferProfile test_profile() {
+    // 64 KB .. 4 MB of packets, 1 s (fast decode) to 3 s (slow decode), 2..5 frames
+    return {64 * 1024, 4 * 1024 * 1024, 1.0, 3.0, 2, 5};
+}
+} // namespace
+
+TEST(AdaptiveBufferTest, HighBitrateIsCappedByBytes) {
+    AdaptiveBuffer buf(test_profile());
+    // ~80 Mbps UHD: 1 MB per 0.1 s packet
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_FALSE(buf.packets_full());
+        buf.observe_demuxed(1024 * 1024, 0.1);
+        buf.on_packet_queued(1024 * 1024, 0.1, true);
+    }
+    // Only 0.4 s queued, but the 4 MB ceiling is reached
+    EXPECT_TRUE(buf.packets_full());
+    EXPECT_EQ(buf.packet_byte_limit(), 4u * 1024 * 1024);
+}
+
+TEST(AdaptiveBufferTest, LowBitrateIsBoundedByDuration) {
+    AdaptiveBuffer buf(test_profile());
+    // 100 packets of 500 bytes, 20 ms each: an old packet-count limit would hold 2 s; we want 1 s
+    int queued = 0;
+    while (!buf.packets_full() && queued < 1000) {
+        buf.observe_demuxed(500, 0.02);
+        buf.on_packet_queued(500, 0.02, true);
+        queued++;
+    }
+    EXPECT_NEAR(queued * 0.02, 1.0, 0.05);
+    EXPECT_EQ(buf.fill(0).packets, static_cast<size_t>(queued));
+
+    buf.on_packet_dequeued(500, 0.02, true);
+    EXPECT_FALSE(buf.packets_full());
+    buf.clear_packets();
+    EXPECT_EQ(buf.fill(0).packet_bytes, 0u);
+}
+
+TEST(AdaptiveBufferTest, AudioMustBeCoveredToo) {
+    AdaptiveBuffer buf(test_profile());
+    buf.on_packet_queued(1000, 2.0, true);
+    buf.on_packet_queued(100, 0.1, false);
+    // Plenty of video, but only 0.1 s of audio queued
+    EXPECT_FALSE(buf.packets_full());
+    buf.on_packet_queued(100, 1.0, false);
+    EXPECT_TRUE(buf.packets_full());
+}
+
+TEST(AdaptiveBufferTest, SlowDecodeGrowsLimits) {
+    AdaptiveBuffer buf(test_profile());
+    EXPECT_EQ(buf.video_frame_limit(), 2u);
+    EXPECT_DOUBLE_EQ(buf.packet_duration_limit(), 1.0);
+
+    // Decode takes 95% of the frame interval
+    for (int i = 0; i < 50; ++i) buf.observe_decode(0.95 / 30.0, 1, 1.0 / 30.0);
+    EXPECT_GT(buf.video_frame_limit(), 2u);
+    EXPECT_LE(buf.video_frame_limit(), 5u);
+    EXPECT_GT(buf.packet_duration_limit(), 2.5);
+    EXPECT_NEAR(buf.fill(0).decode_load, 0.95, 0.01);
+
+    buf.reset();
+    EXPECT_EQ(buf.video_frame_limit(), 2u);
+}
+
+#include "modules/audio_interleave.hpp"
+
+TEST(AudioInterleaveTest, FloatMatchesScalarAtOddLengths) {
+    for (size_t n : {0u, 1u, 3u, 4u, 7u, 17u, 1024u, 1031u}) {
+        std::vector<float> l(n), r(n), out(2 * n, -1.0f);
+        for (size_t i = 0; i < n; ++i) {
+            l[i] = static_cast<float>(i) * 0.5f;
+            r[i] = -static_cast<float>(i) - 0.25f;
+        }
+        interleave_stereo_f32(l.data(), r.data(), out.data(), n);
+        for (size_t i = 0; i < n; ++i) {
+            ASSERT_EQ(out[2 * i], l[i]) << "n=" << n << " i=" << i;
+            ASSERT_EQ(out[2 * i + 1], r[i]) << "n=" << n << " i=" << i;
+        }
+    }
+}
+
+TEST(AudioInterleaveTest, S16MatchesScalarAtOddLengths) {
+    for (size_t n : {0u, 1u, 5u, 8u, 9u, 15u, 16u, 333u}) {
+        std::vector<int16_t> l(n), r(n), out(2 * n, 0);
+        for (size_t i = 0; i < n; ++i) {
+            l[i] = static_cast<int16_t>(i * 97 - 32000);
+            r[i] = static_cast<int16_t>(32000 - i * 89);
+        }
+        interleave_stereo_s16(l.data(), r.data(), out.data(), n);
+        for (size_t i = 0; i < n; ++i) {
+            ASSERT_EQ(out[2 * i], l[i]) << "n=" << n << " i=" << i;
+            ASSERT_EQ(out[2 * i + 1], r[i]) << "n=" << n << " i=" << i;
+        }
+    }
+}
+
+TEST(AudioMixKernelTest, S16SaturatesAndScalesLikeScalar) {
+    const size_t n = 37; // Vector body plus scalar tail
+    std::vector<int16_t> src(n), acc(n);
+    for (size_t i = 0; i < n; ++i) {
+        src[i] = static_cast<int16_t>(i % 2 ? 30000 : -30000);
+        acc[i] = static_cast<int16_t>(i % 2 ? 10000 : -10000);
+    }
+    std::vector<int16_t> sum = acc;
+    mix_add_s16(sum.data(), src.data(), n, 32768);
+    for (size_t i = 0; i < n; ++i) {
+        EXPECT_EQ(sum[i], i % 2 ? 32767 : -32768) << i;
+    }
+
+    std::vector<int16_t> scaled = acc;
+    mix_add_s16(scaled.data(), src.data(), n, 8192); // 0.25
+    for (size_t i = 0; i < n; ++i) {
+        int32_t expected = acc[i] + ((static_cast<int32_t>(src[i]) * 8192) >> 15);
+        EXPECT_EQ(scaled[i], expected) << i;
+    }
+}
+
+TEST(AudioMixKernelTest, FloatMixIsClampedAfterSumming) {
+    const size_t n = 13;
+    std::vector<float> acc(n, 0.75f), src(n, 0.5f);
+    mix_add_f32(acc.data(), src.data(), n, 0.5f);
+    for (float v : acc) EXPECT_FLOAT_EQ(v, 1.0f);
+    mix_add_f32(acc.data(), src.data(), n, 1.0f);
+    clamp_f32(acc.data(), n);
+    for (float v : acc) EXPECT_FLOAT_EQ(v, 1.0f);
+
+    std::vector<float> neg(n, -3.0f);
+    clamp_f32(neg.data(), n);
+    for (float v : neg) EXPECT_FLOAT_EQ(v, -1.0f);
+}
+
+#include "modules/frame_cadence.hpp"
+
+namespace {
+// Drive the selector like render() does: one call per vblank, at most one new frame each
+CadenceStats simulate_cadence(double fps, double refresh_hz, int vblanks, double jitter_sec) {
+    CadenceSelector cadence;
+    cadence.set_refresh_period(1.0 / refresh_hz);
+    const double start = 10.0 + 0.3 / refresh_hz; // Arbitrary phase against the vblank grid
+    int64_t next_frame = 0;
+    uint32_t seed = 12345;
+    for (int k = 0; k < vblanks; ++k) {
+        seed = seed * 1664525u + 1013904223u;
+        double noise = ((seed >> 8) / 16777216.0 - 0.5) * 2.0 * jitter_sec;
+        double scanout = start + k / refresh_hz + noise;
+        if (cadence.select(scanout, start, 1.0 / fps) >= next_frame) next_frame++;
+        cadence.present(next_frame - 1);
+    }
+    return cadence.stats();
+}
+} // namespace
+
+TEST(FrameCadenceTest, Film24OnSixtyHzKeepsThreeTwoPulldown) {
+    // Predictions off by up to 2 ms either way must not move a frame to another vblank
+    CadenceStats st = simulate_cadence(24.0, 60.0, 600, 0.002);
+    EXPECT_EQ(st.breaks, 0u);
+    EXPECT_NEAR(st.vblanks_per_frame, 2.5, 0.01);
+    EXPECT_EQ(st.resyncs, 0u);
+    // Closest-frame selection: never more than half a frame interval off
+    EXPECT_LT(st.max_error_ms, 1000.0 / 24.0 / 2.0 + 0.01);
+}
+
+TEST(FrameCadenceTest, TiesAtFiftyHzResolveConsistently) {
+    // 25 fps started exactly on a vblank puts every other vblank halfway between two frames
+    CadenceSelector cadence;
+    cadence.set_refresh_period(1.0 / 50.0);
+    int64_t next_frame = 0;
+    for (int k = 0; k < 500; ++k) {
+        double scanout = 3.0 + k * 0.02;
+        if (cadence.select(scanout, 3.0, 1.0 / 25.0) >= next_frame) next_frame++;
+        cadence.present(next_frame - 1);
+    }
+    CadenceStats st = cadence.stats();
+    EXPECT_EQ(st.breaks, 0u);
+    EXPECT_DOUBLE_EQ(st.vblanks_per_frame, 2.0);
+    EXPECT_EQ(st.frames, 250u);
+}
+
+TEST(FrameCadenceTest, StarvedFramesAndResyncsAreCounted) {
+    CadenceSelector cadence;
+    cadence.set_refresh_period(1.0 / 60.0);
+    int64_t next_frame = 0;
+    for (int k = 0; k < 120; ++k) {
+        double scanout = k / 60.0;
+        // Decoder misses frame 20: its predecessor stays up until the frame arrives
+        bool starved = k >= 50 && k < 56;
+        if (!starved && cadence.select(scanout, 0.0, 1.0 / 24.0) >= next_frame) next_frame++;
+        if (starved) cadence.select(scanout, 0.0, 1.0 / 24.0);
+        cadence.present(next_frame - 1);
+    }
+    EXPECT_GE(cadence.stats().breaks, 1u);
+
+    // A prediction half a refresh off the grid re-anchors it
+    cadence.select(2.0 + 0.5 / 60.0, 0.0, 1.0 / 24.0);
+    EXPECT_EQ(cadence.stats().resyncs, 1u);
+
+    // Without refresh information every frame whose PTS has passed is due
+    CadenceSelector plain;
+    EXPECT_EQ(plain.select(0.99 / 24.0, 0.0, 1.0 / 24.0), 0);
+    EXPECT_EQ(plain.select(1.01 / 24.0, 0.0, 1.0 / 24.0), 1);
+}
+
+#include "modules/read_ahead_file.hpp"
+#include <cstdio>
+
+namespace {
+std::string write_pattern_file(const std::string& name, size_t bytes) {
+    std::string path = testing::TempDir() + name;
+    std::ofstream out(path, std::ios::binary);
+    for (size_t i = 0; i < bytes; ++i) out.put(static_cast<char>((i * 131 + (i >> 12)) & 0xFF));
+    return path;
+}
+uint8_t pattern_byte(size_t i) { return static_cast<uint8_t>((i * 131 + (i >> 12)) & 0xFF); }
+} // namespace
+
+TEST(ReadAheadFileTest, RingServesSequentialReadsAndResidentSeeks) {
+    const size_t size = 3 * 1024 * 1024 + 517;
+    std::string path = write_pattern_file("read_ahead_ring.bin", size);
+    // 256 KB ring in 16 KB chunks, never mapped
+    ReadAheadFile file({256 * 1024, 16 * 1024, 0});
+    ASSERT_TRUE(file.open(path).has_value());
+    EXPECT_FALSE(file.is_mapped());
+    EXPECT_EQ(file.size(), static_cast<int64_t>(size));
+
+    std::vector<uint8_t> buf(10007);
+    size_t offset = 0;
+    bool contents_ok = true;
+    while (true) {
+        int64_t got = file.read(buf.data(), buf.size());
+        ASSERT_GE(got, 0);
+        if (got == 0) break;
+        for (int64_t i = 0; i < got && contents_ok; ++i) contents_ok = buf[i] == pattern_byte(offset + i);
+        offset += static_cast<size_t>(got);
+    }
+    EXPECT_TRUE(contents_ok);
+    EXPECT_EQ(offset, size);
+
+    // A short step back (demuxers do this when resyncing) is still in the ring
+    ASSERT_EQ(file.seek(static_cast<int64_t>(size) - 64 * 1024), static_cast<int64_t>(size) - 64 * 1024);
+    EXPECT_EQ(file.stats().seeks_in_buffer, 1u);
+    ASSERT_EQ(file.read(buf.data(), 100), 100);
+    EXPECT_EQ(buf[0], pattern_byte(size - 64 * 1024));
+
+    // The start of the file is long gone: the reader restarts there
+    ASSERT_EQ(file.seek(12345), 12345);
+    EXPECT_EQ(file.stats().seeks_in_buffer, 1u);
+    ASSERT_EQ(file.read(buf.data(), 1), 1);
+    EXPECT_EQ(buf[0], pattern_byte(12345));
+    EXPECT_GE(file.stats().bytes_read, size);
+    EXPECT_EQ(file.seek(static_cast<int64_t>(size) + 1), -1);
+    std::remove(path.c_str());
+}
+
+TEST(ReadAheadFileTest, SmallFilesAreMappedWhole) {
+    const size_t size = 200 * 1024;
+    std::string path = write_pattern_file("read_ahead_map.bin", size);
+    ReadAheadFile file({256 * 1024, 16 * 1024, 1024 * 1024});
+    ASSERT_TRUE(file.open(path).has_value());
+    EXPECT_TRUE(file.is_mapped());
+
+    std::vector<uint8_t> buf(size + 10);
+    EXPECT_EQ(file.read(buf.data(), buf.size()), static_cast<int64_t>(size));
+    EXPECT_EQ(buf[size - 1], pattern_byte(size - 1));
+    EXPECT_EQ(file.read(buf.data(), 1), 0);
+    EXPECT_EQ(file.seek(0), 0);
+    EXPECT_EQ(file.stats().seeks_in_buffer, 1u);
+    EXPECT_TRUE(file.stats().mapped);
+
+    ReadAheadFile missing;
+    EXPECT_FALSE(missing.open(testing::TempDir() + "does_not_exist.bin").has_value());
+    std::remove(path.c_str());
+}
+
+#include "modules/network_source.hpp"
+#include <thread>
+
+TEST(NetworkSourceTest, ClassifiesPlaylistEntries) {
+    EXPECT_EQ(classify_source("tests/sample.mp4"), SourceKind::File);
+    EXPECT_EQ(classify_source("/media/clip.mkv"), SourceKind::File);
+    EXPECT_EQ(classify_source("file:///media/clip.mkv"), SourceKind::File);
+    EXPECT_EQ(classify_source("http://10.0.0.2:8000/clip.mp4"), SourceKind::Http);
+    EXPECT_EQ(classify_source("HTTPS://server/live/index.M3U8?token=abc"), SourceKind::Hls);
+    EXPECT_EQ(classify_source("http://server/hls.m3u8.mp4"), SourceKind::Http);
+    EXPECT_EQ(classify_source("rtsp://camera:554/stream1"), SourceKind::Rtsp);
+    EXPECT_EQ(classify_source("udp://239.0.0.1:1234"), SourceKind::Stream);
+    EXPECT_TRUE(is_live_protocol(SourceKind::Rtsp));
+    EXPECT_FALSE(is_live_protocol(SourceKind::Hls));
+    EXPECT_FALSE(is_network_source("movie.mp4"));
+}
+
+TEST(NetworkSourceTest, BackoffDoublesUpToTheCap) {
+    ReconnectBackoff backoff(500, 3000);
+    EXPECT_EQ(backoff.next_delay().count(), 500);
+    EXPECT_EQ(backoff.next_delay().count(), 1000);
+    EXPECT_EQ(backoff.next_delay().count(), 2000);
+    EXPECT_EQ(backoff.next_delay().count(), 3000);
+    EXPECT_EQ(backoff.next_delay().count(), 3000);
+    EXPECT_EQ(backoff.attempts(), 5);
+    backoff.reset();
+    EXPECT_EQ(backoff.next_delay().count(), 500);
+}
+
+TEST(NetworkSourceTest, DeadlineInterruptsBlockingCalls) {
+    IoDeadline deadline;
+    EXPECT_EQ(IoDeadline::interrupt_cb(&deadline), 0);  // Not armed: never interrupts
+    deadline.arm(std::chrono::milliseconds(20));
+    EXPECT_EQ(IoDeadline::interrupt_cb(&deadline), 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    EXPECT_EQ(IoDeadline::interrupt_cb(&deadline), 1);
+    deadline.disarm();
+    EXPECT_FALSE(deadline.expired());
+
+    // abort() outlives re-arming until it is cleared
+    deadline.abort();
+    deadline.arm(std::chrono::seconds(10));
+    EXPECT_TRUE(deadline.expired());
+    deadline.clear_abort();
+    EXPECT_FALSE(deadline.expired());
+}
+
+TEST(NetworkSourceTest, JitterBufferRaisesTheDemuxTarget) {
+    AdaptiveBuffer buf(test_profile());
+    buf.set_min_duration(2.5);
+    EXPECT_DOUBLE_EQ(buf.packet_duration_limit(), 2.5);
+    buf.on_packet_queued(1000, 2.0, true);
+    EXPECT_FALSE(buf.packets_full());
+    buf.set_min_duration(0.0);
+    EXPECT_TRUE(buf.packets_full());
+}
+
+TEST_F(ConfigModuleTest, ParseNetworkOptions) {
+    nlohmann::json j = {
+        {"location", {{"name", "London"}, {"lat", 51.5}, {"lon", -0.1}}},
+        {"stocks", nlohmann::json::array()},
+        {"videos", {{
+            {"playlists", {"rtsp://camera/stream1"}},
+            {"network", {{"jitter_buffer_ms", 150}, {"low_latency", true}, {"reconnect_max_ms", 5000}}}
+        }}}
+    };
+    std::ofstream out(test_file_);
+    out << j.dump();
+    out.close();
+
+    ConfigModule config;
+    auto result = config.load_or_create_config(test_file_);
+    ASSERT_TRUE(result.has_value());
+    ASSERT_EQ(result->videos.size(), 1u);
+    const auto& net = result->videos[0].network;
+    EXPECT_EQ(net.jitter_buffer_ms, 150);
+    EXPECT_TRUE(net.low_latency);
+    EXPECT_EQ(net.reconnect_max_ms, 5000);
+    EXPECT_EQ(net.open_timeout_ms, NetworkSourceOptions{}.open_timeout_ms);
+}
+
+TEST(ConfigValidatorTest, NetworkTimingOutOfRange) {
+    AppConfig config;
+    config.location = {"Test", 0.0f, 0.0f};
+    config.stocks.push_back({"AAPL", "Apple", "$"});
+
+    VideoConfig v1;
+    v1.playlists = {"http://10.0.0.2/live.m3u8"};
+    config.videos.push_back(v1);
+    EXPECT_TRUE(ConfigValidator::validate(config).empty());
+
+    config.videos[0].network.reconnect_max_ms = 100;  // Below reconnect_min_ms
+    auto errors = ConfigValidator::validate(config);
+    ASSERT_EQ(errors.size(), 1u);
+    EXPECT_NE(errors[0].find("network.reconnect_max_ms"), std::string::npos);
+}
+
+#include "modules/probe_cache.hpp"
+#include <filesystem>
+
+namespace {
+ProbeRecord sample_probe_record() {
+    ProbeRecord record;
+    record.format_name = "mov,mp4,m4a,3gp,3g2,mj2";
+    record.duration = 12'000'000;
+    record.bit_rate = 4'000'000;
+    ProbedStream video;
+    video.codec_type = 0;
+    video.codec_id = 27;
+    video.width = 1920;
+    video.height = 1080;
+    video.extradata = {0x01, 0x64, 0x00, 0x28, 0xFF, 0xE1};
+    video.avg_frame_rate_num = 30000;
+    video.avg_frame_rate_den = 1001;
+    ProbedStream audio;
+    audio.codec_type = 1;
+    audio.sample_rate = 48000;
+    audio.channels = 2;
+    audio.channel_mask = 0x3;
+    record.streams = {video, audio};
+    record.keyframe_stream = 0;
+    record.keyframes = {{0.0, 0}, {2.002, 180180}, {4.004, 360360}};
+    record.keyframe_coverage = 6.5;
+    return record;
+}
+} // namespace
+
+TEST(ProbeCacheTest, RoundTripsUntilTheFileChanges) {
+    std::string dir = testing::TempDir() + "probe_cache_roundtrip";
+    std::filesystem::remove_all(dir);
+    std::string media = write_pattern_file("probe_media.bin", 4096);
+    ProbeCache cache(dir);
+
+    EXPECT_FALSE(cache.load(media).has_value());
+    ASSERT_TRUE(cache.store(media, sample_probe_record()));
+
+    auto loaded = cache.load(media);
+    ASSERT_TRUE(loaded.has_value());
+    EXPECT_EQ(loaded->format_name, "mov,mp4,m4a,3gp,3g2,mj2");
+    EXPECT_EQ(loaded->duration, 12'000'000);
+    ASSERT_EQ(loaded->streams.size(), 2u);
+    EXPECT_EQ(loaded->streams[0].width, 1920);
+    EXPECT_EQ(loaded->streams[0].extradata, sample_probe_record().streams[0].extradata);
+    EXPECT_EQ(loaded->streams[0].avg_frame_rate_den, 1001);
+    EXPECT_EQ(loaded->streams[1].channel_mask, 0x3u);
+    ASSERT_EQ(loaded->keyframes.size(), 3u);
+    EXPECT_EQ(loaded->keyframes[2].timestamp, 360360);
+    EXPECT_DOUBLE_EQ(loaded->keyframe_coverage, 6.5);
+    EXPECT_EQ(cache.stats().hits, 1u);
+
+    // Same size, new mtime: probed again
+    std::filesystem::last_write_time(media, std::filesystem::last_write_time(media) + std::chrono::seconds(5));
+    EXPECT_FALSE(cache.load(media).has_value());
+    EXPECT_EQ(cache.stats().invalidated, 1u);
+
+    // Grown file
+    ASSERT_TRUE(cache.store(media, sample_probe_record()));
+    std::ofstream(media, std::ios::binary | std::ios::app).put('x');
+    EXPECT_FALSE(cache.load(media).has_value());
+    EXPECT_EQ(cache.stats().invalidated, 2u);
+    EXPECT_EQ(cache.stats().misses, 3u);
+
+    std::filesystem::remove_all(dir);
+    std::remove(media.c_str());
+}
+
+TEST(ProbeCacheTest, DamagedEntriesAreMisses) {
+    std::string dir = testing::TempDir() + "probe_cache_damaged";
+    std::filesystem::remove_all(dir);
+    std::string media = write_pattern_file("probe_media_damaged.bin", 4096);
+    ProbeCache cache(dir);
+    ASSERT_TRUE(cache.store(media, sample_probe_record()));
+
+    std::filesystem::path entry;
+    for (const auto& e : std::filesystem::directory_iterator(dir)) entry = e.path();
+    ASSERT_FALSE(entry.empty());
+    std::filesystem::resize_file(entry, std::filesystem::file_size(entry) - 7);
+    EXPECT_FALSE(cache.load(media).has_value());
+
+    // A rewrite repairs it
+    ASSERT_TRUE(cache.store(media, sample_probe_record()));
+    EXPECT_TRUE(cache.load(media).has_value());
+    EXPECT_FALSE(cache.load(testing::TempDir() + "probe_missing.bin").has_value());
+    EXPECT_EQ(cache.stats().hits, 1u);
+    EXPECT_EQ(cache.stats().invalidated, 0u);
+
+    std::filesystem::remove_all(dir);
+    std::remove(media.c_str());
+}
+
+TEST(ConfigValidatorTest, SharedSourcesResolveToTheFirstEnabledEntry) {
+    AppConfig config;
+    config.location = {"Test", 0.0f, 0.0f};
+    config.stocks.push_back({"AAPL", "Apple", "$"});
+    VideoConfig feed;
+    feed.playlists = {"lobby.mp4"};
+    feed.source = "lobby";
+    VideoConfig inset;
+    inset.source = "lobby";
+    inset.src_x = 0.5f; inset.src_w = 0.5f;
+    VideoConfig other;
+    other.playlists = {"other.mp4"};
+    VideoConfig disabled = feed;
+    disabled.enabled = false;
+    config.videos = {disabled, feed, other, inset};
+
+    EXPECT_EQ(resolve_video_sources(config.videos), std::vector<int>({-1, 1, 2, 1}));
+    // The inset needs no playlists of its own
+    EXPECT_TRUE(ConfigValidator::validate(config).empty());
+
+    config.videos[3].playlists = {"elsewhere.mp4"};
+    auto errors = ConfigValidator::validate(config);
+    ASSERT_EQ(errors.size(), 1u);
+    EXPECT_NE(errors[0].find("videos[3]"), std::string::npos);
+}
+
+#include "modules/trick_play.hpp"
+
+TEST(TrickPlayTest, SpeedKeysCycleAndReverse) {
+    EXPECT_EQ(TrickPlay::next_speed(0, 1), 2);
+    EXPECT_EQ(TrickPlay::next_speed(2, 1), 4);
+    EXPECT_EQ(TrickPlay::next_speed(8, 1), 16);
+    EXPECT_EQ(TrickPlay::next_speed(16, 1), 0);
+    EXPECT_EQ(TrickPlay::next_speed(0, -1), -2);
+    EXPECT_EQ(TrickPlay::next_speed(-4, -1), -8);
+    EXPECT_EQ(TrickPlay::next_speed(-16, -1), 0);
+    EXPECT_EQ(TrickPlay::next_speed(8, -1), -2);
+    EXPECT_EQ(TrickPlay::next_speed(-2, 1), 2);
+}
+
+TEST(TrickPlayTest, KeyframesFollowTheScanSpeed) {
+    KeyframeIndex index;
+    for (int i = 0; i <= 10; ++i) index.add(i, i * 1000);
+    index.finalize();
+
+    TrickPlay scan;
+    scan.start(4, 2.0);
+    EXPECT_EQ(scan.next_keyframe(index, 100.0, 10.5), nullptr); // Anchors the clock
+    const KeyframeEntry* k = scan.next_keyframe(index, 100.3, 10.5);
+    ASSERT_NE(k, nullptr);
+    EXPECT_DOUBLE_EQ(k->time_sec, 3.0);
+    EXPECT_EQ(scan.next_keyframe(index, 100.4, 10.5), nullptr); // Still before 4 s
+    // A late call skips ahead rather than falling behind the speed
+    k = scan.next_keyframe(index, 101.0, 10.5);
+    ASSERT_NE(k, nullptr);
+    EXPECT_DOUBLE_EQ(k->time_sec, 6.0);
+    EXPECT_FALSE(scan.finished(index, 101.0, 10.5));
+
+    k = scan.next_keyframe(index, 103.0, 10.5);
+    ASSERT_NE(k, nullptr);
+    EXPECT_DOUBLE_EQ(k->time_sec, 10.0);
+    EXPECT_TRUE(scan.finished(index, 103.0, 10.5));
+    EXPECT_DOUBLE_EQ(scan.position(), 10.0);
+
+    scan.start(-8, 5.0);
+    EXPECT_EQ(scan.next_keyframe(index, 0.0, 10.5), nullptr);
+    k = scan.next_keyframe(index, 0.25, 10.5);
+    ASSERT_NE(k, nullptr);
+    EXPECT_DOUBLE_EQ(k->time_sec, 3.0);
+    EXPECT_FALSE(scan.finished(index, 0.25, 10.5));
+    k = scan.next_keyframe(index, 1.0, 10.5);
+    ASSERT_NE(k, nullptr);
+    EXPECT_DOUBLE_EQ(k->time_sec, 0.0);
+    EXPECT_TRUE(scan.finished(index, 1.0, 10.5));
+
+    // A partial packet scan ends the scan where its coverage ends
+    index.set_coverage(4.0);
+    scan.start(16, 0.0);
+    scan.next_keyframe(index, 0.0, 10.5);
+    k = scan.next_keyframe(index, 1.0, 10.5);
+    ASSERT_NE(k, nullptr);
+    EXPECT_DOUBLE_EQ(k->time_sec, 4.0);
+    EXPECT_TRUE(scan.finished(index, 1.0, 10.5));
+
+    scan.stop();
+    EXPECT_FALSE(scan.active());
+    EXPECT_EQ(scan.next_keyframe(index, 2.0, 10.5), nullptr);
+}
+
+#include "modules/decoder_stats.hpp"
+#include <thread>
+
+TEST(DecoderStatsTest, HistogramReportsBucketPercentiles) {
+    using namespace nuc_display::modules;
+    AtomicLatencyHistogram h;
+    EXPECT_EQ(h.summary().count, 0u);
+
+    // 90 fast frames (~3 ms) and 10 slow ones (~40 ms)
+    for (int i = 0; i < 90; ++i) h.record(0.003);
+    for (int i = 0; i < 10; ++i) h.record(0.040);
+    LatencySummary s = h.summary();
+    EXPECT_EQ(s.count, 100u);
+    EXPECT_DOUBLE_EQ(s.p50_ms, 4.096);   // [2048, 4096) us bucket
+    EXPECT_DOUBLE_EQ(s.p95_ms, 40.0);    // Bucket edge 65.536 ms, capped at the max
+    EXPECT_DOUBLE_EQ(s.max_ms, 40.0);
+    EXPECT_LE(s.p50_ms, s.p95_ms);
+    EXPECT_LE(s.p95_ms, s.p99_ms);
+
+    h.reset();
+    EXPECT_EQ(h.summary().count, 0u);
+    EXPECT_DOUBLE_EQ(h.summary().max_ms, 0.0);
+}
+
+TEST(DecoderStatsTest, SnapshotNeverReturnsATornValue) {
+    using namespace nuc_display::modules;
+    StatsSnapshot<BufferFill> snapshot;
+    EXPECT_EQ(snapshot.load().packets, 0u);
+
+    // Every published value keeps its fields consistent with each other
+    std::atomic<bool> done{false};
+    std::thread writer([&] {
+        for (size_t i = 1; i <= 200000; ++i) {
+            BufferFill f;
+            f.packets = i;
+            f.packet_bytes = i * 2;
+            f.video_frames = i * 3;
+            f.bitrate_bps = static_cast<double>(i);
+            snapshot.publish(f);
+        }
+        done = true;
+    });
+    size_t last = 0;
+    while (!done) {
+        BufferFill f = snapshot.load();
+        ASSERT_EQ(f.packet_bytes, f.packets * 2);
+        ASSERT_EQ(f.video_frames, f.packets * 3);
+        ASSERT_DOUBLE_EQ(f.bitrate_bps, static_cast<double>(f.packets));
+        ASSERT_GE(f.packets, last);
+        last = f.packets;
+    }
+    writer.join();
+    EXPECT_EQ(snapshot.load().packets, 200000u);
+}
+
+#include "modules/frame_mailbox.hpp"
+
+TEST(FrameMailboxTest, ConsumerGetsTheNewestFrame) {
+    using namespace nuc_display::modules;
+    FrameMailbox<int> mailbox;
+    EXPECT_FALSE(mailbox.acquire()); // Nothing published yet
+
+    mailbox.back() = 1;
+    mailbox.publish();
+    mailbox.back() = 2;
+    mailbox.publish();               // Frame 1 was never taken: its slot is recycled
+    EXPECT_TRUE(mailbox.acquire());
+    EXPECT_EQ(mailbox.front(), 2);
+    EXPECT_FALSE(mailbox.acquire()); // Nothing newer: front() stays
+    EXPECT_EQ(mailbox.front(), 2);
+
+    // The producer never writes into the slot the consumer holds
+    for (int i = 3; i < 10; ++i) {
+        mailbox.back() = i;
+        EXPECT_EQ(mailbox.front(), 2);
+        mailbox.publish();
+    }
+    EXPECT_TRUE(mailbox.acquire());
+    EXPECT_EQ(mailbox.front(), 9);
+}
+
+TEST(FrameMailboxTest, FramesArriveInOrderAcrossThreads) {
+    using namespace nuc_display::modules;
+    struct Frame { uint64_t sequence = 0; uint64_t check = 0; };
+    FrameMailbox<Frame> mailbox;
+    constexpr uint64_t kFrames = 200000;
+
+    std::thread producer([&] {
+        for (uint64_t i = 1; i <= kFrames; ++i) {
+            mailbox.back().sequence = i;
+            mailbox.back().check = i * 7;
+            mailbox.publish();
+        }
+    });
+    uint64_t last = 0;
+    while (last < kFrames) {
+        if (!mailbox.acquire()) continue;
+        const Frame& f = mailbox.front();
+        ASSERT_EQ(f.check, f.sequence * 7); // Never a half-written slot
+        ASSERT_GT(f.sequence, last);        // Never an older frame
+        last = f.sequence;
+    }
+    producer.join();
+    EXPECT_EQ(last, kFrames);
+}
+
+#include "modules/yuyv_convert.hpp"
+
+TEST(YuyvConvertTest, KernelsMatchScalarReference) {
+    using namespace nuc_display::modules;
+    // Widths that leave vector tails; padded strides like real V4L2 buffers
+    for (int width : {2, 6, 8, 14, 16, 30, 34, 640}) {
+        const int height = 5;
+        const size_t src_stride = width * 2 + 24;
+        const size_t dst_stride = width * 4 + 8;
+        std::vector<uint8_t> src(src_stride * height);
+        uint32_t seed = 12345;
+        for (auto& b : src) { seed = seed * 1103515245 + 12345; b = static_cast<uint8_t>(seed >> 16); }
+
+        std::vector<uint8_t> expected(dst_stride * height, 0);
+        yuyv_to_rgba(src.data(), src_stride, expected.data(), dst_stride, width, height, YuyvKernel::Scalar);
+        for (YuyvKernel kernel : available_yuyv_kernels()) {
+            std::vector<uint8_t> out(dst_stride * height, 0);
+            yuyv_to_rgba(src.data(), src_stride, out.data(), dst_stride, width, height, kernel);
+            ASSERT_EQ(out, expected) << yuyv_kernel_name(kernel) << " width=" << width;
+        }
+    }
+}
+
+TEST(YuyvConvertTest, LimitedRangeEndpointsAndBands) {
+    using namespace nuc_display::modules;
+    // Black (16), white (235) and out-of-range values that must clamp
+    const uint8_t pairs[] = {16, 128, 235, 128, 0, 0, 255, 255};
+    const uint8_t expected[] = {0, 0, 0, 255, 255, 255, 255, 255, 184, 0, 0, 255, 255, 225, 20, 255};
+    for (YuyvKernel kernel : available_yuyv_kernels()) {
+        uint8_t out[16] = {};
+        yuyv_to_rgba(pairs, sizeof(pairs), out, sizeof(out), 4, 1, kernel);
+        EXPECT_EQ(std::vector<uint8_t>(out, out + 16), std::vector<uint8_t>(expected, expected + 16))
+            << yuyv_kernel_name(kernel);
+    }
+
+    // Row bands on the pool produce the same frame as one thread
+    const int width = 64, height = 301;
+    std::vector<uint8_t> src(width * 2 * height);
+    for (size_t i = 0; i < src.size(); ++i) src[i] = static_cast<uint8_t>(i * 31 + i / 7);
+    std::vector<uint8_t> single(width * 4 * height), banded(width * 4 * height);
+    YuyvConverter one(1), four(4);
+    EXPECT_EQ(four.threads(), 4u);
+    one.convert(src.data(), width * 2, single.data(), width * 4, width, height);
+    four.convert(src.data(), width * 2, banded.data(), width * 4, width, height);
+    EXPECT_EQ(banded, single);
+}
+
+#include "modules/yuv_color.hpp"
+#include <cmath>
+
+TEST(YuvColorMatrixTest, LimitedRangeBt601MatchesCpuKernel) {
+    using namespace nuc_display::modules;
+    // The camera shader and the CPU fallback must agree on colours (within rounding)
+    YuvColorMatrix color = yuv_color_matrix(false, false);
+    auto shade = [&](int y, int u, int v, int channel) {
+        float yuv[3] = {y / 255.0f - color.offset[0], u / 255.0f - color.offset[1], v / 255.0f - color.offset[2]};
+        float c = 0.0f;
+        for (int k = 0; k < 3; ++k) c += color.matrix[k * 3 + channel] * yuv[k]; // Column-major
+        return std::clamp(static_cast<int>(std::lround(c * 255.0f)), 0, 255);
+    };
+    for (int y : {16, 60, 128, 200, 235}) {
+        for (int u : {16, 90, 128, 240}) {
+            for (int v : {16, 128, 170, 240}) {
+                uint8_t yuyv[4] = {static_cast<uint8_t>(y), static_cast<uint8_t>(u),
+                                   static_cast<uint8_t>(y), static_cast<uint8_t>(v)};
+                uint8_t rgba[8];
+                yuyv_to_rgba(yuyv, 4, rgba, 8, 2, 1, YuyvKernel::Scalar);
+                for (int ch = 0; ch < 3; ++ch) {
+                    EXPECT_NEAR(shade(y, u, v, ch), rgba[ch], 1) << y << "," << u << "," << v << " ch " << ch;
+                }
+            }
+        }
+    }
+
+    // Full range passes luma straight through
+    YuvColorMatrix full = yuv_color_matrix(true, true);
+    EXPECT_FLOAT_EQ(full.offset[0], 0.0f);
+    EXPECT_FLOAT_EQ(full.matrix[0], 1.0f);
+    EXPECT_FLOAT_EQ(full.matrix[6], 1.5748f); // BT.709 V -> R
+}
+
+#include "modules/mjpeg_decoder.hpp"
+#include <cstdio>
+#include <jpeglib.h>
+
+// Gradient test card encoded as a baseline JPEG with the given luma sampling (2x1 = 4:2:2)
+static std::vector<uint8_t> encode_test_jpeg(int width, int height, int h_samp, int v_samp) {
+    jpeg_compress_struct cinfo;
+    jpeg_error_mgr jerr;
+    cinfo.err = jpeg_std_error(&jerr);
+    jpeg_create_compress(&cinfo);
+    unsigned char* buffer = nullptr;
+    unsigned long size = 0;
+    jpeg_mem_dest(&cinfo, &buffer, &size);
+    cinfo.image_width = width;
+    cinfo.image_height = height;
+    cinfo.input_components = 3;
+    cinfo.in_color_space = JCS_RGB;
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_quality(&cinfo, 95, TRUE);
+    cinfo.comp_info[0].h_samp_factor = h_samp;
+    cinfo.comp_info[0].v_samp_factor = v_samp;
+    jpeg_start_compress(&cinfo, TRUE);
+    std::vector<uint8_t> row(width * 3);
+    while (cinfo.next_scanline < cinfo.image_height) {
+        for (int x = 0; x < width; ++x) {
+            row[x * 3] = static_cast<uint8_t>(x * 255 / width);
+            row[x * 3 + 1] = static_cast<uint8_t>(cinfo.next_scanline * 255 / height);
+            row[x * 3 + 2] = 128;
+        }
+        JSAMPROW rows[1] = {row.data()};
+        jpeg_write_scanlines(&cinfo, rows, 1);
+    }
+    jpeg_finish_compress(&cinfo);
+    jpeg_destroy_compress(&cinfo);
+    std::vector<uint8_t> jpeg(buffer, buffer + size);
+    free(buffer);
+    return jpeg;
+}
+
+TEST(MjpegDecoderTest, ScaleCoversTheDestination) {
+    EXPECT_EQ(MjpegDecoder::scale_for(1920, 1080, 0, 0), 1);       // Unknown target
+    EXPECT_EQ(MjpegDecoder::scale_for(1920, 1080, 1920, 1080), 1);
+    EXPECT_EQ(MjpegDecoder::scale_for(1920, 1080, 960, 540), 2);
+    EXPECT_EQ(MjpegDecoder::scale_for(1920, 1080, 480, 200), 4);
+    EXPECT_EQ(MjpegDecoder::scale_for(1920, 1080, 100, 100), 8);
+    EXPECT_EQ(MjpegDecoder::scale_for(1920, 1080, 961, 100), 1);    // Any axis short: no
+}
+
+TEST(MjpegDecoderTest, DecodesScaledRgbAndRawPlanes) {
+    MjpegDecoder decoder;
+    std::vector<uint8_t> jpeg = encode_test_jpeg(320, 240, 2, 1); // 4:2:2 like most webcams
+    std::vector<uint8_t> out;
+    MjpegImage image;
+
+    ASSERT_TRUE(decoder.decode(jpeg.data(), jpeg.size(), 1, false, out, image));
+    EXPECT_EQ(image.width, 320);
+    EXPECT_EQ(image.height, 240);
+    EXPECT_FALSE(image.planar);
+    ASSERT_EQ(out.size(), 320u * 240u * 3u);
+    EXPECT_NEAR(out[(120 * 320 + 160) * 3], 128, 8);      // Red follows x
+    EXPECT_NEAR(out[(120 * 320 + 160) * 3 + 1], 128, 8);  // Green follows y
+
+    // Same decompressor, DCT-domain downscale
+    ASSERT_TRUE(decoder.decode(jpeg.data(), jpeg.size(), 4, false, out, image));
+    EXPECT_EQ(image.width, 80);
+    EXPECT_EQ(image.height, 60);
+    EXPECT_NEAR(out[(30 * 80 + 40) * 3], 128, 8);
+
+    // Raw planes keep the JPEG's subsampling
+    ASSERT_TRUE(decoder.decode(jpeg.data(), jpeg.size(), 2, true, out, image));
+    EXPECT_TRUE(image.planar);
+    EXPECT_EQ(image.width, 160);
+    EXPECT_EQ(image.height, 120);
+    EXPECT_EQ(image.chroma_width, 80);
+    EXPECT_EQ(image.chroma_height, 120);
+    EXPECT_EQ(out.size(), 160u * 120u + 2u * 80u * 120u);
+
+    std::vector<uint8_t> jpeg420 = encode_test_jpeg(64, 48, 2, 2);
+    ASSERT_TRUE(decoder.decode(jpeg420.data(), jpeg420.size(), 1, true, out, image));
+    EXPECT_EQ(image.chroma_width, 32);
+    EXPECT_EQ(image.chroma_height, 24);
+}
+
+TEST(MjpegDecoderTest, CorruptFrameFailsAndDecoderRecovers) {
+    MjpegDecoder decoder;
+    std::vector<uint8_t> jpeg = encode_test_jpeg(64, 48, 2, 1);
+    std::vector<uint8_t> out;
+    MjpegImage image;
+
+    std::vector<uint8_t> garbage = {0xFF, 0xD8, 0xFF, 0x00, 0x12, 0x34};
+    EXPECT_FALSE(decoder.decode(garbage.data(), garbage.size(), 1, false, out, image));
+    ASSERT_TRUE(decoder.decode(jpeg.data(), jpeg.size(), 1, true, out, image));
+    EXPECT_EQ(image.width, 64);
+}
+
+#include "modules/capture_format.hpp"
+#include <linux/videodev2.h>
+
+// A typical USB 2.0 UVC webcam: uncompressed YUYV only keeps up at small sizes
+static std::vector<CaptureMode> webcam_modes() {
+    return {
+        {V4L2_PIX_FMT_YUYV, 640, 480, 30.0},
+        {V4L2_PIX_FMT_YUYV, 1280, 720, 10.0},
+        {V4L2_PIX_FMT_YUYV, 1920, 1080, 5.0},
+        {V4L2_PIX_FMT_MJPEG, 640, 480, 30.0},
+        {V4L2_PIX_FMT_MJPEG, 1280, 720, 30.0},
+        {V4L2_PIX_FMT_MJPEG, 1920, 1080, 30.0},
+        {V4L2_PIX_FMT_H264, 1920, 1080, 30.0},   // Not displayable: never chosen
+    };
+}
+
+TEST(CaptureFormatTest, PrefersRawWhenTheBusCarriesIt) {
+    EXPECT_DOUBLE_EQ(capture_bytes_per_sec(V4L2_PIX_FMT_YUYV, 640, 480, 30), 640.0 * 480 * 2 * 30);
+    EXPECT_DOUBLE_EQ(capture_bytes_per_sec(V4L2_PIX_FMT_MJPEG, 640, 480, 30), 0.0);
+
+    CaptureRequest request;
+    request.width = 320;   // Drawn small: smallest mode that covers it, uncompressed
+    request.height = 240;
+    request.fps = 30;
+    request.bandwidth_bytes_per_sec = 24e6;
+    auto mode = choose_capture_mode(webcam_modes(), request);
+    ASSERT_TRUE(mode.has_value());
+    EXPECT_EQ(*mode, (CaptureMode{V4L2_PIX_FMT_YUYV, 640, 480, 30.0}));
+
+    // Same size over a slower link: 18 MB/s of YUYV doesn't fit, MJPEG does
+    request.bandwidth_bytes_per_sec = 10e6;
+    mode = choose_capture_mode(webcam_modes(), request);
+    ASSERT_TRUE(mode.has_value());
+    EXPECT_EQ(*mode, (CaptureMode{V4L2_PIX_FMT_MJPEG, 640, 480, 30.0}));
+
+    // A virtual or CSI device (no bus limit) with NV12: NV12 at the covering size
+    std::vector<CaptureMode> vivid = {
+        {V4L2_PIX_FMT_YUYV, 1280, 720, 60.0},
+        {V4L2_PIX_FMT_NV12, 640, 480, 60.0},
+        {V4L2_PIX_FMT_NV12, 1280, 720, 60.0},
+        {V4L2_PIX_FMT_NV12, 1920, 1080, 60.0},
+    };
+    request = CaptureRequest{};
+    request.width = 1000;
+    request.height = 700;
+    mode = choose_capture_mode(vivid, request);
+    ASSERT_TRUE(mode.has_value());
+    EXPECT_EQ(*mode, (CaptureMode{V4L2_PIX_FMT_NV12, 1280, 720, 60.0}));
+}
+
+TEST(CaptureFormatTest, FpsAndSizeBeforeFormat) {
+    CaptureRequest request;
+    request.width = 1280;
+    request.height = 720;
+    request.fps = 30;
+    request.bandwidth_bytes_per_sec = 24e6;
+    // YUYV 720p only does 10 fps: MJPEG 720p
+    auto mode = choose_capture_mode(webcam_modes(), request);
+    ASSERT_TRUE(mode.has_value());
+    EXPECT_EQ(mode->fourcc, static_cast<uint32_t>(V4L2_PIX_FMT_MJPEG));
+    EXPECT_EQ(mode->width, 1280);
+
+    // Nothing covers 4K: the largest mode that keeps up
+    request.width = 3840;
+    request.height = 2160;
+    mode = choose_capture_mode(webcam_modes(), request);
+    ASSERT_TRUE(mode.has_value());
+    EXPECT_EQ(*mode, (CaptureMode{V4L2_PIX_FMT_MJPEG, 1920, 1080, 30.0}));
+
+    // A configured format is kept, but the size is still negotiated
+    request.fourcc = V4L2_PIX_FMT_YUYV;
+    request.width = 320;
+    request.height = 240;
+    mode = choose_capture_mode(webcam_modes(), request);
+    ASSERT_TRUE(mode.has_value());
+    EXPECT_EQ(*mode, (CaptureMode{V4L2_PIX_FMT_YUYV, 640, 480, 30.0}));
+
+    request.fourcc = V4L2_PIX_FMT_NV12;
+    EXPECT_FALSE(choose_capture_mode(webcam_modes(), request).has_value());
+    EXPECT_FALSE(choose_capture_mode({}, CaptureRequest{}).has_value());
+}
+
+TEST(CaptureFormatTest, CacheIsKeyedByDeviceAndRequest) {
+    CaptureModeCache cache;
+    CaptureRequest request;
+    request.width = 640;
+    request.height = 480;
+    CaptureMode mode{V4L2_PIX_FMT_MJPEG, 640, 480, 30.0};
+
+    EXPECT_FALSE(cache.find("HD Pro Webcam C920", request).has_value());
+    cache.store("HD Pro Webcam C920", request, mode);
+    ASSERT_TRUE(cache.find("HD Pro Webcam C920", request).has_value());
+    EXPECT_EQ(*cache.find("HD Pro Webcam C920", request), mode);
+    EXPECT_FALSE(cache.find("vivid", request).has_value());
+
+    CaptureRequest bigger = request;
+    bigger.width = 1920;
+    EXPECT_FALSE(cache.find("HD Pro Webcam C920", bigger).has_value());
+
+    cache.invalidate("HD Pro Webcam C920", request);
+    EXPECT_FALSE(cache.find("HD Pro Webcam C920", request).has_value());
+}
+
+TEST(CaptureFormatTest, PlanesFollowBytesPerLine) {
+    // Unpadded 1080p NV12
+    auto planes = capture_planes(V4L2_PIX_FMT_NV12, 1920, 1080, 1920, 1920 * 1080 * 3 / 2);
+    ASSERT_TRUE(planes.has_value());
+    EXPECT_EQ(planes->pitch, 1920u);
+    EXPECT_EQ(planes->uv_offset, 1920u * 1080u);
+
+    // Rows padded to 2048 bytes: chroma starts after the padded luma rows, not at width*height
+    planes = capture_planes(V4L2_PIX_FMT_NV12, 1920, 1080, 2048, 2048 * 1080 * 3 / 2 + 4096);
+    ASSERT_TRUE(planes.has_value());
+    EXPECT_EQ(planes->pitch, 2048u);
+    EXPECT_EQ(planes->uv_offset, 2048u * 1080u);
+    EXPECT_EQ(planes->size, 2048u * 1620u);
+
+    // Unset bytesperline: unpadded; odd heights round the chroma rows up
+    planes = capture_planes(V4L2_PIX_FMT_NV12, 640, 481, 0, 640 * 722);
+    ASSERT_TRUE(planes.has_value());
+    EXPECT_EQ(planes->pitch, 640u);
+    EXPECT_EQ(planes->size, 640u * 722u);
+    // Odd widths: a chroma row is one byte longer than the luma row
+    EXPECT_FALSE(capture_planes(V4L2_PIX_FMT_NV12, 641, 481, 641, 641 * 722).has_value());
+    planes = capture_planes(V4L2_PIX_FMT_NV12, 641, 481, 0, 642 * 722);
+    ASSERT_TRUE(planes.has_value());
+    EXPECT_EQ(planes->pitch, 642u);
+
+    planes = capture_planes(V4L2_PIX_FMT_YUYV, 640, 480, 1536, 1536 * 480);
+    ASSERT_TRUE(planes.has_value());
+    EXPECT_EQ(planes->pitch, 1536u);
+    EXPECT_EQ(planes->uv_offset, 0u);
+
+    EXPECT_FALSE(capture_planes(V4L2_PIX_FMT_YUYV, 640, 480, 1000, 1000 * 480).has_value()); // Row too short
+    EXPECT_FALSE(capture_planes(V4L2_PIX_FMT_NV12, 640, 480, 640, 640 * 480).has_value());   // No room for chroma
+    EXPECT_FALSE(capture_planes(V4L2_PIX_FMT_MJPEG, 640, 480, 0, 1 << 20).has_value());
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -7,11 +7,114 @@
 #include <fstream>
 #include <thread>
 #include <chrono>
+#include <sstream>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
 
 using namespace nuc_display::modules;
 using namespace nuc_display::core;
 using namespace nuc_display::tests::mock;
 
+// The shared mixer writes from its own thread: wait for its counters instead of sleeping blindly
+template <typename Pred>
+static bool wait_for_mixer(Pred pred) {
+    for (int i = 0; i < 300; i++) {
+        if (pred(AudioMixer::shared().stats())) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return false;
+}
+
+// Minimal HTTP server on 127.0.0.1 for network source tests: serves one file (with
+// Range support, so MP4 demuxing can seek), or in silent mode accepts connections
+// and never answers
+class LocalHttpServer {
+public:
+    explicit LocalHttpServer(const std::string& file, bool silent = false) : silent_(silent) {
+        std::ifstream in(file, std::ios::binary);
+        this->body_.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+
+        this->listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        bind(this->listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        listen(this->listen_fd_, 8);
+        socklen_t len = sizeof(addr);
+        getsockname(this->listen_fd_, reinterpret_cast<sockaddr*>(&addr), &len);
+        this->port_ = ntohs(addr.sin_port);
+        this->thread_ = std::jthread([this](std::stop_token stop) { this->run(stop); });
+    }
+
+    ~LocalHttpServer() {
+        this->thread_.request_stop();
+        this->thread_.join();
+        for (int fd : this->idle_fds_) close(fd);
+        close(this->listen_fd_);
+    }
+
+    std::string url(const std::string& name) const {
+        return "http://127.0.0.1:" + std::to_string(this->port_) + "/" + name;
+    }
+
+private:
+    void run(std::stop_token stop) {
+        while (!stop.stop_requested()) {
+            pollfd pfd{this->listen_fd_, POLLIN, 0};
+            if (poll(&pfd, 1, 50) <= 0) continue;
+            int fd = accept(this->listen_fd_, nullptr, nullptr);
+            if (fd < 0) continue;
+            if (this->silent_) {
+                this->idle_fds_.push_back(fd);
+                continue;
+            }
+            this->serve(fd);
+            close(fd);
+        }
+    }
+
+    void serve(int fd) {
+        std::string request;
+        char buf[1024];
+        while (request.find("\r\n\r\n") == std::string::npos) {
+            ssize_t n = recv(fd, buf, sizeof(buf), 0);
+            if (n <= 0) return;
+            request.append(buf, static_cast<size_t>(n));
+        }
+        size_t start = 0;
+        auto range = request.find("Range: bytes=");
+        if (range != std::string::npos) start = std::stoull(request.substr(range + 13));
+        start = std::min(start, this->body_.size());
+
+        std::ostringstream head;
+        head << (range != std::string::npos ? "HTTP/1.1 206 Partial Content\r\n" : "HTTP/1.1 200 OK\r\n")
+             << "Content-Type: video/mp4\r\nAccept-Ranges: bytes\r\nConnection: close\r\n"
+             << "Content-Length: " << this->body_.size() - start << "\r\n";
+        if (range != std::string::npos) {
+            head << "Content-Range: bytes " << start << "-" << this->body_.size() - 1 << "/" << this->body_.size() << "\r\n";
+        }
+        head << "\r\n";
+        std::string data = head.str() + this->body_.substr(start);
+        for (size_t sent = 0; sent < data.size();) {
+            ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0) return; // Client closed early (probe, seek)
+            sent += static_cast<size_t>(n);
+        }
+    }
+
+    std::string body_;
+    bool silent_;
+    int listen_fd_ = -1;
+    int port_ = 0;
+    std::vector<int> idle_fds_;
+    std::jthread thread_;
+};
+
 class VideoDecoderTest : public ::testing::Test {
 protected:
     void SetUp() override {
@@ -59,14 +162,16 @@ TEST_F(VideoDecoderTest, AlsaUnderrunRecovery) {
     ASSERT_TRUE(decoder.load(test_video_path_).has_value());
     
     // Trigger an underrun simulation on the next write
+    uint64_t underruns = AudioMixer::shared().stats().underruns;
     g_alsa_mock.simulate_underrun = true;
     
-    // We need to call process() to let it read packets and write audio
+    // We need to call process() to let it read packets and feed the mixer
     for (int i=0; i<200; i++) {
         decoder.process(0.1 * i);
     }
     
-    // We expect it to have recovered and written frames eventually
+    // The mixer thread hits the underrun, prepares the device and keeps writing
+    EXPECT_TRUE(wait_for_mixer([&](const AudioMixerStats& st) { return st.underruns > underruns; }));
     EXPECT_FALSE(g_alsa_mock.simulate_underrun); // Flag should have been consumed
 }
 
@@ -119,19 +224,18 @@ TEST_F(VideoDecoderTest, SkipBackwardBounds) {
 TEST_F(VideoDecoderTest, AlsaStateTransitions) {
     VideoDecoder decoder;
     decoder.set_audio_enabled(true);
-    decoder.init_audio("default"); // Opens PCM, state -> OPEN
-    
-    ASSERT_TRUE(decoder.load(test_video_path_).has_value());
-    // After load, state should be PREPARED
+    decoder.init_audio("default"); // The mixer opens and configures the PCM
     EXPECT_EQ(g_alsa_mock.state, PcmState::PREPARED);
     // Threshold should be set to 1
     EXPECT_EQ(g_alsa_mock.sw_start_threshold, 1);
     
-    // Simulate loading a second video. 
-    // cleanup_codec() should move state to SETUP via hw_free()
-    // then load() should successfully move it back to PREPARED via hw_params()
     ASSERT_TRUE(decoder.load(test_video_path_).has_value());
     EXPECT_EQ(g_alsa_mock.state, PcmState::PREPARED);
+    
+    // Loading a second video only flushes this region's stream; the device is left alone
+    ASSERT_TRUE(decoder.load(test_video_path_).has_value());
+    EXPECT_EQ(g_alsa_mock.state, PcmState::PREPARED);
+    EXPECT_TRUE(AudioMixer::shared().is_open());
 }
 
 // 7. Negative Test: Load non-existent file
@@ -150,12 +254,377 @@ TEST_F(VideoDecoderTest, AlsaHwParamsFailure) {
     // Simulate EBUSY by putting PCM in wrong state before load
     g_alsa_mock.state = PcmState::RUNNING; 
     
-    // load() calls cleanup_codec() -> hw_free() which should move state to SETUP
-    // but if it failed to free or something, we test the robust transition.
+    // The device belongs to the mixer: load() must not depend on its state
     auto res = decoder.load(test_video_path_);
     EXPECT_TRUE(res.has_value()); // The video should still load even if audio setup fails
 }
 
+// 9. Software backend: without init_backends() the decoder must run threaded software decode
+TEST_F(VideoDecoderTest, SoftwareBackendDecodesFrames) {
+    VideoDecoder decoder;
+    ASSERT_TRUE(decoder.load(test_video_path_).has_value());
+    EXPECT_FALSE(decoder.is_hw_accelerated());
+    EXPECT_STREQ(decoder.backend_name(), "sw");
+
+    for (int i = 0; i < 20; i++) {
+        EXPECT_TRUE(decoder.process(0.033 * i).has_value());
+    }
+    EXPECT_TRUE(decoder.is_loaded());
+}
+
+// 10. Keyframe index: built at load, seeks land on a keyframe at or before the target
+TEST_F(VideoDecoderTest, KeyframeIndexPreciseSeek) {
+    ContainerReader reader;
+    ASSERT_TRUE(reader.open(test_video_path_).has_value());
+    int vs = reader.find_video_stream();
+    ASSERT_GE(vs, 0);
+    ASSERT_GT(reader.build_keyframe_index(vs), 0u);
+    EXPECT_LE(reader.seek_to_keyframe(vs, 2.0), 2.0);
+
+    VideoDecoder decoder;
+    ASSERT_TRUE(decoder.load(test_video_path_).has_value());
+    const double frame_sec = 1.0 / 25.0; // The sample's frame rate
+    // Frames short of the target are decoded as references but never queued
+    auto seek_and_decode = [&](auto seek, double target) {
+        uint64_t discarded = decoder.drop_stats().seek_discarded;
+        seek();
+        for (int i = 0; i < 50 && decoder.next_frame_sec() < 0.0; i++) {
+            ASSERT_TRUE(decoder.process(0.033 * i).has_value());
+        }
+        EXPECT_GE(decoder.next_frame_sec(), target - frame_sec);
+        EXPECT_LT(decoder.next_frame_sec(), target + frame_sec);
+        EXPECT_GT(decoder.drop_stats().seek_discarded, discarded);
+    };
+    // The sample's only keyframe is at 0: both seeks decode ahead from there
+    seek_and_decode([&] { decoder.skip_forward(2.0); }, 2.0);
+    seek_and_decode([&] { decoder.skip_backward(1.0); }, 1.0);
+}
+
+// 11. The mixer opens the device in float when it allows it, S16 otherwise
+TEST_F(VideoDecoderTest, AudioNegotiatesFloatAtSourceRate) {
+    g_alsa_mock.supports_float = true;
+    g_alsa_mock.supported_rates = {44100, 48000};
+    {
+        VideoDecoder decoder;
+        decoder.set_audio_enabled(true);
+        decoder.init_audio("default");
+        ASSERT_TRUE(decoder.load(test_video_path_).has_value());
+        EXPECT_EQ(g_alsa_mock.format, SND_PCM_FORMAT_FLOAT_LE);
+        EXPECT_EQ(g_alsa_mock.rate, 48000u);
+        uint64_t written = AudioMixer::shared().stats().frames_written;
+        for (int i = 0; i < 50; i++) {
+            EXPECT_TRUE(decoder.process(0.1 * i).has_value());
+        }
+        EXPECT_TRUE(wait_for_mixer([&](const AudioMixerStats& st) { return st.frames_written > written; }));
+    }
+    // Last stream gone: the device is closed
+    EXPECT_FALSE(AudioMixer::shared().is_open());
+
+    // Device without float support falls back to S16
+    g_alsa_mock.reset();
+    VideoDecoder decoder;
+    decoder.set_audio_enabled(true);
+    decoder.init_audio("default");
+    ASSERT_TRUE(decoder.load(test_video_path_).has_value());
+    EXPECT_EQ(g_alsa_mock.format, SND_PCM_FORMAT_S16_LE);
+}
+
+// 12. Two streams are summed with saturation; a ducking stream lowers the other one
+TEST_F(VideoDecoderTest, MixerSumsAndDucksStreams) {
+    AudioMixer mixer(false); // Driven by pump() below, no thread
+    auto a = mixer.add_stream("default");
+    auto b = mixer.add_stream("default");
+    ASSERT_TRUE(a && b);
+    ASSERT_FALSE(a->is_float());
+    EXPECT_EQ(mixer.stats().streams, 2u);
+
+    const size_t frames = a->rate(); // 1 s, fills the ring
+    std::vector<int16_t> loud(frames * 2, 20000), quiet(frames * 2, 1000);
+    ASSERT_EQ(a->write(reinterpret_cast<const uint8_t*>(loud.data()), frames), frames);
+    ASSERT_EQ(b->write(reinterpret_cast<const uint8_t*>(loud.data()), frames), frames);
+
+    auto last_sample = [] { return reinterpret_cast<const int16_t*>(g_alsa_mock.last_written.data())[0]; };
+    ASSERT_TRUE(mixer.pump());
+    EXPECT_EQ(last_sample(), 32767); // 20000 + 20000 saturates
+
+    // B is replaced by a quiet stream that ducks A: A ramps down to kDuckGain and stays there
+    mixer.remove_stream(b);
+    auto c = mixer.add_stream("default");
+    ASSERT_EQ(c->write(reinterpret_cast<const uint8_t*>(quiet.data()), frames), frames);
+    c->set_ducking(true);
+    for (int i = 0; i < 40; i++) ASSERT_TRUE(mixer.pump());
+    EXPECT_NEAR(last_sample(), 1000 + 20000 * AudioMixer::kDuckGain, 2);
+
+    // A paused: only C is heard
+    a->set_paused(true);
+    ASSERT_TRUE(mixer.pump());
+    EXPECT_EQ(last_sample(), 1000);
+
+    mixer.remove_stream(a);
+    mixer.remove_stream(c);
+    EXPECT_FALSE(mixer.is_open());
+    EXPECT_EQ(g_alsa_mock.state, PcmState::CLOSED);
+}
+
+// 13. Underruns and recovery are handled once, in the mixer
+TEST_F(VideoDecoderTest, MixerRecoversFromUnderrun) {
+    AudioMixer mixer(false);
+    auto s = mixer.add_stream("default");
+    ASSERT_TRUE(s);
+    std::vector<int16_t> tone(s->rate() * 2, 500);
+    s->write(reinterpret_cast<const uint8_t*>(tone.data()), s->rate());
+
+    g_alsa_mock.simulate_underrun = true;
+    EXPECT_FALSE(mixer.pump());
+    EXPECT_EQ(mixer.stats().underruns, 1u);
+    EXPECT_EQ(g_alsa_mock.state, PcmState::PREPARED);
+    // The block that hit the underrun is written on the next cycle
+    EXPECT_TRUE(mixer.pump());
+    EXPECT_GT(mixer.stats().frames_written, 0u);
+    mixer.remove_stream(s);
+}
+
+// 14. A single-item playlist wraps around in place instead of reloading the codec
+TEST_F(VideoDecoderTest, SingleItemPlaylistLoopsInPlace) {
+    std::string clip = "tests/loop_clip.mp4";
+    if (!std::filesystem::exists(clip)) {
+        system(("ffmpeg -f lavfi -i color=c=blue:s=160x120:r=25 -frames:v 1 -c:v libx264 " + clip + " -y >/dev/null 2>&1").c_str());
+    }
+    VideoDecoder decoder;
+    decoder.load_playlist({clip});
+    ASSERT_TRUE(decoder.is_loaded());
+
+    // One frame per iteration, so the frame queue never fills before the drain completes
+    for (int i = 0; i < 20 && decoder.loops_completed() == 0; i++) {
+        ASSERT_TRUE(decoder.process(0.04 * i).has_value());
+    }
+    EXPECT_GE(decoder.loops_completed(), 1u);
+    EXPECT_TRUE(decoder.is_loaded());
+}
+
+// 15. Network sources open on the decode thread: load() returns at once, process() connects
+TEST_F(VideoDecoderTest, HttpSourceConnectsFromProcess) {
+    LocalHttpServer server(test_video_path_);
+    NetworkSourceOptions options;
+    options.jitter_buffer_ms = 200;
+
+    VideoDecoder decoder;
+    decoder.set_network_options(options);
+    auto start = std::chrono::steady_clock::now();
+    ASSERT_TRUE(decoder.load(server.url("dummy_video.mp4")).has_value());
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(100));
+    EXPECT_TRUE(decoder.is_loaded());
+
+    for (int i = 0; i < 100 && decoder.decoded_bytes_per_frame() == 0; i++) {
+        ASSERT_TRUE(decoder.process(0.033 * i).has_value());
+    }
+    EXPECT_GT(decoder.decoded_bytes_per_frame(), 0u);
+    EXPECT_EQ(decoder.reconnects(), 0u);
+}
+
+// 16. A server that accepts but never answers can't hold open() past its deadline
+TEST_F(VideoDecoderTest, SilentServerTimesOut) {
+    LocalHttpServer server(test_video_path_, true);
+    NetworkSourceOptions options;
+    options.open_timeout_ms = 300;
+
+    ContainerReader reader;
+    reader.set_network_options(options);
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_FALSE(reader.open(server.url("dummy_video.mp4")).has_value());
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(2));
+    EXPECT_TRUE(reader.is_network());
+}
+
+// 17. Suspend frees the codec and the mixer stream; resume reopens at the saved position
+TEST_F(VideoDecoderTest, SuspendReleasesAndResumesInPlace) {
+    VideoDecoder decoder;
+    decoder.set_audio_enabled(true);
+    decoder.init_audio("default");
+    decoder.load_playlist({test_video_path_});
+    ASSERT_TRUE(decoder.is_loaded());
+    decoder.skip_forward(0.5);
+    for (int i = 0; i < 5; i++) {
+        ASSERT_TRUE(decoder.process(0.033 * i).has_value());
+    }
+
+    decoder.suspend();
+    EXPECT_TRUE(decoder.is_suspended());
+    EXPECT_FALSE(decoder.is_loaded());
+    EXPECT_FALSE(AudioMixer::shared().is_open());
+    EXPECT_EQ(decoder.buffer_fill().packets, 0u);
+
+    decoder.resume();
+    EXPECT_FALSE(decoder.is_suspended());
+    ASSERT_TRUE(decoder.is_loaded());
+    EXPECT_TRUE(AudioMixer::shared().is_open());
+    for (int i = 0; i < 5; i++) {
+        EXPECT_TRUE(decoder.process(0.033 * i).has_value());
+    }
+}
+
+// 18. Scan keys cycle 2x..16x and back; scanning decodes keyframes and mutes audio
+TEST_F(VideoDecoderTest, ScanCyclesSpeedsOverKeyframes) {
+    // A keyframe every second (the shared sample only has one), so the scan has somewhere to go
+    const std::string scan_path = "tests/dummy_video_gop1s.mp4";
+    if (!std::filesystem::exists(scan_path)) {
+        system(("ffmpeg -f lavfi -i color=c=black:s=320x240:d=10.0 -f lavfi -i anullsrc=r=48000:cl=stereo -c:v libx264 -g 25 -c:a aac -shortest " + scan_path + " -y >/dev/null 2>&1").c_str());
+    }
+    VideoDecoder decoder;
+    decoder.set_audio_enabled(true);
+    decoder.init_audio("default");
+    decoder.load_playlist({scan_path});
+    ASSERT_TRUE(decoder.is_loaded());
+    for (int i = 0; i < 10; i++) {
+        ASSERT_TRUE(decoder.process(0.033 * i).has_value());
+    }
+
+    // The scan clock starts with the first process() after the key press. The queued
+    // keyframe is the last one the position (start + speed x elapsed) has passed.
+    auto scan_for = [&](double from, double seconds, double expected_sec) {
+        double last = decoder.next_frame_sec();
+        for (double t = 0.0; t <= seconds + 1e-9; t += 0.25) {
+            ASSERT_TRUE(decoder.process(from + t).has_value());
+            double pos = decoder.next_frame_sec();
+            if (pos < 0.0) continue;
+            // Never against the scan direction
+            if (last >= 0.0) EXPECT_TRUE(decoder.scan_speed() > 0 ? pos >= last : pos <= last) << pos << " after " << last;
+            last = pos;
+        }
+        EXPECT_LE(last, expected_sec + 0.05);
+        EXPECT_GT(last, expected_sec - 1.05); // Within one keyframe interval
+        // Muted and nothing converted while scanning
+        EXPECT_EQ(decoder.stats().audio_buffer_ms, 0.0);
+    };
+
+    decoder.scan(1);
+    EXPECT_EQ(decoder.scan_speed(), 2);
+    scan_for(10.0, 4.0, 8.0);   // 4 s at 2x from 0 s
+    decoder.scan(-1);
+    EXPECT_EQ(decoder.scan_speed(), -2);
+    scan_for(20.0, 2.0, 4.0);   // 2 s at -2x from the keyframe at 8 s
+    decoder.scan(-1);
+    decoder.scan(-1);
+    decoder.scan(-1);
+    EXPECT_EQ(decoder.scan_speed(), -16);
+    for (int i = 0; i < 10; i++) {
+        ASSERT_TRUE(decoder.process(30.0 + 0.5 * i).has_value());
+    }
+    // One more press past 16x plays normally again
+    decoder.scan(-1);
+    EXPECT_EQ(decoder.scan_speed(), 0);
+
+    decoder.scan(1);
+    decoder.stop_scan();
+    EXPECT_EQ(decoder.scan_speed(), 0);
+    EXPECT_TRUE(decoder.process(40.0).has_value());
+}
+
+// 19. Backends are probed in order; ones without a device or a decoder for the codec are passed over
+TEST_F(VideoDecoderTest, BackendsFallBackInPriorityOrder) {
+    for (auto kind : {DecodeBackendKind::Vaapi, DecodeBackendKind::V4l2M2m,
+                      DecodeBackendKind::DrmPrime, DecodeBackendKind::Software}) {
+        EXPECT_EQ(decode_backend_from_name(decode_backend_name(kind)), kind);
+    }
+    EXPECT_FALSE(decode_backend_from_name("cuda").has_value());
+    EXPECT_EQ(default_decode_backends().back(), DecodeBackendKind::Software);
+
+    VideoDecoder decoder;
+    EXPECT_STREQ(decoder.backend_name(), "none");
+    ASSERT_TRUE(decoder.init_backends(DecodeDevices{}, default_decode_backends()).has_value());
+    ASSERT_TRUE(decoder.load(test_video_path_).has_value());
+    // Whichever backend took the stream decodes it
+    for (int i = 0; i < 10; i++) {
+        EXPECT_TRUE(decoder.process(0.033 * i).has_value());
+    }
+    EXPECT_TRUE(decoder.is_loaded());
+    EXPECT_STRNE(decoder.backend_name(), "none");
+
+    // An empty order leaves nothing to decode with
+    VideoDecoder none;
+    EXPECT_FALSE(none.init_backends(DecodeDevices{}, {}).has_value());
+}
+
+// 20. stats() reports decode progress and latency without a render loop
+TEST_F(VideoDecoderTest, StatsSnapshotTracksDecoding) {
+    VideoDecoder decoder;
+    VideoDecoderStats idle = decoder.stats();
+    EXPECT_STREQ(idle.backend, "none");
+    EXPECT_EQ(idle.frames_decoded, 0u);
+
+    ASSERT_TRUE(decoder.load(test_video_path_).has_value());
+    for (int i = 0; i < 20; i++) {
+        ASSERT_TRUE(decoder.process(0.033 * i).has_value());
+    }
+    VideoDecoderStats s = decoder.stats();
+    EXPECT_STREQ(s.backend, "sw");
+    EXPECT_FALSE(s.hardware);
+    EXPECT_GT(s.frames_decoded, 0u);
+    EXPECT_EQ(s.decode.count, s.frames_decoded);
+    EXPECT_LE(s.decode.p50_ms, s.decode.p99_ms);
+    EXPECT_EQ(s.frames_presented, 0u); // Nothing rendered yet
+    EXPECT_FALSE(s.audio);
+
+    // A new item starts from zero
+    ASSERT_TRUE(decoder.load(test_video_path_).has_value());
+    EXPECT_EQ(decoder.stats().frames_decoded, 0u);
+    EXPECT_EQ(decoder.stats().decode.count, 0u);
+}
+
+// Software decode posing as a hardware backend, so the fallback can be driven without a device:
+// either without a decoder for the stream, or one that drops it after the first frame
+class ScriptedBackend : public DecodeBackend {
+public:
+    ScriptedBackend(DecodeBackendKind kind, bool has_decoder, bool stays_active)
+        : kind_(kind), has_decoder_(has_decoder), stays_active_(stays_active) {}
+
+    DecodeBackendKind kind() const override { return this->kind_; }
+    const AVCodec* find_decoder(const AVCodecParameters* params) const override {
+        return this->has_decoder_ ? avcodec_find_decoder(params->codec_id) : nullptr;
+    }
+    void configure(AVCodecContext* ctx, const DecodeSetup& setup) override { (void)ctx; (void)setup; }
+    bool active(const AVCodecContext* ctx) const override { (void)ctx; return this->stays_active_; }
+
+private:
+    DecodeBackendKind kind_;
+    bool has_decoder_;
+    bool stays_active_;
+};
+
+// 21. A backend that opens but drops the stream hands it to the next one that can decode it
+TEST_F(VideoDecoderTest, DecliningBackendReopensWithNext) {
+    std::vector<std::unique_ptr<DecodeBackend>> backends;
+    backends.push_back(std::make_unique<ScriptedBackend>(DecodeBackendKind::DrmPrime, false, true));
+    backends.push_back(std::make_unique<ScriptedBackend>(DecodeBackendKind::Vaapi, true, false));
+    backends.push_back(std::make_unique<ScriptedBackend>(DecodeBackendKind::V4l2M2m, false, true));
+    backends.push_back(DecodeBackend::create(DecodeBackendKind::Software));
+
+    VideoDecoder decoder;
+    ASSERT_TRUE(decoder.init_backends(std::move(backends)).has_value());
+    ASSERT_TRUE(decoder.load(test_video_path_).has_value());
+    // No decoder for the codec: passed over at open
+    EXPECT_STREQ(decoder.backend_name(), "vaapi");
+
+    // process() only flags the fallback; the render thread applies it between tasks
+    for (int i = 0; i < 20 && !decoder.backend_fallback_pending(); i++) {
+        ASSERT_TRUE(decoder.process(0.033 * i).has_value());
+    }
+    ASSERT_TRUE(decoder.backend_fallback_pending());
+    EXPECT_STREQ(decoder.backend_name(), "vaapi");
+    EXPECT_EQ(decoder.stats().frames_decoded, 0u); // The dropped frame never reached the queue
+    decoder.apply_backend_fallback();
+    EXPECT_FALSE(decoder.backend_fallback_pending());
+    EXPECT_STREQ(decoder.backend_name(), "sw");
+    EXPECT_TRUE(decoder.is_loaded());
+
+    for (int i = 0; i < 20; i++) {
+        ASSERT_TRUE(decoder.process(0.033 * i).has_value());
+    }
+    EXPECT_FALSE(decoder.backend_fallback_pending());
+    EXPECT_STREQ(decoder.backend_name(), "sw");
+    EXPECT_GT(decoder.stats().frames_decoded, 0u);
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
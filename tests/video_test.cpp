@@ -11,7 +11,7 @@ using namespace nuc_display::modules;
 static int setup_vaapi(VideoDecoder& decoder) {
     int drm_fd = open("/dev/dri/renderD128", O_RDWR);
     if (drm_fd >= 0) {
-        auto init_res = decoder.init_vaapi(drm_fd);
+        auto init_res = decoder.init_backends(DecodeDevices{}, {DecodeBackendKind::Vaapi, DecodeBackendKind::Software});
         if (!init_res) {
             close(drm_fd);
             return -1;